@@ -0,0 +1,98 @@
+/**
+ * @file BenchReport.hpp
+ * @brief Result collection for the QNX Remote Process Monitor benchmarks
+ *
+ * Both the microbenchmarks and the load generator report through this
+ * file. Every result is written as one JSON object per line, so runs can be
+ * appended to a file and compared across releases with standard tools.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qnx {
+/**
+ * @class LatencySamples
+ * @brief Every latency observed by one benchmark, for exact percentiles
+ */
+class LatencySamples {
+public:
+  void add(std::chrono::steady_clock::duration duration) {
+    samples_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+    sorted_ = false;
+  }
+
+  void merge(const LatencySamples &other) {
+    samples_.insert(samples_.end(), other.samples_.begin(),
+                    other.samples_.end());
+    sorted_ = false;
+  }
+
+  size_t size() const noexcept { return samples_.size(); }
+
+  /**
+   * @brief Get a percentile of the samples
+   * @param percentile In [0, 100]
+   * @return The sample at that rank in microseconds, 0 if there are none
+   */
+  double percentileUs(double percentile) const;
+
+  /**
+   * @brief Get the mean of the samples in microseconds
+   */
+  double meanUs() const;
+
+private:
+  mutable std::vector<int64_t> samples_; ///< Nanoseconds; sorted lazily
+  mutable bool sorted_ = false;
+};
+
+/**
+ * @struct BenchResult
+ * @brief Outcome of one benchmark at one parameter setting
+ */
+struct BenchResult {
+  std::string name; ///< e.g. "collect_synthetic" or "command"
+  /// Parameters that distinguish runs of the same benchmark
+  std::vector<std::pair<std::string, std::string>> params;
+  uint64_t operations = 0; ///< Operations timed
+  uint64_t errors = 0;     ///< Operations that failed
+  std::chrono::steady_clock::duration elapsed{};
+  LatencySamples latency;
+};
+
+/**
+ * @class BenchReporter
+ * @brief Writes results as JSON lines
+ */
+class BenchReporter {
+public:
+  /**
+   * @param out Stream receiving one line per result
+   * @param suite Name of the executable's suite, e.g. "micro" or "load"
+   * @param label Free-form run label, e.g. a release tag; may be empty
+   */
+  BenchReporter(std::ostream &out, std::string suite, std::string label);
+
+  /**
+   * @brief Write one result line and flush it
+   * @param result The result
+   */
+  void report(const BenchResult &result);
+
+private:
+  std::ostream &out_;
+  std::string suite_;
+  std::string label_;
+  std::string host_;
+  int64_t started_; ///< Run start, seconds since the epoch
+};
+} // namespace qnx
@@ -0,0 +1,231 @@
+/**
+ * @file BinaryProtocol.hpp
+ * @brief Compact binary response encoding for the QNX Remote Process Monitor
+ *
+ * Clients that log in with "encoding": "binary" (over length-prefixed
+ * framing) receive the process table, delta and history responses as binary
+ * records instead of JSON text. Other commands keep answering in JSON; a
+ * client tells the two apart by the first byte of the frame body ('{' for
+ * JSON, 'Q' for binary).
+ *
+ * All fixed-width integers are little-endian. "varint" is unsigned LEB128,
+ * "svarint" a zigzag-encoded varint. PIDs are written as svarint deltas from
+ * the previous PID in the same section (starting from 0), so sorted PID
+ * lists cost one or two bytes each.
+ *
+ * @code
+ * frame:    "QB" u8 version(1) u8 type body
+ * row:      svarint pid-delta, then for each bit set in the field mask, in
+ *           ProcessField order:
+ *             parent_pid       svarint (parent_pid - pid)
+ *             name             varint length, bytes (not escaped)
+ *             cpu_usage        u32, hundredths of a percent
+ *             memory_usage_kb  u32
+ *             threads          u16
+ *             priority         u8
+ *             policy           u8
+ *             state            u8
+ *
+ * PROCESS_TABLE   u64 generation, u32 total, u16 field mask, u32 n, n rows
+ * PROCESS_DELTA   u64 generation, u8 full
+ *                 full:  u16 field mask, u32 n, n rows
+ *                 delta: u64 base, u16 field mask,
+ *                        u32 n, n added rows,
+ *                        u32 n, n svarint removed pid-deltas,
+ *                        u32 n, n changes
+ *   change:       svarint pid-delta, u8 mask (1 cpu, 2 memory, 4 threads,
+ *                 8 priority, 16 state), then for each set bit:
+ *                 cpu svarint delta (hundredths), memory svarint delta (KB),
+ *                 threads svarint delta, priority u8, state u8
+ * PROCESS_UPDATE  as PROCESS_DELTA; pushed to delta subscriptions, based on
+ *                 the generation of the previous push
+ * PROCESS_HISTORY varint pid, u32 n, n entries of:
+ *                 svarint timestamp delta (s), u32 cpu (hundredths),
+ *                 svarint memory delta (KB)
+ * PROCESS_HISTORY_RANGE varint pid, u32 resolution (s), u32 n, n points of:
+ *                 svarint timestamp delta (s),
+ *                 u32 cpu min, u32 cpu avg, u32 cpu max (hundredths),
+ *                 svarint memory avg delta (KB),
+ *                 varint avg - min (KB), varint max - avg (KB)
+ * @endcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+namespace qnx {
+struct ProcessInfo;
+
+namespace BinaryProtocol {
+/// Protocol version written in every frame header
+constexpr uint8_t VERSION = 1;
+
+/**
+ * @enum MessageType
+ * @brief Body layout of a binary frame
+ */
+enum class MessageType : uint8_t {
+  ProcessTable = 1,
+  ProcessDelta = 2,
+  ProcessHistory = 3,
+  ProcessHistoryRange = 4,
+  ProcessUpdate = 5,
+};
+
+/// Bits of a change record's mask
+enum ChangeBits : uint8_t {
+  CHANGE_CPU = 1u << 0,
+  CHANGE_MEMORY = 1u << 1,
+  CHANGE_THREADS = 1u << 2,
+  CHANGE_PRIORITY = 1u << 3,
+  CHANGE_STATE = 1u << 4,
+};
+
+/**
+ * @brief Convert a CPU percentage to the wire's hundredths of a percent
+ */
+uint32_t cpuToWire(double cpu_usage) noexcept;
+
+/**
+ * @class Writer
+ * @brief Appends little-endian binary fields to a caller-owned buffer
+ */
+class Writer {
+public:
+  explicit Writer(std::string &out) noexcept : out_(out) {}
+
+  void putU8(uint8_t value) { out_ += static_cast<char>(value); }
+  void putU16(uint16_t value);
+  void putU32(uint32_t value);
+  void putU64(uint64_t value);
+  void putVarint(uint64_t value);
+  void putSvarint(int64_t value);
+  void putBytes(std::string_view bytes);
+
+  /**
+   * @brief Write a frame header
+   * @param type The body layout that follows
+   */
+  void putHeader(MessageType type);
+
+  /**
+   * @brief Reserve a u32 to be filled in later (e.g. a record count)
+   * @return Offset to pass to patchU32()
+   */
+  size_t reserveU32();
+
+  /**
+   * @brief Fill in a u32 reserved with reserveU32()
+   */
+  void patchU32(size_t offset, uint32_t value);
+
+  /**
+   * @brief Write one process row
+   *
+   * @param info The process to write
+   * @param fields ProcessField bitmask of the columns to include
+   * @param previous_pid PID of the previous row in the section; updated
+   */
+  void putProcessRow(const ProcessInfo &info, unsigned fields,
+                     pid_t &previous_pid);
+
+  /**
+   * @brief Write the fields of a process that changed between two samples
+   *
+   * @param before The base sample
+   * @param after The current sample
+   * @param previous_pid PID of the previous change record; updated if a
+   * record is written
+   * @return false (and nothing written) if no field changed
+   */
+  bool putProcessChange(const ProcessInfo &before, const ProcessInfo &after,
+                        pid_t &previous_pid);
+
+private:
+  std::string &out_;
+};
+
+/**
+ * @struct ProcessChange
+ * @brief One decoded change record; a field is only set if its bit is
+ */
+struct ProcessChange {
+  pid_t pid = 0;
+  uint8_t mask = 0;         ///< ChangeBits
+  int64_t cpu_delta = 0;    ///< Hundredths of a percent
+  int64_t memory_delta = 0; ///< KB
+  int64_t threads_delta = 0;
+  uint8_t priority = 0;
+  uint8_t state = 0;
+
+  /**
+   * @brief Apply the change to the sample it was computed against
+   * @param info The base sample; updated in place
+   */
+  void applyTo(ProcessInfo &info) const noexcept;
+};
+
+/**
+ * @class Reader
+ * @brief Reads the fields written by Writer back out of a received frame
+ *
+ * Reading past the end of the frame yields zeros and marks the reader
+ * failed, so a record can be decoded field by field and checked once.
+ */
+class Reader {
+public:
+  explicit Reader(std::string_view in) noexcept : in_(in) {}
+
+  uint8_t getU8();
+  uint16_t getU16();
+  uint32_t getU32();
+  uint64_t getU64();
+  uint64_t getVarint();
+  int64_t getSvarint();
+  std::string_view getBytes(size_t length);
+
+  /**
+   * @brief Read a frame header
+   * @param type Receives the body layout that follows
+   * @return false if this is not a binary frame of a known version
+   */
+  bool getHeader(MessageType &type);
+
+  /**
+   * @brief Read one process row
+   *
+   * Columns not in the field mask are left unchanged.
+   *
+   * @param info Receives the row; its name views the frame
+   * @param fields ProcessField bitmask the rows were written with
+   * @param previous_pid PID of the previous row in the section; updated
+   */
+  void getProcessRow(ProcessInfo &info, unsigned fields, pid_t &previous_pid);
+
+  /**
+   * @brief Read one change record
+   *
+   * @param change Receives the record
+   * @param previous_pid PID of the previous change record; updated
+   */
+  void getProcessChange(ProcessChange &change, pid_t &previous_pid);
+
+  /// Whether a read ran past the end of the frame
+  bool failed() const noexcept { return failed_; }
+  /// Bytes not read yet
+  size_t remaining() const noexcept { return in_.size() - pos_; }
+
+private:
+  bool take(size_t length);
+
+  std::string_view in_;
+  size_t pos_ = 0;
+  bool failed_ = false;
+};
+} // namespace BinaryProtocol
+} // namespace qnx
@@ -0,0 +1,134 @@
+/**
+ * @file BoundedQueue.hpp
+ * @brief Lock-free bounded multi-producer/multi-consumer queue
+ *
+ * This file defines a fixed-capacity MPMC ring queue (after Dmitry Vyukov's
+ * bounded queue). Each cell carries a sequence number that tells producers
+ * and consumers whether it is free or full, so push and pop are a single
+ * CAS on the shared position in the uncontended case and never take a lock.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace qnx {
+/**
+ * @class BoundedQueue
+ * @brief Fixed-capacity lock-free MPMC queue
+ *
+ * tryPush() fails instead of blocking when the queue is full, which lets
+ * callers apply back-pressure.
+ *
+ * @tparam T Element type; must be default constructible and movable
+ */
+template <typename T> class BoundedQueue {
+public:
+  /**
+   * @brief Create a queue
+   * @param capacity Requested capacity, rounded up to a power of two
+   */
+  explicit BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_ = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  /**
+   * @brief Append an element unless the queue is full
+   * @param value The element to move into the queue
+   * @return true if the element was queued
+   */
+  bool tryPush(T &&value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Remove the oldest element unless the queue is empty
+   * @param value Receives the element
+   * @return true if an element was removed
+   */
+  bool tryPop(T &value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Approximate number of queued elements
+   * @return The element count at some recent point in time
+   */
+  size_t sizeApprox() const noexcept {
+    size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+    size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  /**
+   * @brief Get the queue capacity
+   * @return Maximum number of elements
+   */
+  size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence{0};
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_ = 0;
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+} // namespace qnx
@@ -0,0 +1,272 @@
+/**
+ * @file FleetGateway.hpp
+ * @brief Multi-target aggregation for the QNX Remote Process Monitor
+ *
+ * In gateway mode the server does not monitor its own host. It keeps one
+ * persistent connection to each upstream server, subscribes to that
+ * server's process table as binary deltas and mirrors it into a
+ * ProcessSnapshot of its own. The mirrors are published together as an
+ * immutable FleetSnapshot, keyed by (node, pid), so cross-node queries such
+ * as the busiest processes of the fleet or totals per executable are
+ * answered from memory without asking any upstream.
+ */
+
+#pragma once
+
+#include "server/MessageFraming.hpp"
+#include "server/ProcessCore.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace qnx {
+/**
+ * @struct UpstreamTarget
+ * @brief One server the gateway aggregates
+ */
+struct UpstreamTarget {
+  std::string name; ///< Node name reported to clients
+  std::string host; ///< Address or host name
+  int port = 8080;
+};
+
+/**
+ * @brief Parse an upstream given as "[name=]host[:port]"
+ *
+ * @param spec The specification; the name defaults to "host:port"
+ * @return The target, or std::nullopt if the specification is malformed
+ */
+std::optional<UpstreamTarget> parseUpstreamTarget(std::string_view spec);
+
+/**
+ * @struct GatewayConfig
+ * @brief What the gateway connects to and how it logs in
+ */
+struct GatewayConfig {
+  std::vector<UpstreamTarget> upstreams;
+  std::string username; ///< Account on every upstream (any user type)
+  std::string password;
+  std::chrono::milliseconds interval{1000}; ///< Push interval to ask for
+};
+
+/**
+ * @enum UpstreamState
+ * @brief Progress of one upstream connection
+ */
+enum class UpstreamState {
+  Disconnected, ///< Waiting to retry
+  Connecting,   ///< TCP connect in progress
+  LoggingIn,    ///< Login sent, waiting for the reply
+  Subscribing,  ///< Delta subscription sent, waiting for the reply
+  Streaming     ///< Receiving updates
+};
+
+/**
+ * @brief Name of a state as reported to clients
+ */
+const char *upstreamStateName(UpstreamState state) noexcept;
+
+/**
+ * @struct FleetGroup
+ * @brief Totals over the processes of one executable name
+ */
+struct FleetGroup {
+  std::string_view name;         ///< Interned
+  std::string_view escaped_name; ///< JSON-escaped name; empty if none needed
+  ResourceTotals totals;
+  uint32_t num_nodes = 0; ///< Nodes running at least one such process
+};
+
+/**
+ * @struct FleetNode
+ * @brief One upstream as of a fleet generation; immutable once published
+ */
+struct FleetNode {
+  std::string name;
+  std::string address; ///< "host:port"
+  UpstreamState state = UpstreamState::Disconnected;
+  /// Mirrored table, never null; its generation is the upstream's. Empty
+  /// while the node is not streaming.
+  ProcessSnapshotPtr table;
+  std::vector<uint32_t> by_cpu; ///< Rows of table, busiest first
+  /// StringTable id of a name -> totals over this node's rows
+  std::unordered_map<uint32_t, FleetGroup> groups;
+  ResourceTotals totals;  ///< Over every row of table
+  uint64_t updates = 0;    ///< Updates applied since the gateway started
+  uint64_t reconnects = 0; ///< Connections lost or attempts failed
+  std::chrono::steady_clock::time_point updated; ///< Last update received
+  std::string last_error; ///< Why the connection last dropped
+};
+
+using FleetNodePtr = std::shared_ptr<const FleetNode>;
+
+/**
+ * @struct FleetRow
+ * @brief A process of the fleet view
+ */
+struct FleetRow {
+  uint32_t node;           ///< Index into FleetSnapshot::nodes
+  const ProcessInfo *info; ///< Valid while the snapshot is held
+};
+
+/**
+ * @struct FleetSnapshot
+ * @brief Immutable view of every upstream, published by the gateway thread
+ *
+ * Nodes that did not change since the previous generation are shared with
+ * it, so a publication costs O(nodes + names) plus the rebuild of the
+ * nodes that did.
+ */
+struct FleetSnapshot {
+  uint64_t generation = 0; ///< Monotonic publication counter
+  std::chrono::steady_clock::time_point timestamp;
+  std::vector<FleetNodePtr> nodes; ///< In configuration order
+  /// StringTable id of a name -> totals over every node
+  std::unordered_map<uint32_t, FleetGroup> groups;
+  ResourceTotals totals; ///< Over every node
+
+  /**
+   * @brief Look a node up by name
+   * @return Its index, or std::nullopt if there is no such node
+   */
+  std::optional<uint32_t> findNode(std::string_view name) const;
+
+  /**
+   * @brief Look up a process of one node without copying it
+   * @return Pointer into the node's table, or nullptr if it is not present
+   */
+  const ProcessInfo *find(uint32_t node, pid_t pid) const noexcept;
+
+  /**
+   * @brief The busiest processes across all nodes
+   * @param count Number of rows wanted
+   * @return Up to count rows, busiest first. Costs
+   * O(nodes + count log nodes).
+   */
+  std::vector<FleetRow> topCpu(size_t count) const;
+};
+
+using FleetSnapshotPtr = std::shared_ptr<const FleetSnapshot>;
+
+/**
+ * @struct UpstreamLink
+ * @brief Connection and mirror of one upstream
+ *
+ * Only the gateway thread touches a link; readers see it through the
+ * FleetNode it last published.
+ */
+struct UpstreamLink {
+  /// Largest frame accepted from an upstream (a full table)
+  static constexpr size_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+  explicit UpstreamLink(UpstreamTarget target);
+
+  UpstreamTarget target;
+  int fd = -1;
+  UpstreamState state = UpstreamState::Disconnected;
+  FrameDecoder decoder{Framing::LengthPrefixed, MAX_FRAME_SIZE};
+  std::string out;       ///< Framed requests not yet written
+  size_t out_offset = 0; ///< Bytes of out already written
+  std::chrono::steady_clock::time_point retry_at; ///< Next connect attempt
+  std::chrono::steady_clock::time_point last_frame; ///< For the timeout
+  std::chrono::milliseconds backoff;
+
+  /// Mirror of the upstream's table, and the one it replaced, which is
+  /// reused as the next build buffer once no reader holds it
+  std::shared_ptr<ProcessSnapshot> table;
+  std::shared_ptr<ProcessSnapshot> spare;
+  std::vector<uint8_t> dropped; ///< Per-row scratch flags, reused
+
+  FleetNodePtr node; ///< What was last published for this link
+  bool dirty = true; ///< Node needs republishing
+  uint64_t updates = 0;
+  uint64_t reconnects = 0;
+  std::chrono::steady_clock::time_point updated;
+  std::string last_error;
+};
+
+/**
+ * @class FleetGateway
+ * @brief Maintains the fleet view from persistent upstream connections
+ *
+ * This singleton runs one thread that drives every upstream connection
+ * with poll(): it connects, logs in with binary encoding, subscribes to
+ * delta updates and applies each push to the upstream's mirror. Failed
+ * connections are retried with exponential backoff; the full table sent on
+ * resubscribing resynchronises the mirror.
+ */
+class FleetGateway {
+public:
+  /**
+   * @brief Get the singleton instance of FleetGateway
+   * @return Reference to the singleton instance
+   */
+  static FleetGateway &getInstance();
+
+  // Delete copy and move constructors/operators
+  FleetGateway(const FleetGateway &) = delete;
+  FleetGateway &operator=(const FleetGateway &) = delete;
+  FleetGateway(FleetGateway &&) = delete;
+  FleetGateway &operator=(FleetGateway &&) = delete;
+
+  /**
+   * @brief Start aggregating the configured upstreams
+   * @param config The upstreams and credentials
+   * @return false if already running or no upstream was given
+   */
+  bool start(GatewayConfig config);
+
+  /**
+   * @brief Close every upstream connection and stop the gateway thread
+   */
+  void stop();
+
+  /**
+   * @brief Whether the server is running as a gateway
+   */
+  bool isRunning() const noexcept;
+
+  /**
+   * @brief Get the current fleet view
+   * @return The latest published snapshot; empty, never null, before the
+   * gateway has started
+   */
+  FleetSnapshotPtr getSnapshot() const noexcept;
+
+private:
+  FleetGateway() = default;
+  ~FleetGateway();
+
+  void run();
+  void connect(UpstreamLink &link, std::chrono::steady_clock::time_point now);
+  void fail(UpstreamLink &link, const std::string &error,
+            std::chrono::steady_clock::time_point now);
+  void login(UpstreamLink &link);
+  void queueRequest(UpstreamLink &link, const std::string &payload);
+  bool flush(UpstreamLink &link);
+  bool receive(UpstreamLink &link, std::chrono::steady_clock::time_point now);
+  bool handleFrame(UpstreamLink &link, const std::string &frame,
+                   std::chrono::steady_clock::time_point now);
+  bool applyUpdate(UpstreamLink &link, const std::string &frame,
+                   std::chrono::steady_clock::time_point now);
+  void publish(std::chrono::steady_clock::time_point now);
+  static FleetNodePtr buildNode(const UpstreamLink &link);
+
+  GatewayConfig config_;
+  std::vector<UpstreamLink> links_; ///< Gateway thread only
+  uint64_t next_generation_ = 1;
+  // Only accessed through std::atomic_load/atomic_store
+  FleetSnapshotPtr snapshot_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stop_{false};
+};
+} // namespace qnx
@@ -0,0 +1,118 @@
+/**
+ * @file HandlerPool.hpp
+ * @brief Worker threads for command execution in the QNX Remote Process
+ * Monitor
+ *
+ * This file defines the HandlerPool class, a fixed set of threads fed by a
+ * bounded lock-free queue. It lets request handling scale with the number
+ * of cores instead of running on the network thread.
+ */
+
+#pragma once
+
+#include "BoundedQueue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qnx {
+/**
+ * @class HandlerPool
+ * @brief Singleton pool of handler threads
+ *
+ * Jobs are submitted with trySubmit(), which fails when the queue is full so
+ * the caller can stop reading from the network (back-pressure) rather than
+ * buffering without bound. Workers only sleep when the queue is empty.
+ */
+class HandlerPool {
+public:
+  using Job = std::function<void()>;
+
+  /**
+   * @brief Get the singleton instance of HandlerPool
+   * @return Reference to the singleton instance
+   */
+  static HandlerPool &getInstance();
+
+  // Delete copy/move constructors and assignment operators
+  HandlerPool(const HandlerPool &) = delete;
+  HandlerPool &operator=(const HandlerPool &) = delete;
+  HandlerPool(HandlerPool &&) = delete;
+  HandlerPool &operator=(HandlerPool &&) = delete;
+
+  /**
+   * @brief Start the worker threads
+   *
+   * @param threads Number of workers, or 0 for one per CPU
+   * @return true if the pool is running
+   */
+  bool start(unsigned threads = 0);
+
+  /**
+   * @brief Stop accepting jobs, finish the queued ones and join the workers
+   */
+  void stop();
+
+  /**
+   * @brief Check whether the pool has been started
+   * @return true while worker threads are running
+   */
+  bool isRunning() const noexcept { return running_.load(); }
+
+  /**
+   * @brief Queue a job for execution on a worker thread
+   *
+   * @param job The job to run
+   * @return false if the pool is stopped or the queue is full
+   */
+  bool trySubmit(Job job);
+
+  /**
+   * @brief Run a function over [0, count) in chunks spread across workers
+   *
+   * Chunks are claimed from a shared counter by the calling thread and by
+   * helper jobs submitted to idle workers. The caller only waits for chunks
+   * already being run, never for a helper to start, so this is safe to call
+   * from a job and degrades to running inline when the pool is stopped,
+   * busy or full.
+   *
+   * @param count Number of items
+   * @param chunk Items per chunk (at least 1)
+   * @param fn Called as fn(begin, end) for each chunk; must not throw
+   */
+  void parallelFor(size_t count, size_t chunk,
+                   const std::function<void(size_t, size_t)> &fn);
+
+  /**
+   * @brief Get the approximate number of queued jobs
+   * @return Jobs waiting for a worker
+   */
+  size_t queueDepth() const noexcept { return queue_.sizeApprox(); }
+
+  /**
+   * @brief Get the number of worker threads
+   * @return The worker count, 0 when stopped
+   */
+  size_t threadCount() const noexcept { return workers_.size(); }
+
+private:
+  /// Maximum number of queued jobs before trySubmit() pushes back
+  static constexpr size_t QUEUE_CAPACITY = 1024;
+
+  HandlerPool() : queue_(QUEUE_CAPACITY) {}
+  ~HandlerPool();
+
+  void workerLoop();
+
+  BoundedQueue<Job> queue_;
+  std::vector<std::thread> workers_;
+  std::atomic<bool> running_{false};
+  std::mutex sleep_mutex_; ///< Only used to park idle workers
+  std::condition_variable sleep_cv_;
+  std::atomic<size_t> sleeping_{0};
+};
+} // namespace qnx
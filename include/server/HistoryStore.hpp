@@ -0,0 +1,179 @@
+/**
+ * @file HistoryStore.hpp
+ * @brief Persistent, memory-mapped process history for the QNX Remote
+ * Process Monitor
+ *
+ * This file defines the HistoryStore class, an optional on-disk backing for
+ * process history that survives server restarts and target reboots.
+ *
+ * History is appended to segment files, each covering a window of up to
+ * SEGMENT_TICKS ticks. A segment is preallocated (sparse) and mapped, and has
+ * a fixed layout, so it can be used again after a restart without parsing.
+ * Its series capacity is recorded in the header, and is sized from the
+ * process count when the segment is created:
+ *
+ * @code
+ * SegmentHeader                       64 bytes
+ * int64  tick_time[SEGMENT_TICKS]     timestamp shared by every series
+ * SeriesEntry index[series]           (pid, start time) -> column slot
+ * float  cpu[series][SEGMENT_TICKS]
+ * u32    memory_kb[series][SEGMENT_TICKS]
+ * @endcode
+ *
+ * A series is one process's contiguous run of ticks within a segment; a
+ * process that disappears and reappears, or a reused PID, starts a new
+ * series. A sealed
+ * segment's index is sorted by (pid, start time).
+ */
+
+#pragma once
+
+#include "server/ProcessHistory.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+namespace qnx {
+struct ProcessSnapshot;
+
+class HistoryStore {
+public:
+  /// Ticks per segment (ten minutes at the 1 s stats interval)
+  static constexpr uint32_t SEGMENT_TICKS = 600;
+  /// Fewest series slots a segment is created with
+  static constexpr uint32_t MIN_SEGMENT_SERIES = 256;
+  /// Most series slots a segment is created with
+  static constexpr uint32_t MAX_SEGMENT_SERIES = 65536;
+
+  /**
+   * @brief Get the singleton instance of HistoryStore.
+   * @return Reference to the singleton instance.
+   */
+  static HistoryStore &getInstance();
+
+  // Delete copy/move constructors and assignment operators
+  HistoryStore(const HistoryStore &) = delete;
+  HistoryStore &operator=(const HistoryStore &) = delete;
+  HistoryStore(HistoryStore &&) = delete;
+  HistoryStore &operator=(HistoryStore &&) = delete;
+
+  /**
+   * @brief Open the store, mapping the segments already in a directory.
+   *
+   * Segments left unsealed by a crash are sealed. New history goes to a
+   * fresh segment created on the first append.
+   *
+   * @param directory Existing directory holding the segment files.
+   * @param retention How long history is kept; older segments are deleted.
+   * @return true if the store is ready for use.
+   */
+  bool open(const std::string &directory, std::chrono::seconds retention);
+
+  /**
+   * @brief Seal the current segment and unmap everything.
+   */
+  void close();
+
+  /**
+   * @brief Whether open() succeeded and close() has not been called.
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief Append one tick for every process in a snapshot.
+   * @param snapshot The snapshot just published by ProcessCore.
+   */
+  void append(const ProcessSnapshot &snapshot);
+
+  /**
+   * @brief Query stored history over a time range within a point budget.
+   *
+   * Samples are read straight from the mappings. When the range holds
+   * more than max_points samples, runs of adjacent samples are merged into
+   * min/avg/max points.
+   *
+   * @param pid The process ID.
+   * @param from Start of the range (inclusive).
+   * @param to End of the range (inclusive).
+   * @param max_points Maximum number of points to return (at least 1).
+   * @return The resolution and the points, oldest first.
+   */
+  HistoryRange getHistoryRange(pid_t pid, time_t from, time_t to,
+                               size_t max_points) const;
+
+private:
+  HistoryStore() = default;
+  ~HistoryStore();
+
+  /**
+   * @brief Fixed header at the start of every segment file
+   */
+  struct SegmentHeader {
+    char magic[8];         ///< "QRPMHIST"
+    uint32_t version;      ///< Layout version
+    uint32_t ticks;        ///< Tick capacity (SEGMENT_TICKS)
+    uint32_t series;       ///< Series capacity
+    uint32_t sealed;       ///< 1 once complete; index is then sorted
+    int64_t window_start;  ///< Timestamp of the first tick
+    uint32_t tick_count;   ///< Ticks written; bumped after the tick's data
+    uint32_t series_count; ///< Index entries written
+    uint8_t reserved[24];
+  };
+
+  /**
+   * @brief Index entry locating one series in the columns
+   */
+  struct SeriesEntry {
+    int32_t pid;
+    uint32_t slot;       ///< Row of the cpu and memory columns
+    uint64_t start_time; ///< Process start time (ns)
+    uint32_t first_tick; ///< Ticks are positions within the segment
+    uint32_t last_tick;
+  };
+
+  /**
+   * @brief One mapped segment file
+   */
+  struct Segment {
+    ~Segment();
+
+    std::string path;
+    void *base = nullptr;
+    size_t length = 0;
+    SegmentHeader *header = nullptr;
+    int64_t *tick_time = nullptr;
+    SeriesEntry *index = nullptr;
+    float *cpu = nullptr;
+    uint32_t *memory_kb = nullptr;
+  };
+
+  static size_t segmentLength(uint32_t series);
+  static std::unique_ptr<Segment> mapSegment(const std::string &path, int fd);
+  static void sealSegment(Segment &segment);
+  bool startSegment(time_t window_start, uint32_t series);
+  void enforceRetention(time_t now);
+
+  mutable std::shared_mutex mutex_;
+  std::string directory_;
+  std::chrono::seconds retention_{0};
+  bool open_ = false;
+  std::vector<std::unique_ptr<Segment>> segments_; ///< Oldest first
+  /**
+   * @brief A series of current_ that was extended on the last tick
+   */
+  struct ActiveSeries {
+    uint64_t start_time; ///< Process start time the series belongs to
+    uint32_t slot;       ///< Slot of the series in current_
+  };
+
+  Segment *current_ = nullptr; ///< Segment being appended to, if any
+  std::unordered_map<pid_t, ActiveSeries> active_; ///< Keyed by PID
+};
+} // namespace qnx
@@ -1,16 +1,29 @@
 #pragma once
 
+#include "SessionManager.hpp"
 #include "SocketServer.hpp" // Included for client_socket type
 #include <string>
 #include <sys/json.h> // Include QNX JSON header
 
 namespace qnx {
 
+/**
+ * @struct RequestContext
+ * @brief Per-request information made available to command handlers
+ */
+struct RequestContext {
+  int client_socket = -1; ///< Socket of the client that sent the request
+  Session session;        ///< What the client negotiated on login
+};
+
 /**
  * @brief Handles JSON messages received from clients
  *
  * Processes incoming JSON messages, performs the requested operations,
  * and generates appropriate JSON responses using QNX JSON library.
+ * Each message is parsed once. The encoder and decoder are owned by the
+ * calling thread and reused across requests, so concurrent calls from
+ * different handler threads are safe.
  *
  * @param client_socket The socket descriptor for the client connection
  * @param message The JSON message received from the client
@@ -39,12 +52,14 @@ std::string toJson(const std::string &data);
 /**
  * @brief Handles specific JSON command types using QNX JSON library
  *
+ * @param context The client the request came from
  * @param command The command to process
- * @param raw_params_json The raw JSON string containing the parameters
- * @param encoder Pointer to the QNX JSON encoder for building the response
+ * @param decoder Decoder holding the parsed request, positioned inside its
+ * top-level object
+ * @param encoder Reset encoder for building the response
  * @return std::string JSON response
  */
-std::string processCommand(const std::string &command,
-                           const std::string &raw_params_json,
-                           json_encoder_t *encoder);
+std::string processCommand(const RequestContext &context,
+                           const std::string &command,
+                           json_decoder_t *decoder, json_encoder_t *encoder);
 } // namespace qnx
\ No newline at end of file
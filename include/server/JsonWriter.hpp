@@ -0,0 +1,135 @@
+/**
+ * @file JsonWriter.hpp
+ * @brief Direct-to-buffer JSON serializer for high-volume responses
+ *
+ * This file defines JsonWriter, a small streaming serializer that appends
+ * JSON text straight into a caller-owned std::string. It is used for the
+ * responses whose shape is fixed and whose volume is large (process lists
+ * and process rows); the QNX libjson encoder remains in use for everything
+ * else.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace qnx {
+struct ProcessInfo;
+
+/**
+ * @enum ProcessField
+ * @brief Columns of a serialized process row, usable as a bitmask
+ */
+enum ProcessField : unsigned {
+  FIELD_PID = 1u << 0,
+  FIELD_PARENT_PID = 1u << 1,
+  FIELD_NAME = 1u << 2,
+  FIELD_CPU_USAGE = 1u << 3,
+  FIELD_MEMORY_USAGE = 1u << 4,
+  FIELD_THREADS = 1u << 5,
+  FIELD_PRIORITY = 1u << 6,
+  FIELD_POLICY = 1u << 7,
+  FIELD_STATE = 1u << 8,
+};
+
+/// Columns of a row when the client does not ask for specific ones
+constexpr unsigned DEFAULT_FIELDS = FIELD_PID | FIELD_NAME | FIELD_CPU_USAGE |
+                                    FIELD_MEMORY_USAGE | FIELD_THREADS |
+                                    FIELD_PRIORITY | FIELD_STATE;
+
+/**
+ * @brief Map a column name (e.g. "cpu_usage") to its ProcessField bit
+ * @param name The column name as used on the wire
+ * @return The bit, or 0 if the name is unknown
+ */
+unsigned parseProcessField(std::string_view name) noexcept;
+
+/**
+ * @brief Check whether a string contains characters JSON requires escaped
+ * @param value The string to check
+ * @return true if value cannot be written between quotes verbatim
+ */
+bool needsJsonEscape(std::string_view value) noexcept;
+
+/**
+ * @brief Append a string's JSON-escaped contents (without quotes)
+ * @param out Buffer to append to
+ * @param value The string to escape
+ */
+void appendJsonEscaped(std::string &out, std::string_view value);
+
+/**
+ * @brief Return a string's JSON-escaped contents (without quotes)
+ * @param value The string to escape
+ * @return The escaped string
+ */
+std::string jsonEscape(std::string_view value);
+
+/**
+ * @class JsonWriter
+ * @brief Streaming JSON serializer writing into a caller-owned buffer
+ *
+ * Keys are written verbatim and must be plain identifiers; string values
+ * are escaped. Numbers are formatted with std::to_chars, so nothing is
+ * allocated beyond the growth of the output buffer itself. An empty key
+ * denotes an array element.
+ */
+class JsonWriter {
+public:
+  /**
+   * @brief Create a writer appending to out
+   * @param out The output buffer; must outlive the writer
+   */
+  explicit JsonWriter(std::string &out) noexcept : out_(out) {}
+
+  JsonWriter &beginObject(std::string_view key = {});
+  JsonWriter &endObject();
+  JsonWriter &beginArray(std::string_view key = {});
+  JsonWriter &endArray();
+
+  JsonWriter &addInt(std::string_view key, int64_t value);
+  JsonWriter &addUInt(std::string_view key, uint64_t value);
+  JsonWriter &addDouble(std::string_view key, double value);
+  JsonWriter &addBool(std::string_view key, bool value);
+  JsonWriter &addString(std::string_view key, std::string_view value);
+
+  /**
+   * @brief Add a string value that has already been JSON-escaped
+   * @param key The member name, or empty for an array element
+   * @param escaped The escaped contents, without quotes
+   */
+  JsonWriter &addEscapedString(std::string_view key, std::string_view escaped);
+
+  /**
+   * @brief Add one process as an object with the selected columns
+   *
+   * Uses the cached escaped name when the collector provided one.
+   *
+   * @param info The process to write
+   * @param fields ProcessField bitmask of the columns to include
+   * @param key The member name, or empty for an array element
+   */
+  JsonWriter &addProcessRow(const ProcessInfo &info,
+                            unsigned fields = DEFAULT_FIELDS,
+                            std::string_view key = {});
+
+private:
+  /// Maximum nesting depth tracked for comma placement
+  static constexpr int MAX_DEPTH = 32;
+
+  void separator();
+  void writeKey(std::string_view key);
+  void writeValue(int64_t value);
+  void writeValue(uint64_t value);
+  void writeValue(double value);
+  void open(char bracket);
+  void close(char bracket);
+
+  std::string &out_;
+  int depth_ = 0;
+  uint32_t has_members_ = 0; ///< Bit n: container at depth n is non-empty
+};
+} // namespace qnx
@@ -0,0 +1,73 @@
+/**
+ * @file LinuxProcessSource.hpp
+ * @brief Linux /proc process source for the QNX Remote Process Monitor
+ *
+ * Reads each process from /proc/<pid>/stat, which carries everything the
+ * collector needs in one line. The stat descriptor is kept open across
+ * cycles and re-read with pread() into a fixed buffer that is parsed in
+ * place, so a steady-state cycle makes no allocations and one system call
+ * per process. Lets the collector be profiled on Linux test and benchmark
+ * hosts.
+ */
+
+#pragma once
+
+#include "server/ProcessSource.hpp"
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace qnx {
+class LinuxProcessSource : public ProcessSource {
+public:
+  /**
+   * @param proc_root Directory holding one subdirectory per PID
+   */
+  explicit LinuxProcessSource(std::string proc_root = "/proc");
+
+  const char *name() const noexcept override { return "linux"; }
+  void listPids(std::vector<pid_t> &pids) override;
+  std::unique_ptr<Reader> openReader() override;
+
+  /**
+   * @brief Parse one /proc/<pid>/stat line without allocating
+   *
+   * The state is reported as the character code of the state letter.
+   *
+   * @param begin Start of the line
+   * @param end One past its last character
+   * @param tick_ns Nanoseconds per clock tick
+   * @param page_size Bytes per page
+   * @param sample Filled in on success
+   * @return false if the line is truncated or malformed
+   */
+  static bool parseStat(const char *begin, const char *end, uint64_t tick_ns,
+                        uint64_t page_size, ProcessSample &sample);
+
+private:
+  class StatReader : public Reader {
+  public:
+    explicit StatReader(const LinuxProcessSource &source) : source_(source) {}
+    ~StatReader() override;
+
+    size_t readBatch(const pid_t *pids, size_t count,
+                     ProcessSample *out) override;
+    bool readThreads(pid_t pid, std::vector<ThreadSample> &out) override;
+    std::string readName(pid_t pid) override;
+    void forget(pid_t pid) override;
+    void retain(const std::vector<pid_t> &pids) override;
+
+  private:
+    bool readStat(pid_t pid, ProcessSample &sample);
+    bool readStatFile(const char *path, ProcessSample &sample);
+
+    const LinuxProcessSource &source_;
+    std::unordered_map<pid_t, int> stat_fds_; ///< Open /proc/<pid>/stat
+    char buffer_[2048];                      ///< One stat line
+  };
+
+  std::string proc_root_;
+  uint64_t tick_ns_; ///< Nanoseconds per clock tick
+  uint64_t page_size_; ///< Bytes per page
+};
+} // namespace qnx
@@ -0,0 +1,132 @@
+/**
+ * @file MessageFraming.hpp
+ * @brief Stream framing for client connections of the QNX Remote Process
+ * Monitor
+ *
+ * TCP delivers a byte stream, not messages. This file defines the framing
+ * layer that reassembles complete request frames from whatever segments
+ * arrive, and that frames responses the same way the client framed its
+ * requests.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace qnx {
+/**
+ * @enum Framing
+ * @brief Wire framing used by a connection
+ *
+ * The mode is negotiated implicitly by the first byte a client sends:
+ * a JSON document start ('{' or '[') selects Json, anything else selects
+ * LengthPrefixed.
+ */
+enum class Framing {
+  Unknown,       ///< Nothing received yet
+  Json,          ///< Back-to-back JSON documents, optionally '\n'-delimited
+  LengthPrefixed ///< 4-byte big-endian payload length, then the payload
+};
+
+/**
+ * @class FrameDecoder
+ * @brief Per-connection reassembly buffer
+ *
+ * Bytes are appended as they arrive and complete frames are extracted in
+ * order. Consumed bytes are only reclaimed once they make up at least half
+ * of the buffer, so a partial frame is not copied every time more data
+ * arrives. In Json mode the scanner state is kept between calls, so every
+ * byte is scanned exactly once no matter how the frame was split.
+ */
+class FrameDecoder {
+public:
+  /// Largest frame accepted from a client
+  static constexpr size_t MAX_FRAME_SIZE = 1024 * 1024;
+
+  FrameDecoder() = default;
+
+  /**
+   * @brief Create a decoder for a stream whose framing is already known
+   *
+   * Used on upstream connections, where this side chose the framing and a
+   * single frame (a whole process table) may exceed what a client may send.
+   *
+   * @param framing The framing the peer uses
+   * @param max_frame_size Largest frame accepted
+   */
+  FrameDecoder(Framing framing, size_t max_frame_size) noexcept
+      : framing_(framing), max_frame_size_(max_frame_size) {}
+
+  /**
+   * @brief Append received bytes to the reassembly buffer
+   *
+   * @param data Pointer to the received bytes
+   * @param length Number of bytes received
+   */
+  void append(const char *data, size_t length);
+
+  /**
+   * @brief Extract the next complete frame, if any
+   *
+   * @param frame Receives the frame payload (without framing bytes)
+   * @return true if a frame was extracted, false if more data is needed
+   */
+  bool next(std::string &frame);
+
+  /**
+   * @brief Check whether the stream violated the framing rules
+   *
+   * Once set (e.g. a frame exceeded the size limit) the connection cannot
+   * be resynchronised and should be closed.
+   *
+   * @return true if the stream is unusable
+   */
+  bool failed() const noexcept { return failed_; }
+
+  /**
+   * @brief Get the framing mode negotiated for this connection
+   *
+   * @return The framing mode, Unknown until the first byte arrives
+   */
+  Framing framing() const noexcept { return framing_; }
+
+private:
+  bool nextJson(std::string &frame);
+  bool nextLengthPrefixed(std::string &frame);
+  void consume(size_t end);
+
+  std::string buffer_;
+  size_t begin_ = 0; ///< Start of unconsumed data in buffer_
+  Framing framing_ = Framing::Unknown;
+  size_t max_frame_size_ = MAX_FRAME_SIZE;
+  bool failed_ = false;
+
+  // Incremental JSON scanner state (Json mode)
+  size_t scan_pos_ = 0; ///< Next byte to scan
+  size_t frame_start_ = 0;
+  int depth_ = 0;
+  bool in_string_ = false;
+  bool escape_ = false;
+};
+
+/**
+ * @brief Build the bytes that precede a payload on the wire
+ *
+ * @param framing The connection's framing mode
+ * @param payload_size Size of the payload that follows
+ * @return The prefix (the length header, or empty for Json framing)
+ */
+std::string framePrefix(Framing framing, size_t payload_size);
+
+/**
+ * @brief Get the bytes that follow a payload on the wire
+ *
+ * @param framing The connection's framing mode
+ * @return Shared suffix buffer ("\n" for Json framing), or nullptr if the
+ * framing has no suffix
+ */
+std::shared_ptr<const std::string> frameSuffix(Framing framing);
+} // namespace qnx
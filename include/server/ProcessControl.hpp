@@ -3,6 +3,7 @@
 #include <optional>
 #include <string>
 #include <sys/types.h>
+#include <system_error>
 #include <vector>
 
 #ifdef __QNXNTO__
@@ -27,7 +28,20 @@ struct BasicProcessInfo {
   std::optional<std::string> workingDirectory; // Can be optional
 };
 
+// Control operation applied to each target of a batch request
+enum class ControlAction { Suspend, Resume, Terminate, Kill, SetPriority };
+
+// What to do to a process; priority and policy are used by SetPriority only
+struct ControlRequest {
+  ControlAction action;
+  int priority = 0;
+  int policy = 0;
+};
+
 // Function declarations (now directly under qnx)
+std::error_code signalProcess(pid_t pid, int signal);
+std::error_code setScheduling(pid_t pid, int priority, int policy);
+std::error_code applyControl(pid_t pid, const ControlRequest &request);
 bool sendSignal(pid_t pid, int signal);
 bool suspend(pid_t pid);
 bool resume(pid_t pid);
@@ -35,7 +49,8 @@ bool terminate(pid_t pid);
 bool exists(pid_t pid);
 std::optional<pid_t> getParentPid(pid_t pid);
 std::vector<pid_t> getChildProcesses(pid_t pid);
-std::string getCommandLine(pid_t pid);
+std::string getCommandLine(pid_t pid, const std::string &proc_root = "/proc");
 std::optional<std::string> getWorkingDirectory(pid_t pid);
-std::optional<std::string> getProcessExecutablePath(pid_t pid);
+std::optional<std::string>
+getProcessExecutablePath(pid_t pid, const std::string &proc_root = "/proc");
 } // namespace qnx
\ No newline at end of file
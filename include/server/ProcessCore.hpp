@@ -11,17 +11,26 @@
  */
 
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "server/ProcessSource.hpp"
+#include "server/StringTable.hpp"
+
 // POSIX headers
 #include <dirent.h>
 #include <fcntl.h>
@@ -43,18 +52,207 @@ namespace qnx {
 /**
  * @class ProcessInfo
  * @brief Struct representing process information
+ *
+ * Names are interned in the StringTable, so rows own no memory and are
+ * copied memberwise.
  */
 struct ProcessInfo {
   pid_t pid;
   pid_t parent_pid;
-  std::string name;
+  std::string_view name; ///< Interned; valid for the server's lifetime
   int group_id;
-  uint64_t memory_usage;
+  uint64_t memory_usage; ///< Resident memory (bytes)
   double cpu_usage;
   int priority;
   int policy;
   int num_threads;
   int state;
+  uint64_t start_time; ///< Process start time (ns), disambiguates PID reuse
+  std::string_view escaped_name; ///< JSON-escaped name; empty if none needed
+  uint32_t name_id; ///< StringTable id of name; equal ids mean equal names
+};
+
+/**
+ * @struct ThreadInfo
+ * @brief Per-thread sample produced by per-thread CPU accounting
+ */
+struct ThreadInfo {
+  pid_t pid;
+  int tid;
+  double cpu_usage;
+  int priority;
+  int policy;
+  int state;
+};
+
+/**
+ * @struct ThreadSamplingConfig
+ * @brief Selects which processes get per-thread CPU accounting
+ *
+ * Walking every thread costs one read per thread, so it only runs for
+ * processes that used at least cpu_threshold percent in the previous cycle
+ * or that are explicitly watched.
+ */
+struct ThreadSamplingConfig {
+  bool enabled = false;
+  double cpu_threshold = 10.0;       ///< Previous-cycle CPU% that triggers it
+  std::unordered_set<pid_t> watched; ///< Always sampled per thread
+  std::unordered_set<pid_t> explicit_pids; ///< Watched whatever the group
+  int watched_group = -1; ///< Group kept mirrored into watched, -1 = none
+};
+
+/// PID -> process group ID, published by ProcessGroup as an immutable table
+using GroupMembership = std::unordered_map<pid_t, int>;
+
+/**
+ * @struct ResourceTotals
+ * @brief Resource usage summed over a set of processes (a group or subtree)
+ */
+struct ResourceTotals {
+  double cpu_usage = 0.0;
+  uint64_t memory_usage = 0;
+  size_t num_processes = 0;
+};
+
+/**
+ * @struct ProcessSnapshot
+ * @brief Immutable view of the process table produced by one collection pass
+ *
+ * Snapshots are published atomically by ProcessCore::collectInfo() and are
+ * never modified once published. Readers pin a snapshot through
+ * ProcessCore::getSnapshot() and may hold it for as long as they like without
+ * blocking the collector.
+ *
+ * Every container draws from the snapshot's own pool. A recycled snapshot
+ * refills the blocks its previous generation freed, so steady-state
+ * collection does not touch the heap, and when the last reader drops a
+ * snapshot that is not recycled its memory is released in one shot.
+ * Snapshots are built and modified by one thread, before publication.
+ */
+struct ProcessSnapshot {
+  ProcessSnapshot();
+  ProcessSnapshot(const ProcessSnapshot &) = delete;
+  ProcessSnapshot &operator=(const ProcessSnapshot &) = delete;
+
+  /// Backs every container below, so it is declared first
+  std::pmr::unsynchronized_pool_resource arena;
+
+  uint64_t generation = 0; ///< Monotonic collection counter (0 = never run)
+  std::chrono::steady_clock::time_point timestamp; ///< When it was collected
+  std::pmr::vector<ProcessInfo> processes; ///< One entry per live process
+  /// PID -> position in processes
+  std::pmr::unordered_map<pid_t, size_t> index;
+  /// Threads of per-thread sampled processes
+  std::pmr::vector<ThreadInfo> threads;
+  /// Group membership the snapshot was built against
+  std::shared_ptr<const GroupMembership> group_membership;
+  /// Group ID -> totals over the members present in processes
+  std::pmr::unordered_map<int, ResourceTotals> group_totals;
+
+  /// Marks a row without a parent in the snapshot
+  static constexpr uint32_t NO_ROW = UINT32_MAX;
+  /// Row of each row's parent, or NO_ROW for roots
+  std::pmr::vector<uint32_t> parent_rows;
+  /// Children of row i are child_rows[child_offsets[i], child_offsets[i + 1])
+  std::pmr::vector<uint32_t> child_offsets;
+  std::pmr::vector<uint32_t> child_rows;
+  /// Rows reachable from the roots, every parent before its children
+  std::pmr::vector<uint32_t> tree_order;
+  /// Totals over each row's subtree, the row itself included
+  std::pmr::vector<ResourceTotals> subtree_totals;
+
+  /**
+   * @brief Look up a process in this snapshot without copying it
+   * @param pid The process ID to find
+   * @return Pointer into processes, or nullptr if the PID is not present.
+   * Valid for as long as the snapshot is held.
+   */
+  const ProcessInfo *find(pid_t pid) const noexcept {
+    auto it = index.find(pid);
+    return it != index.end() ? &processes[it->second] : nullptr;
+  }
+
+  /**
+   * @brief Direct children of a process
+   * @param pid The parent process ID
+   * @return Their PIDs; empty if the PID is not present or has none
+   */
+  std::vector<pid_t> childrenOf(pid_t pid) const;
+
+  /**
+   * @brief Rows of a process and all of its descendants
+   * @param pid The subtree's root
+   * @return Row indices, every parent before its children; empty if the
+   * PID is not present. Costs O(subtree).
+   */
+  std::vector<size_t> subtreeRows(pid_t pid) const;
+
+  /**
+   * @brief Chain of ancestors of a process
+   * @param pid The process ID
+   * @return PIDs from the parent up to the root; empty if the PID is not
+   * present or is a root
+   */
+  std::vector<pid_t> ancestorsOf(pid_t pid) const;
+};
+
+/// Shared handle to a published, read-only snapshot
+using ProcessSnapshotPtr = std::shared_ptr<const ProcessSnapshot>;
+
+/**
+ * @struct ProcessLifecycle
+ * @brief Processes that appeared or disappeared between two snapshots
+ */
+struct ProcessLifecycle {
+  std::vector<pid_t> created;
+  std::vector<pid_t> exited;
+};
+
+ProcessLifecycle diffSnapshots(const ProcessSnapshot &before,
+                               const ProcessSnapshot &after);
+
+/**
+ * @struct ProcessMetadata
+ * @brief Static per-process attributes cached across collection cycles
+ *
+ * These never change for a live process, so they are only read when a PID
+ * is first seen or when the start time shows the PID has been reused.
+ */
+struct ProcessMetadata {
+  uint64_t start_time = 0; ///< Start time the entry was resolved for
+  InternedString name;     ///< Executable path, or first cmdline word
+};
+
+/**
+ * @struct CollectorShard
+ * @brief Per-worker slice of the collector state
+ *
+ * PIDs are assigned to shards by `pid % shard count`, so each PID's tracking
+ * state always lives in the same shard and workers never share maps.
+ */
+struct CollectorShard {
+  /**
+   * @brief Last sutime seen for a process or thread, the cycle it was seen
+   * in and when; entries not refreshed in a full cycle are pruned at its end
+   */
+  struct SutimeSample {
+    uint64_t sutime;
+    uint64_t cycle;
+    std::chrono::steady_clock::time_point time; ///< When it was read
+  };
+
+  std::vector<pid_t> pids;         ///< PIDs assigned to this shard this cycle
+  std::vector<ProcessInfo> buffer; ///< Local output rows (slots are reused)
+  size_t count = 0;                ///< Rows of buffer filled this cycle
+  std::vector<ThreadInfo> threads; ///< Per-thread rows filled this cycle
+  uint64_t cycle = 0;              ///< Number of cycles collected
+  /// Keyed by (pid << 32 | tid); tid 0 is the process-level sample
+  std::unordered_map<uint64_t, SutimeSample> last_sutimes;
+  std::unordered_map<pid_t, ProcessMetadata> metadata;
+  /// Reads this shard's PIDs; opened by ProcessCore on first use
+  std::unique_ptr<ProcessSource::Reader> reader;
+  std::vector<ProcessSample> samples;       ///< Batch read buffer, reused
+  std::vector<ThreadSample> thread_samples; ///< Thread walk buffer, reused
 };
 
 /**
@@ -73,32 +271,115 @@ public:
 
   // Process information collection
   std::optional<int> collectInfo();
+  std::optional<int> refreshProcesses(const std::unordered_set<pid_t> &pids);
+  std::optional<int> updateMembership();
+
+  /// Snapshots kept for delta queries: every generation published within
+  /// SNAPSHOT_RETENTION, but at least SNAPSHOT_HISTORY and at most
+  /// MAX_SNAPSHOT_HISTORY of them. Sizing the ring by time keeps a base a
+  /// client received a few intervals ago available however often fast
+  /// sampling tiers publish.
+  static constexpr size_t SNAPSHOT_HISTORY = 8;
+  static constexpr size_t MAX_SNAPSHOT_HISTORY = 128;
+  static constexpr std::chrono::milliseconds SNAPSHOT_RETENTION{3000};
 
   // Process information retrieval
+  ProcessSnapshotPtr getSnapshot() const noexcept;
+  ProcessSnapshotPtr getSnapshot(uint64_t generation) const;
+  uint64_t getGeneration() const noexcept;
   size_t getCount() const noexcept;
-  const std::vector<ProcessInfo> &getProcessList() const noexcept;
   std::optional<ProcessInfo> getProcessById(pid_t pid) const noexcept;
 
   // Process control
   bool adjustPriority(pid_t pid, int priority, int policy);
 
+  // Collector configuration
+  /// Most collector workers accepted; more only adds contention on /proc
+  static constexpr unsigned MAX_COLLECTOR_THREADS = 256;
+  bool setCollectorThreads(unsigned threads);
+  unsigned getCollectorThreads() const noexcept;
+  bool setCollectorAffinity(uint64_t cpu_mask);
+  void setProcessSource(std::unique_ptr<ProcessSource> source);
+  std::string getProcessSourceName() const;
+  void setThreadSampling(ThreadSamplingConfig config);
+  std::shared_ptr<const ThreadSamplingConfig> getThreadSampling() const;
+  void setGroupMembership(std::shared_ptr<const GroupMembership> membership);
+  std::shared_ptr<const GroupMembership> getGroupMembership() const;
+
+  // Per-thread accounting results
+  std::vector<ThreadInfo> getHotThreads(size_t count) const;
+
   // Display
   void displayInfo() const;
 
 private:
   ProcessCore();
-  ~ProcessCore() = default;
+  ~ProcessCore();
 
   // Helper methods
-  bool readProcessInfo(pid_t pid, ProcessInfo &info,
-                       std::chrono::duration<double> elapsed_time);
-  bool readProcessMemory(pid_t pid, ProcessInfo &info);
-  std::optional<uint64_t> readProcessStatus(pid_t pid, ProcessInfo &info);
+  void collectShard(CollectorShard &shard,
+                    std::chrono::steady_clock::time_point sample_time);
+  bool readProcessInfo(CollectorShard &shard, pid_t pid, ProcessInfo &info,
+                       std::chrono::steady_clock::time_point sample_time);
+  void fillProcessInfo(CollectorShard &shard, const ProcessSample &sample,
+                       ProcessInfo &info,
+                       std::chrono::steady_clock::time_point sample_time);
+  bool shouldSampleThreads(pid_t pid) const;
+  std::optional<double>
+  readThreadStatus(CollectorShard &shard, pid_t pid,
+                   std::chrono::steady_clock::time_point sample_time);
+  const ProcessMetadata &getMetadata(CollectorShard &shard, pid_t pid,
+                                     uint64_t start_time);
+  ProcessSource::Reader &getReader(CollectorShard &shard);
+
+  // Worker pool management (collector mutex held)
+  void startWorkers();
+  void stopWorkers();
+  void workerLoop(size_t shard_index, uint64_t start_cycle);
+
+  std::shared_ptr<ProcessSnapshot> takeBuildBuffer();
+  void publishSnapshot(std::shared_ptr<ProcessSnapshot> next);
+  static void buildProcessTree(ProcessSnapshot &snapshot);
+
+  // Published snapshot; only accessed through std::atomic_load/atomic_store
+  ProcessSnapshotPtr snapshot_;
+  // Writable alias of the published snapshot, and the snapshot that last
+  // fell out of the history ring. The latter is recycled as the next build
+  // buffer once no reader holds it any more.
+  std::shared_ptr<ProcessSnapshot> current_;
+  std::shared_ptr<ProcessSnapshot> spare_;
+  uint64_t next_generation_ = 1;
 
-  std::vector<ProcessInfo> process_list_;
+  // The recently published snapshots, oldest first, with consecutive
+  // generations. Guarded by history_mutex_ so readers never
+  // touch the collector mutex.
+  std::deque<std::shared_ptr<ProcessSnapshot>> history_;
+  mutable std::mutex history_mutex_;
+
+  // Serialises collectors; readers never take it
   mutable std::mutex mutex_;
-  std::chrono::steady_clock::time_point last_update_time_;
-  std::unordered_map<pid_t, uint64_t> last_sutimes_;
+  // Declared before the shards, whose readers must be destroyed first
+  std::unique_ptr<ProcessSource> source_;
+  std::vector<CollectorShard> shards_;
+  std::vector<pid_t> listed_pids_; ///< Process listing buffer, reused
+  uint64_t cpu_mask_ = 0; ///< Worker runmask, 0 = unrestricted
+
+  // Only accessed through std::atomic_load/atomic_store
+  std::shared_ptr<const ThreadSamplingConfig> thread_sampling_;
+  // Sampling config pinned for the cycle in progress
+  std::shared_ptr<const ThreadSamplingConfig> cycle_sampling_;
+  // Only accessed through std::atomic_load/atomic_store
+  std::shared_ptr<const GroupMembership> group_membership_;
+
+  // Collector worker pool; shard i is handled by workers_[i]
+  std::vector<std::thread> workers_;
+  std::mutex pool_mutex_;
+  std::condition_variable pool_cv_;
+  std::condition_variable pool_done_cv_;
+  uint64_t pool_cycle_ = 0;
+  size_t pool_pending_ = 0;
+  bool pool_stop_ = false;
+  std::chrono::steady_clock::time_point pool_sample_time_;
 };
 
 } // namespace qnx
@@ -0,0 +1,33 @@
+/**
+ * @file ProcessDelta.hpp
+ * @brief Encoding of the changes between two process snapshots
+ *
+ * Shared by get_process_table_delta replies and by delta subscriptions, so
+ * a client applies a reply and a push in the same way.
+ */
+
+#pragma once
+
+#include "server/ProcessCore.hpp"
+#include "server/SessionManager.hpp"
+#include <string>
+
+namespace qnx {
+/**
+ * @brief Encode the changes from one snapshot to a newer one
+ *
+ * Rows listed as added replace any row the client holds for that PID,
+ * which also covers a PID reused by a new process. Without a base the
+ * whole table is sent and the client has to start over.
+ *
+ * @param out Buffer the message is appended to
+ * @param current The newer snapshot
+ * @param base The snapshot the client holds, or nullptr if it is unknown
+ * @param encoding How the client asked for responses to be encoded
+ * @param pushed Encode a subscription push (a "process_delta" event or a
+ * PROCESS_UPDATE frame) instead of a reply
+ */
+void encodeProcessDelta(std::string &out, const ProcessSnapshot &current,
+                        const ProcessSnapshot *base, WireEncoding encoding,
+                        bool pushed);
+} // namespace qnx
@@ -0,0 +1,80 @@
+/**
+ * @file ProcessEvents.hpp
+ * @brief Process creation and exit notifications for the QNX Remote Process
+ * Monitor
+ *
+ * This file defines the ProcessEvents class, which asks procnto to signal
+ * every process creation and death with procmgr_event_notify_add(). The
+ * notifications are pulses and carry no PID, so each one wakes the stats
+ * loop for a membership pass that finds the processes by listing /proc.
+ * Coalesced pulses are still counted, so a fork storm shows up in the
+ * counters even when its processes exit before they can be listed.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace qnx {
+class ProcessEvents {
+public:
+  /**
+   * @brief Get the singleton instance of ProcessEvents
+   * @return Reference to the singleton instance
+   */
+  static ProcessEvents &getInstance();
+
+  // Delete copy/move constructors and assignment operators
+  ProcessEvents(const ProcessEvents &) = delete;
+  ProcessEvents &operator=(const ProcessEvents &) = delete;
+  ProcessEvents(ProcessEvents &&) = delete;
+  ProcessEvents &operator=(ProcessEvents &&) = delete;
+
+  /**
+   * @brief Register for notifications and start the receiving thread
+   *
+   * Without notifications the server still works; membership changes are
+   * then only seen by full collections.
+   *
+   * @return true if notifications are being received
+   */
+  bool start();
+
+  /**
+   * @brief Unregister and stop the receiving thread
+   */
+  void stop();
+
+  /**
+   * @brief Whether start() succeeded and stop() has not been called
+   */
+  bool isRunning() const noexcept { return running_.load(); }
+
+  /**
+   * @brief Process creations notified since start()
+   */
+  uint64_t createdCount() const noexcept { return created_.load(); }
+
+  /**
+   * @brief Process deaths notified since start()
+   */
+  uint64_t exitedCount() const noexcept { return exited_.load(); }
+
+private:
+  ProcessEvents() = default;
+  ~ProcessEvents();
+
+  void receiveLoop();
+
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> created_{0};
+  std::atomic<uint64_t> exited_{0};
+  std::thread thread_;
+  int chid_ = -1;          ///< Channel the pulses arrive on
+  int coid_ = -1;          ///< Side-channel connection the events target
+  int create_handle_ = -1; ///< procmgr_event_notify_add() registrations
+  int death_handle_ = -1;
+};
+} // namespace qnx
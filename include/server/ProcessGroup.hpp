@@ -10,8 +10,11 @@
 
 #pragma once
 
+#include "server/ProcessCore.hpp"
 #include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
@@ -39,7 +42,6 @@ struct Group {
   std::string name;          ///< Display name for the group
   int priority;              ///< Display priority (lower values appear first)
   std::string description;   ///< Optional description of the group's purpose
-  std::set<pid_t> processes; ///< Set of process IDs belonging to this group
   double total_cpu_usage =
       0.0; ///< Sum of CPU usage of all processes in the group
   long total_memory_usage =
@@ -154,8 +156,9 @@ public:
   /**
    * @brief Update group statistics
    *
-   * Recalculates CPU and memory usage totals for all groups
-   * based on current process information.
+   * Takes the CPU and memory usage totals for all groups from the current
+   * snapshot, where they were summed as it was built, and drops members
+   * that have exited since.
    */
   void updateGroupStats();
 
@@ -170,9 +173,18 @@ public:
   /**
    * @brief Prioritize a group
    *
+   * Applies a scheduling policy and priority to every member of the group
+   * currently in it. Members that could not be adjusted are logged and
+   * skipped.
+   *
    * @param group_id ID of the group to prioritize
+   * @param priority Scheduling priority to give each member
+   * @param policy Scheduling policy to give each member (e.g., SCHED_RR)
+   * @return Number of members adjusted, or std::nullopt if the group does
+   *         not exist
    */
-  void prioritizeGroup(int group_id);
+  std::optional<size_t> prioritizeGroup(int group_id, int priority,
+                                        int policy);
 
 private:
   /**
@@ -196,9 +208,19 @@ private:
   std::map<int, Group> groups_;
 
   /**
-   * @brief Map of process IDs to their group IDs
+   * @brief Flat table of process IDs to their group IDs
+   *
+   * Immutable once published: changes build a new table, which is also
+   * handed to ProcessCore so the next snapshot is tagged and totalled
+   * against it.
+   */
+  std::shared_ptr<const GroupMembership> membership_ =
+      std::make_shared<const GroupMembership>();
+
+  /**
+   * @brief Replace the membership table (mutex_ held)
    */
-  std::map<pid_t, int> process_group_map_;
+  void publishMembership(GroupMembership membership);
 
   /**
    * @brief Mutex for thread-safe access to group data
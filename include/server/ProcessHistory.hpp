@@ -6,27 +6,131 @@
  * recording and managing historical data about processes. This includes
  * metrics like CPU and memory usage over time, allowing for trend analysis
  * and visualization in the monitoring interface.
+ *
+ * Samples are stored column-wise in a slab of fixed-capacity per-process ring
+ * buffers. All processes are sampled on the same tick, so timestamps live in
+ * a single shared column indexed by tick rather than in every sample.
+ *
+ * Older history is kept in coarser rollup tiers (10 s, 1 min and 10 min
+ * buckets) holding min/max/avg CPU and memory. Tiers are updated as samples
+ * arrive, so long-range queries read O(points returned) buckets.
  */
 
 #pragma once
 
 #include "ProcessControl.hpp"
-#include <deque>
-#include <map>
-#include <mutex>
-#include <string>
+#include <cstdint>
+#include <ctime>
+#include <iterator>
+#include <shared_mutex>
 #include <sys/types.h>
+#include <unordered_map>
 #include <vector>
 
 namespace qnx {
+struct ProcessSnapshot;
+
 struct ProcessHistoryEntry {
   double cpu_usage;
   long memory_usage;
   time_t timestamp;
 };
 
+/**
+ * @brief One point of a range query: a raw sample or a rolled-up bucket
+ *
+ * For raw samples min, avg and max are equal.
+ */
+struct HistoryPoint {
+  time_t timestamp; ///< Sample time, or start of the bucket
+  float cpu_min;
+  float cpu_avg;
+  float cpu_max;
+  uint32_t memory_min_kb;
+  uint32_t memory_avg_kb;
+  uint32_t memory_max_kb;
+};
+
+/**
+ * @brief Result of a range query
+ */
+struct HistoryRange {
+  time_t resolution = 0; ///< Seconds covered by each point
+  std::vector<HistoryPoint> points; ///< Oldest first
+};
+
+/**
+ * @brief Read-only view over the samples recorded for one process
+ *
+ * A view reads straight from the history columns and holds a shared lock on
+ * them for as long as it lives, so keep it short-lived: sampling waits
+ * until all views are gone. Iteration runs oldest to newest and skips ticks
+ * on which the process was not sampled.
+ */
+class HistoryView {
+public:
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ProcessHistoryEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const ProcessHistoryEntry *;
+    using reference = ProcessHistoryEntry;
+
+    ProcessHistoryEntry operator*() const;
+    Iterator &operator++();
+    bool operator==(const Iterator &other) const {
+      return tick_ == other.tick_;
+    }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+  private:
+    friend class HistoryView;
+    Iterator(const HistoryView *view, uint64_t tick)
+        : view_(view), tick_(tick) {
+      skipGaps();
+    }
+    void skipGaps();
+
+    const HistoryView *view_;
+    uint64_t tick_;
+  };
+
+  HistoryView() = default;
+
+  Iterator begin() const { return Iterator(this, first_tick_); }
+  Iterator end() const { return Iterator(this, end_tick_); }
+
+  /**
+   * @brief Whether the view covers no ticks at all
+   */
+  bool empty() const { return first_tick_ == end_tick_; }
+
+  /**
+   * @brief Number of ticks covered, including ticks without a sample
+   *
+   * An upper bound on the number of entries iteration yields; suitable for
+   * reserving output space.
+   */
+  size_t span() const { return static_cast<size_t>(end_tick_ - first_tick_); }
+
+private:
+  friend class ProcessHistory;
+
+  std::shared_lock<std::shared_mutex> lock_;
+  const float *cpu_ = nullptr;          ///< This series' slot in cpu column
+  const uint32_t *memory_kb_ = nullptr; ///< Its slot in the memory column
+  const time_t *tick_time_ = nullptr;   ///< Shared per-tick timestamp column
+  size_t capacity_ = 0;
+  uint64_t first_tick_ = 0;
+  uint64_t end_tick_ = 0;
+};
+
 class ProcessHistory {
 public:
+  /// Memory the slab and rollup tiers may use; bounds tracked processes
+  static constexpr size_t MEMORY_BUDGET = size_t{256} * 1024 * 1024;
+
   /**
    * @brief Get the singleton instance of ProcessHistory.
    * @return Reference to the singleton instance.
@@ -41,6 +145,9 @@ public:
 
   /**
    * @brief Add a new history entry for a specific process.
+   *
+   * Calls made within the same second belong to the same tick.
+   *
    * @param pid The process ID.
    * @param cpu_usage Current CPU usage.
    * @param memory_usage Current memory usage.
@@ -48,18 +155,50 @@ public:
   void addEntry(pid_t pid, double cpu_usage, long memory_usage);
 
   /**
-   * @brief Retrieve historical entries for a specific process.
+   * @brief Append one tick for every process in a snapshot.
+   *
+   * Processes that are tracked but absent from the snapshot have exited
+   * and their history is dropped.
+   *
+   * @param snapshot The snapshot just published by ProcessCore.
+   */
+  void ingestSnapshot(const ProcessSnapshot &snapshot);
+
+  /**
+   * @brief View the historical entries for a specific process.
    * @param pid The process ID.
-   * @return A vector containing the requested historical entries, or an empty
-   * vector if none exist.
+   * @return A view over the recorded entries, empty if none exist.
    */
-  std::vector<ProcessHistoryEntry> getHistory(pid_t pid) const;
+  HistoryView getHistory(pid_t pid) const;
 
   /**
-   * @brief Retrieve historical entries for all processes.
-   * @return A map containing historical entries for all processes.
+   * @brief Query history over a time range within a point budget.
+   *
+   * Picks the finest resolution that still holds the whole range and fits
+   * within max_points; if even the coarsest tier has too many points,
+   * adjacent buckets are merged further. Only completed buckets are
+   * returned from the rollup tiers.
+   *
+   * @param pid The process ID.
+   * @param from Start of the range (inclusive).
+   * @param to End of the range (inclusive).
+   * @param max_points Maximum number of points to return (at least 1).
+   * @return The chosen resolution and the points, empty if none exist.
    */
-  std::map<pid_t, std::vector<ProcessHistoryEntry>> getAllHistory() const;
+  HistoryRange getHistoryRange(pid_t pid, time_t from, time_t to,
+                               size_t max_points) const;
+
+  /**
+   * @brief Get the IDs of all processes with recorded history.
+   * @return The tracked process IDs, in no particular order.
+   */
+  std::vector<pid_t> getTrackedProcesses() const;
+
+  /**
+   * @brief Get the number of processes with recorded history.
+   * @return The number of tracked processes.
+   */
+  size_t trackedCount() const;
 
   /**
    * @brief Clear all historical data for a specific process
@@ -73,12 +212,90 @@ public:
   void clearAllHistory();
 
 private:
-  ProcessHistory() = default;
+  ProcessHistory();
   ~ProcessHistory() = default;
 
-  mutable std::mutex mutex_;
-  std::map<pid_t, std::deque<ProcessHistoryEntry>> history_data_;
-  size_t max_entries_per_process_ = 100;
-  size_t max_tracked_processes_ = 1000;
+  /**
+   * @brief Location of one process's ring buffer in the slab
+   */
+  struct Series {
+    uint32_t slot;       ///< Index of the ring buffer in the slab
+    uint64_t first_tick; ///< Oldest tick the series covers
+    uint64_t last_tick;  ///< Newest tick with a sample
+  };
+
+  /**
+   * @brief Running min/max/sum over the samples of an open bucket
+   */
+  struct Rollup {
+    float cpu_min;
+    float cpu_max;
+    double cpu_sum;
+    uint32_t memory_min_kb;
+    uint32_t memory_max_kb;
+    uint64_t memory_sum_kb;
+    uint32_t count = 0;
+  };
+
+  /**
+   * @brief Per-process state of one rollup tier
+   */
+  struct TierSeries {
+    uint64_t first_bucket = 0; ///< Oldest bucket the series covers
+    uint64_t last_bucket = 0;  ///< Newest completed bucket; 0 if none
+    uint64_t open_bucket = 0;  ///< Bucket the open rollup accumulates
+    Rollup open;
+  };
+
+  /**
+   * @brief A ring of fixed-width buckets per process, laid out like the slab
+   *
+   * Bucket b covers [b * seconds, (b + 1) * seconds) and sits at ring
+   * position b % capacity. A NaN cpu_avg marks a bucket without samples.
+   */
+  struct Tier {
+    Tier(time_t seconds, size_t capacity)
+        : seconds(seconds), capacity(capacity) {}
+
+    time_t seconds;
+    size_t capacity;
+    std::vector<float> cpu_min;
+    std::vector<float> cpu_avg;
+    std::vector<float> cpu_max;
+    std::vector<uint32_t> memory_min_kb;
+    std::vector<uint32_t> memory_avg_kb;
+    std::vector<uint32_t> memory_max_kb;
+    std::vector<TierSeries> series; ///< Indexed by slab slot
+  };
+
+  void advanceTick(time_t now);
+  void recordSample(pid_t pid, double cpu_usage, uint64_t memory_usage);
+  void growTiers();
+  void rollUp(Tier &tier, uint32_t slot, time_t now, float cpu,
+              uint32_t memory_kb);
+  void closeBucket(Tier &tier, uint32_t slot);
+  void readRaw(const Series &series, time_t from, time_t to,
+               HistoryRange &range) const;
+  void readTier(const Tier &tier, uint32_t slot, time_t from, time_t to,
+                HistoryRange &range) const;
+  void releaseSeries(std::unordered_map<pid_t, Series>::iterator it);
+
+  size_t max_entries_per_process_ = 3600;
+  size_t max_tracked_processes_ = 0; ///< Derived from MEMORY_BUDGET
+
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<pid_t, Series> series_;
+
+  // Slab columns: slot s owns [s * capacity, (s + 1) * capacity)
+  std::vector<float> cpu_;          ///< CPU percent, NaN where not sampled
+  std::vector<uint32_t> memory_kb_; ///< Resident memory in KB
+  std::vector<uint32_t> free_slots_;
+  uint32_t slots_used_ = 0; ///< Slots ever handed out (the slab's size)
+
+  std::vector<time_t> tick_time_; ///< Timestamp of tick t at t % capacity
+  uint64_t tick_ = 0;             ///< Current tick; 0 before the first sample
+
+  static constexpr size_t TIER_COUNT = 3;
+  Tier tiers_[TIER_COUNT]; ///< Rollups, finest first
 };
-} // namespace qnx
\ No newline at end of file
+} // namespace qnx
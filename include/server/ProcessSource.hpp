@@ -0,0 +1,167 @@
+/**
+ * @file ProcessSource.hpp
+ * @brief Pluggable process-table backends for the QNX Remote Process Monitor
+ *
+ * ProcessCore derives everything it publishes (CPU percentages, names,
+ * groups, the process tree) from raw readings produced by a ProcessSource.
+ * The source decides where those readings come from: devctl() on QNX,
+ * /proc/<pid>/stat on Linux, or a generated workload for profiling.
+ *
+ * Reading is split in two so collector workers never share state: the
+ * source lists the PIDs once per cycle, and each collector shard reads its
+ * PIDs in one batch through a Reader it owns. A reader keeps whatever it
+ * caches between cycles (typically open /proc descriptors) to itself.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace qnx {
+/**
+ * @struct ProcessSample
+ * @brief Raw reading of one process, before CPU usage is derived
+ */
+struct ProcessSample {
+  pid_t pid = 0;
+  pid_t parent_pid = -1;
+  int num_threads = 0;
+  int priority = 0;
+  int policy = 0;
+  int state = 0;           ///< Backend-specific state code
+  uint64_t start_time = 0; ///< Start time (ns), disambiguates PID reuse
+  uint64_t sutime = 0;     ///< System + user CPU time consumed (ns)
+  uint64_t memory_usage = 0; ///< Resident memory (bytes), 0 if unknown
+};
+
+/**
+ * @struct ThreadSample
+ * @brief Raw reading of one thread of a process
+ */
+struct ThreadSample {
+  int tid = 0;
+  uint64_t sutime = 0; ///< System + user CPU time consumed (ns)
+  int priority = 0;
+  int policy = 0;
+  int state = 0;
+};
+
+/**
+ * @class ProcessSource
+ * @brief Where the collector gets its process readings from
+ *
+ * listPids() and openReader() are called with the collector mutex held.
+ * Readers of different shards are used concurrently, one thread each.
+ */
+class ProcessSource {
+public:
+  /**
+   * @class Reader
+   * @brief Per-shard reading state, used by one collector thread at a time
+   *
+   * A reader must not outlive the source that opened it.
+   */
+  class Reader {
+  public:
+    virtual ~Reader() = default;
+
+    /**
+     * @brief Read a batch of processes
+     *
+     * Processes that no longer exist or cannot be read are skipped, so the
+     * samples are packed at the front of out in the order of pids.
+     *
+     * @param pids The PIDs to read, in ascending order
+     * @param count Number of PIDs
+     * @param out Room for count samples
+     * @return The number of samples written
+     */
+    virtual size_t readBatch(const pid_t *pids, size_t count,
+                             ProcessSample *out) = 0;
+
+    /**
+     * @brief Read every thread of a process
+     *
+     * @param pid The process ID
+     * @param out Replaced with one sample per thread
+     * @return false if the threads could not be read
+     */
+    virtual bool readThreads(pid_t pid, std::vector<ThreadSample> &out) = 0;
+
+    /**
+     * @brief Resolve a process's name
+     *
+     * Only called when a PID is first seen or has been reused, so it may
+     * be slow.
+     *
+     * @param pid The process ID
+     * @return The executable path or first command line word; empty if
+     * neither can be read
+     */
+    virtual std::string readName(pid_t pid) = 0;
+
+    /**
+     * @brief Drop everything cached for a process that has gone
+     */
+    virtual void forget(pid_t pid) = 0;
+
+    /**
+     * @brief Drop everything cached for processes not in a listing
+     * @param pids The live PIDs of this shard, in ascending order
+     */
+    virtual void retain(const std::vector<pid_t> &pids) = 0;
+  };
+
+  virtual ~ProcessSource() = default;
+
+  /**
+   * @brief Name the source is selected by, e.g. "devctl"
+   */
+  virtual const char *name() const noexcept = 0;
+
+  /**
+   * @brief List the PIDs of every live process
+   *
+   * @param pids Replaced with the PIDs, in no particular order
+   * @throws std::runtime_error if the process table cannot be listed
+   */
+  virtual void listPids(std::vector<pid_t> &pids) = 0;
+
+  /**
+   * @brief Create the reading state for one collector shard
+   */
+  virtual std::unique_ptr<Reader> openReader() = 0;
+};
+
+/**
+ * @brief Name of the source used when none is configured
+ *
+ * @return "devctl" on QNX, "linux" elsewhere
+ */
+const char *defaultProcessSourceName() noexcept;
+
+/**
+ * @brief Create a process source by name
+ *
+ * @param name "devctl", "linux" or "replay"
+ * @param proc_root Where the /proc based sources list and open processes
+ * @return The source, or nullptr if the name is unknown
+ */
+std::unique_ptr<ProcessSource>
+createProcessSource(const std::string &name, const std::string &proc_root);
+
+/**
+ * @brief List the numeric directory names under a /proc mount
+ *
+ * Shared by the /proc based sources.
+ *
+ * @param root Directory holding one subdirectory per PID
+ * @param pids Replaced with the PIDs, in directory order
+ * @throws std::runtime_error if root does not exist
+ */
+void listProcDirectory(const std::string &root, std::vector<pid_t> &pids);
+} // namespace qnx
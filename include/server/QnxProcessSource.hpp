@@ -0,0 +1,67 @@
+/**
+ * @file QnxProcessSource.hpp
+ * @brief devctl() process source for the QNX Remote Process Monitor
+ *
+ * Reads each process with DCMD_PROC_INFO and DCMD_PROC_TIDSTATUS on
+ * /proc/<pid>/ctl and its resident size from /proc/<pid>/as. Opening a
+ * /proc entry is a message pass to procnto, so both descriptors are kept
+ * open for as long as the PID is alive. Outside QNX the source lists
+ * processes but cannot read any.
+ */
+
+#pragma once
+
+#include "server/ProcessSource.hpp"
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace qnx {
+class QnxProcessSource : public ProcessSource {
+public:
+  /**
+   * @param proc_root Directory holding one subdirectory per PID
+   */
+  explicit QnxProcessSource(std::string proc_root = "/proc")
+      : proc_root_(std::move(proc_root)) {}
+
+  const char *name() const noexcept override { return "devctl"; }
+  void listPids(std::vector<pid_t> &pids) override;
+  std::unique_ptr<Reader> openReader() override;
+
+private:
+  /**
+   * @struct Handles
+   * @brief Open /proc file descriptors kept for a process across cycles
+   */
+  struct Handles {
+    int ctl_fd = -1; ///< /proc/<pid>/ctl, used for devctl() queries
+    int as_fd = -1;  ///< /proc/<pid>/as, used for the address space summary
+  };
+
+  class DevctlReader : public Reader {
+  public:
+    explicit DevctlReader(const std::string &proc_root)
+        : proc_root_(proc_root) {}
+    ~DevctlReader() override;
+
+    size_t readBatch(const pid_t *pids, size_t count,
+                     ProcessSample *out) override;
+    bool readThreads(pid_t pid, std::vector<ThreadSample> &out) override;
+    std::string readName(pid_t pid) override;
+    void forget(pid_t pid) override;
+    void retain(const std::vector<pid_t> &pids) override;
+
+  private:
+    bool readStatus(pid_t pid, ProcessSample &sample);
+    bool readMemory(pid_t pid, ProcessSample &sample);
+    int getCtlFd(pid_t pid);
+    int getAsFd(pid_t pid);
+
+    const std::string &proc_root_;
+    std::unordered_map<pid_t, Handles> handles_;
+  };
+
+  std::string proc_root_;
+};
+} // namespace qnx
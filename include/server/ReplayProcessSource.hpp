@@ -0,0 +1,87 @@
+/**
+ * @file ReplayProcessSource.hpp
+ * @brief Synthetic process source for the QNX Remote Process Monitor
+ *
+ * Generates a process table from a seed instead of reading one: a process
+ * tree of a chosen size, a share of it busy, and processes exiting and
+ * being replaced at a chosen rate. The same seed and workload replay the
+ * same sequence of tables, so scaling runs of the server can be compared
+ * across hosts and releases without any /proc traffic. CPU time advances
+ * with the wall clock, so the busy processes report their configured load.
+ */
+
+#pragma once
+
+#include "server/ProcessSource.hpp"
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace qnx {
+class ReplayProcessSource : public ProcessSource {
+public:
+  /**
+   * @struct Workload
+   * @brief Shape of the generated process table
+   */
+  struct Workload {
+    size_t processes = 1000;      ///< Live processes at any time
+    unsigned threads = 4;         ///< Threads per process
+    double busy_fraction = 0.1;   ///< Share of processes using CPU
+    double busy_load = 25.0;      ///< CPU% used by each busy process
+    double churn_per_second = 0;  ///< Processes replaced per second
+    uint32_t seed = 1;
+  };
+
+  explicit ReplayProcessSource(Workload workload);
+
+  const char *name() const noexcept override { return "replay"; }
+  void listPids(std::vector<pid_t> &pids) override;
+  std::unique_ptr<Reader> openReader() override;
+
+  /**
+   * @brief The workload the table is generated from
+   */
+  const Workload &workload() const noexcept { return workload_; }
+
+private:
+  /**
+   * @struct Process
+   * @brief One generated process
+   */
+  struct Process {
+    ProcessSample sample;
+    double load = 0.0; ///< Fraction of a CPU used
+    std::string name;
+  };
+
+  class ReplayReader : public Reader {
+  public:
+    explicit ReplayReader(const ReplayProcessSource &source)
+        : source_(source) {}
+
+    size_t readBatch(const pid_t *pids, size_t count,
+                     ProcessSample *out) override;
+    bool readThreads(pid_t pid, std::vector<ThreadSample> &out) override;
+    std::string readName(pid_t pid) override;
+    void forget(pid_t) override {}
+    void retain(const std::vector<pid_t> &) override {}
+
+  private:
+    const ReplayProcessSource &source_;
+  };
+
+  const Process *find(pid_t pid) const;
+  Process spawn();
+  void advance(std::chrono::steady_clock::time_point now);
+
+  Workload workload_;
+  std::mt19937 rng_;
+  std::vector<Process> processes_; ///< Sorted by PID
+  pid_t next_pid_ = 1;
+  double pending_churn_ = 0.0; ///< Replacements owed, fractional part kept
+  std::chrono::steady_clock::time_point started_;
+  std::chrono::steady_clock::time_point last_advance_;
+};
+} // namespace qnx
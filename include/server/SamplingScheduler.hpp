@@ -0,0 +1,181 @@
+/**
+ * @file SamplingScheduler.hpp
+ * @brief Cadence of the statistics loop for the QNX Remote Process Monitor
+ *
+ * This file defines the SamplingScheduler class, which decides when the
+ * stats loop collects and what it collects. Full collections run on a
+ * fixed-rate steady_clock deadline, backing off to a slower interval while
+ * no client is subscribed. Fast tiers re-read a few processes or groups
+ * between full collections, and a request can ask for an immediate refresh.
+ * Process lifecycle events trigger a membership pass that only picks up
+ * created and exited processes.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+#include <unordered_set>
+#include <vector>
+
+namespace qnx {
+/**
+ * @struct SamplingTier
+ * @brief A set of processes re-read more often than the full collection
+ */
+struct SamplingTier {
+  std::chrono::milliseconds interval{100}; ///< Time between re-reads
+  std::unordered_set<pid_t> pids;          ///< Processes in the tier
+  int group_id = -1; ///< Group whose members are also in it, -1 = none
+};
+
+/**
+ * @struct SamplingPass
+ * @brief What the stats loop should do next
+ */
+struct SamplingPass {
+  enum Kind {
+    Full, ///< Collect every process
+    Fast,       ///< Re-read only the processes in pids
+    Membership, ///< Add created and drop exited processes
+    Stop        ///< The scheduler was stopped; exit the loop
+  };
+  Kind kind = Stop;
+  std::unordered_set<pid_t> pids; ///< Fast tier members due now
+  uint64_t refresh_seq = 0; ///< Refresh requests this pass answers
+};
+
+/**
+ * @class SamplingScheduler
+ * @brief Singleton that paces the stats loop
+ *
+ * Deadlines advance by whole intervals from where they were, not from when
+ * a pass finished, so collection time does not make the period drift. A
+ * deadline that has already been missed by a whole interval is moved to
+ * now rather than replayed, so an overrun never turns into a burst.
+ */
+class SamplingScheduler {
+public:
+  /// Shortest fast tier interval accepted
+  static constexpr std::chrono::milliseconds MIN_INTERVAL{50};
+  /// Lifecycle events within this window share one membership pass
+  static constexpr std::chrono::milliseconds MEMBERSHIP_COALESCE{20};
+  /// Refreshes within this window of a full pass share the next one
+  static constexpr std::chrono::milliseconds REFRESH_COALESCE{250};
+
+  /**
+   * @brief Get the singleton instance of SamplingScheduler
+   * @return Reference to the singleton instance
+   */
+  static SamplingScheduler &getInstance();
+
+  // Delete copy/move constructors and assignment operators
+  SamplingScheduler(const SamplingScheduler &) = delete;
+  SamplingScheduler &operator=(const SamplingScheduler &) = delete;
+  SamplingScheduler(SamplingScheduler &&) = delete;
+  SamplingScheduler &operator=(SamplingScheduler &&) = delete;
+
+  /**
+   * @brief Set the full collection intervals
+   *
+   * @param active Interval while at least one client is subscribed
+   * @param idle Interval while nobody is subscribed; fast tiers also pause
+   */
+  void setIntervals(std::chrono::milliseconds active,
+                    std::chrono::milliseconds idle);
+
+  /**
+   * @brief Replace the fast sampling tiers
+   *
+   * Intervals below MIN_INTERVAL are raised to it. Takes effect at once.
+   *
+   * @param tiers The new tiers; empty disables fast sampling
+   */
+  void setTiers(std::vector<SamplingTier> tiers);
+
+  /**
+   * @brief Get the current fast sampling tiers
+   * @return A copy of the tiers
+   */
+  std::vector<SamplingTier> getTiers() const;
+
+  /**
+   * @brief Block until the next pass is due
+   *
+   * Called by the stats loop, which must report each pass it ran through
+   * completePass().
+   *
+   * @return The pass to run, or a Stop pass once stop() has been called
+   */
+  SamplingPass waitForNextPass();
+
+  /**
+   * @brief Report that a pass returned by waitForNextPass() has finished
+   * @param pass The pass
+   */
+  void completePass(const SamplingPass &pass);
+
+  /**
+   * @brief Ask for a full collection now and wait for it to finish
+   *
+   * A request made within REFRESH_COALESCE of the last full collection
+   * starting waits for the end of that window, and shares the collection
+   * with every other request made meanwhile. The next regular collection
+   * is rescheduled a full interval after it.
+   *
+   * @param timeout How long to wait; zero returns without waiting
+   * @return true if a collection started after the request has finished
+   */
+  bool requestRefresh(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Report that processes were created or exited
+   *
+   * Called by the lifecycle event source. While someone is subscribed, a
+   * membership pass follows within MEMBERSHIP_COALESCE; otherwise the
+   * change is left to the next full collection.
+   */
+  void notifyMembershipChange();
+
+  /**
+   * @brief Wake the stats loop and make waitForNextPass() return Stop
+   */
+  void stop();
+
+private:
+  SamplingScheduler() = default;
+  ~SamplingScheduler() = default;
+
+  using Clock = std::chrono::steady_clock;
+
+  std::chrono::milliseconds fullInterval(bool active) const;
+  static void advance(Clock::time_point &deadline,
+                      std::chrono::milliseconds interval,
+                      Clock::time_point now);
+  SamplingPass fullPass(Clock::time_point now);
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_cv_;      ///< Wakes the stats loop
+  std::condition_variable completed_cv_; ///< Wakes refresh requesters
+  bool stopped_ = false;
+
+  std::chrono::milliseconds active_interval_{1000};
+  std::chrono::milliseconds idle_interval_{5000};
+  Clock::time_point last_full_{};       ///< Deadline of the last full pass
+  Clock::time_point last_full_start_{}; ///< When it was handed out
+  bool started_ = false;                ///< A full pass has been handed out
+
+  bool membership_pending_ = false;
+  Clock::time_point last_membership_{};
+
+  std::vector<SamplingTier> tiers_;
+  std::vector<Clock::time_point> tier_deadlines_; ///< Parallel to tiers_
+
+  uint64_t refresh_requested_ = 0;  ///< Requests made so far
+  uint64_t refresh_dispatched_ = 0; ///< Requests a handed-out pass covers
+  uint64_t refresh_completed_ = 0;  ///< Requests a finished pass covered
+};
+} // namespace qnx
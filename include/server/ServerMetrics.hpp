@@ -0,0 +1,276 @@
+/**
+ * @file ServerMetrics.hpp
+ * @brief Self-instrumentation for the QNX Remote Process Monitor
+ *
+ * This file defines the ServerMetrics class, which measures what the server
+ * itself costs: collection time, failed devctl() calls, per-command latency,
+ * bytes moved and time spent waiting for the collector and history locks.
+ *
+ * Every thread that records owns a block of counters and fixed-bucket
+ * latency histograms. Recording touches only that block, without locks or
+ * shared cache lines; the blocks are summed when the metrics are read.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qnx {
+/**
+ * @brief Event counters
+ */
+enum class Counter : size_t {
+  DevctlCalls,           ///< devctl() queries issued by the collector
+  DevctlFailures,        ///< Of which failed
+  Requests,              ///< Messages handled
+  RequestErrors,         ///< Rejected: malformed, unknown or not permitted
+  BytesReceived,         ///< Read from client sockets
+  BytesSent,             ///< Written to client sockets
+  HistorySamplesDropped, ///< Not kept: ProcessHistory was at its limit
+  COUNT
+};
+
+/**
+ * @brief Timed operations other than commands
+ */
+enum class Latency : size_t {
+  Collect,         ///< ProcessCore::collectInfo()
+  Refresh,         ///< Fast tier re-reads
+  Membership,      ///< Lifecycle membership passes
+  CoreLockWait,    ///< Waiting for the ProcessCore collector mutex
+  HistoryLockWait, ///< Waiting for the ProcessHistory mutex
+  COUNT
+};
+
+/**
+ * @brief Summed contents of one latency histogram
+ *
+ * Bucket i counts durations below 2^i microseconds (and at least 2^(i-1)
+ * for i > 0); the last bucket also takes everything longer.
+ */
+struct HistogramSnapshot {
+  static constexpr size_t BUCKETS = 24; ///< Up to about 8 s
+
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+  std::array<uint64_t, BUCKETS> buckets{};
+
+  /**
+   * @brief Upper bound of the bucket holding a quantile
+   * @param q The quantile, in [0, 1]
+   * @return The bound in microseconds, or 0 if nothing was recorded
+   */
+  uint64_t quantileUs(double q) const;
+
+  /**
+   * @brief Upper bound of bucket i in microseconds
+   */
+  static uint64_t bucketBoundUs(size_t i) { return uint64_t{1} << i; }
+};
+
+/**
+ * @brief Summed metrics of every thread, as returned by ServerMetrics
+ */
+struct MetricsSnapshot {
+  std::chrono::steady_clock::duration uptime{};
+  std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> counters{};
+  std::array<HistogramSnapshot, static_cast<size_t>(Latency::COUNT)> latency;
+  /// Parallel to ServerMetrics::commandNames(); unused slots are empty
+  std::vector<HistogramSnapshot> commands;
+};
+
+/**
+ * @brief A point-in-time value reported next to the metrics
+ */
+struct Gauge {
+  std::string name; ///< Metric name, e.g. "handler_queue_depth"
+  std::string help; ///< One-line description
+  double value = 0;
+  bool monotonic = false; ///< A running total rather than a level
+};
+
+/**
+ * @class ServerMetrics
+ * @brief Singleton holding the server's own counters and histograms
+ */
+class ServerMetrics {
+public:
+  /// Commands that can be timed individually
+  static constexpr size_t MAX_COMMANDS = 64;
+  /// Returned by registerCommand() when every slot is taken
+  static constexpr size_t NO_COMMAND = MAX_COMMANDS;
+
+  /**
+   * @brief Get the singleton instance of ServerMetrics
+   * @return Reference to the singleton instance
+   */
+  static ServerMetrics &getInstance();
+
+  // Delete copy/move constructors and assignment operators
+  ServerMetrics(const ServerMetrics &) = delete;
+  ServerMetrics &operator=(const ServerMetrics &) = delete;
+  ServerMetrics(ServerMetrics &&) = delete;
+  ServerMetrics &operator=(ServerMetrics &&) = delete;
+
+  /**
+   * @brief Add to a counter
+   * @param counter The counter
+   * @param amount The amount to add
+   */
+  void add(Counter counter, uint64_t amount = 1);
+
+  /**
+   * @brief Record the duration of an operation
+   * @param latency The operation
+   * @param duration How long it took
+   */
+  void record(Latency latency, std::chrono::steady_clock::duration duration);
+
+  /**
+   * @brief Give a command its own latency histogram
+   *
+   * Meant to be called once per command at startup; the slot is then
+   * passed to recordCommand().
+   *
+   * @param name The command name
+   * @return The command's slot, or NO_COMMAND if all are taken
+   */
+  size_t registerCommand(const std::string &name);
+
+  /**
+   * @brief Record how long a command took to handle
+   * @param slot Slot returned by registerCommand(); NO_COMMAND is ignored
+   * @param duration How long it took
+   */
+  void recordCommand(size_t slot, std::chrono::steady_clock::duration duration);
+
+  /**
+   * @brief Sum the metrics of every thread, live and exited
+   * @return The totals
+   */
+  MetricsSnapshot snapshot() const;
+
+  /**
+   * @brief Get the names of the registered commands
+   * @return The names, indexed by slot
+   */
+  std::vector<std::string> commandNames() const;
+
+  /**
+   * @brief Render metrics in the Prometheus text exposition format
+   *
+   * @param snapshot Metrics returned by snapshot()
+   * @param gauges Values to report alongside them
+   * @return The text, one sample per line
+   */
+  std::string formatPrometheus(const MetricsSnapshot &snapshot,
+                               const std::vector<Gauge> &gauges) const;
+
+  /**
+   * @brief Name of a counter as used by both output formats
+   */
+  static std::string_view counterName(Counter counter);
+
+  /**
+   * @brief Name of a timed operation as used by both output formats
+   */
+  static std::string_view latencyName(Latency latency);
+
+private:
+  /**
+   * @brief Histogram written by a single thread
+   *
+   * Only the owning thread stores, so updates are plain relaxed load/store
+   * pairs rather than read-modify-write instructions.
+   */
+  struct Histogram {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::BUCKETS> buckets{};
+
+    void record(std::chrono::steady_clock::duration duration);
+    void addTo(HistogramSnapshot &total) const;
+  };
+
+  /**
+   * @brief Metrics recorded by one thread
+   */
+  struct ThreadMetrics {
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)>
+        counters{};
+    std::array<Histogram, static_cast<size_t>(Latency::COUNT)> latency;
+    std::array<Histogram, MAX_COMMANDS> commands;
+
+    void addTo(MetricsSnapshot &total) const;
+  };
+
+  /**
+   * @brief Owns the calling thread's block; folds it into retired_ on exit
+   */
+  struct ThreadSlot {
+    ~ThreadSlot();
+    ThreadMetrics *metrics = nullptr;
+  };
+
+  ServerMetrics();
+  ~ServerMetrics() = default;
+
+  ThreadMetrics &local();
+
+  std::chrono::steady_clock::time_point started_;
+
+  mutable std::mutex mutex_; ///< Protects the fields below
+  std::vector<std::unique_ptr<ThreadMetrics>> threads_; ///< Live threads
+  MetricsSnapshot retired_; ///< Totals of threads that have exited
+  std::vector<std::string> command_names_;
+};
+
+/**
+ * @brief Records the lifetime of a scope as one operation
+ */
+class ScopedLatency {
+public:
+  explicit ScopedLatency(Latency latency)
+      : latency_(latency), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedLatency() {
+    ServerMetrics::getInstance().record(
+        latency_, std::chrono::steady_clock::now() - start_);
+  }
+
+  ScopedLatency(const ScopedLatency &) = delete;
+  ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+private:
+  Latency latency_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Acquire a lock and record how long that took
+ *
+ * An uncontended lock is taken with try_lock() and recorded as a zero wait,
+ * so the clock is only read when the caller actually has to block.
+ *
+ * @param lock An unlocked std::unique_lock or std::shared_lock
+ * @param latency The histogram to record the wait in
+ */
+template <typename Lock> void lockTimed(Lock &lock, Latency latency) {
+  if (lock.try_lock()) {
+    ServerMetrics::getInstance().record(latency, {});
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  lock.lock();
+  ServerMetrics::getInstance().record(latency,
+                                      std::chrono::steady_clock::now() - start);
+}
+} // namespace qnx
@@ -0,0 +1,145 @@
+/**
+ * @file SessionManager.hpp
+ * @brief Per-connection session state for the QNX Remote Process Monitor
+ *
+ * This file defines the SessionManager class, which remembers what a client
+ * negotiated on the login handshake (who it is and which wire encoding it
+ * wants) for as long as its connection stays open.
+ *
+ * A successful password login also issues a session token bound to the
+ * connection. A client that reconnects can log in again with the token
+ * instead of its password, which skips the deliberately slow crypt() hash.
+ */
+
+#pragma once
+
+#include "shared/Authenticator.hpp"
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace qnx {
+/**
+ * @enum WireEncoding
+ * @brief Encoding of response bodies on a connection
+ */
+enum class WireEncoding {
+  Json,  ///< JSON text (default)
+  Binary ///< Compact binary records, see BinaryProtocol.hpp
+};
+
+/**
+ * @struct Session
+ * @brief State negotiated by one client connection
+ */
+struct Session {
+  bool authenticated = false; ///< Set by a successful login
+  Authentication::UserType user_type = Authentication::VIEWER;
+  WireEncoding encoding = WireEncoding::Json;
+  std::string token; ///< Session token bound to the connection, if any
+};
+
+/**
+ * @class SessionManager
+ * @brief Singleton registry of sessions keyed by client socket
+ *
+ * Entries are dropped when the connection closes, before its descriptor
+ * number can be reused by another client.
+ */
+class SessionManager {
+public:
+  /**
+   * @brief Get the singleton instance of SessionManager
+   *
+   * @return Reference to the singleton instance
+   */
+  static SessionManager &getInstance();
+
+  // Delete copy and move constructors/operators
+  SessionManager(const SessionManager &) = delete;
+  SessionManager &operator=(const SessionManager &) = delete;
+  SessionManager(SessionManager &&) = delete;
+  SessionManager &operator=(SessionManager &&) = delete;
+
+  /**
+   * @brief Get a client's session
+   *
+   * @param client_socket The client socket descriptor
+   * @return The session, or a default (unauthenticated, JSON) one
+   */
+  Session getSession(int client_socket) const;
+
+  /**
+   * @brief Replace a client's session
+   *
+   * @param client_socket The client socket descriptor
+   * @param session The new session state
+   */
+  void setSession(int client_socket, const Session &session);
+
+  /**
+   * @brief Forget a client's session
+   *
+   * @param client_socket The client socket descriptor
+   */
+  void removeClient(int client_socket);
+
+  /**
+   * @brief Authenticate a connection and issue a session token for it
+   *
+   * Any token previously bound to the connection is revoked.
+   *
+   * @param client_socket The client socket descriptor
+   * @param session The session to store; its token is filled in
+   * @param username The user the session belongs to
+   * @return The new token
+   */
+  std::string issueToken(int client_socket, Session &session,
+                         const std::string &username);
+
+  /**
+   * @brief Authenticate a connection with a previously issued token
+   *
+   * The token is moved to the new connection, and a connection still
+   * holding it loses its authentication. The user is looked up again in
+   * the login file, so removing or demoting them takes effect here.
+   *
+   * @param client_socket The client socket descriptor
+   * @param session The session to store; user type and token are filled in
+   * @param token The token presented by the client
+   * @return true if the token was valid and the session was stored
+   */
+  bool redeemToken(int client_socket, Session &session,
+                   const std::string &token);
+
+  /// How long a token stays valid after it was last issued or redeemed
+  static constexpr std::chrono::hours TOKEN_LIFETIME{12};
+
+private:
+  /// Maximum outstanding tokens; the one closest to expiry is dropped
+  static constexpr size_t MAX_TOKENS = 1024;
+
+  /**
+   * @brief A token's owner and the connection it is bound to
+   */
+  struct TokenGrant {
+    std::string username;
+    std::string hash; ///< Password hash at issue; a change revokes the token
+    int client_socket;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  SessionManager() = default;
+  ~SessionManager() = default;
+
+  void bindToken(int client_socket, Session &session, TokenGrant grant,
+                 std::string token);
+  void makeRoomForToken();
+
+  std::unordered_map<int, Session> sessions_;
+  std::unordered_map<std::string, TokenGrant> tokens_;
+  mutable std::mutex mutex_;
+};
+} // namespace qnx
@@ -10,13 +10,19 @@
 
 #pragma once
 
+#include "MessageFraming.hpp"
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <netinet/in.h>
 #include <string>
 #include <sys/socket.h>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace qnx {
@@ -30,8 +36,15 @@ namespace qnx {
  * - Dispatches requests to appropriate handlers
  * - Sends responses back to clients
  *
- * The server runs in its own thread and can handle multiple client
- * connections simultaneously.
+ * The server runs a single poll()-driven I/O thread over non-blocking
+ * sockets. Each connection has its own read buffer and write queue; sends
+ * that cannot complete immediately are queued and flushed when the socket
+ * becomes writable, so one slow client never blocks the others.
+ *
+ * When the HandlerPool is running, complete requests are executed on its
+ * worker threads instead of the I/O thread. Each connection has at most one
+ * job in flight, so its responses keep request order while different
+ * connections are served in parallel.
  */
 class SocketServer {
 public:
@@ -39,12 +52,25 @@ public:
    * @brief Callback function type for message handling
    *
    * This function type is used to process incoming client messages.
+   * It is called once per complete frame, so a message split across TCP
+   * segments arrives whole and pipelined messages arrive one at a time.
    * It should parse the message, perform the requested operation,
    * and return a response to be sent back to the client.
+   * It may run on any HandlerPool thread, concurrently for different
+   * clients, but never concurrently for the same client.
    */
   using MessageHandler = std::function<std::string(
       int /* client_socket */, const std::string & /* message */)>;
 
+  /**
+   * @brief Callback function type for connection teardown
+   *
+   * Called on the I/O thread after a client socket has been closed, so state
+   * keyed by the socket (e.g. subscriptions) can be released before the
+   * descriptor number is reused.
+   */
+  using DisconnectHandler = std::function<void(int /* client_socket */)>;
+
   /**
    * @brief Get the singleton instance of SocketServer
    *
@@ -76,6 +102,17 @@ public:
    */
   bool init(int port, MessageHandler handler);
 
+  /**
+   * @brief Set the callback invoked when a client disconnects
+   *
+   * Must be called before init().
+   *
+   * @param handler The callback, or an empty function to clear it
+   */
+  void setDisconnectHandler(DisconnectHandler handler) {
+    disconnect_handler_ = std::move(handler);
+  }
+
   /**
    * @brief Shut down the socket server.
    *
@@ -90,15 +127,28 @@ public:
   /**
    * @brief Send a message to a specific client.
    *
-   * This method sends a message to a specific client identified
-   * by their socket descriptor.
+   * The message is written immediately if the socket accepts it; whatever
+   * does not fit is queued and flushed by the I/O thread. Safe to call from
+   * any thread.
    *
    * @param client_socket The client socket descriptor
    * @param message The message to send
-   * @return true on successful send, false on error
+   * @return true if the message was sent or queued, false on error
    */
   bool send(int client_socket, const std::string &message);
 
+  /**
+   * @brief Send a shared, already encoded message to a specific client.
+   *
+   * The buffer is queued by reference, so one payload can be fanned out to
+   * many clients without copying it per client.
+   *
+   * @param client_socket The client socket descriptor
+   * @param message The message to send
+   * @return true if the message was sent or queued, false on error
+   */
+  bool send(int client_socket, std::shared_ptr<const std::string> message);
+
   /**
    * @brief Broadcast a message to all connected clients.
    *
@@ -109,6 +159,38 @@ public:
    */
   void broadcast(const std::string &message);
 
+  /**
+   * @brief Get the framing a client negotiated with its first request
+   *
+   * @param client_socket The client socket descriptor
+   * @return The connection's framing, or Framing::Unknown if it is not
+   * connected or has not sent anything yet
+   */
+  Framing getFraming(int client_socket);
+
+  /**
+   * @struct ClientTraffic
+   * @brief Bytes moved on one client connection
+   */
+  struct ClientTraffic {
+    int client_socket = -1;
+    uint64_t bytes_received = 0; ///< Read from the socket so far
+    uint64_t bytes_sent = 0;     ///< Accepted by the socket so far
+    size_t queued_bytes = 0;     ///< Waiting in the write queue
+  };
+
+  /**
+   * @brief Get the traffic counters of every connected client
+   *
+   * @return One entry per connection, in no particular order
+   */
+  std::vector<ClientTraffic> getClientTraffic();
+
+  /**
+   * @brief Get the number of connected clients
+   */
+  size_t connectionCount();
+
   /**
    * @brief Check if the server is running
    *
@@ -130,6 +212,32 @@ public:
   inline static const std::string AUTH_LOGIN = "Login";
 
 private:
+  /**
+   * @struct Connection
+   * @brief Per-client I/O state
+   */
+  struct Connection {
+    int fd = -1;          ///< Client socket (non-blocking)
+    FrameDecoder decoder; ///< Reassembles frames (I/O thread only)
+    std::atomic<Framing> framing{
+        Framing::Unknown}; ///< Negotiated framing, readable by senders
+    std::mutex write_mutex;  ///< Protects the write queue
+    std::deque<std::shared_ptr<const std::string>> write_queue;
+    size_t write_offset = 0; ///< Bytes of write_queue.front() already sent
+    size_t queued_bytes = 0; ///< Total unsent bytes in write_queue
+    uint64_t bytes_sent = 0; ///< Bytes sent so far (under write_mutex)
+    std::atomic<uint64_t> bytes_received{0}; ///< Written by the I/O thread
+    /// Set once no more I/O may happen; the socket itself is closed when
+    /// no handler job owns the connection any more
+    bool closed = false;
+
+    std::mutex request_mutex; ///< Protects the request fields below
+    std::deque<std::string> requests; ///< Frames waiting for the handler
+    bool dispatching = false; ///< A handler job owns this connection
+    bool read_paused = false; ///< Reads stopped until requests drain
+    bool peer_closed = false; ///< Close once the requests are handled
+  };
+
   /**
    * @brief Default constructor - private to enforce singleton pattern
    */
@@ -141,30 +249,99 @@ private:
   ~SocketServer(); // Ensure resources are cleaned up
 
   /**
-   * @brief Main server loop that accepts new connections
+   * @brief Main I/O loop
    *
    * This method runs in a separate thread and:
-   * 1. Accepts incoming client connections
-   * 2. Creates a client handler for each new connection
-   * 3. Continues until the server is shut down
+   * 1. Polls the listening socket, the wake-up pipe and every client
+   * 2. Accepts new client connections
+   * 3. Reads available data and dispatches it to the message handler
+   * 4. Flushes queued writes when sockets become writable
+   * Continues until the server is shut down.
    */
   void serverLoop();
 
   /**
-   * @brief Handles communication with a specific client
+   * @brief Accept all pending connections on the listening socket
+   */
+  void acceptConnections();
+
+  /**
+   * @brief Drain a readable client socket and dispatch complete frames
    *
-   * This method:
-   * 1. Receives messages from the client
-   * 2. Passes messages to the message handler
-   * 3. Sends responses back to the client
-   * 4. Handles disconnection and cleanup
+   * @param conn The connection to read from
+   * @return false if the peer closed the connection or an error occurred
+   */
+  bool handleClient(const std::shared_ptr<Connection> &conn);
+
+  /**
+   * @brief Write as much of the connection's queue as the socket accepts
+   *
+   * Must be called with conn.write_mutex held.
+   *
+   * @param conn The connection to flush
+   * @return false if the connection failed and should be closed
+   */
+  bool flushLocked(Connection &conn);
+
+  /**
+   * @brief Hand a connection's queued requests to the handler
+   *
+   * Submits a HandlerPool job unless one is already in flight, or runs the
+   * handler inline when the pool is not running.
+   *
+   * @param conn The connection with pending requests
+   * @return false if the pool queue is full and the dispatch must be retried
+   */
+  bool dispatch(const std::shared_ptr<Connection> &conn);
+
+  /**
+   * @brief Run the handler for a batch of a connection's requests, in order
+   *
+   * Must only be called by the owner of conn.dispatching.
    *
-   * @param client_socket The socket descriptor for the client connection
+   * @param conn The connection that owns the requests
+   * @return true if requests remain and the caller still owns the connection
+   */
+  bool processRequests(const std::shared_ptr<Connection> &conn);
+
+  /**
+   * @brief HandlerPool job: process a connection's requests in batches
+   *
+   * Requeues itself between batches so one busy client cannot monopolise a
+   * worker while others wait.
+   *
+   * @param conn The connection that owns the requests
+   */
+  void handlerJob(const std::shared_ptr<Connection> &conn);
+
+  /**
+   * @brief Frame a buffer, queue it on a connection and try to send it
+   */
+  bool enqueue(int client_socket, std::shared_ptr<const std::string> message);
+
+  /**
+   * @brief Frame a buffer and queue it on a known connection
+   */
+  bool enqueue(const std::shared_ptr<Connection> &conn,
+               std::shared_ptr<const std::string> message);
+
+  /**
+   * @brief Remove a connection and close its socket
+   *
+   * Deferred while a handler job owns the connection, so its descriptor
+   * number cannot be reused under a handler still running for it.
+   */
+  void closeConnection(int client_socket);
+
+  /**
+   * @brief Wake the I/O thread out of poll()
    */
-  void handleClient(int client_socket);
+  void wake();
 
-  int server_fd_ = -1;              ///< Server socket file descriptor
-  std::vector<int> client_sockets_; ///< List of connected client sockets
+  int server_fd_ = -1; ///< Server socket file descriptor
+  int wake_fds_[2] = {-1, -1}; ///< Self-pipe used to interrupt poll()
+  std::unordered_map<int, std::shared_ptr<Connection>>
+      connections_; ///< Connected clients keyed by socket
   std::mutex
       clients_mutex_; ///< Mutex to protect concurrent access to the client list
   std::atomic<bool> running_{
@@ -172,6 +349,7 @@ private:
   std::thread server_thread_; ///< Thread that runs the server loop
   MessageHandler
       message_handler_; ///< Callback function for processing messages
+  DisconnectHandler disconnect_handler_; ///< Called after a client closes
   struct sockaddr_in server_address_; ///< Server address configuration
 };
 } // namespace qnx
\ No newline at end of file
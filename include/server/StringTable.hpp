@@ -0,0 +1,100 @@
+/**
+ * @file StringTable.hpp
+ * @brief Interned process names for the QNX Remote Process Monitor
+ *
+ * Process rows refer to their name by id and std::string_view instead of
+ * owning a copy, so a snapshot row holds no heap memory, copying one is a
+ * memberwise copy, and a thousand workers running the same executable
+ * share one string. Each entry also stores its JSON-escaped form.
+ *
+ * Entries are never removed: published snapshots and the history ring may
+ * reference any of them, and the set of distinct executable names on a
+ * target is small. Views stay valid for the lifetime of the process. Names
+ * from untrusted input, such as a gateway's upstreams, go through
+ * tryIntern() with a size bound instead.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace qnx {
+/**
+ * @struct InternedString
+ * @brief Handle to a StringTable entry
+ */
+struct InternedString {
+  uint32_t id = 0;          ///< 0 is the empty string
+  std::string_view text;    ///< The string itself
+  std::string_view escaped; ///< JSON-escaped text; empty if text needs none
+};
+
+class StringTable {
+public:
+  /**
+   * @brief Get the singleton instance of StringTable
+   * @return Reference to the singleton instance
+   */
+  static StringTable &getInstance();
+
+  // Delete copy/move constructors and assignment operators
+  StringTable(const StringTable &) = delete;
+  StringTable &operator=(const StringTable &) = delete;
+  StringTable(StringTable &&) = delete;
+  StringTable &operator=(StringTable &&) = delete;
+
+  /**
+   * @brief Get the entry for a string, adding it if it is new
+   * @param text The string
+   * @return The entry; its views stay valid for the process lifetime
+   */
+  InternedString intern(std::string_view text);
+
+  /**
+   * @brief Get the entry for a string, adding it only if the table stays
+   * within a size bound
+   * @param text The string
+   * @param max_bytes Bound on bytes(), checked before a new entry is added
+   * @return The entry, or std::nullopt if text is new and would not fit
+   */
+  std::optional<InternedString> tryIntern(std::string_view text,
+                                          size_t max_bytes);
+
+  /**
+   * @brief Number of distinct strings interned
+   */
+  size_t size() const;
+
+  /**
+   * @brief Bytes of string data held, escaped forms included
+   */
+  size_t bytes() const;
+
+private:
+  StringTable();
+  ~StringTable() = default;
+
+  /**
+   * @struct Entry
+   * @brief Storage of one string; a deque never moves its elements
+   */
+  struct Entry {
+    std::string text;
+    std::string escaped;
+  };
+
+  InternedString handle(uint32_t id) const;
+
+  mutable std::shared_mutex mutex_;
+  std::deque<Entry> entries_; ///< Indexed by id
+  std::unordered_map<std::string_view, uint32_t> ids_; ///< Views into entries_
+  size_t bytes_ = 0;
+};
+} // namespace qnx
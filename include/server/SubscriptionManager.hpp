@@ -0,0 +1,186 @@
+/**
+ * @file SubscriptionManager.hpp
+ * @brief Server-push subscriptions for the QNX Remote Process Monitor
+ *
+ * This file defines the SubscriptionManager class, which lets clients
+ * register interest in a set of processes once and then receive updates
+ * pushed after each collection pass instead of polling for them.
+ */
+
+#pragma once
+
+#include "ProcessCore.hpp"
+#include "SessionManager.hpp"
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace qnx {
+/**
+ * @enum SubscriptionScope
+ * @brief Which processes a subscription covers
+ */
+enum class SubscriptionScope {
+  All,  ///< Every process in the snapshot
+  Pids, ///< An explicit list of PIDs
+  Group ///< The current members of a process group
+};
+
+/**
+ * @struct Subscription
+ * @brief One client's registration for pushed process updates
+ */
+struct Subscription {
+  int id = 0;              ///< Assigned by SubscriptionManager::subscribe()
+  int client_socket = -1;  ///< Client the updates are pushed to
+  SubscriptionScope scope = SubscriptionScope::All;
+  std::vector<pid_t> pids; ///< Sorted PID list (Pids scope)
+  int group_id = -1;       ///< Group to follow (Group scope)
+  std::chrono::milliseconds interval{1000}; ///< Minimum time between pushes
+  std::chrono::steady_clock::time_point next_due; ///< Next push (epoch = now)
+  bool lifecycle = false; ///< Also push process creations and exits
+  /// Push the changes since the previous push instead of every row (All
+  /// scope only); the first push, and any after the base has left the
+  /// snapshot history, carries the full table
+  bool delta = false;
+  WireEncoding encoding = WireEncoding::Json; ///< Encoding of delta pushes
+  uint64_t last_generation = 0; ///< Generation of the previous delta push
+};
+
+/**
+ * @class SubscriptionManager
+ * @brief Tracks subscriptions and fans out snapshot updates
+ *
+ * This singleton class is fed by the stats loop after every published
+ * snapshot. Subscriptions that are due and cover the same processes share
+ * one encoded payload, which is queued by reference on every matching
+ * client, so the cost of a push grows with the number of distinct scopes
+ * rather than the number of subscribers. Delta subscriptions share a
+ * payload when they were last pushed the same generation.
+ */
+class SubscriptionManager {
+public:
+  /// Shortest push interval accepted from clients
+  static constexpr std::chrono::milliseconds MIN_INTERVAL{100};
+
+  /**
+   * @brief Get the singleton instance of SubscriptionManager
+   *
+   * @return Reference to the singleton instance
+   */
+  static SubscriptionManager &getInstance();
+
+  // Delete copy and move constructors/operators
+  SubscriptionManager(const SubscriptionManager &) = delete;
+  SubscriptionManager &operator=(const SubscriptionManager &) = delete;
+  SubscriptionManager(SubscriptionManager &&) = delete;
+  SubscriptionManager &operator=(SubscriptionManager &&) = delete;
+
+  /**
+   * @brief Register a subscription
+   *
+   * The first update is pushed after the next collection pass.
+   *
+   * @param subscription The subscription; its id is ignored
+   * @return The ID assigned to the subscription
+   */
+  int subscribe(Subscription subscription);
+
+  /**
+   * @brief Remove one of a client's subscriptions
+   *
+   * @param client_socket The client that owns the subscription
+   * @param subscription_id The subscription to remove
+   * @return true if the subscription existed and belonged to the client
+   */
+  bool unsubscribe(int client_socket, int subscription_id);
+
+  /**
+   * @brief Remove every subscription of a client
+   *
+   * Called when a client disconnects.
+   *
+   * @param client_socket The client socket descriptor
+   * @return Number of subscriptions removed
+   */
+  size_t removeClient(int client_socket);
+
+  /**
+   * @brief Push a snapshot to every subscription that is due
+   *
+   * Encodes one payload per distinct scope and sends the shared buffer to
+   * all of its subscribers.
+   *
+   * @param snapshot The snapshot that was just published
+   */
+  void publish(const ProcessSnapshotPtr &snapshot);
+
+  /**
+   * @brief Push process creations and exits to subscriptions that want them
+   *
+   * Called after every published snapshot. Lifecycle events are not
+   * throttled by the subscription interval, and the snapshots are only
+   * diffed if some subscription asked for them.
+   *
+   * @param before The previously published snapshot
+   * @param after The snapshot just published
+   */
+  void publishLifecycle(const ProcessSnapshot &before,
+                        const ProcessSnapshot &after);
+
+  /**
+   * @brief Get the number of active subscriptions
+   * @return The subscription count
+   */
+  size_t count() const;
+
+private:
+  /**
+   * @brief Private constructor for singleton pattern
+   */
+  SubscriptionManager() = default;
+
+  /**
+   * @brief Private destructor
+   */
+  ~SubscriptionManager() = default;
+
+  /**
+   * @brief Build the key shared by subscriptions that get the same payload
+   */
+  static std::string scopeKey(const Subscription &subscription);
+
+  /**
+   * @brief Encode the update for one scope
+   *
+   * @param snapshot The snapshot to encode
+   * @param subscription Any subscription with the scope to encode
+   * @return The encoded JSON payload
+   */
+  static std::string encodeUpdate(const ProcessSnapshot &snapshot,
+                                  const Subscription &subscription);
+
+  /**
+   * @brief Encode the lifecycle events one scope covers
+   *
+   * @param before The previously published snapshot
+   * @param after The snapshot just published
+   * @param lifecycle The changes between them
+   * @param subscription Any subscription with the scope to encode
+   * @return The encoded JSON payload, or an empty string if the scope
+   * covers none of the changes
+   */
+  static std::string encodeLifecycle(const ProcessSnapshot &before,
+                                     const ProcessSnapshot &after,
+                                     const ProcessLifecycle &lifecycle,
+                                     const Subscription &subscription);
+
+  int next_id_ = 1;
+  std::map<int, Subscription> subscriptions_;
+  mutable std::mutex mutex_;
+};
+} // namespace qnx
@@ -57,6 +57,18 @@ struct UserEntry {
   static std::optional<UserEntry> FromString(std::string_view line);
 };
 
+/**
+ * @brief Look up a user's entry in the login file
+ *
+ * The file is parsed into an in-memory map on first use and parsed again
+ * only when its modification time or size changes, so a lookup costs a
+ * stat() and a hash map probe.
+ *
+ * @param username The username to look up
+ * @return The user's entry, or std::nullopt if there is none
+ */
+std::optional<UserEntry> FindUser(std::string_view username);
+
 /**
  * @brief Authenticate user login credentials
  * @param username The username to check
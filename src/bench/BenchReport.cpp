@@ -0,0 +1,93 @@
+/**
+ * @file BenchReport.cpp
+ * @brief Implementation of benchmark result reporting for QNX Remote Process
+ * Monitor
+ */
+
+#include "bench/BenchReport.hpp"
+#include "server/JsonWriter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <numeric>
+#include <unistd.h>
+
+namespace qnx {
+/**
+ * @brief Get a percentile of the samples
+ *
+ * Uses the nearest-rank method on the sorted samples.
+ *
+ * @param percentile In [0, 100]
+ * @return The sample at that rank in microseconds, 0 if there are none
+ */
+double LatencySamples::percentileUs(double percentile) const {
+  if (samples_.empty()) {
+    return 0.0;
+  }
+  if (!sorted_) {
+    std::sort(samples_.begin(), samples_.end());
+    sorted_ = true;
+  }
+  double rank = std::ceil(percentile / 100.0 * samples_.size());
+  size_t index = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+  index = std::min(index, samples_.size() - 1);
+  return samples_[index] / 1e3;
+}
+
+/**
+ * @brief Get the mean of the samples in microseconds
+ */
+double LatencySamples::meanUs() const {
+  if (samples_.empty()) {
+    return 0.0;
+  }
+  double total = std::accumulate(samples_.begin(), samples_.end(), 0.0);
+  return total / samples_.size() / 1e3;
+}
+
+BenchReporter::BenchReporter(std::ostream &out, std::string suite,
+                             std::string label)
+    : out_(out), suite_(std::move(suite)), label_(std::move(label)),
+      started_(static_cast<int64_t>(std::time(nullptr))) {
+  char host[256] = {0};
+  if (gethostname(host, sizeof(host) - 1) == 0) {
+    host_ = host;
+  }
+}
+
+/**
+ * @brief Write one result line and flush it
+ *
+ * @param result The result
+ */
+void BenchReporter::report(const BenchResult &result) {
+  double seconds = std::chrono::duration<double>(result.elapsed).count();
+
+  std::string line;
+  JsonWriter json(line);
+  json.beginObject()
+      .addString("suite", suite_)
+      .addString("label", label_)
+      .addString("host", host_)
+      .addInt("run_started", started_)
+      .addString("bench", result.name);
+  json.beginObject("params");
+  for (const auto &param : result.params) {
+    json.addString(param.first, param.second);
+  }
+  json.endObject();
+  json.addUInt("operations", result.operations)
+      .addUInt("errors", result.errors)
+      .addDouble("elapsed_s", seconds)
+      .addDouble("ops_per_s", seconds > 0 ? result.operations / seconds : 0.0)
+      .addDouble("mean_us", result.latency.meanUs())
+      .addDouble("p50_us", result.latency.percentileUs(50))
+      .addDouble("p90_us", result.latency.percentileUs(90))
+      .addDouble("p99_us", result.latency.percentileUs(99))
+      .addDouble("max_us", result.latency.percentileUs(100))
+      .endObject();
+  out_ << line << '\n';
+  out_.flush();
+}
+} // namespace qnx
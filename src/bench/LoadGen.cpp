@@ -0,0 +1,443 @@
+/**
+ * @file LoadGen.cpp
+ * @brief Multi-client load generator for the QNX Remote Process Monitor
+ *
+ * Opens many connections to a running server and keeps a fixed number of
+ * requests in flight on each. The server answers every connection in
+ * request order, so each response is matched to the oldest outstanding
+ * request and timed from when that request was queued. Results go out as
+ * JSON lines (see BenchReport.hpp), overall and per command.
+ *
+ * Connections are spread over a few threads, each driving its share with
+ * poll() over non-blocking sockets.
+ */
+
+#include "bench/BenchReport.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Options controlling a load run
+ */
+struct LoadOptions {
+  std::string host = "127.0.0.1";
+  int port = 8080;
+  unsigned connections = 16;
+  unsigned depth = 1;   ///< Requests in flight per connection
+  unsigned threads = 0; ///< 0 = one per CPU, at most one per connection
+  std::chrono::seconds duration{10};
+  std::chrono::seconds warmup{1}; ///< Run first, not measured
+  bool length_prefixed = false;   ///< Otherwise newline-delimited JSON
+  std::vector<std::string> commands; ///< Requests, sent round-robin
+  std::string label;
+  std::string output; ///< Empty = stdout
+};
+
+/**
+ * @brief Outstanding request on a connection
+ */
+struct InFlight {
+  size_t command; ///< Index into LoadOptions::commands
+  Clock::time_point sent;
+};
+
+/**
+ * @brief One client connection
+ */
+struct Client {
+  int fd = -1;
+  std::string out;          ///< Framed requests not yet written
+  size_t out_offset = 0;    ///< Bytes of out already written
+  std::string in;           ///< Response bytes not yet split into frames
+  std::deque<InFlight> pending; ///< In request order
+  size_t next_command = 0;
+  bool failed = false;
+};
+
+/**
+ * @brief Measurements of one thread, merged at the end
+ */
+struct ThreadStats {
+  std::vector<qnx::LatencySamples> latency; ///< Per command
+  std::vector<uint64_t> errors;             ///< Per command
+  uint64_t bytes_received = 0;
+  unsigned failed_connections = 0;
+};
+
+int connectTo(const LoadOptions &options) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(options.port));
+  if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1 ||
+      connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) ==
+          -1) {
+    close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  return fd;
+}
+
+/**
+ * @brief Append a framed request to a client's output
+ */
+void queueRequest(const LoadOptions &options, Client &client) {
+  size_t command = client.next_command;
+  client.next_command = (command + 1) % options.commands.size();
+  const std::string &payload = options.commands[command];
+  if (options.length_prefixed) {
+    uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+    client.out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    client.out += payload;
+  } else {
+    client.out += payload;
+    client.out += '\n';
+  }
+  client.pending.push_back({command, Clock::now()});
+}
+
+/**
+ * @brief Split complete responses off a client's input
+ *
+ * JSON responses end in a newline (the encoder escapes newlines inside
+ * strings); length-prefixed ones carry a 4-byte big-endian length.
+ *
+ * @return The responses, each without framing
+ */
+std::vector<std::string> takeResponses(const LoadOptions &options,
+                                       Client &client) {
+  std::vector<std::string> responses;
+  size_t pos = 0;
+  while (pos < client.in.size()) {
+    if (options.length_prefixed) {
+      if (client.in.size() - pos < 4) {
+        break;
+      }
+      uint32_t length;
+      std::memcpy(&length, client.in.data() + pos, sizeof(length));
+      length = ntohl(length);
+      if (client.in.size() - pos - 4 < length) {
+        break;
+      }
+      responses.emplace_back(client.in, pos + 4, length);
+      pos += 4 + length;
+    } else {
+      size_t end = client.in.find('\n', pos);
+      if (end == std::string::npos) {
+        break;
+      }
+      if (end > pos) {
+        responses.emplace_back(client.in, pos, end - pos);
+      }
+      pos = end + 1;
+    }
+  }
+  client.in.erase(0, pos);
+  return responses;
+}
+
+/**
+ * @brief Drive a share of the connections until the deadline
+ */
+void runClients(const LoadOptions &options, std::vector<Client> &clients,
+                Clock::time_point measure_from, Clock::time_point deadline,
+                ThreadStats &stats) {
+  stats.latency.resize(options.commands.size());
+  stats.errors.assign(options.commands.size(), 0);
+  std::vector<pollfd> fds(clients.size());
+  char buffer[65536];
+
+  for (auto &client : clients) {
+    while (client.pending.size() < options.depth) {
+      queueRequest(options, client);
+    }
+  }
+
+  while (Clock::now() < deadline) {
+    size_t live = 0;
+    for (size_t i = 0; i < clients.size(); ++i) {
+      fds[i].fd = clients[i].failed ? -1 : clients[i].fd;
+      fds[i].events = POLLIN;
+      if (clients[i].out_offset < clients[i].out.size()) {
+        fds[i].events |= POLLOUT;
+      }
+      fds[i].revents = 0;
+      live += !clients[i].failed;
+    }
+    if (live == 0) {
+      break;
+    }
+    if (poll(fds.data(), fds.size(), 100) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+      Client &client = clients[i];
+      if (client.failed || fds[i].revents == 0) {
+        continue;
+      }
+      if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        client.failed = true;
+        continue;
+      }
+      if (fds[i].revents & POLLOUT) {
+        ssize_t sent =
+            send(client.fd, client.out.data() + client.out_offset,
+                 client.out.size() - client.out_offset, SEND_FLAGS);
+        if (sent > 0) {
+          client.out_offset += static_cast<size_t>(sent);
+          if (client.out_offset == client.out.size()) {
+            client.out.clear();
+            client.out_offset = 0;
+          }
+        } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+          client.failed = true;
+          continue;
+        }
+      }
+      if (fds[i].revents & POLLIN) {
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+          if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            client.failed = true;
+          }
+          continue;
+        }
+        client.in.append(buffer, static_cast<size_t>(received));
+        auto now = Clock::now();
+        for (const std::string &response : takeResponses(options, client)) {
+          if (client.pending.empty()) {
+            break; // more responses than requests: server misbehaved
+          }
+          InFlight request = client.pending.front();
+          client.pending.pop_front();
+          if (request.sent >= measure_from) {
+            stats.bytes_received += response.size();
+            stats.latency[request.command].add(now - request.sent);
+            if (response.find(R"("status":"error")") != std::string::npos) {
+              ++stats.errors[request.command];
+            }
+          }
+          queueRequest(options, client);
+        }
+      }
+    }
+  }
+
+  for (auto &client : clients) {
+    stats.failed_connections += client.failed;
+    close(client.fd);
+  }
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "  --host ADDR         server address (default: 127.0.0.1)\n"
+            << "  --port N            server port (default: 8080)\n"
+            << "  --connections N     concurrent clients (default: 16)\n"
+            << "  --depth N           requests in flight per client "
+               "(default: 1)\n"
+            << "  --threads N         driver threads (default: one per "
+               "CPU)\n"
+            << "  --duration S        measured seconds (default: 10)\n"
+            << "  --warmup S          unmeasured seconds first (default: 1)\n"
+            << "  --command JSON      request to send; repeat for a "
+               "round-robin mix\n"
+            << "                      (default: get_process_table)\n"
+            << "  --length-prefixed   frame requests with a length header\n"
+            << "  --label TEXT        run label, e.g. a release tag\n"
+            << "  --output FILE       append results to FILE instead of "
+               "stdout\n"
+            << "  --help              Show this message" << std::endl;
+}
+
+std::optional<LoadOptions> parseArguments(int argc, char *argv[]) {
+  LoadOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    bool has_value = i + 1 < argc;
+    try {
+      if (arg == "--host" && has_value) {
+        options.host = argv[++i];
+      } else if (arg == "--port" && has_value) {
+        options.port = std::stoi(argv[++i]);
+      } else if (arg == "--connections" && has_value) {
+        options.connections = std::max(1ul, std::stoul(argv[++i]));
+      } else if (arg == "--depth" && has_value) {
+        options.depth = std::max(1ul, std::stoul(argv[++i]));
+      } else if (arg == "--threads" && has_value) {
+        options.threads = std::stoul(argv[++i]);
+      } else if (arg == "--duration" && has_value) {
+        options.duration = std::chrono::seconds(std::stoul(argv[++i]));
+      } else if (arg == "--warmup" && has_value) {
+        options.warmup = std::chrono::seconds(std::stoul(argv[++i]));
+      } else if (arg == "--command" && has_value) {
+        options.commands.push_back(argv[++i]);
+      } else if (arg == "--length-prefixed") {
+        options.length_prefixed = true;
+      } else if (arg == "--label" && has_value) {
+        options.label = argv[++i];
+      } else if (arg == "--output" && has_value) {
+        options.output = argv[++i];
+      } else if (arg == "--help") {
+        printUsage(argv[0]);
+        return std::nullopt;
+      } else {
+        std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+        printUsage(argv[0]);
+        return std::nullopt;
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Invalid value for " << arg << ": " << e.what()
+                << std::endl;
+      return std::nullopt;
+    }
+  }
+  if (options.commands.empty()) {
+    options.commands.push_back(R"({"command":"get_process_table"})");
+  }
+  return options;
+}
+
+/**
+ * @brief The "command" field of a request, for labelling results
+ */
+std::string commandName(const std::string &request) {
+  const std::string key = R"("command":")";
+  size_t start = request.find(key);
+  if (start == std::string::npos) {
+    return request;
+  }
+  start += key.size();
+  size_t end = request.find('"', start);
+  return request.substr(start, end == std::string::npos ? end : end - start);
+}
+} // namespace
+
+/**
+ * @brief Main entry point for the load generator
+ */
+int main(int argc, char *argv[]) {
+  auto options_opt = parseArguments(argc, argv);
+  if (!options_opt) {
+    return 1;
+  }
+  const LoadOptions &options = *options_opt;
+
+  unsigned threads = options.threads;
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, options.connections);
+
+  std::vector<std::vector<Client>> shares(threads);
+  for (unsigned i = 0; i < options.connections; ++i) {
+    Client client;
+    client.fd = connectTo(options);
+    if (client.fd == -1) {
+      std::error_code ec(errno, std::system_category());
+      std::cerr << "Failed to connect to " << options.host << ":"
+                << options.port << ": " << ec.message() << std::endl;
+      return 1;
+    }
+    shares[i % threads].push_back(std::move(client));
+  }
+
+  auto start = Clock::now();
+  auto measure_from = start + options.warmup;
+  auto deadline = measure_from + options.duration;
+  std::vector<ThreadStats> stats(threads);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i) {
+    workers.emplace_back(runClients, std::cref(options), std::ref(shares[i]),
+                         measure_from, deadline, std::ref(stats[i]));
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  std::ofstream file;
+  if (!options.output.empty()) {
+    file.open(options.output, std::ios::app);
+    if (!file) {
+      std::cerr << "Failed to open " << options.output << std::endl;
+      return 1;
+    }
+  }
+  qnx::BenchReporter reporter(options.output.empty() ? std::cout : file,
+                              "load", options.label);
+
+  const std::vector<std::pair<std::string, std::string>> shared = {
+      {"connections", std::to_string(options.connections)},
+      {"depth", std::to_string(options.depth)},
+      {"framing", options.length_prefixed ? "length" : "json"}};
+
+  qnx::BenchResult total;
+  total.name = "load";
+  total.params = shared;
+  total.params.emplace_back("command", "all");
+  total.elapsed = options.duration;
+  uint64_t bytes = 0;
+  unsigned failed = 0;
+  for (size_t c = 0; c < options.commands.size(); ++c) {
+    qnx::BenchResult result;
+    result.name = "load";
+    result.params = shared;
+    result.params.emplace_back("command", commandName(options.commands[c]));
+    result.elapsed = options.duration;
+    for (const auto &thread : stats) {
+      result.latency.merge(thread.latency[c]);
+      result.errors += thread.errors[c];
+    }
+    result.operations = result.latency.size();
+    total.latency.merge(result.latency);
+    total.errors += result.errors;
+    if (options.commands.size() > 1) {
+      reporter.report(result);
+    }
+  }
+  for (const auto &thread : stats) {
+    bytes += thread.bytes_received;
+    failed += thread.failed_connections;
+  }
+  total.operations = total.latency.size();
+  total.params.emplace_back("bytes_received", std::to_string(bytes));
+  total.params.emplace_back("failed_connections", std::to_string(failed));
+  reporter.report(total);
+  return failed == 0 ? 0 : 2;
+}
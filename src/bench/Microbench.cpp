@@ -0,0 +1,410 @@
+/**
+ * @file Microbench.cpp
+ * @brief Microbenchmarks for the QNX Remote Process Monitor
+ *
+ * Runs the collector, the request path, process history and group
+ * statistics in-process against the server's own singletons and reports
+ * each as a JSON line (see BenchReport.hpp). Run it on the target or on a
+ * Linux host: the collector reads the real /proc through the platform's
+ * process source unless pointed at a synthetic tree or workload.
+ *
+ * A synthetic tree holds numbered directories with empty ctl, as and
+ * vmstat entries and a fixed stat line. It measures what the collector
+ * spends per PID on listing, handle caching and merging, independent of
+ * how many processes the machine actually runs; entries that cannot answer
+ * devctl() are dropped from the snapshot like processes that exited
+ * mid-read, while the Linux source reads them in full. The replay source
+ * measures the collector with no /proc traffic at all.
+ */
+
+#include "bench/BenchReport.hpp"
+#include "server/JsonHandler.hpp"
+#include "server/LinuxProcessSource.hpp"
+#include "server/ProcessCore.hpp"
+#include "server/ProcessGroup.hpp"
+#include "server/ProcessHistory.hpp"
+#include "server/ReplayProcessSource.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+/// Every benchmark runs at least this many operations, however slow
+constexpr uint64_t MIN_OPERATIONS = 5;
+
+/// A stat line with the awkward parts: a name with spaces and parentheses
+constexpr char STAT_LINE[] =
+    "4242 (bench (worker) 1) S 1 4242 4242 0 -1 4194560 1830 0 0 0 5120 "
+    "733 0 0 20 0 8 0 91023 1258291200 30564 18446744073709551615 1 1 0 "
+    "0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0\n";
+
+/**
+ * @brief Options controlling a benchmark run
+ */
+struct BenchOptions {
+  std::string filter; ///< Only run benchmarks whose name contains this
+  std::chrono::milliseconds min_time{500}; ///< Per benchmark and setting
+  std::vector<size_t> sizes{100, 1000, 10000}; ///< Synthetic process counts
+  std::string label;                           ///< Copied into every result
+  std::string output;                          ///< Empty = stdout
+};
+
+/**
+ * @brief Run an operation repeatedly and time every run
+ *
+ * @param options The run options
+ * @param name The benchmark name
+ * @param params Parameters of this setting
+ * @param op Returns false if the operation failed
+ * @return The result
+ */
+template <typename Op>
+qnx::BenchResult runTimed(const BenchOptions &options, std::string name,
+                          Params params, Op op) {
+  qnx::BenchResult result;
+  result.name = std::move(name);
+  result.params = std::move(params);
+
+  auto start = Clock::now();
+  auto deadline = start + options.min_time;
+  Clock::time_point end;
+  do {
+    auto begin = Clock::now();
+    bool ok = op();
+    end = Clock::now();
+    result.latency.add(end - begin);
+    ++result.operations;
+    if (!ok) {
+      ++result.errors;
+    }
+  } while (end < deadline || result.operations < MIN_OPERATIONS);
+  result.elapsed = end - start;
+  return result;
+}
+
+/**
+ * @class SyntheticProc
+ * @brief A throwaway directory laid out like /proc
+ */
+class SyntheticProc {
+public:
+  explicit SyntheticProc(size_t count) {
+    char root[] = "/tmp/qrpm-bench-proc-XXXXXX";
+    if (!mkdtemp(root)) {
+      std::error_code ec(errno, std::system_category());
+      std::cerr << "Failed to create synthetic /proc: " << ec.message()
+                << std::endl;
+      return;
+    }
+    root_ = root;
+    for (size_t pid = 1; pid <= count; ++pid) {
+      std::filesystem::path dir =
+          std::filesystem::path(root_) / std::to_string(pid);
+      std::filesystem::create_directory(dir);
+      for (const char *entry : {"ctl", "as", "vmstat"}) {
+        std::ofstream(dir / entry).flush();
+      }
+      std::ofstream(dir / "stat")
+          << pid << " (bench) S 1 " << pid << " " << pid
+          << " 0 -1 4194560 100 0 0 0 " << pid % 97 << " " << pid % 13
+          << " 0 0 20 0 1 0 " << pid << " 1048576 " << pid % 512 + 1
+          << " 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0\n";
+    }
+  }
+
+  ~SyntheticProc() {
+    if (!root_.empty()) {
+      std::error_code ec;
+      std::filesystem::remove_all(root_, ec);
+    }
+  }
+
+  SyntheticProc(const SyntheticProc &) = delete;
+  SyntheticProc &operator=(const SyntheticProc &) = delete;
+
+  const std::string &root() const noexcept { return root_; }
+
+private:
+  std::string root_; ///< Empty if creation failed
+};
+
+void benchCollect(const BenchOptions &options, qnx::BenchReporter &reporter) {
+  auto &proc_core = qnx::ProcessCore::getInstance();
+  std::string threads = std::to_string(proc_core.getCollectorThreads());
+
+  std::string source = proc_core.getProcessSourceName();
+
+  int processes = proc_core.collectInfo().value_or(0);
+  reporter.report(runTimed(
+      options, "collect",
+      {{"processes", std::to_string(processes)},
+       {"collector_threads", threads},
+       {"source", source}},
+      [&] { return proc_core.collectInfo().has_value(); }));
+
+  for (size_t size : options.sizes) {
+    SyntheticProc tree(size);
+    if (tree.root().empty()) {
+      continue;
+    }
+    proc_core.setProcessSource(qnx::createProcessSource(source, tree.root()));
+    proc_core.collectInfo(); // opens the handles the timed runs reuse
+    reporter.report(runTimed(
+        options, "collect_synthetic",
+        {{"processes", std::to_string(size)},
+         {"collector_threads", threads},
+         {"source", source}},
+        [&] { return proc_core.collectInfo().has_value(); }));
+  }
+
+  for (size_t size : options.sizes) {
+    qnx::ReplayProcessSource::Workload workload;
+    workload.processes = size;
+    proc_core.setProcessSource(
+        std::make_unique<qnx::ReplayProcessSource>(workload));
+    proc_core.collectInfo();
+    reporter.report(runTimed(
+        options, "collect_replay",
+        {{"processes", std::to_string(size)}, {"collector_threads", threads}},
+        [&] { return proc_core.collectInfo().has_value(); }));
+  }
+  proc_core.setProcessSource(qnx::createProcessSource(source, "/proc"));
+  proc_core.collectInfo();
+
+  const char *line_end = STAT_LINE + sizeof(STAT_LINE) - 1;
+  reporter.report(runTimed(options, "collect_parse_stat", {}, [&] {
+    qnx::ProcessSample sample;
+    return qnx::LinuxProcessSource::parseStat(STAT_LINE, line_end, 10000000,
+                                              4096, sample) &&
+           sample.pid == 4242;
+  }));
+}
+
+void benchCommands(const BenchOptions &options,
+                   qnx::BenchReporter &reporter) {
+  auto &proc_core = qnx::ProcessCore::getInstance();
+  // A second generation so the delta has a base to diff against
+  proc_core.collectInfo();
+  proc_core.collectInfo();
+  uint64_t base = proc_core.getGeneration() - 1;
+  std::string self = std::to_string(getpid());
+  std::string processes = std::to_string(proc_core.getCount());
+
+  const std::vector<std::pair<std::string, std::string>> requests = {
+      {"get_processes", R"({"command":"get_processes"})"},
+      {"get_process_info",
+       R"({"command":"get_process_info","pid":)" + self + "}"},
+      {"get_process_table", R"({"command":"get_process_table"})"},
+      {"get_process_table_delta",
+       R"({"command":"get_process_table_delta","since":)" +
+           std::to_string(base) + "}"},
+      {"get_process_tree", R"({"command":"get_process_tree","pid":1})"},
+      {"get_process_history",
+       R"({"command":"get_process_history","pid":)" + self + "}"},
+      {"get_hot_threads", R"({"command":"get_hot_threads"})"},
+      {"get_server_metrics", R"({"command":"get_server_metrics"})"},
+  };
+  for (const auto &request : requests) {
+    size_t bytes = 0;
+    qnx::BenchResult result = runTimed(
+        options, "command",
+        {{"command", request.first}, {"processes", processes}}, [&] {
+          std::string response = qnx::handleMessage(-1, request.second);
+          bytes = response.size();
+          return response.find(R"("status":"error")") == std::string::npos;
+        });
+    result.params.emplace_back("response_bytes", std::to_string(bytes));
+    reporter.report(result);
+  }
+}
+
+void benchHistory(const BenchOptions &options, qnx::BenchReporter &reporter) {
+  auto &history = qnx::ProcessHistory::getInstance();
+  for (size_t size : options.sizes) {
+    qnx::ProcessSnapshot snapshot;
+    snapshot.processes.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+      qnx::ProcessInfo &info = snapshot.processes[i];
+      info = {};
+      info.pid = static_cast<pid_t>(i + 1);
+      info.cpu_usage = static_cast<double>(i % 100);
+      info.memory_usage = 1024 * (i % 512 + 1);
+      snapshot.index.emplace(info.pid, i);
+    }
+
+    history.clearAllHistory();
+    reporter.report(runTimed(options, "history_ingest",
+                             {{"processes", std::to_string(size)}}, [&] {
+                               history.ingestSnapshot(snapshot);
+                               return true;
+                             }));
+
+    // Query a series that has been filled for as long as ingest ran
+    pid_t pid = 1;
+    reporter.report(runTimed(
+        options, "history_view", {{"processes", std::to_string(size)}}, [&] {
+          qnx::HistoryView view = history.getHistory(pid);
+          double total = 0.0;
+          for (const qnx::ProcessHistoryEntry entry : view) {
+            total += entry.cpu_usage;
+          }
+          return !view.empty() && total >= 0.0;
+        }));
+    time_t now = std::time(nullptr);
+    reporter.report(runTimed(
+        options, "history_range",
+        {{"processes", std::to_string(size)}, {"max_points", "500"}}, [&] {
+          return !history.getHistoryRange(pid, now - 3600, now + 1, 500)
+                      .points.empty();
+        }));
+  }
+  history.clearAllHistory();
+}
+
+void benchGroups(const BenchOptions &options, qnx::BenchReporter &reporter) {
+  auto &proc_core = qnx::ProcessCore::getInstance();
+  auto &groups = qnx::ProcessGroup::getInstance();
+  qnx::ProcessSnapshotPtr snapshot = proc_core.getSnapshot();
+
+  for (size_t count : options.sizes) {
+    std::vector<int> ids;
+    for (size_t i = 0; i < count; ++i) {
+      int id = groups.createGroup("bench-" + std::to_string(i), 0);
+      if (id != -1) {
+        ids.push_back(id);
+      }
+    }
+    if (ids.empty()) {
+      continue;
+    }
+    // Spread the live processes over the groups; only live PIDs are taken
+    size_t members = 0;
+    for (size_t i = 0; i < snapshot->processes.size(); ++i) {
+      members += groups.addProcessToGroup(snapshot->processes[i].pid,
+                                          ids[i % ids.size()]);
+    }
+    proc_core.collectInfo(); // sums the totals against the new membership
+
+    reporter.report(runTimed(options, "group_stats",
+                             {{"groups", std::to_string(ids.size())},
+                              {"members", std::to_string(members)}},
+                             [&] {
+                               groups.updateGroupStats();
+                               return true;
+                             }));
+    for (int id : ids) {
+      groups.deleteGroup(id);
+    }
+  }
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "  --filter NAME     only run benchmarks containing NAME "
+               "(collect, command, history, group)\n"
+            << "  --min-time MS     time spent on each setting "
+               "(default: 500)\n"
+            << "  --sizes N,N,...   synthetic process and group counts "
+               "(default: 100,1000,10000)\n"
+            << "  --label TEXT      run label, e.g. a release tag\n"
+            << "  --output FILE     append results to FILE instead of "
+               "stdout\n"
+            << "  --help            Show this message" << std::endl;
+}
+
+std::optional<BenchOptions> parseArguments(int argc, char *argv[]) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    bool has_value = i + 1 < argc;
+    try {
+      if (arg == "--filter" && has_value) {
+        options.filter = argv[++i];
+      } else if (arg == "--min-time" && has_value) {
+        options.min_time = std::chrono::milliseconds(std::stoul(argv[++i]));
+      } else if (arg == "--sizes" && has_value) {
+        options.sizes.clear();
+        std::string list(argv[++i]);
+        size_t pos = 0;
+        while (pos < list.size()) {
+          size_t comma = list.find(',', pos);
+          if (comma == std::string::npos) {
+            comma = list.size();
+          }
+          options.sizes.push_back(std::stoul(list.substr(pos, comma - pos)));
+          pos = comma + 1;
+        }
+      } else if (arg == "--label" && has_value) {
+        options.label = argv[++i];
+      } else if (arg == "--output" && has_value) {
+        options.output = argv[++i];
+      } else if (arg == "--help") {
+        printUsage(argv[0]);
+        return std::nullopt;
+      } else {
+        std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+        printUsage(argv[0]);
+        return std::nullopt;
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Invalid value for " << arg << ": " << e.what()
+                << std::endl;
+      return std::nullopt;
+    }
+  }
+  return options;
+}
+} // namespace
+
+/**
+ * @brief Main entry point for the microbenchmarks
+ */
+int main(int argc, char *argv[]) {
+  auto options_opt = parseArguments(argc, argv);
+  if (!options_opt) {
+    return 1;
+  }
+  const BenchOptions &options = *options_opt;
+
+  std::ofstream file;
+  if (!options.output.empty()) {
+    file.open(options.output, std::ios::app);
+    if (!file) {
+      std::cerr << "Failed to open " << options.output << std::endl;
+      return 1;
+    }
+  }
+  qnx::BenchReporter reporter(options.output.empty() ? std::cout : file,
+                              "micro", options.label);
+
+  const std::vector<std::pair<const char *, void (*)(const BenchOptions &,
+                                                    qnx::BenchReporter &)>>
+      benches = {{"collect", benchCollect},
+                 {"command", benchCommands},
+                 {"history", benchHistory},
+                 {"group", benchGroups}};
+
+  // Everything else reads the snapshot the first collection publishes
+  if (!qnx::ProcessCore::getInstance().collectInfo()) {
+    std::cerr << "Initial collection failed" << std::endl;
+    return 1;
+  }
+  for (const auto &bench : benches) {
+    if (options.filter.empty() ||
+        std::string(bench.first).find(options.filter) != std::string::npos) {
+      bench.second(options, reporter);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file BinaryProtocol.cpp
+ * @brief Implementation of the compact binary response encoding for QNX
+ * Remote Process Monitor
+ *
+ * Integers are serialized byte by byte so the encoding is independent of the
+ * host's endianness and alignment.
+ */
+
+#include "server/BinaryProtocol.hpp"
+#include "server/JsonWriter.hpp" // ProcessField
+#include "server/ProcessCore.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace qnx::BinaryProtocol {
+/**
+ * @brief Convert a CPU percentage to the wire's hundredths of a percent
+ *
+ * @param cpu_usage CPU usage in percent
+ * @return The rounded, clamped wire value
+ */
+uint32_t cpuToWire(double cpu_usage) noexcept {
+  if (!(cpu_usage > 0.0)) {
+    return 0; // also catches NaN
+  }
+  double scaled = std::round(cpu_usage * 100.0);
+  return scaled >= 4294967295.0 ? UINT32_MAX : static_cast<uint32_t>(scaled);
+}
+
+void Writer::putU16(uint16_t value) {
+  putU8(static_cast<uint8_t>(value));
+  putU8(static_cast<uint8_t>(value >> 8));
+}
+
+void Writer::putU32(uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    putU8(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void Writer::putU64(uint64_t value) {
+  for (int shift = 0; shift < 64; shift += 8) {
+    putU8(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void Writer::putVarint(uint64_t value) {
+  while (value >= 0x80) {
+    putU8(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  putU8(static_cast<uint8_t>(value));
+}
+
+void Writer::putSvarint(int64_t value) {
+  // Zigzag: small magnitudes of either sign become small unsigned values
+  putVarint((static_cast<uint64_t>(value) << 1) ^
+            static_cast<uint64_t>(value >> 63));
+}
+
+void Writer::putBytes(std::string_view bytes) {
+  out_.append(bytes.data(), bytes.size());
+}
+
+void Writer::putHeader(MessageType type) {
+  putU8('Q');
+  putU8('B');
+  putU8(VERSION);
+  putU8(static_cast<uint8_t>(type));
+}
+
+size_t Writer::reserveU32() {
+  size_t offset = out_.size();
+  putU32(0);
+  return offset;
+}
+
+void Writer::patchU32(size_t offset, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out_[offset + i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+/**
+ * @brief Write one process row
+ *
+ * @param info The process to write
+ * @param fields ProcessField bitmask of the columns to include
+ * @param previous_pid PID of the previous row in the section; updated
+ */
+void Writer::putProcessRow(const ProcessInfo &info, unsigned fields,
+                           pid_t &previous_pid) {
+  putSvarint(static_cast<int64_t>(info.pid) - previous_pid);
+  previous_pid = info.pid;
+  if (fields & FIELD_PARENT_PID)
+    putSvarint(static_cast<int64_t>(info.parent_pid) - info.pid);
+  if (fields & FIELD_NAME) {
+    putVarint(info.name.size());
+    putBytes(info.name);
+  }
+  if (fields & FIELD_CPU_USAGE)
+    putU32(cpuToWire(info.cpu_usage));
+  if (fields & FIELD_MEMORY_USAGE)
+    putU32(static_cast<uint32_t>(
+        std::min<uint64_t>(info.memory_usage / 1024, UINT32_MAX)));
+  if (fields & FIELD_THREADS)
+    putU16(static_cast<uint16_t>(std::clamp(info.num_threads, 0, 65535)));
+  if (fields & FIELD_PRIORITY)
+    putU8(static_cast<uint8_t>(info.priority));
+  if (fields & FIELD_POLICY)
+    putU8(static_cast<uint8_t>(info.policy));
+  if (fields & FIELD_STATE)
+    putU8(static_cast<uint8_t>(info.state));
+}
+
+/**
+ * @brief Write the fields of a process that changed between two samples
+ *
+ * Numeric fields are sent as deltas from the base sample, which the client
+ * already holds.
+ *
+ * @return false (and nothing written) if no field changed
+ */
+bool Writer::putProcessChange(const ProcessInfo &before,
+                              const ProcessInfo &after, pid_t &previous_pid) {
+  int64_t cpu_delta = static_cast<int64_t>(cpuToWire(after.cpu_usage)) -
+                      static_cast<int64_t>(cpuToWire(before.cpu_usage));
+  int64_t memory_delta = static_cast<int64_t>(after.memory_usage / 1024) -
+                         static_cast<int64_t>(before.memory_usage / 1024);
+  uint8_t mask = 0;
+  if (cpu_delta != 0)
+    mask |= CHANGE_CPU;
+  if (memory_delta != 0)
+    mask |= CHANGE_MEMORY;
+  if (after.num_threads != before.num_threads)
+    mask |= CHANGE_THREADS;
+  if (after.priority != before.priority)
+    mask |= CHANGE_PRIORITY;
+  if (after.state != before.state)
+    mask |= CHANGE_STATE;
+  if (mask == 0) {
+    return false;
+  }
+
+  putSvarint(static_cast<int64_t>(after.pid) - previous_pid);
+  previous_pid = after.pid;
+  putU8(mask);
+  if (mask & CHANGE_CPU)
+    putSvarint(cpu_delta);
+  if (mask & CHANGE_MEMORY)
+    putSvarint(memory_delta);
+  if (mask & CHANGE_THREADS)
+    putSvarint(after.num_threads - before.num_threads);
+  if (mask & CHANGE_PRIORITY)
+    putU8(static_cast<uint8_t>(after.priority));
+  if (mask & CHANGE_STATE)
+    putU8(static_cast<uint8_t>(after.state));
+  return true;
+}
+
+/**
+ * @brief Apply the change to the sample it was computed against
+ *
+ * CPU and memory are reconstructed from the wire values of the base, so a
+ * client applying every change in turn stays exact.
+ *
+ * @param info The base sample; updated in place
+ */
+void ProcessChange::applyTo(ProcessInfo &info) const noexcept {
+  if (mask & CHANGE_CPU) {
+    int64_t cpu = static_cast<int64_t>(cpuToWire(info.cpu_usage)) + cpu_delta;
+    info.cpu_usage = static_cast<double>(std::max<int64_t>(cpu, 0)) / 100.0;
+  }
+  if (mask & CHANGE_MEMORY) {
+    int64_t memory_kb =
+        static_cast<int64_t>(info.memory_usage / 1024) + memory_delta;
+    info.memory_usage =
+        static_cast<uint64_t>(std::max<int64_t>(memory_kb, 0)) * 1024;
+  }
+  if (mask & CHANGE_THREADS)
+    info.num_threads += static_cast<int>(threads_delta);
+  if (mask & CHANGE_PRIORITY)
+    info.priority = priority;
+  if (mask & CHANGE_STATE)
+    info.state = state;
+}
+
+/**
+ * @brief Claim the next bytes of the frame
+ *
+ * @param length Number of bytes wanted
+ * @return false (and the reader marked failed) if fewer are left
+ */
+bool Reader::take(size_t length) {
+  if (failed_ || in_.size() - pos_ < length) {
+    failed_ = true;
+    return false;
+  }
+  pos_ += length;
+  return true;
+}
+
+uint8_t Reader::getU8() {
+  return take(1) ? static_cast<uint8_t>(in_[pos_ - 1]) : 0;
+}
+
+uint16_t Reader::getU16() {
+  uint16_t low = getU8();
+  return static_cast<uint16_t>(low | (getU8() << 8));
+}
+
+uint32_t Reader::getU32() {
+  uint32_t value = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    value |= static_cast<uint32_t>(getU8()) << shift;
+  }
+  return value;
+}
+
+uint64_t Reader::getU64() {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 8) {
+    value |= static_cast<uint64_t>(getU8()) << shift;
+  }
+  return value;
+}
+
+uint64_t Reader::getVarint() {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = getU8();
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  failed_ = true; // Longer than any 64-bit value
+  return 0;
+}
+
+int64_t Reader::getSvarint() {
+  uint64_t value = getVarint();
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+std::string_view Reader::getBytes(size_t length) {
+  return take(length) ? in_.substr(pos_ - length, length) : std::string_view();
+}
+
+bool Reader::getHeader(MessageType &type) {
+  bool valid = getU8() == 'Q' && getU8() == 'B' && getU8() == VERSION;
+  type = static_cast<MessageType>(getU8());
+  return valid && !failed_;
+}
+
+/**
+ * @brief Read one process row
+ *
+ * @param info Receives the row; its name views the frame
+ * @param fields ProcessField bitmask the rows were written with
+ * @param previous_pid PID of the previous row in the section; updated
+ */
+void Reader::getProcessRow(ProcessInfo &info, unsigned fields,
+                           pid_t &previous_pid) {
+  info.pid = static_cast<pid_t>(previous_pid + getSvarint());
+  previous_pid = info.pid;
+  if (fields & FIELD_PARENT_PID)
+    info.parent_pid = static_cast<pid_t>(info.pid + getSvarint());
+  if (fields & FIELD_NAME)
+    info.name = getBytes(getVarint());
+  if (fields & FIELD_CPU_USAGE)
+    info.cpu_usage = getU32() / 100.0;
+  if (fields & FIELD_MEMORY_USAGE)
+    info.memory_usage = static_cast<uint64_t>(getU32()) * 1024;
+  if (fields & FIELD_THREADS)
+    info.num_threads = getU16();
+  if (fields & FIELD_PRIORITY)
+    info.priority = getU8();
+  if (fields & FIELD_POLICY)
+    info.policy = getU8();
+  if (fields & FIELD_STATE)
+    info.state = getU8();
+}
+
+/**
+ * @brief Read one change record
+ *
+ * @param change Receives the record
+ * @param previous_pid PID of the previous change record; updated
+ */
+void Reader::getProcessChange(ProcessChange &change, pid_t &previous_pid) {
+  change.pid = static_cast<pid_t>(previous_pid + getSvarint());
+  previous_pid = change.pid;
+  change.mask = getU8();
+  if (change.mask & CHANGE_CPU)
+    change.cpu_delta = getSvarint();
+  if (change.mask & CHANGE_MEMORY)
+    change.memory_delta = getSvarint();
+  if (change.mask & CHANGE_THREADS)
+    change.threads_delta = getSvarint();
+  if (change.mask & CHANGE_PRIORITY)
+    change.priority = getU8();
+  if (change.mask & CHANGE_STATE)
+    change.state = getU8();
+}
+} // namespace qnx::BinaryProtocol
@@ -0,0 +1,908 @@
+/**
+ * @file FleetGateway.cpp
+ * @brief Implementation of multi-target aggregation for QNX Remote Process
+ * Monitor
+ *
+ * Each upstream connection runs through connect, login ("encoding":
+ * "binary"), subscribe ("scope": "all", "delta": true) and then streams
+ * PROCESS_UPDATE frames. An update is applied to a copy of the mirror,
+ * resolved through the mirror's PID index, so readers holding the previous
+ * table are never disturbed. Updates are coalesced: the fleet view is
+ * republished at most every PUBLISH_INTERVAL, and only the nodes that
+ * changed are rebuilt.
+ */
+
+#include "server/FleetGateway.hpp"
+#include "server/BinaryProtocol.hpp"
+#include "server/JsonWriter.hpp"
+#include "server/StringTable.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <sys/json.h> // QNX native JSON library
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+namespace qnx {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+/// Longest the gateway thread waits in poll() before checking timers
+constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+/// Updates arriving closer together than this are published together
+constexpr std::chrono::milliseconds PUBLISH_INTERVAL{100};
+/// Reconnect delays, doubled after every failed attempt
+constexpr std::chrono::milliseconds MIN_BACKOFF{500};
+constexpr std::chrono::milliseconds MAX_BACKOFF{30000};
+/// Shortest silence after which an upstream is considered gone
+constexpr std::chrono::milliseconds MIN_STALL_TIMEOUT{10000};
+
+/// Longest process name kept from an upstream (QNX's PATH_MAX)
+constexpr size_t MAX_NAME_LENGTH = 1024;
+/// Upstream names are only interned while the string table stays below
+/// this; entries live for the process lifetime, and upstreams are not
+/// trusted to keep their set of names small
+constexpr size_t MAX_NAME_BYTES = 16 * 1024 * 1024;
+/// Stands in for names that no longer fit
+constexpr std::string_view OVERFLOW_NAME = "<unknown>";
+
+/**
+ * @brief Intern a process name received from an upstream, within bounds
+ *
+ * Names longer than MAX_NAME_LENGTH are cut at a UTF-8 character boundary.
+ * Once the string table is full, new names are reported as OVERFLOW_NAME.
+ */
+InternedString internUpstreamName(std::string_view name) {
+  if (name.size() > MAX_NAME_LENGTH) {
+    size_t length = MAX_NAME_LENGTH;
+    while (length > 0 && (static_cast<unsigned char>(name[length]) & 0xC0) ==
+                             0x80) {
+      --length;
+    }
+    name = name.substr(0, length);
+  }
+  StringTable &names = StringTable::getInstance();
+  if (auto interned = names.tryIntern(name, MAX_NAME_BYTES)) {
+    return *interned;
+  }
+  static bool warned = false; // Gateway thread only
+  if (!warned) {
+    std::cerr << "Upstream process names exceed " << MAX_NAME_BYTES
+              << " bytes; reporting new names as " << OVERFLOW_NAME
+              << std::endl;
+    warned = true;
+  }
+  return names.intern(OVERFLOW_NAME);
+}
+
+void addTotals(ResourceTotals &into, const ResourceTotals &from) {
+  into.cpu_usage += from.cpu_usage;
+  into.memory_usage += from.memory_usage;
+  into.num_processes += from.num_processes;
+}
+
+/**
+ * @brief Read the status of a JSON reply
+ *
+ * @param frame The reply
+ * @param message Receives the reply's "message", if any
+ * @return true if the status is "success"
+ */
+bool replySucceeded(const std::string &frame, std::string &message) {
+  json_decoder_t *decoder = json_decoder_create();
+  bool success = false;
+  if (json_decoder_parse_json_str(decoder, frame.c_str()) ==
+          JSON_DECODER_OK &&
+      json_decoder_push_object(decoder, NULL, false) == JSON_DECODER_OK) {
+    const char *status = NULL;
+    const char *text = NULL;
+    json_decoder_get_string(decoder, "status", &status, false);
+    success = status && std::strcmp(status, "success") == 0;
+    if (json_decoder_get_string(decoder, "message", &text, true) ==
+            JSON_DECODER_OK &&
+        text) {
+      message = text;
+    }
+  } else {
+    message = "Invalid reply";
+  }
+  json_decoder_destroy(decoder);
+  return success;
+}
+} // namespace
+
+/**
+ * @brief Parse an upstream given as "[name=]host[:port]"
+ *
+ * @param spec The specification; the name defaults to "host:port"
+ * @return The target, or std::nullopt if the specification is malformed
+ */
+std::optional<UpstreamTarget> parseUpstreamTarget(std::string_view spec) {
+  UpstreamTarget target;
+  size_t equals = spec.find('=');
+  if (equals != std::string_view::npos) {
+    target.name = std::string(spec.substr(0, equals));
+    spec.remove_prefix(equals + 1);
+  }
+  size_t colon = spec.rfind(':');
+  if (colon != std::string_view::npos) {
+    std::string_view port = spec.substr(colon + 1);
+    int value = 0;
+    auto result =
+        std::from_chars(port.data(), port.data() + port.size(), value);
+    if (result.ec != std::errc() || result.ptr != port.data() + port.size() ||
+        value <= 0 || value > 65535) {
+      return std::nullopt;
+    }
+    target.port = value;
+    spec = spec.substr(0, colon);
+  }
+  if (spec.empty() || (equals != std::string_view::npos &&
+                       target.name.empty())) {
+    return std::nullopt;
+  }
+  target.host = std::string(spec);
+  if (target.name.empty()) {
+    target.name = target.host + ":" + std::to_string(target.port);
+  }
+  return target;
+}
+
+/**
+ * @brief Name of a state as reported to clients
+ */
+const char *upstreamStateName(UpstreamState state) noexcept {
+  switch (state) {
+  case UpstreamState::Connecting:
+    return "connecting";
+  case UpstreamState::LoggingIn:
+    return "logging_in";
+  case UpstreamState::Subscribing:
+    return "subscribing";
+  case UpstreamState::Streaming:
+    return "streaming";
+  default:
+    return "disconnected";
+  }
+}
+
+/**
+ * @brief Look a node up by name
+ *
+ * @param name The node name
+ * @return Its index, or std::nullopt if there is no such node
+ */
+std::optional<uint32_t> FleetSnapshot::findNode(std::string_view name) const {
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i]->name == name) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Look up a process of one node without copying it
+ *
+ * @param node Index of the node
+ * @param pid The process ID on that node
+ * @return Pointer into the node's table, or nullptr if it is not present
+ */
+const ProcessInfo *FleetSnapshot::find(uint32_t node, pid_t pid) const
+    noexcept {
+  return node < nodes.size() ? nodes[node]->table->find(pid) : nullptr;
+}
+
+/**
+ * @brief The busiest processes across all nodes
+ *
+ * Every node's rows are already ordered busiest first, so the node lists
+ * are merged through a heap holding one cursor per node.
+ *
+ * @param count Number of rows wanted
+ * @return Up to count rows, busiest first
+ */
+std::vector<FleetRow> FleetSnapshot::topCpu(size_t count) const {
+  struct Cursor {
+    uint32_t node;
+    size_t position; ///< Into the node's by_cpu
+  };
+  auto rowOf = [this](const Cursor &cursor) -> const ProcessInfo & {
+    const FleetNode &node = *nodes[cursor.node];
+    return node.table->processes[node.by_cpu[cursor.position]];
+  };
+  // Max-heap on CPU usage
+  auto less = [&rowOf](const Cursor &a, const Cursor &b) {
+    return rowOf(a).cpu_usage < rowOf(b).cpu_usage;
+  };
+
+  std::vector<Cursor> heap;
+  heap.reserve(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (!nodes[i]->by_cpu.empty()) {
+      heap.push_back({static_cast<uint32_t>(i), 0});
+    }
+  }
+  std::make_heap(heap.begin(), heap.end(), less);
+
+  std::vector<FleetRow> rows;
+  rows.reserve(std::min(count, static_cast<size_t>(totals.num_processes)));
+  while (rows.size() < count && !heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), less);
+    Cursor &cursor = heap.back();
+    rows.push_back({cursor.node, &rowOf(cursor)});
+    if (++cursor.position < nodes[cursor.node]->by_cpu.size()) {
+      std::push_heap(heap.begin(), heap.end(), less);
+    } else {
+      heap.pop_back();
+    }
+  }
+  return rows;
+}
+
+/**
+ * @brief Constructor: a link starts disconnected with an empty mirror
+ *
+ * @param target The upstream to connect to
+ */
+UpstreamLink::UpstreamLink(UpstreamTarget target)
+    : target(std::move(target)), backoff(MIN_BACKOFF),
+      table(std::make_shared<ProcessSnapshot>()) {}
+
+/**
+ * @brief Get the singleton instance of the FleetGateway class
+ *
+ * @return Reference to the singleton FleetGateway instance
+ */
+FleetGateway &FleetGateway::getInstance() {
+  static FleetGateway instance;
+  return instance;
+}
+
+/**
+ * @brief Destructor: closes the upstream connections
+ */
+FleetGateway::~FleetGateway() { stop(); }
+
+/**
+ * @brief Start aggregating the configured upstreams
+ *
+ * Publishes a view listing every node as disconnected, then starts the
+ * gateway thread, which makes the first connection attempts.
+ *
+ * @param config The upstreams and credentials
+ * @return false if already running, no upstream was given or two share a
+ * name
+ */
+bool FleetGateway::start(GatewayConfig config) {
+  if (running_ || config.upstreams.empty()) {
+    return false;
+  }
+  for (size_t i = 0; i < config.upstreams.size(); ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (config.upstreams[i].name == config.upstreams[j].name) {
+        std::cerr << "Duplicate upstream name: " << config.upstreams[i].name
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  config_ = std::move(config);
+  links_.clear();
+  links_.reserve(config_.upstreams.size());
+  for (const UpstreamTarget &target : config_.upstreams) {
+    links_.emplace_back(target);
+  }
+  publish(Clock::now());
+
+  stop_ = false;
+  running_ = true;
+  thread_ = std::thread(&FleetGateway::run, this);
+  return true;
+}
+
+/**
+ * @brief Close every upstream connection and stop the gateway thread
+ */
+void FleetGateway::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  stop_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+/**
+ * @brief Whether the server is running as a gateway
+ */
+bool FleetGateway::isRunning() const noexcept { return running_.load(); }
+
+/**
+ * @brief Get the current fleet view
+ *
+ * @return The latest published snapshot; empty, never null, before the
+ * gateway has started
+ */
+FleetSnapshotPtr FleetGateway::getSnapshot() const noexcept {
+  FleetSnapshotPtr snapshot = std::atomic_load(&snapshot_);
+  if (!snapshot) {
+    static const FleetSnapshotPtr empty =
+        std::make_shared<const FleetSnapshot>();
+    return empty;
+  }
+  return snapshot;
+}
+
+/**
+ * @brief Gateway thread: drive every upstream connection until stopped
+ */
+void FleetGateway::run() {
+  // An upstream pushes at least every interval; allow for a few misses
+  auto stall_timeout = std::max<Clock::duration>(MIN_STALL_TIMEOUT,
+                                                 config_.interval * 5);
+  std::vector<pollfd> fds;
+  std::vector<size_t> polled; ///< Link index of each entry of fds
+  Clock::time_point last_publish;
+
+  while (!stop_) {
+    auto now = Clock::now();
+    for (UpstreamLink &link : links_) {
+      if (link.state == UpstreamState::Disconnected) {
+        if (now >= link.retry_at) {
+          connect(link, now);
+        }
+      } else if (now - link.last_frame > stall_timeout) {
+        fail(link, "No data from upstream", now);
+      }
+    }
+
+    fds.clear();
+    polled.clear();
+    for (size_t i = 0; i < links_.size(); ++i) {
+      const UpstreamLink &link = links_[i];
+      if (link.fd == -1) {
+        continue;
+      }
+      pollfd entry{};
+      entry.fd = link.fd;
+      entry.events = POLLIN;
+      if (link.state == UpstreamState::Connecting ||
+          link.out_offset < link.out.size()) {
+        entry.events |= POLLOUT;
+      }
+      fds.push_back(entry);
+      polled.push_back(i);
+    }
+    if (poll(fds.data(), fds.size(), static_cast<int>(POLL_INTERVAL.count())) <
+            0 &&
+        errno != EINTR) {
+      std::cerr << "FleetGateway: poll failed: " << std::strerror(errno)
+                << std::endl;
+    }
+
+    now = Clock::now();
+    for (size_t k = 0; k < fds.size(); ++k) {
+      UpstreamLink &link = links_[polled[k]];
+      short events = fds[k].revents;
+      if (events == 0 || link.fd != fds[k].fd) {
+        continue;
+      }
+      if (link.state == UpstreamState::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(link.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+          fail(link, std::string("Connect failed: ") + std::strerror(error),
+               now);
+          continue;
+        }
+        login(link);
+      } else if (events & POLLIN) {
+        if (!receive(link, now)) {
+          continue;
+        }
+      } else if (events & (POLLERR | POLLHUP | POLLNVAL)) {
+        fail(link, "Connection lost", now);
+        continue;
+      }
+      if (link.out_offset < link.out.size() && !flush(link)) {
+        fail(link, std::string("Send failed: ") + std::strerror(errno), now);
+      }
+    }
+
+    bool dirty = std::any_of(links_.begin(), links_.end(),
+                             [](const UpstreamLink &link) {
+                               return link.dirty;
+                             });
+    if (dirty && now - last_publish >= PUBLISH_INTERVAL) {
+      publish(now);
+      last_publish = now;
+    }
+  }
+
+  for (UpstreamLink &link : links_) {
+    if (link.fd != -1) {
+      close(link.fd);
+      link.fd = -1;
+    }
+    link.state = UpstreamState::Disconnected;
+  }
+}
+
+/**
+ * @brief Start a non-blocking connection to an upstream
+ *
+ * Host names are resolved here, on every attempt, so an upstream that
+ * moves is found again after its connection drops.
+ *
+ * @param link The link to connect
+ * @param now The current time
+ */
+void FleetGateway::connect(UpstreamLink &link, Clock::time_point now) {
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses = nullptr;
+  std::string port = std::to_string(link.target.port);
+  if (getaddrinfo(link.target.host.c_str(), port.c_str(), &hints,
+                  &addresses) != 0 ||
+      !addresses) {
+    fail(link, "Cannot resolve " + link.target.host, now);
+    return;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
+    freeaddrinfo(addresses);
+    fail(link, std::string("socket: ") + std::strerror(errno), now);
+    return;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+
+  int result = ::connect(fd, addresses->ai_addr, addresses->ai_addrlen);
+  int error = errno;
+  freeaddrinfo(addresses);
+  if (result == -1 && error != EINPROGRESS) {
+    close(fd);
+    fail(link, std::string("Connect failed: ") + std::strerror(error), now);
+    return;
+  }
+
+  link.fd = fd;
+  link.decoder = FrameDecoder(Framing::LengthPrefixed,
+                              UpstreamLink::MAX_FRAME_SIZE);
+  link.out.clear();
+  link.out_offset = 0;
+  link.last_frame = now;
+  link.state = UpstreamState::Connecting;
+  link.dirty = true;
+  if (result == 0) {
+    login(link);
+  }
+}
+
+/**
+ * @brief Drop a link's connection and schedule the next attempt
+ *
+ * The node's rows leave the fleet view until it streams again; the full
+ * table sent on resubscribing brings them back.
+ *
+ * @param link The failed link
+ * @param error Why it failed
+ * @param now The current time
+ */
+void FleetGateway::fail(UpstreamLink &link, const std::string &error,
+                        Clock::time_point now) {
+  if (link.fd != -1) {
+    close(link.fd);
+    link.fd = -1;
+  }
+  if (link.state == UpstreamState::Streaming) {
+    std::cerr << "Upstream " << link.target.name << ": " << error
+              << std::endl;
+  }
+  link.state = UpstreamState::Disconnected;
+  link.last_error = error;
+  link.out.clear();
+  link.out_offset = 0;
+  link.retry_at = now + link.backoff;
+  link.backoff = std::min(link.backoff * 2, MAX_BACKOFF);
+  ++link.reconnects;
+  if (link.table->generation != 0) {
+    link.table = std::make_shared<ProcessSnapshot>();
+  }
+  link.dirty = true;
+}
+
+/**
+ * @brief Send the login once the connection is up
+ *
+ * The gateway logs in with binary encoding, which is what makes the
+ * subscription push PROCESS_UPDATE frames.
+ *
+ * @param link The link whose connection completed
+ */
+void FleetGateway::login(UpstreamLink &link) {
+  std::string request;
+  JsonWriter json(request);
+  json.beginObject()
+      .addString("command", "login")
+      .addString("username", config_.username)
+      .addString("password", config_.password)
+      .addString("encoding", "binary")
+      .endObject();
+  queueRequest(link, request);
+  link.state = UpstreamState::LoggingIn;
+  link.dirty = true;
+}
+
+/**
+ * @brief Append a length-prefixed request to a link's output
+ */
+void FleetGateway::queueRequest(UpstreamLink &link,
+                                const std::string &payload) {
+  link.out += framePrefix(Framing::LengthPrefixed, payload.size());
+  link.out += payload;
+}
+
+/**
+ * @brief Write as much of a link's pending output as the socket takes
+ *
+ * @return false if the connection failed (errno is set)
+ */
+bool FleetGateway::flush(UpstreamLink &link) {
+  while (link.out_offset < link.out.size()) {
+    ssize_t sent = send(link.fd, link.out.data() + link.out_offset,
+                        link.out.size() - link.out_offset, SEND_FLAGS);
+    if (sent < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    link.out_offset += static_cast<size_t>(sent);
+  }
+  link.out.clear();
+  link.out_offset = 0;
+  return true;
+}
+
+/**
+ * @brief Read what a link's socket has and handle every complete frame
+ *
+ * @param link The readable link
+ * @param now The current time
+ * @return false if the link failed
+ */
+bool FleetGateway::receive(UpstreamLink &link, Clock::time_point now) {
+  char buffer[65536];
+  while (true) {
+    ssize_t received = recv(link.fd, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+      link.decoder.append(buffer, static_cast<size_t>(received));
+      continue;
+    }
+    if (received == 0) {
+      fail(link, "Connection closed by upstream", now);
+      return false;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+    fail(link, std::string("Receive failed: ") + std::strerror(errno), now);
+    return false;
+  }
+
+  std::string frame;
+  while (link.decoder.next(frame)) {
+    if (!handleFrame(link, frame, now)) {
+      return false;
+    }
+  }
+  if (link.decoder.failed()) {
+    fail(link, "Frame too large", now);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Handle one frame from an upstream
+ *
+ * JSON frames are the replies to the login and the subscription, which is
+ * sent once the login succeeded. Binary frames are updates; the first one
+ * may arrive before the subscription's reply.
+ *
+ * @param link The link the frame came from
+ * @param frame The frame payload
+ * @param now The current time
+ * @return false if the link failed
+ */
+bool FleetGateway::handleFrame(UpstreamLink &link, const std::string &frame,
+                               Clock::time_point now) {
+  link.last_frame = now;
+  if (frame.empty()) {
+    return true;
+  }
+  if (frame[0] == 'Q') {
+    if (link.state != UpstreamState::Subscribing &&
+        link.state != UpstreamState::Streaming) {
+      return true;
+    }
+    return applyUpdate(link, frame, now);
+  }
+  if (link.state != UpstreamState::LoggingIn &&
+      link.state != UpstreamState::Subscribing) {
+    return true; // Some other event; not asked for
+  }
+
+  std::string message;
+  if (!replySucceeded(frame, message)) {
+    fail(link,
+         (link.state == UpstreamState::LoggingIn ? "Login failed: "
+                                                 : "Subscribe failed: ") +
+             message,
+         now);
+    return false;
+  }
+  if (link.state == UpstreamState::LoggingIn) {
+    std::string request;
+    JsonWriter json(request);
+    json.beginObject()
+        .addString("command", "subscribe")
+        .addString("scope", "all")
+        .addBool("delta", true)
+        .addInt("interval_ms", config_.interval.count())
+        .endObject();
+    queueRequest(link, request);
+    link.state = UpstreamState::Subscribing;
+  } else {
+    link.state = UpstreamState::Streaming;
+    link.backoff = MIN_BACKOFF;
+  }
+  link.dirty = true;
+  return true;
+}
+
+/**
+ * @brief Apply one PROCESS_UPDATE frame to a link's mirror
+ *
+ * The update is applied to a copy of the mirror: rows are carried over,
+ * added rows replace or extend them, changes are applied in place and
+ * removed rows are compacted away, every lookup going through the current
+ * mirror's PID index. A delta based on any generation but the mirror's
+ * means pushes were lost, so the connection is restarted to resynchronise.
+ *
+ * @param link The link the frame came from
+ * @param frame The frame payload
+ * @param now The current time
+ * @return false if the link failed
+ */
+bool FleetGateway::applyUpdate(UpstreamLink &link, const std::string &frame,
+                               Clock::time_point now) {
+  using BinaryProtocol::MessageType;
+  BinaryProtocol::Reader reader(frame);
+  MessageType type;
+  if (!reader.getHeader(type)) {
+    fail(link, "Malformed update", now);
+    return false;
+  }
+  if (type != MessageType::ProcessUpdate) {
+    return true;
+  }
+
+  const ProcessSnapshot &current = *link.table;
+  std::shared_ptr<ProcessSnapshot> next;
+  if (link.spare && link.spare.use_count() == 1) {
+    next = std::move(link.spare);
+  } else {
+    link.spare.reset();
+    next = std::make_shared<ProcessSnapshot>();
+  }
+  std::pmr::vector<ProcessInfo> &processes = next->processes;
+
+  uint64_t generation = reader.getU64();
+  bool full = reader.getU8() != 0;
+  if (!full) {
+    uint64_t base = reader.getU64();
+    if (base != current.generation) {
+      fail(link,
+           "Update based on generation " + std::to_string(base) +
+               ", mirror holds " + std::to_string(current.generation),
+           now);
+      return false;
+    }
+  }
+  unsigned fields = reader.getU16();
+
+  // Fields not sent keep these values
+  ProcessInfo blank{};
+  blank.group_id = -1;
+  auto readRow = [&](ProcessInfo &info, pid_t &previous_pid) {
+    info = blank;
+    reader.getProcessRow(info, fields, previous_pid);
+    InternedString name = internUpstreamName(info.name);
+    info.name = name.text;
+    info.escaped_name = name.escaped;
+    info.name_id = name.id;
+  };
+
+  pid_t previous_pid = 0;
+  uint32_t count = reader.getU32();
+  if (count > reader.remaining()) {
+    fail(link, "Malformed update", now);
+    return false;
+  }
+  if (full) {
+    processes.resize(count);
+    for (ProcessInfo &info : processes) {
+      readRow(info, previous_pid);
+    }
+  } else {
+    processes = current.processes;
+    link.dropped.assign(processes.size(), 0);
+    ProcessInfo info;
+    for (uint32_t i = 0; i < count && !reader.failed(); ++i) {
+      readRow(info, previous_pid);
+      auto row = current.index.find(info.pid);
+      if (row != current.index.end()) {
+        processes[row->second] = info; // A new process reusing the PID
+      } else {
+        processes.push_back(info);
+      }
+    }
+
+    previous_pid = 0;
+    count = reader.getU32();
+    for (uint32_t i = 0; i < count && !reader.failed(); ++i) {
+      previous_pid = static_cast<pid_t>(previous_pid + reader.getSvarint());
+      auto row = current.index.find(previous_pid);
+      if (row != current.index.end()) {
+        link.dropped[row->second] = 1;
+      }
+    }
+
+    previous_pid = 0;
+    count = reader.getU32();
+    BinaryProtocol::ProcessChange change;
+    for (uint32_t i = 0; i < count && !reader.failed(); ++i) {
+      reader.getProcessChange(change, previous_pid);
+      auto row = current.index.find(change.pid);
+      if (row != current.index.end()) {
+        change.applyTo(processes[row->second]);
+      }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < processes.size(); ++i) {
+      if (i >= link.dropped.size() || !link.dropped[i]) {
+        processes[kept++] = processes[i];
+      }
+    }
+    processes.resize(kept);
+  }
+  if (reader.failed()) {
+    fail(link, "Malformed update", now);
+    return false;
+  }
+
+  next->index.clear();
+  next->index.reserve(processes.size());
+  for (size_t i = 0; i < processes.size(); ++i) {
+    next->index.emplace(processes[i].pid, i);
+  }
+  next->generation = generation;
+  next->timestamp = now;
+
+  link.spare = std::move(link.table);
+  link.table = std::move(next);
+  link.updated = now;
+  ++link.updates;
+  link.dirty = true;
+  return true;
+}
+
+/**
+ * @brief Build the published view of one link
+ *
+ * Orders the rows by CPU usage and sums them per name, so fleet queries and
+ * publications only merge what the nodes precomputed.
+ *
+ * @param link The link
+ * @return The node, sharing the link's mirror
+ */
+FleetNodePtr FleetGateway::buildNode(const UpstreamLink &link) {
+  auto node = std::make_shared<FleetNode>();
+  node->name = link.target.name;
+  node->address = link.target.host + ":" + std::to_string(link.target.port);
+  node->state = link.state;
+  node->table = link.table;
+  node->updates = link.updates;
+  node->reconnects = link.reconnects;
+  node->updated = link.updated;
+  node->last_error = link.last_error;
+
+  const std::pmr::vector<ProcessInfo> &processes = link.table->processes;
+  node->by_cpu.resize(processes.size());
+  std::iota(node->by_cpu.begin(), node->by_cpu.end(), 0u);
+  std::sort(node->by_cpu.begin(), node->by_cpu.end(),
+            [&processes](uint32_t a, uint32_t b) {
+              if (processes[a].cpu_usage != processes[b].cpu_usage) {
+                return processes[a].cpu_usage > processes[b].cpu_usage;
+              }
+              return processes[a].pid < processes[b].pid;
+            });
+
+  for (const ProcessInfo &info : processes) {
+    FleetGroup &group = node->groups[info.name_id];
+    if (group.num_nodes == 0) {
+      group.name = info.name;
+      group.escaped_name = info.escaped_name;
+      group.num_nodes = 1;
+    }
+    group.totals.cpu_usage += info.cpu_usage;
+    group.totals.memory_usage += info.memory_usage;
+    ++group.totals.num_processes;
+  }
+  for (const auto &pair : node->groups) {
+    addTotals(node->totals, pair.second.totals);
+  }
+  return node;
+}
+
+/**
+ * @brief Publish a new fleet view
+ *
+ * Rebuilds the nodes that changed and shares the others with the previous
+ * view.
+ *
+ * @param now The current time
+ */
+void FleetGateway::publish(Clock::time_point now) {
+  auto next = std::make_shared<FleetSnapshot>();
+  next->generation = next_generation_++;
+  next->timestamp = now;
+  next->nodes.reserve(links_.size());
+  for (UpstreamLink &link : links_) {
+    if (link.dirty || !link.node) {
+      link.node = buildNode(link);
+      link.dirty = false;
+    }
+    next->nodes.push_back(link.node);
+
+    for (const auto &pair : link.node->groups) {
+      FleetGroup &group = next->groups[pair.first];
+      if (group.num_nodes == 0) {
+        group.name = pair.second.name;
+        group.escaped_name = pair.second.escaped_name;
+      }
+      addTotals(group.totals, pair.second.totals);
+      ++group.num_nodes;
+    }
+    addTotals(next->totals, link.node->totals);
+  }
+  std::atomic_store(&snapshot_, FleetSnapshotPtr(std::move(next)));
+}
+} // namespace qnx
@@ -0,0 +1,194 @@
+/**
+ * @file HandlerPool.cpp
+ * @brief Implementation of the command handler thread pool for QNX Remote
+ * Process Monitor
+ *
+ * Workers pop jobs from a lock-free bounded queue. The mutex and condition
+ * variable are only used to park workers while the queue is empty; the
+ * submit path touches them only when a worker is actually asleep.
+ */
+
+#include "server/HandlerPool.hpp"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <memory>
+
+namespace qnx {
+/**
+ * @brief Get the singleton instance of the HandlerPool class
+ *
+ * @return Reference to the singleton HandlerPool instance
+ */
+HandlerPool &HandlerPool::getInstance() {
+  static HandlerPool instance;
+  return instance;
+}
+
+/**
+ * @brief Destructor: stops the workers if still running
+ */
+HandlerPool::~HandlerPool() { stop(); }
+
+/**
+ * @brief Start the worker threads
+ *
+ * @param threads Number of workers, or 0 for one per CPU
+ * @return true if the pool is running
+ */
+bool HandlerPool::start(unsigned threads) {
+  if (running_.exchange(true)) {
+    return true; // Already started
+  }
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+    threads = threads > 0 ? threads : 1;
+  }
+  workers_.reserve(threads);
+  for (unsigned i = 0; i < threads; ++i) {
+    workers_.emplace_back(&HandlerPool::workerLoop, this);
+  }
+  std::cout << "Handler pool started with " << threads << " threads"
+            << std::endl;
+  return true;
+}
+
+/**
+ * @brief Stop accepting jobs, finish the queued ones and join the workers
+ */
+void HandlerPool::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  sleep_cv_.notify_all();
+  for (auto &worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
+/**
+ * @brief Queue a job for execution on a worker thread
+ *
+ * @param job The job to run
+ * @return false if the pool is stopped or the queue is full
+ */
+bool HandlerPool::trySubmit(Job job) {
+  if (!running_.load() || !queue_.tryPush(std::move(job))) {
+    return false;
+  }
+  // Pairs with the fence in workerLoop(): either we see the sleeper or it
+  // sees the job
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load() > 0) {
+    // Taking the lock orders this notify after a worker's emptiness check
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    sleep_cv_.notify_one();
+  }
+  return true;
+}
+
+/**
+ * @brief Run a function over [0, count) in chunks spread across workers
+ *
+ * Every participant registers in active before claiming its first chunk, so
+ * once the caller has seen the counter run out and active drop to zero, no
+ * chunk is left running. A helper that starts later finds nothing to claim
+ * and never touches fn.
+ *
+ * @param count Number of items
+ * @param chunk Items per chunk (at least 1)
+ * @param fn Called as fn(begin, end) for each chunk; must not throw
+ */
+void HandlerPool::parallelFor(size_t count, size_t chunk,
+                              const std::function<void(size_t, size_t)> &fn) {
+  chunk = std::max<size_t>(chunk, 1);
+  size_t chunks = (count + chunk - 1) / chunk;
+  size_t helpers = std::min(chunks, threadCount()) - (chunks > 0 ? 1 : 0);
+  if (helpers == 0 || !running_.load()) {
+    if (count > 0) {
+      fn(0, count);
+    }
+    return;
+  }
+
+  struct State {
+    std::atomic<size_t> next{0};
+    size_t count;
+    size_t chunk;
+    const std::function<void(size_t, size_t)> *fn;
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t active = 0;
+  };
+  auto state = std::make_shared<State>();
+  state->count = count;
+  state->chunk = chunk;
+  state->fn = &fn;
+
+  auto run = [](State &s) {
+    {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      ++s.active;
+    }
+    for (;;) {
+      size_t begin = s.next.fetch_add(s.chunk);
+      if (begin >= s.count) {
+        break;
+      }
+      (*s.fn)(begin, std::min(begin + s.chunk, s.count));
+    }
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (--s.active == 0) {
+      s.done.notify_all();
+    }
+  };
+
+  for (size_t i = 0; i < helpers; ++i) {
+    if (!trySubmit([state, run] { run(*state); })) {
+      break;
+    }
+  }
+  run(*state);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done.wait(lock, [&] { return state->active == 0; });
+}
+
+/**
+ * @brief Body of a worker thread
+ *
+ * Runs jobs until the pool is stopped and the queue has been drained.
+ * Exceptions thrown by a job are logged and do not kill the worker.
+ */
+void HandlerPool::workerLoop() {
+  Job job;
+  while (true) {
+    if (queue_.tryPop(job)) {
+      try {
+        job();
+      } catch (const std::exception &e) {
+        std::cerr << "Unhandled exception in handler job: " << e.what()
+                  << std::endl;
+      }
+      job = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    if (!running_.load()) {
+      return;
+    }
+    ++sleeping_;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    sleep_cv_.wait(lock, [this] {
+      return !running_.load() || queue_.sizeApprox() > 0;
+    });
+    --sleeping_;
+  }
+}
+} // namespace qnx
@@ -0,0 +1,593 @@
+/**
+ * @file HistoryStore.cpp
+ * @brief Implementation of the memory-mapped history store for QNX Remote
+ * Process Monitor
+ *
+ * Segment files are created at their full size with ftruncate(), which
+ * leaves them sparse until written, and mapped shared so that appends are
+ * plain stores into the page cache. Written pages are file-backed and can
+ * be reclaimed by the kernel, which keeps the monitor's resident set small
+ * no matter how much history is retained.
+ *
+ * Recovery needs no parsing: a segment is mapped and its header and index
+ * are used in place. The header's tick count is only advanced once a tick's
+ * data has been written, so a crash loses at most the tick in progress.
+ */
+
+#include "server/HistoryStore.hpp"
+#include "server/ProcessCore.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace qnx {
+namespace {
+constexpr char SEGMENT_MAGIC[8] = {'Q', 'R', 'P', 'M', 'H', 'I', 'S', 'T'};
+constexpr uint32_t SEGMENT_VERSION = 1;
+constexpr const char *SEGMENT_PREFIX = "history-";
+constexpr const char *SEGMENT_SUFFIX = ".seg";
+
+// Byte offsets of the sections of a segment file with the given capacity
+constexpr size_t TICK_TIME_OFFSET = 64;
+constexpr size_t INDEX_OFFSET =
+    TICK_TIME_OFFSET + sizeof(int64_t) * HistoryStore::SEGMENT_TICKS;
+
+size_t cpuOffset(uint32_t series) {
+  return INDEX_OFFSET + 24 * static_cast<size_t>(series);
+}
+
+size_t memoryOffset(uint32_t series) {
+  return cpuOffset(series) + sizeof(float) * static_cast<size_t>(series) *
+                                 HistoryStore::SEGMENT_TICKS;
+}
+
+// Series capacity for a new segment: room for every live process, plus
+// headroom for the ones started during the window
+uint32_t seriesCapacity(size_t processes) {
+  size_t series = processes + processes / 2;
+  return static_cast<uint32_t>(
+      std::clamp<size_t>(series, HistoryStore::MIN_SEGMENT_SERIES,
+                         HistoryStore::MAX_SEGMENT_SERIES));
+}
+
+bool isSegmentName(const std::string &name) {
+  const size_t prefix = strlen(SEGMENT_PREFIX);
+  const size_t suffix = strlen(SEGMENT_SUFFIX);
+  return name.size() > prefix + suffix &&
+         name.compare(0, prefix, SEGMENT_PREFIX) == 0 &&
+         name.compare(name.size() - suffix, suffix, SEGMENT_SUFFIX) == 0;
+}
+
+// Cells [lo, hi) of a series whose tick times lie within [from, to]
+void tickRange(const int64_t *tick_time, uint32_t first, uint32_t last,
+               time_t from, time_t to, uint32_t &lo, uint32_t &hi) {
+  const int64_t *begin = tick_time + first;
+  const int64_t *end = tick_time + last + 1;
+  lo = static_cast<uint32_t>(std::lower_bound(begin, end, from) - tick_time);
+  hi = static_cast<uint32_t>(std::upper_bound(begin, end, to) - tick_time);
+}
+} // namespace
+
+HistoryStore::Segment::~Segment() {
+  if (base) {
+    munmap(base, length);
+  }
+}
+
+HistoryStore::~HistoryStore() { close(); }
+
+/**
+ * @brief Get the singleton instance of the HistoryStore class
+ *
+ * @return Reference to the singleton HistoryStore instance
+ */
+HistoryStore &HistoryStore::getInstance() {
+  static HistoryStore instance;
+  return instance;
+}
+
+/**
+ * @brief Size of a segment file in bytes
+ *
+ * @param series Series capacity of the segment
+ */
+size_t HistoryStore::segmentLength(uint32_t series) {
+  static_assert(sizeof(SegmentHeader) == TICK_TIME_OFFSET,
+                "segment header layout changed");
+  static_assert(sizeof(SeriesEntry) == 24, "series entry layout changed");
+  return memoryOffset(series) +
+         sizeof(uint32_t) * static_cast<size_t>(series) * SEGMENT_TICKS;
+}
+
+/**
+ * @brief Map a segment file and locate its sections
+ *
+ * The header is read first, as it gives the series capacity and so the
+ * layout. The descriptor is closed once mapped. Files with a foreign header,
+ * or too short for their layout, are rejected.
+ *
+ * @param path Path of the segment file, for messages
+ * @param fd Open descriptor of the file, opened for reading and writing
+ * @return The mapped segment, or nullptr on failure
+ */
+std::unique_ptr<HistoryStore::Segment>
+HistoryStore::mapSegment(const std::string &path, int fd) {
+  SegmentHeader header;
+  if (pread(fd, &header, sizeof(header), 0) !=
+      static_cast<ssize_t>(sizeof(header))) {
+    std::cerr << "History segment " << path << " is truncated, skipping"
+              << std::endl;
+    ::close(fd);
+    return nullptr;
+  }
+  if (memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 ||
+      header.version != SEGMENT_VERSION || header.ticks != SEGMENT_TICKS ||
+      header.series == 0 || header.series > MAX_SEGMENT_SERIES ||
+      header.tick_count > SEGMENT_TICKS ||
+      header.series_count > header.series) {
+    std::cerr << "History segment " << path
+              << " has an unknown layout, skipping" << std::endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  const size_t length = segmentLength(header.series);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < length) {
+    std::cerr << "History segment " << path << " is truncated, skipping"
+              << std::endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  void *base =
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  std::error_code ec(errno, std::system_category());
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    std::cerr << "Failed to map history segment " << path << ": "
+              << ec.message() << std::endl;
+    return nullptr;
+  }
+
+  auto segment = std::make_unique<Segment>();
+  segment->path = path;
+  segment->base = base;
+  segment->length = length;
+  char *bytes = static_cast<char *>(base);
+  segment->header = reinterpret_cast<SegmentHeader *>(bytes);
+  segment->tick_time = reinterpret_cast<int64_t *>(bytes + TICK_TIME_OFFSET);
+  segment->index = reinterpret_cast<SeriesEntry *>(bytes + INDEX_OFFSET);
+  segment->cpu = reinterpret_cast<float *>(bytes + cpuOffset(header.series));
+  segment->memory_kb =
+      reinterpret_cast<uint32_t *>(bytes + memoryOffset(header.series));
+  return segment;
+}
+
+/**
+ * @brief Mark a segment complete and sort its index for lookup
+ *
+ * Also clamps series to the ticks actually committed, which matters for
+ * segments left behind by a crash.
+ *
+ * @param segment The segment to seal
+ */
+void HistoryStore::sealSegment(Segment &segment) {
+  SegmentHeader &header = *segment.header;
+  SeriesEntry *begin = segment.index;
+  SeriesEntry *end = segment.index + header.series_count;
+  if (header.tick_count == 0) {
+    end = begin;
+  }
+  end = std::remove_if(begin, end, [&](const SeriesEntry &entry) {
+    return entry.first_tick >= header.tick_count;
+  });
+  for (SeriesEntry *entry = begin; entry != end; ++entry) {
+    entry->last_tick = std::min(entry->last_tick, header.tick_count - 1);
+  }
+  std::sort(begin, end, [](const SeriesEntry &a, const SeriesEntry &b) {
+    return a.pid != b.pid ? a.pid < b.pid : a.start_time < b.start_time;
+  });
+  header.series_count = static_cast<uint32_t>(end - begin);
+  header.sealed = 1;
+  msync(segment.base, segment.length, MS_ASYNC);
+}
+
+/**
+ * @brief Open the store, mapping the segments already in a directory
+ *
+ * @param directory Existing directory holding the segment files
+ * @param retention How long history is kept; older segments are deleted
+ * @return true if the store is ready for use
+ */
+bool HistoryStore::open(const std::string &directory,
+                        std::chrono::seconds retention) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (open_) {
+    std::cerr << "History store already open." << std::endl;
+    return true;
+  }
+
+  DIR *dir = opendir(directory.c_str());
+  if (!dir) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to open history directory " << directory << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+  std::vector<std::string> names;
+  while (struct dirent *entry = readdir(dir)) {
+    if (isSegmentName(entry->d_name)) {
+      names.push_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+
+  for (const std::string &name : names) {
+    std::string path = directory + "/" + name;
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+      std::error_code ec(errno, std::system_category());
+      std::cerr << "Failed to open history segment " << path << ": "
+                << ec.message() << std::endl;
+      continue;
+    }
+    std::unique_ptr<Segment> segment = mapSegment(path, fd);
+    if (!segment) {
+      continue;
+    }
+    if (!segment->header->sealed) {
+      sealSegment(*segment); // Left behind by a crash
+    }
+    if (segment->header->tick_count == 0) {
+      unlink(path.c_str());
+      continue;
+    }
+    segments_.push_back(std::move(segment));
+  }
+  std::sort(segments_.begin(), segments_.end(),
+            [](const std::unique_ptr<Segment> &a,
+               const std::unique_ptr<Segment> &b) {
+              return a->header->window_start < b->header->window_start;
+            });
+
+  directory_ = directory;
+  retention_ = retention;
+  current_ = nullptr;
+  active_.clear();
+  open_ = true;
+  enforceRetention(std::time(nullptr));
+
+  std::cout << "History store opened with " << segments_.size()
+            << " recovered segment(s)." << std::endl;
+  return true;
+}
+
+/**
+ * @brief Seal the current segment and unmap everything
+ */
+void HistoryStore::close() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (current_) {
+    sealSegment(*current_);
+    current_ = nullptr;
+  }
+  segments_.clear();
+  active_.clear();
+  open_ = false;
+}
+
+/**
+ * @brief Whether open() succeeded and close() has not been called
+ */
+bool HistoryStore::isOpen() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return open_;
+}
+
+/**
+ * @brief Seal the current segment and create the next one
+ *
+ * The file is named after its window start; should that name be taken, the
+ * next free second is used.
+ *
+ * Must be called with the store lock held exclusively.
+ *
+ * @param window_start Timestamp of the segment's first tick
+ * @param series Series capacity of the new segment
+ * @return true if a new segment is ready for appending
+ */
+bool HistoryStore::startSegment(time_t window_start, uint32_t series) {
+  if (current_) {
+    sealSegment(*current_);
+    current_ = nullptr;
+  }
+  active_.clear();
+
+  int fd = -1;
+  std::string path;
+  for (int attempt = 0; attempt < 8 && fd < 0; ++attempt) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s%lld%s", SEGMENT_PREFIX,
+             static_cast<long long>(window_start) + attempt, SEGMENT_SUFFIX);
+    path = directory_ + "/" + name;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno != EEXIST) {
+      break;
+    }
+  }
+  if (fd < 0) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to create history segment " << path << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+  if (ftruncate(fd, static_cast<off_t>(segmentLength(series))) != 0) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to size history segment " << path << ": "
+              << ec.message() << std::endl;
+    ::close(fd);
+    unlink(path.c_str());
+    return false;
+  }
+
+  // Fill in the header before mapSegment() validates it
+  SegmentHeader header{};
+  memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+  header.version = SEGMENT_VERSION;
+  header.ticks = SEGMENT_TICKS;
+  header.series = series;
+  header.window_start = window_start;
+  if (pwrite(fd, &header, sizeof(header), 0) !=
+      static_cast<ssize_t>(sizeof(header))) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to write history segment " << path << ": "
+              << ec.message() << std::endl;
+    ::close(fd);
+    unlink(path.c_str());
+    return false;
+  }
+
+  std::unique_ptr<Segment> segment = mapSegment(path, fd);
+  if (!segment) {
+    unlink(path.c_str());
+    return false;
+  }
+  current_ = segment.get();
+  segments_.push_back(std::move(segment));
+  enforceRetention(window_start);
+  return true;
+}
+
+/**
+ * @brief Delete the sealed segments whose last tick is past retention
+ *
+ * Segments are rolled over early when they run out of series slots, so
+ * retention goes by time rather than by a segment count.
+ *
+ * Must be called with the store lock held exclusively.
+ *
+ * @param now The current time
+ */
+void HistoryStore::enforceRetention(time_t now) {
+  const int64_t cutoff = static_cast<int64_t>(now) - retention_.count();
+  while (!segments_.empty() && segments_.front().get() != current_) {
+    const Segment &oldest = *segments_.front();
+    const uint32_t ticks = oldest.header->tick_count;
+    if (ticks != 0 && oldest.tick_time[ticks - 1] >= cutoff) {
+      break;
+    }
+    unlink(oldest.path.c_str());
+    segments_.erase(segments_.begin());
+  }
+}
+
+/**
+ * @brief Append one tick for every process in a snapshot
+ *
+ * A process present on the previous tick extends its series; any other
+ * process starts a new one. The segment is rolled over when its ticks run
+ * out, or before a tick whose new series would not fit; the next segment
+ * is sized for the processes in the snapshot.
+ *
+ * Thread-safe through mutex locking of the store.
+ *
+ * @param snapshot The snapshot just published by ProcessCore
+ */
+void HistoryStore::append(const ProcessSnapshot &snapshot) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (!open_) {
+    return;
+  }
+
+  time_t now = std::time(nullptr);
+  bool roll_over =
+      !current_ || current_->header->tick_count == SEGMENT_TICKS;
+  if (!roll_over) {
+    size_t new_series = 0;
+    for (const ProcessInfo &info : snapshot.processes) {
+      auto it = active_.find(info.pid);
+      new_series += it == active_.end() ||
+                    it->second.start_time != info.start_time;
+    }
+    // A full segment at the largest capacity is not helped by rolling over
+    const SegmentHeader &header = *current_->header;
+    const uint32_t free_series = header.series - header.series_count;
+    roll_over = new_series > free_series &&
+                (free_series != 0 || header.series < MAX_SEGMENT_SERIES);
+  }
+  if (roll_over &&
+      !startSegment(now, seriesCapacity(snapshot.processes.size()))) {
+    return;
+  }
+
+  Segment &segment = *current_;
+  SegmentHeader &header = *segment.header;
+  const uint32_t tick = header.tick_count;
+  segment.tick_time[tick] = now;
+
+  for (const ProcessInfo &info : snapshot.processes) {
+    auto it = active_.find(info.pid);
+    if (it == active_.end() || it->second.start_time != info.start_time) {
+      if (header.series_count == header.series) {
+        continue; // More processes than MAX_SEGMENT_SERIES
+      }
+      uint32_t slot = header.series_count;
+      segment.index[slot] =
+          SeriesEntry{info.pid, slot, info.start_time, tick, tick};
+      header.series_count = slot + 1;
+      ActiveSeries series{info.start_time, slot};
+      it = active_.insert_or_assign(info.pid, series).first;
+    }
+    const uint32_t slot = it->second.slot;
+    segment.index[slot].last_tick = tick;
+
+    size_t cell = static_cast<size_t>(slot) * SEGMENT_TICKS + tick;
+    segment.cpu[cell] = std::isfinite(info.cpu_usage)
+                            ? static_cast<float>(info.cpu_usage)
+                            : 0.0f;
+    segment.memory_kb[cell] = static_cast<uint32_t>(std::min<uint64_t>(
+        info.memory_usage / 1024, std::numeric_limits<uint32_t>::max()));
+  }
+
+  // Processes absent from this tick have exited
+  for (auto it = active_.begin(); it != active_.end();) {
+    if (segment.index[it->second.slot].last_tick != tick) {
+      it = active_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  header.tick_count = tick + 1;
+}
+
+/**
+ * @brief Query stored history over a time range within a point budget
+ *
+ * A first pass over the indexes counts the samples in range, which fixes how
+ * many are merged into each point; a second pass streams them out of the
+ * mappings.
+ *
+ * Thread-safe through mutex locking of the store.
+ *
+ * @param pid The process ID to query
+ * @param from Start of the range (inclusive)
+ * @param to End of the range (inclusive)
+ * @param max_points Maximum number of points to return
+ * @return The resolution and the points, oldest first
+ */
+HistoryRange HistoryStore::getHistoryRange(pid_t pid, time_t from, time_t to,
+                                           size_t max_points) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  HistoryRange range;
+  max_points = std::max<size_t>(max_points, 1);
+  if (!open_ || from > to) {
+    return range;
+  }
+
+  // Series of the PID in segments overlapping the range, oldest first
+  struct Run {
+    const Segment *segment;
+    uint32_t slot;
+    uint32_t lo;
+    uint32_t hi;
+  };
+  std::vector<Run> runs;
+  uint64_t samples = 0;
+  for (const auto &segment_ptr : segments_) {
+    const Segment &segment = *segment_ptr;
+    const SegmentHeader &header = *segment.header;
+    const uint32_t ticks = header.tick_count;
+    if (ticks == 0 || segment.tick_time[0] > to ||
+        segment.tick_time[ticks - 1] < from) {
+      continue;
+    }
+
+    const SeriesEntry *begin = segment.index;
+    const SeriesEntry *end = segment.index + header.series_count;
+    if (header.sealed) {
+      struct PidLess {
+        bool operator()(const SeriesEntry &a, pid_t b) const {
+          return a.pid < b;
+        }
+        bool operator()(pid_t a, const SeriesEntry &b) const {
+          return a < b.pid;
+        }
+      };
+      auto bounds = std::equal_range(begin, end, pid, PidLess());
+      begin = bounds.first;
+      end = bounds.second;
+    }
+    size_t first_run = runs.size();
+    for (const SeriesEntry *entry = begin; entry != end; ++entry) {
+      if (entry->pid != pid || entry->first_tick >= ticks) {
+        continue;
+      }
+      uint32_t lo = 0;
+      uint32_t hi = 0;
+      tickRange(segment.tick_time, entry->first_tick,
+                std::min(entry->last_tick, ticks - 1), from, to, lo, hi);
+      if (lo < hi) {
+        runs.push_back(Run{&segment, entry->slot, lo, hi});
+        samples += hi - lo;
+      }
+    }
+    // The open segment's index is in creation order, not start time
+    std::sort(runs.begin() + first_run, runs.end(),
+              [](const Run &a, const Run &b) { return a.lo < b.lo; });
+  }
+
+  size_t group = std::max<uint64_t>(1, (samples + max_points - 1) / max_points);
+  range.resolution = static_cast<time_t>(group);
+  range.points.reserve(std::min<uint64_t>(samples, max_points));
+
+  HistoryPoint point{};
+  size_t merged = 0;
+  double cpu_sum = 0.0;
+  uint64_t memory_sum = 0;
+  for (const Run &run : runs) {
+    const Segment &segment = *run.segment;
+    const size_t base = static_cast<size_t>(run.slot) * SEGMENT_TICKS;
+    for (uint32_t tick = run.lo; tick < run.hi; ++tick) {
+      float cpu = segment.cpu[base + tick];
+      uint32_t memory_kb = segment.memory_kb[base + tick];
+      if (merged == 0) {
+        point = HistoryPoint{static_cast<time_t>(segment.tick_time[tick]),
+                             cpu, cpu, cpu, memory_kb, memory_kb, memory_kb};
+        cpu_sum = 0.0;
+        memory_sum = 0;
+      }
+      point.cpu_min = std::min(point.cpu_min, cpu);
+      point.cpu_max = std::max(point.cpu_max, cpu);
+      point.memory_min_kb = std::min(point.memory_min_kb, memory_kb);
+      point.memory_max_kb = std::max(point.memory_max_kb, memory_kb);
+      cpu_sum += cpu;
+      memory_sum += memory_kb;
+      if (++merged == group) {
+        point.cpu_avg = static_cast<float>(cpu_sum / merged);
+        point.memory_avg_kb = static_cast<uint32_t>(memory_sum / merged);
+        range.points.push_back(point);
+        merged = 0;
+      }
+    }
+  }
+  if (merged != 0) {
+    point.cpu_avg = static_cast<float>(cpu_sum / merged);
+    point.memory_avg_kb = static_cast<uint32_t>(memory_sum / merged);
+    range.points.push_back(point);
+  }
+  return range;
+}
+} // namespace qnx
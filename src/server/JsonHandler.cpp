@@ -1,71 +1,185 @@
 #include "server/JsonHandler.hpp"
 #include "shared/Authenticator.hpp"
+#include "server/BinaryProtocol.hpp"
+#include "server/FleetGateway.hpp"
+#include "server/HandlerPool.hpp"
+#include "server/HistoryStore.hpp"
+#include "server/JsonWriter.hpp"
 #include "server/ProcessControl.hpp"
 #include "server/ProcessCore.hpp" // Added for ProcessCore & ProcessInfo
+#include "server/ProcessDelta.hpp"
 #include "server/ProcessGroup.hpp"
 #include "server/ProcessHistory.hpp"
+#include "server/ProcessEvents.hpp"
+#include "server/SamplingScheduler.hpp"
+#include "server/ServerMetrics.hpp"
 #include "server/SocketServer.hpp" // Include for message type constants
+#include "server/StringTable.hpp"
+#include "server/SubscriptionManager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <sched.h>
+#include <set>
 #include <sstream>
 #include <string>
 #include <sys/json.h> // QNX native JSON library
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>    // For std::make_pair
+#include <vector>
 
 namespace qnx {
-using CommandHandler = std::function<void(json_decoder_t *, json_encoder_t *)>;
+using CommandHandler = std::function<void(
+    const RequestContext &, json_decoder_t *, json_encoder_t *)>;
+// Writes the complete response document itself (see JsonWriter)
+using RawCommandHandler = std::function<void(const RequestContext &,
+                                             json_decoder_t *, std::string &)>;
+
+// Read an optional array of PIDs; returns false if it is absent
+bool readPidArray(json_decoder_t *decoder, const char *name,
+                  std::vector<pid_t> &pids) {
+  if (json_decoder_push_array(decoder, name, true) != JSON_DECODER_OK) {
+    return false;
+  }
+  int pid = 0;
+  while (json_decoder_get_int(decoder, NULL, &pid, false) ==
+         JSON_DECODER_OK) {
+    pids.push_back(static_cast<pid_t>(pid));
+  }
+  json_decoder_pop(decoder);
+  return true;
+}
+
+// Strict weak ordering of two rows by one column, for get_process_table
+bool processLess(const ProcessInfo &a, const ProcessInfo &b,
+                 ProcessField field) {
+  switch (field) {
+  case FIELD_PARENT_PID:
+    return a.parent_pid < b.parent_pid;
+  case FIELD_NAME:
+    return a.name < b.name;
+  case FIELD_CPU_USAGE:
+    return a.cpu_usage < b.cpu_usage;
+  case FIELD_MEMORY_USAGE:
+    return a.memory_usage < b.memory_usage;
+  case FIELD_THREADS:
+    return a.num_threads < b.num_threads;
+  case FIELD_PRIORITY:
+    return a.priority < b.priority;
+  case FIELD_POLICY:
+    return a.policy < b.policy;
+  case FIELD_STATE:
+    return a.state < b.state;
+  default:
+    return a.pid < b.pid;
+  }
+}
+
+// Finish a JsonWriter response with an error status
+void writeError(JsonWriter &json, std::string_view message) {
+  json.addString("status", "error").addString("message", message).endObject();
+}
 
 // --- Command Handler Functions ---
 
-void handleGetProcesses(json_decoder_t *decoder, json_encoder_t *encoder) {
-  json_encoder_add_string(encoder, "status", "success");
-  json_encoder_start_array(encoder, "pids");
-  // TODO: Populate PIDs from ProcessCore
-  const auto &processList = ProcessCore::getInstance().getProcessList();
-  for (const auto &pinfo : processList) {
-    json_encoder_add_int(encoder, NULL, pinfo.pid); // Add PID to array
+void handleGetProcesses(const RequestContext &context, json_decoder_t *decoder,
+                        std::string &out) {
+  // Pin the current snapshot; it stays valid while we encode
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+  out.reserve(32 + snapshot->processes.size() * 8);
+  JsonWriter json(out);
+  json.beginObject().addString("status", "success").beginArray("pids");
+  for (const auto &pinfo : snapshot->processes) {
+    json.addInt({}, pinfo.pid); // Add PID to array
   }
-  json_encoder_end_array(encoder);
+  json.endArray().endObject();
 }
 
-void handleGetProcessInfo(json_decoder_t *decoder, json_encoder_t *encoder) {
+void handleGetProcessInfo(const RequestContext &context,
+                          json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
   int pid_int = 0;
   if (json_decoder_get_int(decoder, "pid", &pid_int, false) !=
       JSON_DECODER_OK) {
-    json_encoder_add_string(encoder, "status", "error");
-    json_encoder_add_string(encoder, "message", "Missing or invalid 'pid'");
+    writeError(json, "Missing or invalid 'pid'");
     return;
   }
   pid_t pid = static_cast<pid_t>(pid_int); // Cast to pid_t
-  json_encoder_add_int(encoder, "pid", pid);
+  json.addInt("pid", pid);
 
-  // Use ProcessCore to get info
-  if (auto info_opt = qnx::ProcessCore::getInstance().getProcessById(pid)) {
-    const auto &info = *info_opt; // Dereference optional
-    json_encoder_add_string(encoder, "status", "success");
-    json_encoder_start_object(encoder, "info");
-    // Use members from ProcessInfo struct
-    json_encoder_add_string(encoder, "name", info.name.c_str());
-    json_encoder_add_double(encoder, "cpu_usage", info.cpu_usage);
-    json_encoder_add_int_ll(encoder, "memory_usage_kb",
-                            info.memory_usage /
-                                1024); // Use memory_usage (bytes) and convert
-    json_encoder_add_int(encoder, "threads", info.num_threads);
-    json_encoder_add_int(encoder, "priority", info.priority);
-    json_encoder_add_int(encoder, "state", info.state); // Raw state code
-    // Parent PID, UID, GID are not currently in ProcessInfo struct
-    // json_encoder_add_int(encoder, "parent_pid", info.parent_pid);
-    // json_encoder_add_int(encoder, "uid", info.uid);
-    // json_encoder_add_int(encoder, "gid", info.gid);
-    json_encoder_end_object(encoder);
+  // Look the PID up in the pinned snapshot without copying the row
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+  if (const ProcessInfo *info = snapshot->find(pid)) {
+    json.addString("status", "success");
+    json.addProcessRow(*info, DEFAULT_FIELDS & ~FIELD_PID, "info");
+    json.endObject();
   } else {
-    json_encoder_add_string(encoder, "status", "error");
-    json_encoder_add_string(encoder, "message", "Process not found");
+    writeError(json, "Process not found");
   }
 }
 
-void handleSuspendProcess(json_decoder_t *decoder, json_encoder_t *encoder) {
+void handleGetProcessTree(const RequestContext &context,
+                          json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  int pid_int = 0;
+  if (json_decoder_get_int(decoder, "pid", &pid_int, false) !=
+      JSON_DECODER_OK) {
+    writeError(json, "Missing or invalid 'pid'");
+    return;
+  }
+  const char *view = "subtree";
+  json_decoder_get_string(decoder, "view", &view, true);
+  pid_t pid = static_cast<pid_t>(pid_int);
+
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+  auto row = snapshot->index.find(pid);
+  if (row == snapshot->index.end()) {
+    writeError(json, "Process not found");
+    return;
+  }
+
+  std::vector<pid_t> pids;
+  if (strcmp(view, "children") == 0) {
+    pids = snapshot->childrenOf(pid);
+  } else if (strcmp(view, "ancestors") == 0) {
+    pids = snapshot->ancestorsOf(pid);
+  } else if (strcmp(view, "subtree") == 0) {
+    for (size_t member : snapshot->subtreeRows(pid)) {
+      pids.push_back(snapshot->processes[member].pid);
+    }
+  } else {
+    writeError(json, "Invalid 'view' (children, subtree or ancestors)");
+    return;
+  }
+
+  const ResourceTotals &totals = snapshot->subtree_totals[row->second];
+  json.addString("status", "success")
+      .addInt("pid", pid)
+      .addUInt("generation", snapshot->generation)
+      .addString("view", view)
+      .beginArray("pids");
+  for (pid_t member : pids) {
+    json.addInt({}, member);
+  }
+  json.endArray()
+      .beginObject("subtree_total")
+      .addUInt("processes", totals.num_processes)
+      .addDouble("cpu_usage", totals.cpu_usage)
+      .addUInt("memory_usage_kb", totals.memory_usage / 1024)
+      .endObject()
+      .endObject();
+}
+
+void handleSuspendProcess(const RequestContext &context,
+                          json_decoder_t *decoder, json_encoder_t *encoder) {
   int pid = 0;
   if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK) {
     json_encoder_add_string(encoder, "status", "error");
@@ -79,7 +193,8 @@ void handleSuspendProcess(json_decoder_t *decoder, json_encoder_t *encoder) {
     json_encoder_add_string(encoder, "message", "Failed to suspend process");
 }
 
-void handleResumeProcess(json_decoder_t *decoder, json_encoder_t *encoder) {
+void handleResumeProcess(const RequestContext &context, json_decoder_t *decoder,
+                         json_encoder_t *encoder) {
   int pid = 0;
   if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK) {
     json_encoder_add_string(encoder, "status", "error");
@@ -93,7 +208,8 @@ void handleResumeProcess(json_decoder_t *decoder, json_encoder_t *encoder) {
     json_encoder_add_string(encoder, "message", "Failed to resume process");
 }
 
-void handleTerminateProcess(json_decoder_t *decoder, json_encoder_t *encoder) {
+void handleTerminateProcess(const RequestContext &context,
+                            json_decoder_t *decoder, json_encoder_t *encoder) {
   int pid = 0;
   if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK) {
     json_encoder_add_string(encoder, "status", "error");
@@ -107,6 +223,1038 @@ void handleTerminateProcess(json_decoder_t *decoder, json_encoder_t *encoder) {
     json_encoder_add_string(encoder, "message", "Failed to terminate process");
 }
 
+// Batches at least this large are spread across the handler pool
+constexpr size_t BATCH_PARALLEL_THRESHOLD = 256;
+constexpr size_t BATCH_CHUNK = 64;
+
+// Apply one request to every target; errors[i] is the result for targets[i].
+// Targets are claimed in order, so within a chunk they are handled in the
+// order given and across chunks roughly so.
+std::vector<std::error_code> applyBatch(const std::vector<pid_t> &targets,
+                                        const ControlRequest &request) {
+  std::vector<std::error_code> errors(targets.size());
+  auto apply = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      errors[i] = applyControl(targets[i], request);
+    }
+  };
+  if (targets.size() < BATCH_PARALLEL_THRESHOLD) {
+    apply(0, targets.size());
+  } else {
+    HandlerPool::getInstance().parallelFor(targets.size(), BATCH_CHUNK,
+                                           apply);
+  }
+  return errors;
+}
+
+bool parseControlAction(const char *name, ControlAction &action) {
+  static const std::pair<const char *, ControlAction> actions[] = {
+      {"suspend", ControlAction::Suspend},
+      {"resume", ControlAction::Resume},
+      {"terminate", ControlAction::Terminate},
+      {"kill", ControlAction::Kill},
+      {"set_priority", ControlAction::SetPriority},
+  };
+  for (const auto &entry : actions) {
+    if (strcmp(name, entry.first) == 0) {
+      action = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+void handleBatchControl(const RequestContext &context,
+                        json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  const char *action_name = nullptr;
+  ControlRequest request{ControlAction::Terminate};
+  if (json_decoder_get_string(decoder, "action", &action_name, false) !=
+          JSON_DECODER_OK ||
+      !parseControlAction(action_name, request.action)) {
+    writeError(json, "Missing or invalid 'action' (suspend, resume, "
+                     "terminate, kill or set_priority)");
+    return;
+  }
+  if (request.action == ControlAction::SetPriority) {
+    if (json_decoder_get_int(decoder, "priority", &request.priority, false) !=
+        JSON_DECODER_OK) {
+      writeError(json, "Missing or invalid 'priority'");
+      return;
+    }
+    request.policy = SCHED_RR;
+    json_decoder_get_int(decoder, "policy", &request.policy, true);
+  }
+
+  // Exactly one target selector: an explicit list, a group or a subtree
+  std::vector<pid_t> targets;
+  int group_id = 0;
+  int root = 0;
+  bool by_list = readPidArray(decoder, "pids", targets);
+  bool by_group = json_decoder_get_int(decoder, "group_id", &group_id,
+                                       true) == JSON_DECODER_OK;
+  bool by_subtree =
+      json_decoder_get_int(decoder, "subtree", &root, true) == JSON_DECODER_OK;
+  if (by_list + by_group + by_subtree != 1) {
+    writeError(json, "Specify exactly one of 'pids', 'group_id' or 'subtree'");
+    return;
+  }
+
+  if (by_list) {
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+  } else if (by_group) {
+    ProcessGroup &groups = ProcessGroup::getInstance();
+    std::vector<int> ids = groups.getGroupIds();
+    if (std::find(ids.begin(), ids.end(), group_id) == ids.end()) {
+      writeError(json, "Group not found");
+      return;
+    }
+    std::set<pid_t> members = groups.getProcessesInGroup(group_id);
+    targets.assign(members.begin(), members.end());
+  } else {
+    ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+    std::vector<size_t> rows = snapshot->subtreeRows(root);
+    if (rows.empty()) {
+      writeError(json, "Process not found");
+      return;
+    }
+    // Stop and reprioritize parents before children; signal leaves first
+    // when ending the tree so no child is reparented before it is signalled
+    bool leaves_first = request.action == ControlAction::Terminate ||
+                        request.action == ControlAction::Kill;
+    if (leaves_first) {
+      std::reverse(rows.begin(), rows.end());
+    }
+    targets.reserve(rows.size());
+    for (size_t row : rows) {
+      targets.push_back(snapshot->processes[row].pid);
+    }
+  }
+
+  std::vector<std::error_code> errors = applyBatch(targets, request);
+  size_t failures = static_cast<size_t>(
+      std::count_if(errors.begin(), errors.end(),
+                    [](const std::error_code &ec) { return bool(ec); }));
+
+  json.addString("status", failures == 0 ? "success" : "error")
+      .addString("action", action_name)
+      .addUInt("requested", targets.size())
+      .addUInt("succeeded", targets.size() - failures)
+      .beginArray("failed");
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (errors[i]) {
+      json.beginObject()
+          .addInt("pid", targets[i])
+          .addString("error", errors[i].message())
+          .endObject();
+    }
+  }
+  json.endArray().endObject();
+}
+
+void handleTerminateTree(const RequestContext &context,
+                         json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  int pid_int = 0;
+  if (json_decoder_get_int(decoder, "pid", &pid_int, false) !=
+      JSON_DECODER_OK) {
+    writeError(json, "Missing or invalid 'pid'");
+    return;
+  }
+  pid_t pid = static_cast<pid_t>(pid_int);
+
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+  std::vector<size_t> rows = snapshot->subtreeRows(pid);
+  if (rows.empty()) {
+    writeError(json, "Process not found");
+    return;
+  }
+
+  // Leaves first, so no child is reparented before it is signalled
+  std::vector<pid_t> targets;
+  targets.reserve(rows.size());
+  for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+    targets.push_back(snapshot->processes[*it].pid);
+  }
+  std::vector<std::error_code> errors =
+      applyBatch(targets, ControlRequest{ControlAction::Terminate});
+
+  std::vector<pid_t> failed;
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (errors[i]) {
+      failed.push_back(targets[i]);
+    }
+  }
+
+  json.addString("status", failed.empty() ? "success" : "error")
+      .addInt("pid", pid)
+      .addUInt("signalled", rows.size() - failed.size())
+      .beginArray("failed");
+  for (pid_t member : failed) {
+    json.addInt({}, member);
+  }
+  json.endArray().endObject();
+}
+
+void handleGetHotThreads(const RequestContext &context, json_decoder_t *decoder,
+                         json_encoder_t *encoder) {
+  int count = 10;
+  json_decoder_get_int(decoder, "count", &count, true);
+  if (count < 0) {
+    count = 0;
+  }
+
+  json_encoder_add_string(encoder, "status", "success");
+  json_encoder_start_array(encoder, "threads");
+  for (const auto &thread :
+       ProcessCore::getInstance().getHotThreads(static_cast<size_t>(count))) {
+    json_encoder_start_object(encoder, NULL);
+    json_encoder_add_int(encoder, "pid", thread.pid);
+    json_encoder_add_int(encoder, "tid", thread.tid);
+    json_encoder_add_double(encoder, "cpu_usage", thread.cpu_usage);
+    json_encoder_add_int(encoder, "priority", thread.priority);
+    json_encoder_add_int(encoder, "state", thread.state);
+    json_encoder_end_object(encoder);
+  }
+  json_encoder_end_array(encoder);
+}
+
+void handleSetThreadSampling(const RequestContext &context,
+                             json_decoder_t *decoder, json_encoder_t *encoder) {
+  ThreadSamplingConfig config;
+  if (json_decoder_get_bool(decoder, "enabled", &config.enabled, false) !=
+      JSON_DECODER_OK) {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message",
+                            "Missing or invalid 'enabled'");
+    return;
+  }
+  json_decoder_get_double(decoder, "cpu_threshold", &config.cpu_threshold,
+                          true);
+  json_decoder_get_int(decoder, "group_id", &config.watched_group, true);
+
+  std::vector<pid_t> pids;
+  readPidArray(decoder, "pids", pids);
+  config.explicit_pids.insert(pids.begin(), pids.end());
+  config.watched = config.explicit_pids;
+  if (config.watched_group != -1) {
+    // Seed from the group now; the stats loop keeps it in sync afterwards
+    auto members =
+        ProcessGroup::getInstance().getProcessesInGroup(config.watched_group);
+    config.watched.insert(members.begin(), members.end());
+  }
+
+  ProcessCore::getInstance().setThreadSampling(std::move(config));
+  json_encoder_add_string(encoder, "status", "success");
+}
+
+void handleSubscribe(const RequestContext &context, json_decoder_t *decoder,
+                     json_encoder_t *encoder) {
+  Subscription subscription;
+  subscription.client_socket = context.client_socket;
+
+  int interval_ms = 1000;
+  json_decoder_get_int(decoder, "interval_ms", &interval_ms, true);
+  subscription.interval = std::chrono::milliseconds(interval_ms);
+  json_decoder_get_bool(decoder, "lifecycle", &subscription.lifecycle, true);
+  json_decoder_get_bool(decoder, "delta", &subscription.delta, true);
+  subscription.encoding = context.session.encoding;
+
+  const char *scope = NULL;
+  json_decoder_get_string(decoder, "scope", &scope, true);
+  std::string scope_name = scope ? scope : "all";
+  if (scope_name == "pids") {
+    subscription.scope = SubscriptionScope::Pids;
+    if (!readPidArray(decoder, "pids", subscription.pids)) {
+      json_encoder_add_string(encoder, "status", "error");
+      json_encoder_add_string(encoder, "message",
+                              "Scope 'pids' requires a 'pids' array");
+      return;
+    }
+  } else if (scope_name == "group") {
+    subscription.scope = SubscriptionScope::Group;
+    if (json_decoder_get_int(decoder, "group_id", &subscription.group_id,
+                             false) != JSON_DECODER_OK) {
+      json_encoder_add_string(encoder, "status", "error");
+      json_encoder_add_string(encoder, "message",
+                              "Scope 'group' requires a 'group_id'");
+      return;
+    }
+  } else if (scope_name != "all") {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message",
+                            "Invalid 'scope' (all, pids or group)");
+    return;
+  }
+  if (subscription.delta && subscription.scope != SubscriptionScope::All) {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message",
+                            "Delta updates require scope 'all'");
+    return;
+  }
+
+  int id =
+      SubscriptionManager::getInstance().subscribe(std::move(subscription));
+  // Collection may be backed off while nobody is subscribed; catch up now
+  // rather than at the end of the idle interval
+  SamplingScheduler::getInstance().requestRefresh(
+      std::chrono::milliseconds(0));
+  json_encoder_add_string(encoder, "status", "success");
+  json_encoder_add_int(encoder, "subscription_id", id);
+}
+
+void handleUnsubscribe(const RequestContext &context, json_decoder_t *decoder,
+                       json_encoder_t *encoder) {
+  auto &subscriptions = SubscriptionManager::getInstance();
+  int id = 0;
+  if (json_decoder_get_int(decoder, "subscription_id", &id, true) ==
+      JSON_DECODER_OK) {
+    bool removed = subscriptions.unsubscribe(context.client_socket, id);
+    json_encoder_add_string(encoder, "status", removed ? "success" : "error");
+    if (!removed)
+      json_encoder_add_string(encoder, "message", "Unknown subscription");
+    return;
+  }
+  // No ID: drop every subscription of this client
+  size_t removed = subscriptions.removeClient(context.client_socket);
+  json_encoder_add_string(encoder, "status", "success");
+  json_encoder_add_int(encoder, "removed", static_cast<int>(removed));
+}
+
+// Collect now instead of at the next deadline, and wait for the result
+void handleRefresh(const RequestContext &context, json_decoder_t *decoder,
+                   json_encoder_t *encoder) {
+  int wait_ms = 1000;
+  json_decoder_get_int(decoder, "wait_ms", &wait_ms, true);
+  wait_ms = std::clamp(wait_ms, 0, 5000);
+
+  bool done = SamplingScheduler::getInstance().requestRefresh(
+      std::chrono::milliseconds(wait_ms));
+  if (!done && wait_ms > 0) {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message", "Refresh timed out");
+    return;
+  }
+  json_encoder_add_string(encoder, "status", "success");
+  json_encoder_add_int_ll(
+      encoder, "generation",
+      static_cast<long long>(ProcessCore::getInstance().getGeneration()));
+}
+
+// Replace the fast sampling tiers: {"tiers":[{"interval_ms":100,
+// "pids":[...], "group_id":3}, ...]}; an empty list turns them off
+void handleSetSamplingTiers(const RequestContext &context,
+                            json_decoder_t *decoder, json_encoder_t *encoder) {
+  if (json_decoder_push_array(decoder, "tiers", false) != JSON_DECODER_OK) {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message", "Missing or invalid 'tiers'");
+    return;
+  }
+  std::vector<SamplingTier> tiers;
+  while (json_decoder_push_object(decoder, NULL, true) == JSON_DECODER_OK) {
+    SamplingTier tier;
+    int interval_ms = static_cast<int>(tier.interval.count());
+    json_decoder_get_int(decoder, "interval_ms", &interval_ms, true);
+    tier.interval = std::chrono::milliseconds(interval_ms);
+    json_decoder_get_int(decoder, "group_id", &tier.group_id, true);
+    std::vector<pid_t> pids;
+    readPidArray(decoder, "pids", pids);
+    tier.pids.insert(pids.begin(), pids.end());
+    json_decoder_pop(decoder);
+    if (!tier.pids.empty() || tier.group_id != -1) {
+      tiers.push_back(std::move(tier));
+    }
+  }
+  json_decoder_pop(decoder);
+
+  size_t count = tiers.size();
+  SamplingScheduler::getInstance().setTiers(std::move(tiers));
+  json_encoder_add_string(encoder, "status", "success");
+  json_encoder_add_int(encoder, "tiers", static_cast<int>(count));
+}
+
+void handleGetProcessTableDelta(const RequestContext &context,
+                                json_decoder_t *decoder, std::string &out) {
+  long long since = 0;
+  json_decoder_get_int_ll(decoder, "since", &since, true);
+
+  auto &proc_core = ProcessCore::getInstance();
+  ProcessSnapshotPtr current = proc_core.getSnapshot();
+  ProcessSnapshotPtr base;
+  if (since > 0) {
+    base = proc_core.getSnapshot(static_cast<uint64_t>(since));
+  }
+  // An unknown or evicted generation gets the full table
+  encodeProcessDelta(out, *current, base.get(), context.session.encoding,
+                     false);
+}
+
+void handleGetProcessTable(const RequestContext &context,
+                           json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+
+  // Projection
+  unsigned fields = DEFAULT_FIELDS;
+  if (json_decoder_push_array(decoder, "fields", true) == JSON_DECODER_OK) {
+    fields = 0;
+    const char *name = NULL;
+    while (json_decoder_get_string(decoder, NULL, &name, false) ==
+           JSON_DECODER_OK) {
+      unsigned field = name ? parseProcessField(name) : 0;
+      if (field == 0) {
+        json_decoder_pop(decoder);
+        writeError(json, std::string("Unknown field: ") + (name ? name : ""));
+        return;
+      }
+      fields |= field;
+    }
+    json_decoder_pop(decoder);
+    if (fields == 0) {
+      fields = DEFAULT_FIELDS;
+    }
+  }
+
+  // Filter (all conditions are optional and combined with AND)
+  double min_cpu = -1.0;
+  long long min_memory_kb = -1;
+  int state = -1;
+  int parent_pid = -1;
+  int group_id = -1;
+  const char *name_filter = NULL;
+  if (json_decoder_push_object(decoder, "filter", true) == JSON_DECODER_OK) {
+    json_decoder_get_double(decoder, "min_cpu", &min_cpu, true);
+    json_decoder_get_int_ll(decoder, "min_memory_kb", &min_memory_kb, true);
+    json_decoder_get_int(decoder, "state", &state, true);
+    json_decoder_get_int(decoder, "parent_pid", &parent_pid, true);
+    json_decoder_get_int(decoder, "group_id", &group_id, true);
+    json_decoder_get_string(decoder, "name", &name_filter, true);
+    json_decoder_pop(decoder);
+  }
+  std::string name_substring = name_filter ? name_filter : "";
+  std::set<pid_t> group_members;
+  if (group_id != -1) {
+    group_members = ProcessGroup::getInstance().getProcessesInGroup(group_id);
+  }
+
+  // Sort and top-N
+  ProcessField sort_field = FIELD_PID;
+  bool descending = false;
+  const char *sort_by = NULL;
+  if (json_decoder_get_string(decoder, "sort_by", &sort_by, true) ==
+          JSON_DECODER_OK &&
+      sort_by) {
+    unsigned field = parseProcessField(sort_by);
+    if (field == 0) {
+      writeError(json, std::string("Unknown sort field: ") + sort_by);
+      return;
+    }
+    sort_field = static_cast<ProcessField>(field);
+    descending = true; // "top N" is the common case
+  }
+  const char *order = NULL;
+  if (json_decoder_get_string(decoder, "order", &order, true) ==
+          JSON_DECODER_OK &&
+      order) {
+    descending = strcmp(order, "desc") == 0;
+  }
+  int limit = 0;
+  json_decoder_get_int(decoder, "limit", &limit, true);
+
+  // Rows are referenced straight from the pinned snapshot, never copied
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+  std::vector<const ProcessInfo *> rows;
+  rows.reserve(snapshot->processes.size());
+  for (const auto &info : snapshot->processes) {
+    if ((min_cpu >= 0.0 && info.cpu_usage < min_cpu) ||
+        (min_memory_kb >= 0 &&
+         static_cast<long long>(info.memory_usage / 1024) < min_memory_kb) ||
+        (state != -1 && info.state != state) ||
+        (parent_pid != -1 && info.parent_pid != parent_pid) ||
+        (group_id != -1 && group_members.count(info.pid) == 0) ||
+        (!name_substring.empty() &&
+         info.name.find(name_substring) == std::string::npos)) {
+      continue;
+    }
+    rows.push_back(&info);
+  }
+  size_t total = rows.size();
+
+  auto less = [sort_field, descending](const ProcessInfo *a,
+                                       const ProcessInfo *b) {
+    return descending ? processLess(*b, *a, sort_field)
+                      : processLess(*a, *b, sort_field);
+  };
+  if (limit > 0 && static_cast<size_t>(limit) < rows.size()) {
+    std::partial_sort(rows.begin(), rows.begin() + limit, rows.end(), less);
+    rows.resize(static_cast<size_t>(limit));
+  } else {
+    // Shards are appended in turn, so snapshot rows are not in PID order
+    std::sort(rows.begin(), rows.end(), less);
+  }
+
+  if (context.session.encoding == WireEncoding::Binary) {
+    out.clear(); // drop the JSON opened for error replies
+    out.reserve(32 + rows.size() * 24);
+    BinaryProtocol::Writer binary(out);
+    binary.putHeader(BinaryProtocol::MessageType::ProcessTable);
+    binary.putU64(snapshot->generation);
+    binary.putU32(static_cast<uint32_t>(total));
+    binary.putU16(static_cast<uint16_t>(fields));
+    binary.putU32(static_cast<uint32_t>(rows.size()));
+    pid_t previous_pid = 0;
+    for (const ProcessInfo *info : rows) {
+      binary.putProcessRow(*info, fields, previous_pid);
+    }
+    return;
+  }
+
+  out.reserve(64 + rows.size() * 112);
+  json.addString("status", "success")
+      .addUInt("generation", snapshot->generation)
+      .addUInt("total", total)
+      .beginArray("processes");
+  for (const ProcessInfo *info : rows) {
+    json.addProcessRow(*info, fields);
+  }
+  json.endArray().endObject();
+}
+
+// Answer get_process_history for a time range within a point budget
+void writeHistoryRange(const RequestContext &context, pid_t pid,
+                       long long from, long long to, int max_points,
+                       std::string &out) {
+  HistoryRange range = ProcessHistory::getInstance().getHistoryRange(
+      pid, static_cast<time_t>(from), static_cast<time_t>(to),
+      static_cast<size_t>(max_points));
+
+  // Reach back into the persisted history when memory does not cover the
+  // start of the range (e.g. after a restart)
+  HistoryStore &store = HistoryStore::getInstance();
+  if (store.isOpen() &&
+      (range.points.empty() ||
+       range.points.front().timestamp > from + range.resolution)) {
+    HistoryRange stored = store.getHistoryRange(
+        pid, static_cast<time_t>(from), static_cast<time_t>(to),
+        static_cast<size_t>(max_points));
+    if (!stored.points.empty() &&
+        (range.points.empty() ||
+         stored.points.front().timestamp < range.points.front().timestamp)) {
+      range = std::move(stored);
+    }
+  }
+
+  if (context.session.encoding == WireEncoding::Binary) {
+    out.reserve(24 + range.points.size() * 24);
+    BinaryProtocol::Writer binary(out);
+    binary.putHeader(BinaryProtocol::MessageType::ProcessHistoryRange);
+    binary.putVarint(static_cast<uint64_t>(pid));
+    binary.putU32(static_cast<uint32_t>(range.resolution));
+    binary.putU32(static_cast<uint32_t>(range.points.size()));
+    int64_t previous_time = 0;
+    int64_t previous_memory_kb = 0;
+    for (const HistoryPoint &point : range.points) {
+      binary.putSvarint(static_cast<int64_t>(point.timestamp) - previous_time);
+      binary.putU32(BinaryProtocol::cpuToWire(point.cpu_min));
+      binary.putU32(BinaryProtocol::cpuToWire(point.cpu_avg));
+      binary.putU32(BinaryProtocol::cpuToWire(point.cpu_max));
+      binary.putSvarint(static_cast<int64_t>(point.memory_avg_kb) -
+                        previous_memory_kb);
+      binary.putVarint(point.memory_avg_kb - point.memory_min_kb);
+      binary.putVarint(point.memory_max_kb - point.memory_avg_kb);
+      previous_time = point.timestamp;
+      previous_memory_kb = point.memory_avg_kb;
+    }
+    return;
+  }
+
+  out.reserve(64 + range.points.size() * 160);
+  JsonWriter json(out);
+  json.beginObject()
+      .addString("status", "success")
+      .addInt("pid", pid)
+      .addInt("resolution", range.resolution)
+      .beginArray("points");
+  for (const HistoryPoint &point : range.points) {
+    json.beginObject()
+        .addInt("timestamp", point.timestamp)
+        .addDouble("cpu_min", point.cpu_min)
+        .addDouble("cpu_avg", point.cpu_avg)
+        .addDouble("cpu_max", point.cpu_max)
+        .addUInt("memory_min_kb", point.memory_min_kb)
+        .addUInt("memory_avg_kb", point.memory_avg_kb)
+        .addUInt("memory_max_kb", point.memory_max_kb)
+        .endObject();
+  }
+  json.endArray().endObject();
+}
+
+void handleGetProcessHistory(const RequestContext &context,
+                             json_decoder_t *decoder, std::string &out) {
+  int pid_int = 0;
+  if (json_decoder_get_int(decoder, "pid", &pid_int, false) !=
+      JSON_DECODER_OK) {
+    JsonWriter json(out);
+    json.beginObject();
+    writeError(json, "Missing or invalid 'pid'");
+    return;
+  }
+  pid_t pid = static_cast<pid_t>(pid_int);
+
+  // Any of from/to/max_points selects a range query over the rollup tiers
+  long long from = 0;
+  long long to = static_cast<long long>(std::time(nullptr));
+  int max_points = 500;
+  bool ranged = json_decoder_get_int_ll(decoder, "from", &from, true) ==
+                JSON_DECODER_OK;
+  ranged |= json_decoder_get_int_ll(decoder, "to", &to, true) ==
+            JSON_DECODER_OK;
+  ranged |= json_decoder_get_int(decoder, "max_points", &max_points, true) ==
+            JSON_DECODER_OK;
+  if (ranged) {
+    if (max_points < 1) {
+      JsonWriter json(out);
+      json.beginObject();
+      writeError(json, "'max_points' must be at least 1");
+      return;
+    }
+    writeHistoryRange(context, pid, from, to, max_points, out);
+    return;
+  }
+
+  HistoryView history = ProcessHistory::getInstance().getHistory(pid);
+
+  if (context.session.encoding == WireEncoding::Binary) {
+    out.reserve(16 + history.span() * 8);
+    BinaryProtocol::Writer binary(out);
+    binary.putHeader(BinaryProtocol::MessageType::ProcessHistory);
+    binary.putVarint(static_cast<uint64_t>(pid));
+    size_t count_offset = binary.reserveU32();
+    uint32_t count = 0;
+    int64_t previous_time = 0;
+    int64_t previous_memory_kb = 0;
+    for (const ProcessHistoryEntry entry : history) {
+      int64_t memory_kb = entry.memory_usage / 1024;
+      binary.putSvarint(static_cast<int64_t>(entry.timestamp) - previous_time);
+      binary.putU32(BinaryProtocol::cpuToWire(entry.cpu_usage));
+      binary.putSvarint(memory_kb - previous_memory_kb);
+      previous_time = entry.timestamp;
+      previous_memory_kb = memory_kb;
+      ++count;
+    }
+    binary.patchU32(count_offset, count);
+    return;
+  }
+
+  out.reserve(48 + history.span() * 64);
+  JsonWriter json(out);
+  json.beginObject()
+      .addString("status", "success")
+      .addInt("pid", pid)
+      .beginArray("history");
+  for (const ProcessHistoryEntry entry : history) {
+    json.beginObject()
+        .addInt("timestamp", entry.timestamp)
+        .addDouble("cpu_usage", entry.cpu_usage)
+        .addInt("memory_usage_kb", entry.memory_usage / 1024)
+        .endObject();
+  }
+  json.endArray().endObject();
+}
+
+// Write a name, using its cached escaped form when it has one
+void addName(JsonWriter &json, std::string_view key, std::string_view name,
+             std::string_view escaped_name) {
+  if (escaped_name.empty()) {
+    json.addString(key, name);
+  } else {
+    json.addEscapedString(key, escaped_name);
+  }
+}
+
+// Pin the fleet view, or answer with an error outside gateway mode
+FleetSnapshotPtr pinFleet(JsonWriter &json) {
+  FleetGateway &gateway = FleetGateway::getInstance();
+  if (!gateway.isRunning()) {
+    writeError(json, "Server is not running as a gateway");
+    return nullptr;
+  }
+  return gateway.getSnapshot();
+}
+
+// Connection state and totals of every upstream of the gateway
+void handleGetFleetNodes(const RequestContext &context,
+                         json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  FleetSnapshotPtr fleet = pinFleet(json);
+  if (!fleet) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  json.addString("status", "success")
+      .addUInt("generation", fleet->generation)
+      .addUInt("processes", fleet->totals.num_processes)
+      .beginArray("nodes");
+  for (const FleetNodePtr &node : fleet->nodes) {
+    json.beginObject()
+        .addString("node", node->name)
+        .addString("address", node->address)
+        .addString("state", upstreamStateName(node->state))
+        .addUInt("generation", node->table->generation)
+        .addUInt("processes", node->totals.num_processes)
+        .addDouble("cpu_usage", node->totals.cpu_usage)
+        .addUInt("memory_usage_kb", node->totals.memory_usage / 1024)
+        .addUInt("updates", node->updates)
+        .addUInt("reconnects", node->reconnects);
+    if (node->updates > 0) {
+      json.addInt("age_ms",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                      now - node->updated)
+                      .count());
+    }
+    if (!node->last_error.empty()) {
+      json.addString("last_error", node->last_error);
+    }
+    json.endObject();
+  }
+  json.endArray().endObject();
+}
+
+// The busiest processes across every upstream, from the fleet view
+void handleGetFleetTop(const RequestContext &context, json_decoder_t *decoder,
+                       std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  FleetSnapshotPtr fleet = pinFleet(json);
+  if (!fleet) {
+    return;
+  }
+  int count = 10;
+  json_decoder_get_int(decoder, "count", &count, true);
+  std::vector<FleetRow> rows =
+      fleet->topCpu(static_cast<size_t>(std::max(count, 0)));
+
+  out.reserve(out.size() + 64 + rows.size() * 128);
+  json.addString("status", "success")
+      .addUInt("generation", fleet->generation)
+      .addUInt("total", fleet->totals.num_processes)
+      .beginArray("processes");
+  for (const FleetRow &row : rows) {
+    const ProcessInfo &info = *row.info;
+    json.beginObject()
+        .addString("node", fleet->nodes[row.node]->name)
+        .addInt("pid", info.pid);
+    addName(json, "name", info.name, info.escaped_name);
+    json.addDouble("cpu_usage", info.cpu_usage)
+        .addUInt("memory_usage_kb", info.memory_usage / 1024)
+        .addInt("threads", info.num_threads)
+        .addInt("priority", info.priority)
+        .addInt("state", info.state)
+        .endObject();
+  }
+  json.endArray().endObject();
+}
+
+// Totals per executable name across every upstream, busiest first
+void handleGetFleetGroups(const RequestContext &context,
+                          json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  FleetSnapshotPtr fleet = pinFleet(json);
+  if (!fleet) {
+    return;
+  }
+  int limit = 0;
+  json_decoder_get_int(decoder, "limit", &limit, true);
+
+  std::vector<const FleetGroup *> groups;
+  groups.reserve(fleet->groups.size());
+  for (const auto &pair : fleet->groups) {
+    groups.push_back(&pair.second);
+  }
+  auto busier = [](const FleetGroup *a, const FleetGroup *b) {
+    if (a->totals.cpu_usage != b->totals.cpu_usage) {
+      return a->totals.cpu_usage > b->totals.cpu_usage;
+    }
+    return a->name < b->name;
+  };
+  if (limit > 0 && static_cast<size_t>(limit) < groups.size()) {
+    std::partial_sort(groups.begin(), groups.begin() + limit, groups.end(),
+                      busier);
+    groups.resize(static_cast<size_t>(limit));
+  } else {
+    std::sort(groups.begin(), groups.end(), busier);
+  }
+
+  json.addString("status", "success")
+      .addUInt("generation", fleet->generation)
+      .addUInt("total", fleet->groups.size())
+      .beginArray("groups");
+  for (const FleetGroup *group : groups) {
+    json.beginObject();
+    addName(json, "name", group->name, group->escaped_name);
+    json.addUInt("nodes", group->num_nodes)
+        .addUInt("processes", group->totals.num_processes)
+        .addDouble("cpu_usage", group->totals.cpu_usage)
+        .addUInt("memory_usage_kb", group->totals.memory_usage / 1024)
+        .endObject();
+  }
+  json.endArray().endObject();
+}
+
+// One process of the fleet view, addressed by node name and PID
+void handleGetFleetProcess(const RequestContext &context,
+                           json_decoder_t *decoder, std::string &out) {
+  JsonWriter json(out);
+  json.beginObject();
+  const char *node_name = NULL;
+  int pid_int = 0;
+  if (json_decoder_get_string(decoder, "node", &node_name, false) !=
+          JSON_DECODER_OK ||
+      !node_name) {
+    writeError(json, "Missing or invalid 'node'");
+    return;
+  }
+  if (json_decoder_get_int(decoder, "pid", &pid_int, false) !=
+      JSON_DECODER_OK) {
+    writeError(json, "Missing or invalid 'pid'");
+    return;
+  }
+  FleetSnapshotPtr fleet = pinFleet(json);
+  if (!fleet) {
+    return;
+  }
+
+  std::optional<uint32_t> node = fleet->findNode(node_name);
+  if (!node) {
+    writeError(json, "Node not found");
+    return;
+  }
+  const ProcessInfo *info = fleet->find(*node, static_cast<pid_t>(pid_int));
+  if (!info) {
+    writeError(json, "Process not found");
+    return;
+  }
+  json.addString("status", "success")
+      .addString("node", fleet->nodes[*node]->name)
+      .addInt("pid", info->pid)
+      .addUInt("generation", fleet->nodes[*node]->table->generation);
+  json.addProcessRow(*info, DEFAULT_FIELDS & ~FIELD_PID, "info");
+  json.endObject();
+}
+
+// Log in with a username and password, or with a token from an earlier
+// login to skip the password hash
+void handleLogin(const RequestContext &context, json_decoder_t *decoder,
+                 json_encoder_t *encoder) {
+  const char *token = NULL;
+  const char *username = NULL;
+  const char *password = NULL;
+  json_decoder_get_string(decoder, "token", &token, true);
+  if (!token &&
+      (json_decoder_get_string(decoder, "username", &username, false) !=
+           JSON_DECODER_OK ||
+       json_decoder_get_string(decoder, "password", &password, false) !=
+           JSON_DECODER_OK ||
+       !username || !password)) {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message",
+                            "Missing 'username' and 'password', or 'token'");
+    return;
+  }
+
+  Session session;
+  const char *encoding = NULL;
+  json_decoder_get_string(decoder, "encoding", &encoding, true);
+  if (encoding && strcmp(encoding, "binary") == 0) {
+    // Binary bodies cannot be delimited by the JSON scanner
+    if (SocketServer::getInstance().getFraming(context.client_socket) !=
+        Framing::LengthPrefixed) {
+      json_encoder_add_string(encoder, "status", "error");
+      json_encoder_add_string(
+          encoder, "message",
+          "Binary encoding requires length-prefixed framing");
+      return;
+    }
+    session.encoding = WireEncoding::Binary;
+  } else if (encoding && strcmp(encoding, "json") != 0) {
+    json_encoder_add_string(encoder, "status", "error");
+    json_encoder_add_string(encoder, "message",
+                            "Invalid 'encoding' (json or binary)");
+    return;
+  }
+
+  SessionManager &sessions = SessionManager::getInstance();
+  if (token) {
+    if (!sessions.redeemToken(context.client_socket, session, token)) {
+      json_encoder_add_string(encoder, "status", "error");
+      json_encoder_add_string(encoder, "message", "Invalid or expired token");
+      return;
+    }
+  } else {
+    auto user_type = Authentication::ValidateLogin(username, password);
+    if (!user_type) {
+      json_encoder_add_string(encoder, "status", "error");
+      json_encoder_add_string(encoder, "message", "Invalid credentials");
+      return;
+    }
+    session.authenticated = true;
+    session.user_type = *user_type;
+    sessions.issueToken(context.client_socket, session, username);
+  }
+
+  json_encoder_add_string(encoder, "status", "success");
+  json_encoder_add_string(encoder, "user_type",
+                          session.user_type == Authentication::ADMIN
+                              ? "admin"
+                              : "viewer");
+  json_encoder_add_string(encoder, "encoding",
+                          session.encoding == WireEncoding::Binary ? "binary"
+                                                                   : "json");
+  json_encoder_add_string(encoder, "token", session.token.c_str());
+  json_encoder_add_int(
+      encoder, "token_lifetime",
+      std::chrono::seconds(SessionManager::TOKEN_LIFETIME).count());
+}
+
+// Latency summary of one histogram; bounds are bucket upper bounds
+void writeHistogram(JsonWriter &json, std::string_view key,
+                    const HistogramSnapshot &histogram) {
+  json.beginObject(key)
+      .addUInt("count", histogram.count)
+      .addDouble("total_ms", histogram.sum_ns / 1e6)
+      .addDouble("avg_us", histogram.count > 0 ? histogram.sum_ns / 1e3 /
+                                                     histogram.count
+                                               : 0.0)
+      .addUInt("p50_us", histogram.quantileUs(0.5))
+      .addUInt("p90_us", histogram.quantileUs(0.9))
+      .addUInt("p99_us", histogram.quantileUs(0.99))
+      .endObject();
+}
+
+// Values read from their owners at request time rather than recorded
+std::vector<Gauge> collectGauges() {
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+  HandlerPool &pool = HandlerPool::getInstance();
+  ProcessEvents &events = ProcessEvents::getInstance();
+  StringTable &names = StringTable::getInstance();
+  FleetSnapshotPtr fleet = FleetGateway::getInstance().getSnapshot();
+  size_t streaming = static_cast<size_t>(std::count_if(
+      fleet->nodes.begin(), fleet->nodes.end(), [](const FleetNodePtr &node) {
+        return node->state == UpstreamState::Streaming;
+      }));
+  return {
+      {"handler_queue_depth", "Requests waiting for a handler thread",
+       static_cast<double>(pool.queueDepth())},
+      {"handler_threads", "Handler pool worker threads",
+       static_cast<double>(pool.threadCount())},
+      {"collector_threads", "Process collector shards",
+       static_cast<double>(ProcessCore::getInstance().getCollectorThreads())},
+      {"connections", "Connected clients",
+       static_cast<double>(SocketServer::getInstance().connectionCount())},
+      {"subscriptions", "Active subscriptions",
+       static_cast<double>(SubscriptionManager::getInstance().count())},
+      {"processes", "Processes in the current snapshot",
+       static_cast<double>(snapshot ? snapshot->processes.size() : 0)},
+      {"snapshot_generation", "Generation of the current snapshot",
+       static_cast<double>(snapshot ? snapshot->generation : 0)},
+      {"history_processes", "Processes with in-memory history",
+       static_cast<double>(ProcessHistory::getInstance().trackedCount())},
+      {"interned_names", "Distinct process names interned",
+       static_cast<double>(names.size())},
+      {"interned_name_bytes", "Bytes held by interned process names",
+       static_cast<double>(names.bytes())},
+      {"fleet_nodes", "Upstream servers of the gateway",
+       static_cast<double>(fleet->nodes.size())},
+      {"fleet_nodes_streaming", "Upstream servers sending updates",
+       static_cast<double>(streaming)},
+      {"fleet_processes", "Processes in the fleet view",
+       static_cast<double>(fleet->totals.num_processes)},
+      {"process_created_events_total", "Process creation notifications",
+       static_cast<double>(events.createdCount()), true},
+      {"process_exited_events_total", "Process exit notifications",
+       static_cast<double>(events.exitedCount()), true},
+  };
+}
+
+// Report the server's own cost: counters, latency histograms, gauges and
+// per-client traffic, as JSON or as Prometheus text
+void handleGetServerMetrics(const RequestContext &context,
+                            json_decoder_t *decoder, std::string &out) {
+  (void)context;
+  const char *format = "json";
+  json_decoder_get_string(decoder, "format", &format, true);
+
+  ServerMetrics &metrics = ServerMetrics::getInstance();
+  MetricsSnapshot snapshot = metrics.snapshot();
+  std::vector<Gauge> gauges = collectGauges();
+
+  JsonWriter json(out);
+  json.beginObject();
+  if (std::strcmp(format, "prometheus") == 0) {
+    json.addString("status", "success")
+        .addString("format", "prometheus")
+        .addString("text", metrics.formatPrometheus(snapshot, gauges))
+        .endObject();
+    return;
+  }
+  if (std::strcmp(format, "json") != 0) {
+    writeError(json, "'format' must be \"json\" or \"prometheus\"");
+    return;
+  }
+
+  json.addString("status", "success")
+      .addDouble("uptime_s",
+                 std::chrono::duration<double>(snapshot.uptime).count());
+
+  json.beginObject("counters");
+  for (size_t i = 0; i < snapshot.counters.size(); ++i) {
+    json.addUInt(ServerMetrics::counterName(static_cast<Counter>(i)),
+                 snapshot.counters[i]);
+  }
+  json.endObject();
+
+  json.beginObject("gauges");
+  for (const auto &gauge : gauges) {
+    json.addDouble(gauge.name, gauge.value);
+  }
+  json.endObject();
+
+  json.beginObject("latency");
+  for (size_t i = 0; i < snapshot.latency.size(); ++i) {
+    writeHistogram(json, ServerMetrics::latencyName(static_cast<Latency>(i)),
+                   snapshot.latency[i]);
+  }
+  json.endObject();
+
+  // Only commands that have been run
+  std::vector<std::string> names = metrics.commandNames();
+  json.beginObject("commands");
+  for (size_t i = 0; i < snapshot.commands.size() && i < names.size(); ++i) {
+    if (snapshot.commands[i].count > 0) {
+      writeHistogram(json, names[i], snapshot.commands[i]);
+    }
+  }
+  json.endObject();
+
+  json.beginArray("clients");
+  for (const auto &client : SocketServer::getInstance().getClientTraffic()) {
+    json.beginObject()
+        .addInt("client_socket", client.client_socket)
+        .addUInt("bytes_received", client.bytes_received)
+        .addUInt("bytes_sent", client.bytes_sent)
+        .addUInt("queued_bytes", client.queued_bytes)
+        .endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
+
 // --- End Command Handler Functions ---
 
 // Function to initialize the command handlers map
@@ -114,23 +1262,108 @@ std::map<std::string, CommandHandler> initializeCommandHandlers() {
   std::map<std::string, CommandHandler> handlers;
 
   // Assign function pointers to the map
-  handlers["get_processes"] = handleGetProcesses;
-  handlers["get_process_info"] = handleGetProcessInfo;
   handlers["suspend_process"] = handleSuspendProcess;
   handlers["resume_process"] = handleResumeProcess;
   handlers["terminate_process"] = handleTerminateProcess;
+  handlers["get_hot_threads"] = handleGetHotThreads;
+  handlers["set_thread_sampling"] = handleSetThreadSampling;
+  handlers["subscribe"] = handleSubscribe;
+  handlers["unsubscribe"] = handleUnsubscribe;
+  handlers["refresh"] = handleRefresh;
+  handlers["set_sampling_tiers"] = handleSetSamplingTiers;
+  handlers["login"] = handleLogin;
+
+  return handlers;
+}
+
+// High-volume commands with a fixed response shape, serialized directly
+std::map<std::string, RawCommandHandler> initializeRawCommandHandlers() {
+  std::map<std::string, RawCommandHandler> handlers;
+
+  handlers["get_processes"] = handleGetProcesses;
+  handlers["get_process_info"] = handleGetProcessInfo;
+  handlers["get_process_table"] = handleGetProcessTable;
+  handlers["get_process_table_delta"] = handleGetProcessTableDelta;
+  handlers["get_process_history"] = handleGetProcessHistory;
+  handlers["get_process_tree"] = handleGetProcessTree;
+  handlers["terminate_tree"] = handleTerminateTree;
+  handlers["batch_control"] = handleBatchControl;
+  handlers["get_server_metrics"] = handleGetServerMetrics;
+  handlers["get_fleet_nodes"] = handleGetFleetNodes;
+  handlers["get_fleet_top"] = handleGetFleetTop;
+  handlers["get_fleet_groups"] = handleGetFleetGroups;
+  handlers["get_fleet_process"] = handleGetFleetProcess;
 
   return handlers;
 }
 
+// Commands that change process state; only admin sessions may run them
+static const std::unordered_set<std::string> adminCommands = {
+    "suspend_process",    "resume_process",     "terminate_process",
+    "terminate_tree",     "batch_control",
+    // Raise collection cost for the whole server
+    "set_sampling_tiers", "set_thread_sampling",
+};
+
 // Global map of command handlers - initialized by function
 static const std::map<std::string, CommandHandler> commandHandlers =
     initializeCommandHandlers();
+static const std::map<std::string, RawCommandHandler> rawCommandHandlers =
+    initializeRawCommandHandlers();
+
+// Latency histogram slot of every known command, assigned once at startup
+std::unordered_map<std::string, size_t> registerCommandSlots() {
+  std::unordered_map<std::string, size_t> slots;
+  ServerMetrics &metrics = ServerMetrics::getInstance();
+  for (const auto &entry : commandHandlers) {
+    slots.emplace(entry.first, metrics.registerCommand(entry.first));
+  }
+  for (const auto &entry : rawCommandHandlers) {
+    slots.emplace(entry.first, metrics.registerCommand(entry.first));
+  }
+  return slots;
+}
+
+static const std::unordered_map<std::string, size_t> commandSlots =
+    registerCommandSlots();
+
+// Encoder and decoder reused by every request handled on one thread. Each
+// handler thread owns one pair, so they are reset rather than re-created and
+// never shared between concurrent requests.
+struct JsonWorkspace {
+  json_decoder_t *decoder = json_decoder_create();
+  json_encoder_t *encoder = json_encoder_create();
+
+  JsonWorkspace() = default;
+  JsonWorkspace(const JsonWorkspace &) = delete;
+  JsonWorkspace &operator=(const JsonWorkspace &) = delete;
+  ~JsonWorkspace() {
+    json_decoder_destroy(decoder);
+    json_encoder_destroy(encoder);
+  }
+};
+
+JsonWorkspace &threadWorkspace() {
+  thread_local JsonWorkspace workspace;
+  return workspace;
+}
+
+// Copy the finished document out of the encoder; the only copy a response
+// makes before it is queued on the socket
+std::string takeResponse(json_encoder_t *encoder) {
+  const char *json_str = json_encoder_buffer(encoder);
+  if (!json_str) {
+    return "{\"status\":\"error\",\"message\":\"Encoder error\"}";
+  }
+  int length = json_encoder_length(encoder);
+  return length > 0 ? std::string(json_str, static_cast<size_t>(length))
+                    : std::string(json_str);
+}
 
 // Helper function to create a JSON error response using QNX JSON library
-std::string createJsonError(const std::string &error,
+std::string createJsonError(json_encoder_t *enc, const std::string &error,
                             const std::string &details) {
-  json_encoder_t *enc = json_encoder_create();
+  json_encoder_reset(enc, 0);
   json_encoder_start_object(enc, NULL);
   json_encoder_add_string(enc, "status", "error");
   json_encoder_add_string(enc, "message", error.c_str());
@@ -138,17 +1371,16 @@ std::string createJsonError(const std::string &error,
     json_encoder_add_string(enc, "details", details.c_str());
   }
   json_encoder_end_object(enc);
-  const char *json_str = json_encoder_buffer(enc);
-  std::string response(
-      json_str ? json_str
-               : "{\"status\":\"error\",\"message\":\"Encoder error\"}");
-  json_encoder_destroy(enc);
-  return response;
+  return takeResponse(enc);
 }
 
-// Main message handler using QNX JSON library
+// Main message handler using QNX JSON library. The message is parsed exactly
+// once; the positioned decoder is handed to the command handler.
 std::string handleMessage(int client_socket, const std::string &message) {
-  json_decoder_t *decoder = json_decoder_create();
+  ServerMetrics &metrics = ServerMetrics::getInstance();
+  metrics.add(Counter::Requests);
+  JsonWorkspace &workspace = threadWorkspace();
+  json_decoder_t *decoder = workspace.decoder;
   json_decoder_error_t status =
       json_decoder_parse_json_str(decoder, message.c_str());
 
@@ -156,8 +1388,9 @@ std::string handleMessage(int client_socket, const std::string &message) {
     int err_pos;
     const char *err_str;
     json_decoder_get_parse_error(decoder, &err_pos, &err_str);
-    json_decoder_destroy(decoder);
-    return createJsonError("Invalid JSON format", err_str);
+    metrics.add(Counter::RequestErrors);
+    return createJsonError(workspace.encoder, "Invalid JSON format",
+                           err_str ? err_str : "");
   }
 
   json_decoder_push_object(decoder, NULL, false);
@@ -166,19 +1399,17 @@ std::string handleMessage(int client_socket, const std::string &message) {
   if (json_decoder_get_string(decoder, "command", &req_type_ptr, false) !=
           JSON_DECODER_OK ||
       req_type_ptr == NULL) {
-    json_decoder_destroy(decoder);
-    return createJsonError("Missing or invalid 'command'",
+    metrics.add(Counter::RequestErrors);
+    return createJsonError(workspace.encoder, "Missing or invalid 'command'",
                            "Command must be a string");
   }
   std::string command(req_type_ptr);
 
-  json_encoder_t *encoder = json_encoder_create();
-  std::string response = processCommand(command, message, encoder);
-
-  json_decoder_destroy(decoder);
-  json_encoder_destroy(encoder);
-
-  return response;
+  RequestContext context;
+  context.client_socket = client_socket;
+  context.session = SessionManager::getInstance().getSession(client_socket);
+  json_encoder_reset(workspace.encoder, 0);
+  return processCommand(context, command, decoder, workspace.encoder);
 }
 
 // Validation function (simple parse check)
@@ -204,30 +1435,29 @@ std::string toJson(const std::string &data) {
   return response;
 }
 
-// Command processing using QNX JSON library
-std::string processCommand(const std::string &command,
-                           const std::string &raw_params_json,
-                           json_encoder_t *encoder) {
-  json_decoder_t *decoder = json_decoder_create();
-  json_decoder_error_t parse_status =
-      json_decoder_parse_json_str(decoder, raw_params_json.c_str());
-
-  if (parse_status != JSON_DECODER_OK) {
-    json_decoder_destroy(decoder);
-    json_encoder_start_object(encoder, NULL);
-    json_encoder_add_string(encoder, "command", command.c_str());
-    json_encoder_add_string(encoder, "status", "error");
-    json_encoder_add_string(encoder, "message",
-                            "Failed to parse parameters JSON");
-    json_encoder_end_object(encoder);
-    const char *json_response = json_encoder_buffer(encoder);
-    json_encoder_destroy(encoder);
-    return std::string(
-        json_response ? json_response
-                      : "{\"status\":\"error\",\"message\":\"Encoder error\"}");
+// Run the handler for a known command
+std::string dispatchCommand(const RequestContext &context,
+                            const std::string &command,
+                            json_decoder_t *decoder, json_encoder_t *encoder) {
+  // The session was looked up once per request, so this is a set probe
+  if (adminCommands.count(command) != 0 &&
+      (!context.session.authenticated ||
+       context.session.user_type != Authentication::ADMIN)) {
+    ServerMetrics::getInstance().add(Counter::RequestErrors);
+    return createJsonError(encoder, "Permission denied",
+                           "'" + command + "' requires an admin login");
   }
 
-  json_decoder_push_object(decoder, NULL, false);
+  auto raw = rawCommandHandlers.find(command);
+  if (raw != rawCommandHandlers.end()) {
+    std::string response;
+    try {
+      raw->second(context, decoder, response);
+      return response;
+    } catch (const std::exception &e) {
+      return createJsonError(encoder, "Error processing command", e.what());
+    }
+  }
 
   json_encoder_start_object(encoder, NULL);
 
@@ -235,7 +1465,7 @@ std::string processCommand(const std::string &command,
     // Dispatch using global commandHandlers map
     auto it = commandHandlers.find(command);
     if (it != commandHandlers.end()) {
-      it->second(decoder, encoder);
+      it->second(context, decoder, encoder);
     } else {
       json_encoder_add_string(encoder, "status", "error");
       json_encoder_add_string(
@@ -259,13 +1489,24 @@ std::string processCommand(const std::string &command,
     }
   }
 
-  json_decoder_destroy(decoder);
   json_encoder_end_object(encoder);
-  const char *json_response = json_encoder_buffer(encoder);
-  std::string final_response = std::string(
-      json_response ? json_response
-                    : "{\"status\":\"error\",\"message\":\"Encoder error\"}");
-  json_encoder_destroy(encoder);
-  return final_response;
+  return takeResponse(encoder);
+}
+
+// Command processing using QNX JSON library
+std::string processCommand(const RequestContext &context,
+                           const std::string &command,
+                           json_decoder_t *decoder, json_encoder_t *encoder) {
+  auto slot = commandSlots.find(command);
+  if (slot == commandSlots.end()) {
+    // Answered with "Unknown command"
+    ServerMetrics::getInstance().add(Counter::RequestErrors);
+    return dispatchCommand(context, command, decoder, encoder);
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::string response = dispatchCommand(context, command, decoder, encoder);
+  ServerMetrics::getInstance().recordCommand(
+      slot->second, std::chrono::steady_clock::now() - start);
+  return response;
 }
 } // namespace qnx
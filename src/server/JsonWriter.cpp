@@ -0,0 +1,295 @@
+/**
+ * @file JsonWriter.cpp
+ * @brief Implementation of the direct-to-buffer JSON serializer for QNX
+ * Remote Process Monitor
+ *
+ * The process row writer uses key fragments fixed at compile time
+ * (e.g. ",\"cpu_usage\":"), so a row is a handful of appends and
+ * std::to_chars calls.
+ */
+
+#include "server/JsonWriter.hpp"
+#include "server/ProcessCore.hpp"
+#include <charconv>
+#include <cmath>
+
+namespace qnx {
+namespace {
+struct ProcessFieldName {
+  std::string_view name;
+  ProcessField field;
+};
+
+/// In serialization order
+constexpr ProcessFieldName processFieldNames[] = {
+    {"pid", FIELD_PID},
+    {"parent_pid", FIELD_PARENT_PID},
+    {"name", FIELD_NAME},
+    {"cpu_usage", FIELD_CPU_USAGE},
+    {"memory_usage_kb", FIELD_MEMORY_USAGE},
+    {"threads", FIELD_THREADS},
+    {"priority", FIELD_PRIORITY},
+    {"policy", FIELD_POLICY},
+    {"state", FIELD_STATE},
+};
+
+/// Key fragments of a process row, quoted and with the colon, in the same
+/// order as processFieldNames
+constexpr std::string_view rowKeys[] = {
+    "\"pid\":",      "\"parent_pid\":", "\"name\":",
+    "\"cpu_usage\":", "\"memory_usage_kb\":", "\"threads\":",
+    "\"priority\":", "\"policy\":",     "\"state\":",
+};
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+template <typename T> void appendNumber(std::string &out, T value) {
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, result.ptr);
+}
+
+void appendDouble(std::string &out, double value) {
+  if (!std::isfinite(value)) {
+    out += '0'; // JSON has no NaN or infinity
+    return;
+  }
+  appendNumber(out, value);
+}
+} // namespace
+
+/**
+ * @brief Map a column name (e.g. "cpu_usage") to its ProcessField bit
+ */
+unsigned parseProcessField(std::string_view name) noexcept {
+  for (const auto &entry : processFieldNames) {
+    if (entry.name == name) {
+      return entry.field;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Check whether a string contains characters JSON requires escaped
+ */
+bool needsJsonEscape(std::string_view value) noexcept {
+  for (char c : value) {
+    if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Append a string's JSON-escaped contents (without quotes)
+ *
+ * Runs of characters that need no escaping are appended in one call.
+ */
+void appendJsonEscaped(std::string &out, std::string_view value) {
+  size_t run = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c != '"' && c != '\\' && c >= 0x20) {
+      continue;
+    }
+    out.append(value.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      out += "\\u00";
+      out += HEX_DIGITS[c >> 4];
+      out += HEX_DIGITS[c & 0xf];
+      break;
+    }
+  }
+  out.append(value.data() + run, value.size() - run);
+}
+
+/**
+ * @brief Return a string's JSON-escaped contents (without quotes)
+ */
+std::string jsonEscape(std::string_view value) {
+  std::string escaped;
+  escaped.reserve(value.size() + 8);
+  appendJsonEscaped(escaped, value);
+  return escaped;
+}
+
+void JsonWriter::separator() {
+  uint32_t bit = 1u << depth_;
+  if (has_members_ & bit) {
+    out_ += ',';
+  }
+  has_members_ |= bit;
+}
+
+void JsonWriter::writeKey(std::string_view key) {
+  separator();
+  if (!key.empty()) {
+    out_ += '"';
+    out_.append(key.data(), key.size());
+    out_ += "\":";
+  }
+}
+
+void JsonWriter::open(char bracket) {
+  out_ += bracket;
+  if (depth_ + 1 < MAX_DEPTH) {
+    ++depth_;
+    has_members_ &= ~(1u << depth_);
+  }
+}
+
+void JsonWriter::close(char bracket) {
+  out_ += bracket;
+  if (depth_ > 0) {
+    --depth_;
+  }
+}
+
+JsonWriter &JsonWriter::beginObject(std::string_view key) {
+  if (depth_ > 0 || !key.empty()) {
+    writeKey(key);
+  }
+  open('{');
+  return *this;
+}
+
+JsonWriter &JsonWriter::endObject() {
+  close('}');
+  return *this;
+}
+
+JsonWriter &JsonWriter::beginArray(std::string_view key) {
+  if (depth_ > 0 || !key.empty()) {
+    writeKey(key);
+  }
+  open('[');
+  return *this;
+}
+
+JsonWriter &JsonWriter::endArray() {
+  close(']');
+  return *this;
+}
+
+JsonWriter &JsonWriter::addInt(std::string_view key, int64_t value) {
+  writeKey(key);
+  appendNumber(out_, value);
+  return *this;
+}
+
+JsonWriter &JsonWriter::addUInt(std::string_view key, uint64_t value) {
+  writeKey(key);
+  appendNumber(out_, value);
+  return *this;
+}
+
+JsonWriter &JsonWriter::addDouble(std::string_view key, double value) {
+  writeKey(key);
+  appendDouble(out_, value);
+  return *this;
+}
+
+JsonWriter &JsonWriter::addBool(std::string_view key, bool value) {
+  writeKey(key);
+  out_ += value ? "true" : "false";
+  return *this;
+}
+
+JsonWriter &JsonWriter::addString(std::string_view key,
+                                  std::string_view value) {
+  writeKey(key);
+  out_ += '"';
+  appendJsonEscaped(out_, value);
+  out_ += '"';
+  return *this;
+}
+
+JsonWriter &JsonWriter::addEscapedString(std::string_view key,
+                                         std::string_view escaped) {
+  writeKey(key);
+  out_ += '"';
+  out_.append(escaped.data(), escaped.size());
+  out_ += '"';
+  return *this;
+}
+
+/**
+ * @brief Add one process as an object with the selected columns
+ *
+ * Bypasses the generic member path: the row is written with precomputed key
+ * fragments and no per-member bookkeeping.
+ */
+JsonWriter &JsonWriter::addProcessRow(const ProcessInfo &info,
+                                      unsigned fields, std::string_view key) {
+  writeKey(key);
+  out_ += '{';
+  bool first = true;
+  for (size_t i = 0; i < sizeof(rowKeys) / sizeof(rowKeys[0]); ++i) {
+    ProcessField field = processFieldNames[i].field;
+    if (!(fields & field)) {
+      continue;
+    }
+    if (!first) {
+      out_ += ',';
+    }
+    first = false;
+    out_.append(rowKeys[i].data(), rowKeys[i].size());
+    switch (field) {
+    case FIELD_PID:
+      appendNumber(out_, static_cast<int64_t>(info.pid));
+      break;
+    case FIELD_PARENT_PID:
+      appendNumber(out_, static_cast<int64_t>(info.parent_pid));
+      break;
+    case FIELD_NAME:
+      out_ += '"';
+      if (!info.escaped_name.empty()) {
+        out_ += info.escaped_name;
+      } else {
+        appendJsonEscaped(out_, info.name); // a single append when clean
+      }
+      out_ += '"';
+      break;
+    case FIELD_CPU_USAGE:
+      appendDouble(out_, info.cpu_usage);
+      break;
+    case FIELD_MEMORY_USAGE:
+      appendNumber(out_, info.memory_usage / 1024);
+      break;
+    case FIELD_THREADS:
+      appendNumber(out_, info.num_threads);
+      break;
+    case FIELD_PRIORITY:
+      appendNumber(out_, info.priority);
+      break;
+    case FIELD_POLICY:
+      appendNumber(out_, info.policy);
+      break;
+    case FIELD_STATE:
+      appendNumber(out_, info.state);
+      break;
+    }
+  }
+  out_ += '}';
+  return *this;
+}
+} // namespace qnx
@@ -0,0 +1,403 @@
+/**
+ * @file LinuxProcessSource.cpp
+ * @brief Implementation of the Linux /proc process source for QNX Remote
+ * Process Monitor
+ */
+
+#include "server/LinuxProcessSource.hpp"
+#include "server/ProcessControl.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace qnx {
+namespace {
+/// Last stat field the parser needs (rss); later ones are optional
+constexpr int LAST_REQUIRED_FIELD = 24;
+/// Field holding the scheduling policy
+constexpr int POLICY_FIELD = 41;
+
+/**
+ * @brief Parse the next space-separated integer field
+ *
+ * @param p Advanced past the field
+ * @param end End of the line
+ * @param value The field's value
+ * @return false if there is no further numeric field
+ */
+bool nextField(const char *&p, const char *end, int64_t &value) {
+  while (p != end && *p == ' ') {
+    ++p;
+  }
+  bool negative = p != end && *p == '-';
+  if (negative) {
+    ++p;
+  }
+  if (p == end || *p < '0' || *p > '9') {
+    return false;
+  }
+  // Unsigned so values like rsslim's all-ones wrap instead of overflowing
+  uint64_t result = 0;
+  while (p != end && *p >= '0' && *p <= '9') {
+    result = result * 10 + static_cast<uint64_t>(*p - '0');
+    ++p;
+  }
+  value = static_cast<int64_t>(negative ? 0 - result : result);
+  return true;
+}
+
+/**
+ * @brief Format "<root>/<pid>/<entry>" into a fixed buffer
+ *
+ * @return false if the path does not fit
+ */
+bool formatPath(char (&path)[PATH_MAX], const std::string &root, pid_t pid,
+                const char *entry) {
+  int length = std::snprintf(path, sizeof(path), "%s/%d/%s", root.c_str(),
+                             static_cast<int>(pid), entry);
+  return length > 0 && static_cast<size_t>(length) < sizeof(path);
+}
+} // namespace
+
+LinuxProcessSource::LinuxProcessSource(std::string proc_root)
+    : proc_root_(std::move(proc_root)) {
+  long ticks = sysconf(_SC_CLK_TCK);
+  long page = sysconf(_SC_PAGESIZE);
+  tick_ns_ = ticks > 0 ? 1000000000ULL / static_cast<uint64_t>(ticks)
+                       : 10000000ULL;
+  page_size_ = page > 0 ? static_cast<uint64_t>(page) : 4096;
+}
+
+/**
+ * @brief List the PIDs present in the /proc mount
+ *
+ * @param pids Replaced with the PIDs, in directory order
+ * @throws std::runtime_error if the mount does not exist
+ */
+void LinuxProcessSource::listPids(std::vector<pid_t> &pids) {
+  listProcDirectory(proc_root_, pids);
+}
+
+std::unique_ptr<ProcessSource::Reader> LinuxProcessSource::openReader() {
+  return std::make_unique<StatReader>(*this);
+}
+
+/**
+ * @brief Parse one /proc/<pid>/stat line without allocating
+ *
+ * The command name is in parentheses and may itself contain spaces and
+ * parentheses, so the fields after it are counted from the last ')'.
+ *
+ * @param begin Start of the line
+ * @param end One past its last character
+ * @param tick_ns Nanoseconds per clock tick
+ * @param page_size Bytes per page
+ * @param sample Filled in on success
+ * @return false if the line is truncated or malformed
+ */
+bool LinuxProcessSource::parseStat(const char *begin, const char *end,
+                                   uint64_t tick_ns, uint64_t page_size,
+                                   ProcessSample &sample) {
+  const char *p = begin;
+  int64_t value = 0;
+  if (!nextField(p, end, value)) {
+    return false;
+  }
+  pid_t pid = static_cast<pid_t>(value);
+
+  const char *name_end = end;
+  while (name_end != p && *(name_end - 1) != ')') {
+    --name_end;
+  }
+  if (name_end == p) {
+    return false;
+  }
+  p = name_end;
+  while (p != end && *p == ' ') {
+    ++p;
+  }
+  if (p == end) {
+    return false;
+  }
+  int state = static_cast<unsigned char>(*p++);
+
+  int64_t utime = 0;
+  int64_t stime = 0;
+  int policy = 0;
+  for (int field = 4; field <= POLICY_FIELD; ++field) {
+    if (!nextField(p, end, value)) {
+      if (field <= LAST_REQUIRED_FIELD) {
+        return false;
+      }
+      break;
+    }
+    switch (field) {
+    case 4:
+      sample.parent_pid = static_cast<pid_t>(value);
+      break;
+    case 14:
+      utime = value;
+      break;
+    case 15:
+      stime = value;
+      break;
+    case 18:
+      sample.priority = static_cast<int>(value);
+      break;
+    case 20:
+      sample.num_threads = static_cast<int>(value);
+      break;
+    case 22:
+      sample.start_time = static_cast<uint64_t>(value) * tick_ns;
+      break;
+    case 24:
+      sample.memory_usage =
+          value > 0 ? static_cast<uint64_t>(value) * page_size : 0;
+      break;
+    case POLICY_FIELD:
+      policy = static_cast<int>(value);
+      break;
+    default:
+      break;
+    }
+  }
+
+  sample.pid = pid;
+  sample.state = state;
+  sample.policy = policy;
+  sample.sutime = static_cast<uint64_t>(std::max<int64_t>(utime + stime, 0)) *
+                  tick_ns;
+  return true;
+}
+
+/**
+ * @brief Destructor: closes every cached descriptor
+ */
+LinuxProcessSource::StatReader::~StatReader() {
+  for (auto &pair : stat_fds_) {
+    close(pair.second);
+  }
+}
+
+/**
+ * @brief Read a batch of processes through their cached stat descriptors
+ *
+ * @param pids The PIDs to read, in ascending order
+ * @param count Number of PIDs
+ * @param out Room for count samples
+ * @return The number of samples written
+ */
+size_t LinuxProcessSource::StatReader::readBatch(const pid_t *pids,
+                                                 size_t count,
+                                                 ProcessSample *out) {
+  size_t written = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (readStat(pids[i], out[written])) {
+      ++written;
+    }
+  }
+  return written;
+}
+
+/**
+ * @brief Read one process's stat line through its cached descriptor
+ *
+ * A read on a cached descriptor fails once its process has exited. The PID
+ * may already belong to a new process, so the file is reopened once before
+ * giving up.
+ *
+ * @param pid The process ID
+ * @param sample Filled in on success
+ * @return true if the process was read
+ */
+bool LinuxProcessSource::StatReader::readStat(pid_t pid,
+                                              ProcessSample &sample) {
+  auto it = stat_fds_.find(pid);
+  bool cached = it != stat_fds_.end();
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (!cached) {
+      char path[PATH_MAX];
+      if (!formatPath(path, source_.proc_root_, pid, "stat")) {
+        return false;
+      }
+      int fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd == -1) {
+        return false; // Exited between listing and opening
+      }
+      it = stat_fds_.emplace(pid, fd).first;
+    }
+
+    ssize_t length = pread(it->second, buffer_, sizeof(buffer_), 0);
+    if (length > 0 &&
+        parseStat(buffer_, buffer_ + length, source_.tick_ns_,
+                  source_.page_size_, sample)) {
+      return true;
+    }
+    close(it->second);
+    stat_fds_.erase(it);
+    if (!cached) {
+      return false;
+    }
+    cached = false;
+  }
+  return false;
+}
+
+/**
+ * @brief Read and parse a stat file that is not cached
+ *
+ * @param path Path of the file
+ * @param sample Filled in on success
+ * @return true if the file was read
+ */
+bool LinuxProcessSource::StatReader::readStatFile(const char *path,
+                                                  ProcessSample &sample) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  ssize_t length = read(fd, buffer_, sizeof(buffer_));
+  close(fd);
+  return length > 0 && parseStat(buffer_, buffer_ + length, source_.tick_ns_,
+                                 source_.page_size_, sample);
+}
+
+/**
+ * @brief Sample every thread of a process from /proc/<pid>/task
+ *
+ * Thread descriptors are not cached: only busy or watched processes are
+ * walked, and their threads come and go.
+ *
+ * @param pid The process ID
+ * @param out Replaced with one sample per thread
+ * @return false if no thread could be read
+ */
+bool LinuxProcessSource::StatReader::readThreads(
+    pid_t pid, std::vector<ThreadSample> &out) {
+  out.clear();
+  char dir_path[PATH_MAX];
+  if (!formatPath(dir_path, source_.proc_root_, pid, "task")) {
+    return false;
+  }
+  DIR *dir = opendir(dir_path);
+  if (!dir) {
+    return false;
+  }
+
+  char path[PATH_MAX];
+  ProcessSample sample;
+  while (struct dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+      continue;
+    }
+    int length = std::snprintf(path, sizeof(path), "%s/%s/stat", dir_path,
+                               entry->d_name);
+    if (length <= 0 || static_cast<size_t>(length) >= sizeof(path) ||
+        !readStatFile(path, sample)) {
+      continue; // The thread exited while walking
+    }
+    ThreadSample thread;
+    thread.tid = sample.pid;
+    thread.sutime = sample.sutime;
+    thread.priority = sample.priority;
+    thread.policy = sample.policy;
+    thread.state = sample.state;
+    out.push_back(thread);
+  }
+  closedir(dir);
+
+  std::sort(out.begin(), out.end(),
+            [](const ThreadSample &a, const ThreadSample &b) {
+              return a.tid < b.tid;
+            });
+  return !out.empty();
+}
+
+/**
+ * @brief Resolve a name from the exe link, the command line or the stat name
+ *
+ * Kernel threads have neither an executable nor a command line, so they
+ * are named like ps does, by their stat name in brackets.
+ *
+ * @param pid The process ID
+ * @return The name, or empty if the process has gone
+ */
+std::string LinuxProcessSource::StatReader::readName(pid_t pid) {
+  char path[PATH_MAX];
+  if (!formatPath(path, source_.proc_root_, pid, "exe")) {
+    return "";
+  }
+  char target[PATH_MAX];
+  ssize_t length = readlink(path, target, sizeof(target) - 1);
+  if (length > 0) {
+    return std::string(target, static_cast<size_t>(length));
+  }
+
+  std::string name = getCommandLine(pid, source_.proc_root_);
+  size_t first_space = name.find(' ');
+  if (first_space != std::string::npos) {
+    name.resize(first_space);
+  }
+  if (!name.empty()) {
+    return name;
+  }
+
+  if (!formatPath(path, source_.proc_root_, pid, "stat")) {
+    return "";
+  }
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return "";
+  }
+  length = read(fd, buffer_, sizeof(buffer_));
+  close(fd);
+  if (length <= 0) {
+    return "";
+  }
+  const char *begin = buffer_;
+  const char *end = begin + length;
+  const char *open_paren = std::find(begin, end, '(');
+  const char *close_paren = end;
+  while (close_paren != open_paren && *(close_paren - 1) != ')') {
+    --close_paren;
+  }
+  if (open_paren == end || close_paren == open_paren) {
+    return "";
+  }
+  return "[" + std::string(open_paren + 1, close_paren - 1) + "]";
+}
+
+/**
+ * @brief Close the cached descriptor of a process
+ *
+ * @param pid The process ID
+ */
+void LinuxProcessSource::StatReader::forget(pid_t pid) {
+  auto it = stat_fds_.find(pid);
+  if (it != stat_fds_.end()) {
+    close(it->second);
+    stat_fds_.erase(it);
+  }
+}
+
+/**
+ * @brief Close the descriptors of processes that are no longer listed
+ *
+ * @param pids The live PIDs of this shard, in ascending order
+ */
+void LinuxProcessSource::StatReader::retain(const std::vector<pid_t> &pids) {
+  for (auto it = stat_fds_.begin(); it != stat_fds_.end();) {
+    if (!std::binary_search(pids.begin(), pids.end(), it->first)) {
+      close(it->second);
+      it = stat_fds_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+} // namespace qnx
@@ -0,0 +1,203 @@
+/**
+ * @file MessageFraming.cpp
+ * @brief Implementation of stream framing for the QNX Remote Process Monitor
+ *
+ * This file implements the per-connection reassembly buffer and the helpers
+ * used to frame outgoing messages. Two framings are supported: concatenated
+ * (typically newline-delimited) JSON documents, and a 4-byte big-endian
+ * length prefix.
+ */
+
+#include "server/MessageFraming.hpp"
+#include <cctype>
+
+namespace qnx {
+/**
+ * @brief Append received bytes to the reassembly buffer
+ *
+ * Reclaims the consumed prefix of the buffer only when it makes up at least
+ * half of the buffer, which keeps compaction amortised O(1) per byte.
+ *
+ * @param data Pointer to the received bytes
+ * @param length Number of bytes received
+ */
+void FrameDecoder::append(const char *data, size_t length) {
+  if (begin_ > 0 && begin_ >= buffer_.size() / 2) {
+    buffer_.erase(0, begin_);
+    scan_pos_ -= begin_;
+    frame_start_ -= begin_;
+    begin_ = 0;
+  }
+  buffer_.append(data, length);
+}
+
+/**
+ * @brief Extract the next complete frame, if any
+ *
+ * Negotiates the framing mode on the first non-whitespace byte.
+ *
+ * @param frame Receives the frame payload
+ * @return true if a frame was extracted, false if more data is needed
+ */
+bool FrameDecoder::next(std::string &frame) {
+  if (failed_) {
+    return false;
+  }
+
+  if (framing_ == Framing::Unknown) {
+    while (begin_ < buffer_.size() &&
+           std::isspace(static_cast<unsigned char>(buffer_[begin_]))) {
+      ++begin_;
+    }
+    if (begin_ == buffer_.size()) {
+      return false;
+    }
+    char first = buffer_[begin_];
+    framing_ = (first == '{' || first == '[') ? Framing::Json
+                                              : Framing::LengthPrefixed;
+    scan_pos_ = begin_;
+    frame_start_ = begin_;
+  }
+
+  return framing_ == Framing::Json ? nextJson(frame)
+                                   : nextLengthPrefixed(frame);
+}
+
+/**
+ * @brief Extract the next top-level JSON document
+ *
+ * Tracks nesting depth outside of string literals; a document is complete
+ * when the depth returns to zero. Whitespace (including the '\n' delimiter)
+ * between documents is skipped.
+ *
+ * @param frame Receives the document text
+ * @return true if a document was extracted
+ */
+bool FrameDecoder::nextJson(std::string &frame) {
+  while (scan_pos_ < buffer_.size()) {
+    char c = buffer_[scan_pos_++];
+
+    if (depth_ == 0) {
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        consume(scan_pos_);
+        frame_start_ = scan_pos_;
+        continue;
+      }
+      if (c != '{' && c != '[') {
+        failed_ = true; // Not a JSON document; cannot resynchronise
+        return false;
+      }
+      frame_start_ = scan_pos_ - 1;
+    }
+
+    if (in_string_) {
+      if (escape_) {
+        escape_ = false;
+      } else if (c == '\\') {
+        escape_ = true;
+      } else if (c == '"') {
+        in_string_ = false;
+      }
+    } else if (c == '"') {
+      in_string_ = true;
+    } else if (c == '{' || c == '[') {
+      ++depth_;
+    } else if (c == '}' || c == ']') {
+      if (--depth_ == 0) {
+        frame.assign(buffer_, frame_start_, scan_pos_ - frame_start_);
+        consume(scan_pos_);
+        frame_start_ = scan_pos_;
+        return true;
+      }
+    }
+
+    if (scan_pos_ - frame_start_ > max_frame_size_) {
+      failed_ = true;
+      return false;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Extract the next length-prefixed frame
+ *
+ * @param frame Receives the payload
+ * @return true if a complete frame was available
+ */
+bool FrameDecoder::nextLengthPrefixed(std::string &frame) {
+  constexpr size_t HEADER_SIZE = 4;
+  if (buffer_.size() - begin_ < HEADER_SIZE) {
+    return false;
+  }
+
+  const auto *header =
+      reinterpret_cast<const unsigned char *>(buffer_.data() + begin_);
+  size_t length = (static_cast<size_t>(header[0]) << 24) |
+                  (static_cast<size_t>(header[1]) << 16) |
+                  (static_cast<size_t>(header[2]) << 8) |
+                  static_cast<size_t>(header[3]);
+  if (length > max_frame_size_) {
+    failed_ = true;
+    return false;
+  }
+  if (buffer_.size() - begin_ < HEADER_SIZE + length) {
+    return false;
+  }
+
+  frame.assign(buffer_, begin_ + HEADER_SIZE, length);
+  consume(begin_ + HEADER_SIZE + length);
+  return true;
+}
+
+/**
+ * @brief Mark everything before end as consumed
+ *
+ * Releases the whole buffer (keeping its capacity) when nothing is left.
+ *
+ * @param end Offset one past the last consumed byte
+ */
+void FrameDecoder::consume(size_t end) {
+  begin_ = end;
+  if (begin_ == buffer_.size()) {
+    buffer_.clear();
+    begin_ = 0;
+    scan_pos_ = 0;
+    frame_start_ = 0;
+  }
+}
+
+/**
+ * @brief Build the bytes that precede a payload on the wire
+ *
+ * @param framing The connection's framing mode
+ * @param payload_size Size of the payload that follows
+ * @return The 4-byte big-endian length header for LengthPrefixed framing,
+ * or an empty string
+ */
+std::string framePrefix(Framing framing, size_t payload_size) {
+  if (framing != Framing::LengthPrefixed) {
+    return {};
+  }
+  uint32_t length = static_cast<uint32_t>(payload_size);
+  std::string header(4, '\0');
+  header[0] = static_cast<char>((length >> 24) & 0xff);
+  header[1] = static_cast<char>((length >> 16) & 0xff);
+  header[2] = static_cast<char>((length >> 8) & 0xff);
+  header[3] = static_cast<char>(length & 0xff);
+  return header;
+}
+
+/**
+ * @brief Get the bytes that follow a payload on the wire
+ *
+ * Connections that have not sent anything yet are treated as Json.
+ *
+ * @param framing The connection's framing mode
+ * @return A shared "\n" buffer for Json framing, nullptr for LengthPrefixed
+ */
+std::shared_ptr<const std::string> frameSuffix(Framing framing) {
+  static const auto newline = std::make_shared<const std::string>("\n");
+  return framing == Framing::LengthPrefixed ? nullptr : newline;
+}
+} // namespace qnx
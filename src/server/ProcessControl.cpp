@@ -10,6 +10,8 @@
  */
 
 #include "server/ProcessControl.hpp"
+#include "server/ProcessCore.hpp"
+#include <algorithm>
 #include <cerrno>  // for errno
 #include <chrono>  // For time points and durations
 #include <cstring> // for strerror
@@ -18,6 +20,7 @@
 #include <fstream>
 #include <iostream>
 #include <optional>
+#include <sched.h>
 #include <signal.h>
 #include <sstream>
 #include <string>
@@ -40,25 +43,97 @@ int close(int fd);
 
 namespace qnx {
 /**
- * @brief Send a signal to a process
+ * @brief Send a signal to a process without logging failures
  *
- * This function sends a signal to a specific process identified by its PID.
- * It uses QNX's SignalKill function when compiled for QNX, and falls back
- * to standard kill() function for other platforms.
+ * Uses QNX's SignalKill function when compiled for QNX, and falls back to
+ * the standard kill() function for other platforms. Batch operations call
+ * this directly and report the error per target instead of logging each one.
  *
  * @param pid The process ID to send the signal to
  * @param signal The signal number to send (e.g., SIGTERM, SIGSTOP)
- * @return true if the signal was sent successfully, false otherwise
+ * @return An empty error code on success, the errno value otherwise
  */
-bool sendSignal(pid_t pid, int signal) {
-  // Use signalkill for QNX
+std::error_code signalProcess(pid_t pid, int signal) {
 #ifdef __QNXNTO__
   if (SignalKill(0, pid, 0, signal, 0, 0) == -1)
 #else
   if (kill(pid, signal) == -1)
 #endif
   {
-    std::error_code ec(errno, std::system_category());
+    return std::error_code(errno, std::system_category());
+  }
+  return {};
+}
+
+/**
+ * @brief Set the scheduling policy and priority of a process without logging
+ *
+ * @param pid The process ID
+ * @param priority The new priority
+ * @param policy The new scheduling policy (e.g., SCHED_RR)
+ * @return An empty error code on success, the errno value otherwise
+ */
+std::error_code setScheduling(pid_t pid, int priority, int policy) {
+#ifdef __QNXNTO__
+  struct sched_param param;
+  param.sched_priority = priority;
+  if (sched_setscheduler(pid, policy, &param) == -1) {
+    return std::error_code(errno, std::system_category());
+  }
+  return {};
+#else
+  (void)pid;
+  (void)priority;
+  (void)policy;
+  return std::make_error_code(std::errc::not_supported);
+#endif
+}
+
+/**
+ * @brief Apply one control operation to a process without logging
+ *
+ * Suspension, resumption and priority changes are only supported on QNX,
+ * matching suspend(), resume() and ProcessCore::adjustPriority().
+ *
+ * @param pid The process ID
+ * @param request The operation to apply
+ * @return An empty error code on success, the reason for failure otherwise
+ */
+std::error_code applyControl(pid_t pid, const ControlRequest &request) {
+  switch (request.action) {
+#ifdef __QNXNTO__
+  case ControlAction::Suspend:
+    return signalProcess(pid, SIGSTOP);
+  case ControlAction::Resume:
+    return signalProcess(pid, SIGCONT);
+#else
+  case ControlAction::Suspend:
+  case ControlAction::Resume:
+    return std::make_error_code(std::errc::not_supported);
+#endif
+  case ControlAction::Terminate:
+    return signalProcess(pid, SIGTERM);
+  case ControlAction::Kill:
+    return signalProcess(pid, SIGKILL);
+  case ControlAction::SetPriority:
+    return setScheduling(pid, request.priority, request.policy);
+  }
+  return std::make_error_code(std::errc::invalid_argument);
+}
+
+/**
+ * @brief Send a signal to a process
+ *
+ * This function sends a signal to a specific process identified by its PID
+ * and logs the reason if it could not be sent.
+ *
+ * @param pid The process ID to send the signal to
+ * @param signal The signal number to send (e.g., SIGTERM, SIGSTOP)
+ * @return true if the signal was sent successfully, false otherwise
+ */
+bool sendSignal(pid_t pid, int signal) {
+  std::error_code ec = signalProcess(pid, signal);
+  if (ec) {
     std::cerr << "Failed to send signal " << signal << " to PID " << pid << ": "
               << ec.message() << std::endl;
     return false;
@@ -182,48 +257,14 @@ std::optional<pid_t> getParentPid(pid_t pid) {
 /**
  * @brief Get a list of child processes for a given parent
  *
- * Scans the /proc filesystem to find all processes whose parent
- * matches the specified PID. This method is QNX-specific and
- * relies on the procfs filesystem structure.
+ * Answered from the parent -> children index of the current process
+ * snapshot, so it costs O(children) rather than a /proc walk.
  *
  * @param pid The parent process ID
  * @return A vector containing the PIDs of all child processes
  */
 std::vector<pid_t> getChildProcesses(pid_t pid) {
-  std::vector<pid_t> children;
-
-#ifdef __QNXNTO__
-  try {
-    const std::filesystem::path proc_path("/proc");
-
-    // Iterate through all directories in /proc
-    for (const auto &entry : std::filesystem::directory_iterator(proc_path)) {
-      if (!entry.is_directory())
-        continue;
-
-      const std::string &name = entry.path().filename().string();
-      if (name.empty() || !std::isdigit(name[0]))
-        continue;
-
-      try {
-        // Each directory name in /proc is a PID
-        pid_t current_pid = std::stoi(name);
-        auto parent_pid = getParentPid(current_pid);
-
-        // Check if this process is a child of the target PID
-        if (parent_pid && *parent_pid == pid) {
-          children.push_back(current_pid);
-        }
-      } catch (const std::exception &e) {
-        continue;
-      }
-    }
-  } catch (const std::exception &e) {
-    std::cerr << "Error getting child processes: " << e.what() << std::endl;
-  }
-#endif
-
-  return children;
+  return ProcessCore::getInstance().getSnapshot()->childrenOf(pid);
 }
 
 /**
@@ -234,12 +275,13 @@ std::vector<pid_t> getChildProcesses(pid_t pid) {
  * by null characters, which this function replaces with spaces.
  *
  * @param pid The process ID
+ * @param proc_root The /proc mount to read
  * @return The command line string, or empty string if unavailable
  */
-std::string getCommandLine(pid_t pid) {
+std::string getCommandLine(pid_t pid, const std::string &proc_root) {
   // Build cmdline path via filesystem::path
   std::filesystem::path cmd_path =
-      std::filesystem::path("/proc") / std::to_string(pid) / "cmdline";
+      std::filesystem::path(proc_root) / std::to_string(pid) / "cmdline";
   std::ifstream cmdline(cmd_path);
   if (!cmdline) {
     return "";
@@ -310,12 +352,14 @@ std::optional<std::string> getWorkingDirectory(pid_t pid) {
  * from the /proc filesystem.
  *
  * @param pid The process ID
+ * @param proc_root The /proc mount to read
  * @return The executable path if available, nullopt otherwise
  */
-std::optional<std::string> getProcessExecutablePath(pid_t pid) {
+std::optional<std::string>
+getProcessExecutablePath(pid_t pid, const std::string &proc_root) {
   // Build path via filesystem::path
   std::filesystem::path path =
-      std::filesystem::path("/proc") / std::to_string(pid) / "path";
+      std::filesystem::path(proc_root) / std::to_string(pid) / "path";
   std::ifstream path_file(path);
   if (!path_file) {
     return {};
@@ -15,6 +15,10 @@
 #include "server/ProcessControl.hpp"
 #include <chrono> // Added for time points and durations
 #include "server/ProcessCore.hpp"
+#include "server/JsonWriter.hpp"
+#include "server/ServerMetrics.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
@@ -37,10 +41,7 @@
 #include <unistd.h> // for open(), close()
 
 #ifdef __QNXNTO__
-#include <devctl.h>        // devctl(), DCMD_PROC_*
-#include <sys/dcmd_proc.h> // Added for DCMD_PROC_* definitions
 #include <sys/neutrino.h>  // QNX-specific
-#include <sys/procfs.h>    // procfs_status, debug_process_t, debug_thread_t
 #include <sys/syspage.h>
 // Explicitly declare POSIX functions sometimes hidden in C++ on QNX
 extern "C" {
@@ -50,11 +51,89 @@ int close(int fd);
 #endif
 
 namespace qnx {
+namespace {
 /**
- * @brief Constructor: Initializes the last update time.
+ * @brief Number of CPUs of the system, at least 1
+ */
+unsigned cpuCount() {
+#ifdef __QNXNTO__
+  unsigned cpus = _syspage_ptr->num_cpu;
+#else
+  unsigned cpus = std::thread::hardware_concurrency();
+#endif
+  return cpus > 0 ? cpus : 1;
+}
+
+/**
+ * @brief Default number of collector shards: one per CPU
+ */
+unsigned defaultCollectorThreads() {
+  return std::min(cpuCount(), ProcessCore::MAX_COLLECTOR_THREADS);
+}
+
+/**
+ * @brief Key into CollectorShard::last_sutimes
+ */
+uint64_t sutimeKey(pid_t pid, int tid) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(pid)) << 32) |
+         static_cast<uint32_t>(tid);
+}
+
+/**
+ * @brief Turn an sutime reading into a CPU percentage
+ *
+ * Looks up the previous reading for key, records the new one for this cycle
+ * and returns the usage over the time since the previous reading. Each key
+ * keeps its own timestamp because fast-tier processes are also read between
+ * full cycles. The first reading for a key yields 0 since there is nothing
+ * to diff against.
+ */
+double updateCpuUsage(CollectorShard &shard, uint64_t key,
+                      uint64_t current_sutime,
+                      std::chrono::steady_clock::time_point sample_time) {
+  double cpu_usage = 0.0;
+  auto it = shard.last_sutimes.find(key);
+  if (it != shard.last_sutimes.end()) // Check if we have previous data
+  {
+    double elapsed_nanos =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            sample_time - it->second.time)
+            .count();
+    uint64_t last_sutime = it->second.sutime;
+    uint64_t sutime_delta =
+        (current_sutime >= last_sutime)
+            ? (current_sutime - last_sutime)
+            : current_sutime; // Handle potential wraparound or reset? For now
+                              // assume monotonic increase.
+
+    if (elapsed_nanos > 0) {
+      // CPU% = (change in process time / change in wall time) * 100
+      cpu_usage = (static_cast<double>(sutime_delta) / elapsed_nanos) * 100.0;
+    }
+    it->second = {current_sutime, shard.cycle, sample_time};
+  } else {
+    shard.last_sutimes.emplace(key, CollectorShard::SutimeSample{
+                                        current_sutime, shard.cycle,
+                                        sample_time});
+  }
+  return cpu_usage;
+}
+} // namespace
+
+/**
+ * @brief Constructor: Initializes the collector shards.
  */
 ProcessCore::ProcessCore()
-    : last_update_time_(std::chrono::steady_clock::now()) {}
+    : source_(createProcessSource(defaultProcessSourceName(), "/proc")),
+      shards_(defaultCollectorThreads()) {}
+
+/**
+ * @brief Destructor: Stops collector workers and closes cached /proc handles.
+ */
+ProcessCore::~ProcessCore() {
+  stopWorkers();
+  shards_.clear(); // Readers close their handles before the source goes
+}
 
 /**
  * @brief Get the singleton instance of the ProcessCore class
@@ -73,116 +152,625 @@ ProcessCore &ProcessCore::getInstance() {
 /**
  * @brief Collect information about all running processes in the system
  *
- * This method traverses the /proc filesystem to gather information about
- * all currently running processes. For each valid process directory found,
- * it attempts to read detailed process information and adds it to the
- * internal process list.
+ * This method lists every running process through the process source and
+ * partitions the listing across the collector shards by PID; each shard
+ * reads its PIDs in one batch, and with more than one shard each shard is
+ * read by its own worker thread into a local buffer. The shard buffers are
+ * then merged into the next generation, which is published atomically as an
+ * immutable snapshot so readers never observe a partially built list and
+ * never wait for the process table to be read.
  *
- * Thread-safe through mutex locking of the process list.
+ * Concurrent collectors are serialised through the collector mutex.
  *
- * @return The number of processes collected, or -1 if an error occurred
+ * @return The number of processes collected, or std::nullopt on error
  */
 std::optional<int> ProcessCore::collectInfo() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  process_list_.clear();
-  std::unordered_set<pid_t> current_pids;
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  lockTimed(lock, Latency::CoreLockWait);
+  ScopedLatency timer(Latency::Collect);
+
+  std::shared_ptr<ProcessSnapshot> next = takeBuildBuffer();
+  std::pmr::vector<ProcessInfo> &processes = next->processes;
 
-  // --- CPU Calculation Setup ---
+  // Every reading of this cycle is stamped with the same time
   auto now = std::chrono::steady_clock::now();
-  auto elapsed_time = now - last_update_time_;
-  // Avoid division by zero or tiny intervals
-  if (elapsed_time < std::chrono::milliseconds{1}) {
-    elapsed_time = std::chrono::milliseconds{1};
-  }
-  // --- End CPU Calculation Setup ---
 
   try {
-    const std::filesystem::path proc_path("/proc");
-    if (!std::filesystem::exists(proc_path)) {
-      throw std::runtime_error("Proc filesystem not found");
+    for (auto &shard : shards_) {
+      shard.pids.clear();
+      getReader(shard); // Opened here so workers never call into the source
     }
+    cycle_sampling_ = getThreadSampling();
 
-    for (const auto &entry : std::filesystem::directory_iterator(proc_path)) {
-      if (!entry.is_directory())
-        continue;
+    source_->listPids(listed_pids_);
+    for (pid_t pid : listed_pids_) {
+      shards_[static_cast<size_t>(pid) % shards_.size()].pids.push_back(pid);
+    }
 
-      const std::string &name = entry.path().filename().string();
-      if (name.empty() || !std::isdigit(name[0]))
-        continue;
+    if (shards_.size() == 1 && cpu_mask_ == 0) {
+      // Serial mode: no need to hand off to a worker
+      collectShard(shards_.front(), now);
+    } else {
+      if (workers_.empty()) {
+        startWorkers();
+      }
+      std::unique_lock<std::mutex> pool_lock(pool_mutex_);
+      pool_sample_time_ = now;
+      pool_pending_ = shards_.size();
+      ++pool_cycle_;
+      pool_cv_.notify_all();
+      pool_done_cv_.wait(pool_lock, [this] { return pool_pending_ == 0; });
+    }
 
+    // --- Merge shard buffers into the next generation ---
+    size_t count = 0;
+    for (const auto &shard : shards_) {
+      count += shard.count;
+    }
+    if (processes.size() < count) {
+      processes.resize(count);
+    }
+    size_t pos = 0;
+    for (const auto &shard : shards_) {
+      // Rows own no memory, so this is a plain copy into recycled slots
+      std::copy(shard.buffer.begin(), shard.buffer.begin() + shard.count,
+                processes.begin() + pos);
+      pos += shard.count;
+    }
+    processes.resize(count);
+
+    next->threads.clear();
+    for (const auto &shard : shards_) {
+      next->threads.insert(next->threads.end(), shard.threads.begin(),
+                           shard.threads.end());
+    }
+    // --- End Merge ---
+
+    next->timestamp = now;
+    publishSnapshot(std::move(next));
+
+    return std::make_optional(static_cast<int>(count));
+  } catch (const std::exception &e) {
+    std::cerr << "Error collecting process information: " << e.what()
+              << std::endl;
+    return std::nullopt;
+  }
+}
+
+/**
+ * @brief Re-read a few processes between full collections
+ *
+ * Used for fast sampling tiers. The listed processes are read again on the
+ * calling thread and every other row is carried over unchanged from the
+ * current snapshot, then the result is published as a new generation. A
+ * listed process that has exited is dropped from the snapshot; processes
+ * started since the last full collection only appear after the next one.
+ * Tracking state is not pruned here, since most PIDs were not visited.
+ *
+ * @param pids The processes to re-read
+ * @return The number of processes re-read, or std::nullopt if no full
+ * collection has run yet
+ */
+std::optional<int>
+ProcessCore::refreshProcesses(const std::unordered_set<pid_t> &pids) {
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  lockTimed(lock, Latency::CoreLockWait);
+  ScopedLatency timer(Latency::Refresh);
+  if (!current_) {
+    return std::nullopt;
+  }
+
+  std::shared_ptr<ProcessSnapshot> next = takeBuildBuffer();
+  next->processes = current_->processes;
+  next->threads.clear();
+  for (const ThreadInfo &thread : current_->threads) {
+    if (pids.count(thread.pid) == 0) {
+      next->threads.push_back(thread);
+    }
+  }
+  cycle_sampling_ = getThreadSampling();
+
+  auto now = std::chrono::steady_clock::now();
+  std::pmr::vector<ProcessInfo> &processes = next->processes;
+  size_t kept = 0;
+  int refreshed = 0;
+  for (size_t i = 0; i < processes.size(); ++i) {
+    pid_t pid = processes[i].pid;
+    bool alive = true;
+    if (pids.count(pid) > 0) {
+      CollectorShard &shard =
+          shards_[static_cast<size_t>(pid) % shards_.size()];
+      shard.threads.clear();
       try {
-        pid_t pid = std::stoi(name);
-        ProcessInfo info;
-        current_pids.insert(pid);
-
-        // Pass elapsed time for CPU calculation
-        if (readProcessInfo(pid, info, elapsed_time)) {
-          process_list_.push_back(std::move(info));
-        }
+        alive = readProcessInfo(shard, pid, processes[i], now);
       } catch (const std::exception &e) {
-        std::cerr << "Error processing PID " << name << ": " << e.what()
+        std::cerr << "Error processing PID " << pid << ": " << e.what()
                   << std::endl;
-        continue;
+        alive = false;
       }
+      next->threads.insert(next->threads.end(), shard.threads.begin(),
+                           shard.threads.end());
+      refreshed += alive ? 1 : 0;
     }
-    // --- Prune old PIDs from CPU tracking maps ---
-    for (auto it = last_sutimes_.begin(); it != last_sutimes_.end();
-         /* no increment */) {
-      if (current_pids.find(it->first) == current_pids.end()) {
-        it = last_sutimes_.erase(it); // Erase and get next iterator
-      } else {
-        ++it;
+    if (alive) {
+      if (kept != i) {
+        std::swap(processes[kept], processes[i]);
       }
+      ++kept;
     }
-    // --- End Pruning ---
+  }
+  processes.resize(kept);
 
-    // Update last global update time for next cycle's CPU calculation
-    last_update_time_ = now;
+  next->timestamp = now;
+  publishSnapshot(std::move(next));
+  return refreshed;
+}
 
-    return std::make_optional(static_cast<int>(process_list_.size()));
+/**
+ * @brief Bring the snapshot's process set up to date without a full pass
+ *
+ * Run when process lifecycle events report that processes were created or
+ * exited. Only the process table is listed: rows of processes that are
+ * gone are dropped and their cached handles closed, and only processes not
+ * yet in the snapshot are read. Every other row is carried over unchanged.
+ * Nothing is published if the set did not change.
+ *
+ * @return The number of processes added or removed, or std::nullopt if no
+ * full collection has run yet or the processes could not be listed
+ */
+std::optional<int> ProcessCore::updateMembership() {
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  lockTimed(lock, Latency::CoreLockWait);
+  ScopedLatency timer(Latency::Membership);
+  if (!current_) {
+    return std::nullopt;
+  }
+  try {
+    source_->listPids(listed_pids_);
   } catch (const std::exception &e) {
-    std::cerr << "Error collecting process information: " << e.what()
-              << std::endl;
+    std::cerr << "Error listing processes: " << e.what() << std::endl;
     return std::nullopt;
   }
+  std::sort(listed_pids_.begin(), listed_pids_.end());
+  auto listed = [this](pid_t pid) {
+    return std::binary_search(listed_pids_.begin(), listed_pids_.end(), pid);
+  };
+
+  std::shared_ptr<ProcessSnapshot> next = takeBuildBuffer();
+  next->processes = current_->processes;
+  std::pmr::vector<ProcessInfo> &processes = next->processes;
+  int changed = 0;
+  size_t kept = 0;
+  for (size_t i = 0; i < processes.size(); ++i) {
+    pid_t pid = processes[i].pid;
+    if (!listed(pid)) {
+      CollectorShard &shard =
+          shards_[static_cast<size_t>(pid) % shards_.size()];
+      getReader(shard).forget(pid);
+      shard.metadata.erase(pid);
+      ++changed;
+      continue;
+    }
+    if (kept != i) {
+      std::swap(processes[kept], processes[i]);
+    }
+    ++kept;
+  }
+  processes.resize(kept);
+
+  next->threads.clear();
+  for (const ThreadInfo &thread : current_->threads) {
+    if (listed(thread.pid)) {
+      next->threads.push_back(thread);
+    }
+  }
+
+  cycle_sampling_ = getThreadSampling();
+  auto now = std::chrono::steady_clock::now();
+  for (pid_t pid : listed_pids_) {
+    if (current_->index.count(pid) > 0) {
+      continue;
+    }
+    CollectorShard &shard = shards_[static_cast<size_t>(pid) % shards_.size()];
+    shard.threads.clear();
+    processes.emplace_back();
+    try {
+      if (readProcessInfo(shard, pid, processes.back(), now)) {
+        next->threads.insert(next->threads.end(), shard.threads.begin(),
+                             shard.threads.end());
+        ++changed;
+        continue;
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Error processing PID " << pid << ": " << e.what()
+                << std::endl;
+    }
+    processes.pop_back(); // Already gone again, or unreadable
+  }
+
+  if (changed == 0) {
+    spare_ = std::move(next);
+    return 0;
+  }
+  next->timestamp = now;
+  publishSnapshot(std::move(next));
+  return changed;
 }
 
 /**
- * @brief Get the count of currently tracked processes
+ * @brief Work out which processes appeared or disappeared between snapshots
  *
- * Returns the number of ProcessInfo objects currently stored in the internal
- * process list. This method is thread-safe and locks the process list while
- * counting.
+ * A PID whose start time changed was reused, and counts as both.
  *
- * @return The number of processes in the internal process list
+ * @param before The older snapshot
+ * @param after The newer snapshot
+ * @return The changes, each list in snapshot row order
  */
-size_t ProcessCore::getCount() const noexcept {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return process_list_.size();
+ProcessLifecycle diffSnapshots(const ProcessSnapshot &before,
+                               const ProcessSnapshot &after) {
+  ProcessLifecycle lifecycle;
+  for (const ProcessInfo &info : after.processes) {
+    const ProcessInfo *old = before.find(info.pid);
+    if (!old || old->start_time != info.start_time) {
+      lifecycle.created.push_back(info.pid);
+    }
+  }
+  for (const ProcessInfo &info : before.processes) {
+    const ProcessInfo *now = after.find(info.pid);
+    if (!now || now->start_time != info.start_time) {
+      lifecycle.exited.push_back(info.pid);
+    }
+  }
+  return lifecycle;
+}
+
+/**
+ * @brief Get a snapshot to build the next generation in
+ *
+ * Recycles the buffer evicted from the history ring if no reader still pins
+ * it; the ProcessInfo slots (and their string capacity) are reused in place.
+ * Must be called with the collector mutex held.
+ *
+ * @return An unpublished snapshot
+ */
+std::shared_ptr<ProcessSnapshot> ProcessCore::takeBuildBuffer() {
+  if (spare_ && spare_.use_count() == 1) {
+    return std::move(spare_);
+  }
+  spare_.reset();
+  return std::make_shared<ProcessSnapshot>();
+}
+
+/**
+ * @brief Read every PID assigned to a shard and prune its tracking state
+ *
+ * Reads the shard's PIDs in one batch, fills the shard's local buffer and
+ * forgets CPU, metadata and handle state for PIDs that are no longer
+ * listed. Only touches the given shard, so
+ * different shards may be collected concurrently.
+ *
+ * @param shard The shard to collect
+ * @param sample_time The time the readings of this cycle are stamped with
+ */
+void ProcessCore::collectShard(
+    CollectorShard &shard, std::chrono::steady_clock::time_point sample_time) {
+  std::sort(shard.pids.begin(), shard.pids.end());
+  shard.count = 0;
+  shard.threads.clear();
+  ++shard.cycle;
+
+  ProcessSource::Reader &reader = getReader(shard);
+  if (shard.samples.size() < shard.pids.size()) {
+    shard.samples.resize(shard.pids.size());
+  }
+  try {
+    size_t read = reader.readBatch(shard.pids.data(), shard.pids.size(),
+                                   shard.samples.data());
+    if (shard.buffer.size() < read) {
+      shard.buffer.resize(read);
+    }
+    for (size_t i = 0; i < read; ++i) {
+      fillProcessInfo(shard, shard.samples[i], shard.buffer[i], sample_time);
+      ++shard.count;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error reading processes: " << e.what() << std::endl;
+  }
+
+  // --- Prune old PIDs from CPU tracking, metadata and handle caches ---
+  auto gone = [&shard](pid_t pid) {
+    return !std::binary_search(shard.pids.begin(), shard.pids.end(), pid);
+  };
+  for (auto it = shard.last_sutimes.begin(); it != shard.last_sutimes.end();
+       /* no increment */) {
+    // Covers exited processes as well as exited or no longer sampled threads
+    if (it->second.cycle != shard.cycle) {
+      it = shard.last_sutimes.erase(it); // Erase and get next iterator
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = shard.metadata.begin(); it != shard.metadata.end();) {
+    if (gone(it->first)) {
+      it = shard.metadata.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  reader.retain(shard.pids);
+  // --- End Pruning ---
+}
+
+/**
+ * @brief Publish a freshly built snapshot to readers
+ *
+ * Rebuilds the PID index, stamps the snapshot with the next generation
+ * number and swaps it in with a single atomic store. The snapshot is also
+ * appended to the history ring, which drops generations older than
+ * SNAPSHOT_RETENTION; the last one it evicts becomes the spare build buffer
+ * for a following cycle. Must be called with the collector mutex held.
+ *
+ * @param next The fully populated snapshot to publish
+ */
+void ProcessCore::publishSnapshot(std::shared_ptr<ProcessSnapshot> next) {
+  // Group totals are summed in the same pass that builds the PID index
+  next->group_membership = getGroupMembership();
+  const GroupMembership &membership = *next->group_membership;
+
+  // clear() keeps the bucket array of a recycled buffer
+  next->index.clear();
+  next->index.reserve(next->processes.size());
+  next->group_totals.clear();
+  for (size_t i = 0; i < next->processes.size(); ++i) {
+    ProcessInfo &info = next->processes[i];
+    next->index.emplace(info.pid, i);
+
+    auto member = membership.find(info.pid);
+    info.group_id = member != membership.end() ? member->second : -1;
+    if (info.group_id != -1) {
+      ResourceTotals &totals = next->group_totals[info.group_id];
+      totals.cpu_usage += info.cpu_usage;
+      totals.memory_usage += info.memory_usage;
+      ++totals.num_processes;
+    }
+  }
+
+  buildProcessTree(*next);
+
+  next->generation = next_generation_++;
+  std::atomic_store(&snapshot_, ProcessSnapshotPtr(next));
+  {
+    std::lock_guard<std::mutex> history_lock(history_mutex_);
+    history_.push_back(next);
+    auto horizon = next->timestamp - SNAPSHOT_RETENTION;
+    while (history_.size() > MAX_SNAPSHOT_HISTORY ||
+           (history_.size() > SNAPSHOT_HISTORY &&
+            history_.front()->timestamp < horizon)) {
+      spare_ = std::move(history_.front());
+      history_.pop_front();
+    }
+  }
+  current_ = std::move(next);
+}
+
+/**
+ * @brief Build a snapshot's parent -> children index and subtree totals
+ *
+ * Each row's parent is resolved through the PID index. Children are laid
+ * out in compressed sparse row form by a counting sort, and subtree totals
+ * are accumulated bottom-up by walking the breadth-first order in reverse.
+ * All of it is O(processes). A process whose parent is not listed is a
+ * root; rows on a parent cycle (which a consistent listing cannot contain)
+ * are left out of tree_order and only count themselves.
+ *
+ * @param snapshot The snapshot being built; its index must be complete
+ */
+void ProcessCore::buildProcessTree(ProcessSnapshot &snapshot) {
+  constexpr uint32_t NO_ROW = ProcessSnapshot::NO_ROW;
+  const std::pmr::vector<ProcessInfo> &processes = snapshot.processes;
+  const size_t count = processes.size();
+
+  snapshot.parent_rows.resize(count);
+  snapshot.child_offsets.assign(count + 1, 0);
+  for (size_t i = 0; i < count; ++i) {
+    auto it = snapshot.index.find(processes[i].parent_pid);
+    uint32_t parent =
+        it != snapshot.index.end() && it->second != i
+            ? static_cast<uint32_t>(it->second)
+            : NO_ROW;
+    snapshot.parent_rows[i] = parent;
+    if (parent != NO_ROW) {
+      ++snapshot.child_offsets[parent + 1];
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    snapshot.child_offsets[i + 1] += snapshot.child_offsets[i];
+  }
+
+  // Fill using child_offsets[p] as the cursor, then shift it back into place
+  snapshot.child_rows.resize(snapshot.child_offsets[count]);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t parent = snapshot.parent_rows[i];
+    if (parent != NO_ROW) {
+      snapshot.child_rows[snapshot.child_offsets[parent]++] =
+          static_cast<uint32_t>(i);
+    }
+  }
+  for (size_t i = count; i > 0; --i) {
+    snapshot.child_offsets[i] = snapshot.child_offsets[i - 1];
+  }
+  snapshot.child_offsets[0] = 0;
+
+  snapshot.tree_order.clear();
+  for (size_t i = 0; i < count; ++i) {
+    if (snapshot.parent_rows[i] == NO_ROW) {
+      snapshot.tree_order.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  for (size_t next = 0; next < snapshot.tree_order.size(); ++next) {
+    uint32_t row = snapshot.tree_order[next];
+    snapshot.tree_order.insert(
+        snapshot.tree_order.end(),
+        snapshot.child_rows.begin() + snapshot.child_offsets[row],
+        snapshot.child_rows.begin() + snapshot.child_offsets[row + 1]);
+  }
+
+  snapshot.subtree_totals.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    snapshot.subtree_totals[i] =
+        ResourceTotals{processes[i].cpu_usage, processes[i].memory_usage, 1};
+  }
+  for (size_t k = snapshot.tree_order.size(); k > 0; --k) {
+    uint32_t row = snapshot.tree_order[k - 1];
+    uint32_t parent = snapshot.parent_rows[row];
+    if (parent != NO_ROW) {
+      ResourceTotals &totals = snapshot.subtree_totals[parent];
+      totals.cpu_usage += snapshot.subtree_totals[row].cpu_usage;
+      totals.memory_usage += snapshot.subtree_totals[row].memory_usage;
+      totals.num_processes += snapshot.subtree_totals[row].num_processes;
+    }
+  }
+}
+
+/**
+ * @brief Constructor: points every container at the snapshot's pool
+ */
+ProcessSnapshot::ProcessSnapshot()
+    : processes(&arena), index(&arena), threads(&arena),
+      group_totals(&arena), parent_rows(&arena), child_offsets(&arena),
+      child_rows(&arena), tree_order(&arena), subtree_totals(&arena) {}
+
+/**
+ * @brief Direct children of a process
+ *
+ * @param pid The parent process ID
+ * @return Their PIDs; empty if the PID is not present or has none
+ */
+std::vector<pid_t> ProcessSnapshot::childrenOf(pid_t pid) const {
+  std::vector<pid_t> children;
+  auto it = index.find(pid);
+  if (it == index.end()) {
+    return children;
+  }
+  size_t row = it->second;
+  for (uint32_t i = child_offsets[row]; i < child_offsets[row + 1]; ++i) {
+    children.push_back(processes[child_rows[i]].pid);
+  }
+  return children;
+}
+
+/**
+ * @brief Rows of a process and all of its descendants
+ *
+ * Breadth-first over the child index, so every parent precedes its
+ * children. Bounded by the row count in case of a parent cycle.
+ *
+ * @param pid The subtree's root
+ * @return Row indices; empty if the PID is not present
+ */
+std::vector<size_t> ProcessSnapshot::subtreeRows(pid_t pid) const {
+  std::vector<size_t> rows;
+  auto it = index.find(pid);
+  if (it == index.end()) {
+    return rows;
+  }
+  rows.push_back(it->second);
+  for (size_t next = 0; next < rows.size() && rows.size() <= processes.size();
+       ++next) {
+    size_t row = rows[next];
+    for (uint32_t i = child_offsets[row]; i < child_offsets[row + 1]; ++i) {
+      rows.push_back(child_rows[i]);
+    }
+  }
+  return rows;
+}
+
+/**
+ * @brief Chain of ancestors of a process
+ *
+ * @param pid The process ID
+ * @return PIDs from the parent up to the root; empty if the PID is not
+ * present or is a root
+ */
+std::vector<pid_t> ProcessSnapshot::ancestorsOf(pid_t pid) const {
+  std::vector<pid_t> ancestors;
+  auto it = index.find(pid);
+  if (it == index.end()) {
+    return ancestors;
+  }
+  uint32_t row = parent_rows[it->second];
+  while (row != NO_ROW && ancestors.size() < processes.size()) {
+    ancestors.push_back(processes[row].pid);
+    row = parent_rows[row];
+  }
+  return ancestors;
+}
+
+/**
+ * @brief Get the most recently published process snapshot
+ *
+ * The returned snapshot is immutable and remains valid for as long as the
+ * caller holds the pointer, regardless of later collection cycles. No lock
+ * is taken.
+ *
+ * @return Shared pointer to the current snapshot; never null
+ */
+ProcessSnapshotPtr ProcessCore::getSnapshot() const noexcept {
+  ProcessSnapshotPtr snapshot = std::atomic_load(&snapshot_);
+  if (!snapshot) {
+    static const ProcessSnapshotPtr empty =
+        std::make_shared<const ProcessSnapshot>();
+    return empty;
+  }
+  return snapshot;
+}
+
+/**
+ * @brief Get a recently published snapshot by generation
+ *
+ * Generations published within the last SNAPSHOT_RETENTION are retained,
+ * within the SNAPSHOT_HISTORY and MAX_SNAPSHOT_HISTORY bounds.
+ *
+ * @param generation The generation to look up
+ * @return The snapshot, or nullptr if it has been evicted or never existed
+ */
+ProcessSnapshotPtr ProcessCore::getSnapshot(uint64_t generation) const {
+  std::lock_guard<std::mutex> history_lock(history_mutex_);
+  if (history_.empty() || generation < history_.front()->generation ||
+      generation > history_.back()->generation) {
+    return nullptr;
+  }
+  // Generations in the ring are consecutive
+  return history_[generation - history_.front()->generation];
 }
 
 /**
- * @brief Get the list of all currently tracked processes
+ * @brief Get the generation number of the current snapshot
  *
- * Returns a reference to the internal list of ProcessInfo objects. The list
- * contains information about all processes that were found during the last
- * call to collectInfo().
+ * @return The generation of the published snapshot, or 0 if none exists yet
+ */
+uint64_t ProcessCore::getGeneration() const noexcept {
+  return getSnapshot()->generation;
+}
+
+/**
+ * @brief Get the count of currently tracked processes
  *
- * @note This method does not refresh the process list. Call collectInfo() first
- * to get the latest information.
+ * Returns the number of processes in the current snapshot.
  *
- * @return Const reference to the internal vector of ProcessInfo objects
+ * @return The number of processes in the published snapshot
  */
-const std::vector<ProcessInfo> &ProcessCore::getProcessList() const noexcept {
-  return process_list_;
+size_t ProcessCore::getCount() const noexcept {
+  return getSnapshot()->processes.size();
 }
 
 /**
  * @brief Find a specific process by its PID
  *
- * Searches the internal process list for a process with the specified PID and
- * returns its information if found. The method is thread-safe through mutex
- * locking.
+ * Looks the PID up in the current snapshot's index and returns a copy of its
+ * information if found. No lock is taken. Callers on hot paths should pin a
+ * snapshot with getSnapshot() and use ProcessSnapshot::find() instead to
+ * avoid the copy.
  *
  * @param pid The process ID to search for
  * @return An optional containing the ProcessInfo if found, or empty if not
@@ -190,13 +778,9 @@ const std::vector<ProcessInfo> &ProcessCore::getProcessList() const noexcept {
  */
 std::optional<ProcessInfo>
 ProcessCore::getProcessById(pid_t pid) const noexcept {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto it =
-      std::find_if(process_list_.begin(), process_list_.end(),
-                   [pid](const ProcessInfo &info) { return info.pid == pid; });
-
-  if (it != process_list_.end()) {
-    return std::make_optional(*it);
+  ProcessSnapshotPtr snapshot = getSnapshot();
+  if (const ProcessInfo *info = snapshot->find(pid)) {
+    return std::make_optional(*info);
   }
   return {};
 }
@@ -213,22 +797,279 @@ ProcessCore::getProcessById(pid_t pid) const noexcept {
  * @return true if the priority was successfully adjusted, false otherwise
  */
 bool ProcessCore::adjustPriority(pid_t pid, int priority, int policy) {
-#ifdef __QNXNTO__
-  struct sched_param param;
-  param.sched_priority = priority;
-
-  if (sched_setscheduler(pid, policy, &param) == -1) {
-    std::error_code ec(errno, std::system_category());
+  std::error_code ec = setScheduling(pid, priority, policy);
+  if (ec) {
     std::cerr << "Failed to adjust priority for PID " << pid << ": "
               << ec.message() << std::endl;
     return false;
   }
   return true;
-#else
-  std::cerr << "Priority adjustment not supported on non-QNX systems"
-            << std::endl;
-  return false;
+}
+
+/**
+ * @brief Set the number of collector shards / worker threads
+ *
+ * Takes effect from the next collection. Changing the shard count
+ * redistributes PIDs, so cached per-PID state is dropped and CPU usage reads
+ * 0 for one cycle.
+ *
+ * @param threads Number of workers, or 0 for one per CPU
+ * @return false if threads exceeds MAX_COLLECTOR_THREADS; nothing changes
+ */
+bool ProcessCore::setCollectorThreads(unsigned threads) {
+  if (threads > MAX_COLLECTOR_THREADS) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (threads == 0) {
+    threads = defaultCollectorThreads();
+  }
+  if (threads == shards_.size()) {
+    return true;
+  }
+  stopWorkers();
+  shards_.clear();
+  shards_.resize(threads);
+  return true;
+}
+
+/**
+ * @brief Get the number of collector shards / worker threads
+ *
+ * @return The configured shard count
+ */
+unsigned ProcessCore::getCollectorThreads() const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<unsigned>(shards_.size());
+}
+
+/**
+ * @brief Restrict collector workers to a set of CPUs
+ *
+ * Each worker is pinned to one CPU of the mask, round-robin, so collection
+ * stays off cores reserved for real-time partitions. Only QNX honours the
+ * mask; elsewhere it is ignored.
+ *
+ * @param cpu_mask Bit n set allows CPU n; 0 removes the restriction
+ * @return false if the mask names a CPU the system does not have, which
+ * would leave workers unpinned; nothing changes
+ */
+bool ProcessCore::setCollectorAffinity(uint64_t cpu_mask) {
+  unsigned cpus = cpuCount();
+  if (cpus < 64 && (cpu_mask >> cpus) != 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cpu_mask == cpu_mask_) {
+    return true;
+  }
+  stopWorkers(); // restarted with the new mask on the next collection
+  cpu_mask_ = cpu_mask;
+  return true;
+}
+
+/**
+ * @brief Collect from a different process source
+ *
+ * Used to run the collector on Linux hosts or against a synthetic
+ * workload. Cached per-PID state belongs to the old source, so it is
+ * dropped and CPU usage reads 0 for one cycle.
+ *
+ * @param source The new source; nullptr is ignored
+ */
+void ProcessCore::setProcessSource(std::unique_ptr<ProcessSource> source) {
+  if (!source) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopWorkers();
+  size_t shards = shards_.size();
+  shards_.clear(); // The old source's readers go first
+  shards_.resize(shards);
+  source_ = std::move(source);
+}
+
+/**
+ * @brief Get the name of the process source the collector reads
+ *
+ * @return The name, e.g. "devctl"
+ */
+std::string ProcessCore::getProcessSourceName() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return source_->name();
+}
+
+/**
+ * @brief Replace the per-thread accounting configuration
+ *
+ * Takes effect from the next collection. Does not block behind a collection
+ * in progress.
+ *
+ * @param config The new configuration
+ */
+void ProcessCore::setThreadSampling(ThreadSamplingConfig config) {
+  std::atomic_store(&thread_sampling_,
+                    std::shared_ptr<const ThreadSamplingConfig>(
+                        std::make_shared<ThreadSamplingConfig>(
+                            std::move(config))));
+}
+
+/**
+ * @brief Get the current per-thread accounting configuration
+ *
+ * @return Shared pointer to the configuration; never null
+ */
+std::shared_ptr<const ThreadSamplingConfig>
+ProcessCore::getThreadSampling() const {
+  auto config = std::atomic_load(&thread_sampling_);
+  if (!config) {
+    static const std::shared_ptr<const ThreadSamplingConfig> disabled =
+        std::make_shared<const ThreadSamplingConfig>();
+    return disabled;
+  }
+  return config;
+}
+
+/**
+ * @brief Replace the group membership table used to tag snapshot rows
+ *
+ * Takes effect from the next published snapshot, which also carries the
+ * table it was built against.
+ *
+ * @param membership The new PID -> group ID table
+ */
+void ProcessCore::setGroupMembership(
+    std::shared_ptr<const GroupMembership> membership) {
+  std::atomic_store(&group_membership_, std::move(membership));
+}
+
+/**
+ * @brief Get the current group membership table
+ *
+ * @return Shared pointer to the table; never null
+ */
+std::shared_ptr<const GroupMembership>
+ProcessCore::getGroupMembership() const {
+  auto membership = std::atomic_load(&group_membership_);
+  if (!membership) {
+    static const std::shared_ptr<const GroupMembership> empty =
+        std::make_shared<const GroupMembership>();
+    return empty;
+  }
+  return membership;
+}
+
+/**
+ * @brief Get the busiest threads from the current snapshot
+ *
+ * Only threads of processes that were sampled per thread are considered.
+ *
+ * @param count Maximum number of threads to return
+ * @return Up to count threads, ordered by descending CPU usage
+ */
+std::vector<ThreadInfo> ProcessCore::getHotThreads(size_t count) const {
+  ProcessSnapshotPtr snapshot = getSnapshot();
+  std::vector<ThreadInfo> threads(snapshot->threads.begin(),
+                                  snapshot->threads.end());
+  count = std::min(count, threads.size());
+  std::partial_sort(threads.begin(), threads.begin() + count, threads.end(),
+                    [](const ThreadInfo &a, const ThreadInfo &b) {
+                      return a.cpu_usage > b.cpu_usage;
+                    });
+  threads.resize(count);
+  return threads;
+}
+
+/**
+ * @brief Launch one worker thread per shard
+ */
+void ProcessCore::startWorkers() {
+  uint64_t start_cycle;
+  {
+    std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+    pool_stop_ = false;
+    start_cycle = pool_cycle_;
+  }
+  workers_.reserve(shards_.size());
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    workers_.emplace_back(&ProcessCore::workerLoop, this, i, start_cycle);
+  }
+}
+
+/**
+ * @brief Stop and join all worker threads
+ */
+void ProcessCore::stopWorkers() {
+  {
+    std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+    pool_stop_ = true;
+  }
+  pool_cv_.notify_all();
+  for (auto &worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
+/**
+ * @brief Body of a collector worker thread
+ *
+ * Applies the CPU affinity, then collects its shard once per dispatched
+ * cycle until stopped.
+ *
+ * @param shard_index The shard this worker owns
+ * @param start_cycle The pool cycle counter at launch
+ */
+void ProcessCore::workerLoop(size_t shard_index, uint64_t start_cycle) {
+#ifdef __QNXNTO__
+  if (cpu_mask_ != 0) {
+    // Pick the (shard_index mod popcount)-th allowed CPU
+    std::vector<unsigned> cpus;
+    for (unsigned cpu = 0; cpu < 64; ++cpu) {
+      if (cpu_mask_ & (uint64_t{1} << cpu))
+        cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) {
+      // The variable-size form reaches CPUs beyond the first 32: the word
+      // count, then the runmask and the inherit mask of that many words
+      unsigned cpu = cpus[shard_index % cpus.size()];
+      int words = RMSK_SIZE(_syspage_ptr->num_cpu);
+      std::vector<unsigned> masks(1 + 2 * static_cast<size_t>(words), 0);
+      masks[0] = static_cast<unsigned>(words);
+      RMSK_SET(cpu, &masks[1]);
+      RMSK_SET(cpu, &masks[1 + words]);
+      if (ThreadCtl(_NTO_TCTL_RUNMASK_GET_AND_SET_INHERIT, masks.data()) ==
+          -1) {
+        std::error_code ec(errno, std::system_category());
+        std::cerr << "Failed to pin collector worker " << shard_index << ": "
+                  << ec.message() << std::endl;
+      }
+    }
+  }
 #endif
+
+  uint64_t seen_cycle = start_cycle;
+  std::unique_lock<std::mutex> pool_lock(pool_mutex_);
+  while (true) {
+    pool_cv_.wait(pool_lock, [this, seen_cycle] {
+      return pool_stop_ || pool_cycle_ != seen_cycle;
+    });
+    if (pool_stop_) {
+      return;
+    }
+    seen_cycle = pool_cycle_;
+    auto sample_time = pool_sample_time_;
+
+    pool_lock.unlock();
+    collectShard(shards_[shard_index], sample_time);
+    pool_lock.lock();
+
+    if (--pool_pending_ == 0) {
+      pool_done_cv_.notify_one();
+    }
+  }
 }
 
 /**
@@ -240,7 +1081,7 @@ bool ProcessCore::adjustPriority(pid_t pid, int priority, int policy) {
  * priority, and policy information.
  */
 void ProcessCore::displayInfo() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  ProcessSnapshotPtr snapshot = getSnapshot();
 
   // Print header
   std::cout << std::setw(8) << "PID" << std::setw(20) << "Name" << std::setw(12)
@@ -250,7 +1091,7 @@ void ProcessCore::displayInfo() const {
   std::cout << std::string(83, '-') << std::endl;
 
   // Print process information
-  for (const auto &proc : process_list_) {
+  for (const auto &proc : snapshot->processes) {
     std::cout << std::setw(8) << proc.pid << std::setw(20) << proc.name
               << std::setw(12) << proc.memory_usage / 1024 << std::setw(10)
               << std::fixed << std::setprecision(1) << proc.cpu_usage
@@ -262,234 +1103,175 @@ void ProcessCore::displayInfo() const {
 /**
  * @brief Read detailed information for a specific process by PID.
  *
- * This method aggregates information by calling helper functions to read
- * memory usage and status details (including data needed for CPU calculation).
- * It then calculates the CPU usage based on the change in `sutime` over the
- * elapsed time since the last update.
+ * Reads the process as a batch of one; used by the passes that only visit
+ * a few processes.
  *
+ * @param shard The collector shard owning the PID's tracking state.
  * @param pid The process ID to read information for.
  * @param info Reference to a ProcessInfo struct to populate.
- * @param elapsed_time The time elapsed since the last global process list
- * update.
+ * @param sample_time The time the reading is stamped with.
  * @return true if process information was successfully read, false otherwise.
  */
-bool ProcessCore::readProcessInfo(pid_t pid, ProcessInfo &info,
-                                  std::chrono::duration<double> elapsed_time) {
-#ifdef __QNXNTO__
-  // Get status info (including parent_pid, num_threads, priority, policy,
-  // state, sutime)
-  std::optional<uint64_t> current_sutime_opt = readProcessStatus(pid, info);
-
-  if (current_sutime_opt) {
-    // Get the process name separately
-    if (auto path_opt = getProcessExecutablePath(pid)) {
-      info.name = *path_opt;
-    } else {
-      // Fallback or use cmdline?
-      info.name = getCommandLine(pid); // Try cmdline if path fails
-      if (info.name.empty()) {
-        info.name = "N/A"; // Default if both fail
-      } else {
-        // Often cmdline has args, take first part
-        size_t first_space = info.name.find(' ');
-        if (first_space != std::string::npos) {
-          info.name = info.name.substr(0, first_space);
-        }
-      }
-    }
+bool ProcessCore::readProcessInfo(
+    CollectorShard &shard, pid_t pid, ProcessInfo &info,
+    std::chrono::steady_clock::time_point sample_time) {
+  ProcessSample sample;
+  if (getReader(shard).readBatch(&pid, 1, &sample) == 0) {
+    // Not refreshing the PID's sutime entries lets the end-of-cycle prune
+    // drop them
+    return false;
+  }
+  fillProcessInfo(shard, sample, info, sample_time);
+  return true;
+}
 
-    // Read memory info only if status read was successful
-    if (!readProcessMemory(pid, info)) {
-      // Handle memory read failure? Log? Set memory to 0?
-      info.memory_usage = 0;
-    }
+/**
+ * @brief Turn a raw reading into a process row
+ *
+ * Resolves the name through the metadata cache and calculates the CPU
+ * usage from the change in `sutime` since the process was last read.
+ *
+ * @param shard The collector shard owning the PID's tracking state.
+ * @param sample The reading.
+ * @param info Reference to a ProcessInfo struct to populate.
+ * @param sample_time The time the reading is stamped with.
+ */
+void ProcessCore::fillProcessInfo(
+    CollectorShard &shard, const ProcessSample &sample, ProcessInfo &info,
+    std::chrono::steady_clock::time_point sample_time) {
+  pid_t pid = sample.pid;
+  info.pid = pid;
+  info.parent_pid = sample.parent_pid;
+  info.num_threads = sample.num_threads;
+  info.start_time = sample.start_time;
+  info.priority = sample.priority;
+  info.policy = sample.policy;
+  info.state = sample.state;
+  info.memory_usage = sample.memory_usage;
 
-    // --- Calculate CPU Usage ---
-    uint64_t current_sutime = *current_sutime_opt;
-    // Get num_cpu directly from the main syspage structure
-    int num_cpus =
-        _syspage_ptr->num_cpu; // Get number of CPUs directly from syspage
-    double elapsed_nanos =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed_time)
-            .count();
+  // The name only has to be resolved for processes we have not seen yet
+  const ProcessMetadata &meta = getMetadata(shard, pid, sample.start_time);
+  info.name = meta.name.text;
+  info.escaped_name = meta.name.escaped;
+  info.name_id = meta.name.id;
 
-    auto it = last_sutimes_.find(pid);
-    if (it != last_sutimes_.end()) // Check if we have previous data
-    {
-      uint64_t last_sutime = it->second;
-      uint64_t sutime_delta =
-          (current_sutime >= last_sutime)
-              ? (current_sutime - last_sutime)
-              : current_sutime; // Handle potential wraparound or reset? For now
-                                // assume monotonic increase.
-
-      if (elapsed_nanos > 0 && num_cpus > 0) {
-        // CPU% = (change in process time / change in wall time) / num_cpus *
-        // 100
-        info.cpu_usage =
-            (static_cast<double>(sutime_delta) / elapsed_nanos) * 100.0;
-        // Optional: Cap at num_cpus * 100% if needed, though unlikely with
-        // sutime info.cpu_usage = std::min(info.cpu_usage,
-        // static_cast<double>(num_cpus * 100.0));
-      } else {
-        info.cpu_usage = 0.0; // Avoid division by zero
-      }
-    } else {
-      info.cpu_usage =
-          0.0; // First time seeing this process, cannot calculate delta
-    }
-    // Update the last known sutime for this process
-    last_sutimes_[pid] = current_sutime;
-    // --- End CPU Calculation ---
+  // --- Calculate CPU Usage ---
+  info.cpu_usage =
+      updateCpuUsage(shard, sutimeKey(pid, 0), sample.sutime, sample_time);
 
-    return true; // Successfully read status and calculated CPU
-  } else {
-    // Status read failed, cannot proceed
-    info.name = "N/A"; // Set default name on status failure
-    info.cpu_usage = 0.0;
-    info.memory_usage = 0;
-    // Ensure PID is removed from tracking if status fails
-    last_sutimes_.erase(pid);
-    return false;
+  // Busy or watched processes are accounted per thread, so CPU used by
+  // threads other than the first one is not lost
+  if (shouldSampleThreads(pid)) {
+    if (auto thread_total = readThreadStatus(shard, pid, sample_time)) {
+      info.cpu_usage = *thread_total;
+    }
   }
-
-#else
-  // Non-QNX fallback (if needed)
-  info.name = "N/A";
-  info.cpu_usage = 0.0; // Cannot calculate CPU on non-QNX
-  info.memory_usage = 0;
-  // Basic info population might go here if supported
-  return false; // Indicate incomplete information
-#endif
+  // --- End CPU Calculation ---
 }
 
 /**
- * @brief Read memory usage information for a specific process
+ * @brief Decide whether a process gets per-thread accounting this cycle
  *
- * Retrieves memory usage information from the /proc filesystem for the
- * specified process. First attempts to use the address space file (as),
- * then falls back to the vmstat file if necessary.
+ * Uses the process's CPU usage from the previously published snapshot, so
+ * the decision costs no extra reads.
  *
- * @param pid The process ID to read memory information for
- * @param info The ProcessInfo object to update with memory usage data
- * @return true if memory information was successfully read, false otherwise
+ * @param pid The process ID
+ * @return true if every thread of the process should be sampled
  */
-bool ProcessCore::readProcessMemory(pid_t pid, ProcessInfo &info) {
-#ifdef __QNXNTO__
-  // Open the as (address space) file to get memory information
-  std::stringstream path;
-  path << "/proc/" << pid << "/as";
-
-  std::ifstream as(path.str().c_str());
-  if (!as) {
-    // Minor error, might not have permission, don't log verbosely unless
-    // debugging std::cerr << "Failed to open /proc/" << pid << "/as: " <<
-    // std::system_category().message(errno) << std::endl;
+bool ProcessCore::shouldSampleThreads(pid_t pid) const {
+  const ThreadSamplingConfig *config = cycle_sampling_.get();
+  if (!config || !config->enabled) {
     return false;
   }
-
-  debug_aspace_t aspace;
-  if (as.read(reinterpret_cast<char *>(&aspace), sizeof(aspace))) {
-    // Use the Resident Set Size (RSS) as memory usage
-    info.memory_usage = aspace.rss / 1024; // Convert to KB
+  if (config->watched.count(pid) > 0) {
     return true;
   }
+  const ProcessInfo *previous = current_ ? current_->find(pid) : nullptr;
+  return previous && previous->cpu_usage >= config->cpu_threshold;
+}
 
-  // Fall back to vmstat
-  path.str("");
-  path << "/proc/" << pid << "/vmstat";
-
-  std::ifstream vmstat(path.str().c_str());
-  if (!vmstat) {
-    // std::cerr << "Failed to open /proc/" << pid << "/vmstat: " <<
-    // std::system_category().message(errno) << std::endl;
-    return false;
+/**
+ * @brief Sample every thread of a process
+ *
+ * Per-thread rows are appended to the shard and each thread's sutime delta
+ * is tracked in the same map as the process-level samples.
+ *
+ * @param shard The collector shard owning the PID
+ * @param pid The process ID
+ * @param sample_time The time the readings are stamped with
+ * @return The process CPU usage as the sum over its threads, or
+ * std::nullopt if no thread could be read or none has an earlier reading
+ * to diff against (the process-level figure is kept for that cycle)
+ */
+std::optional<double> ProcessCore::readThreadStatus(
+    CollectorShard &shard, pid_t pid,
+    std::chrono::steady_clock::time_point sample_time) {
+  if (!getReader(shard).readThreads(pid, shard.thread_samples)) {
+    return std::nullopt;
   }
 
-  std::string line;
-  uint64_t memory_usage = 0;
-
-  while (std::getline(vmstat, line)) {
-    if (line.find("private") != std::string::npos) {
-      std::stringstream ss(line);
-      std::string key;
-      uint64_t value;
-
-      ss >> key >> value;
-      memory_usage += value;
-    }
+  double total = 0.0;
+  bool baseline = false;
+  for (const ThreadSample &sample : shard.thread_samples) {
+    uint64_t key = sutimeKey(pid, sample.tid);
+    baseline = baseline || shard.last_sutimes.count(key) > 0;
+    ThreadInfo thread;
+    thread.pid = pid;
+    thread.tid = sample.tid;
+    thread.cpu_usage =
+        updateCpuUsage(shard, key, sample.sutime, sample_time);
+    thread.priority = sample.priority;
+    thread.policy = sample.policy;
+    thread.state = sample.state;
+    shard.threads.push_back(thread);
+    total += thread.cpu_usage;
   }
+  return baseline ? std::make_optional(total) : std::nullopt;
+}
 
-  info.memory_usage = memory_usage / 1024; // Convert to KB
-  return true; // Assume success if file opened, even if no "private" found
-#else
-  return false;
-#endif
+/**
+ * @brief Get a shard's reader, opening it on first use
+ *
+ * @param shard The shard
+ * @return The reader, valid until the shards are reset
+ */
+ProcessSource::Reader &ProcessCore::getReader(CollectorShard &shard) {
+  if (!shard.reader) {
+    shard.reader = source_->openReader();
+  }
+  return *shard.reader;
 }
 
 /**
- * @brief Read process status information using devctl.
+ * @brief Get the cached static attributes of a process
  *
- * Retrieves process metadata like parent PID, name, state, priority, policy,
- * thread count, and the total system + user time (`sutime`) using QNX's devctl
- * interface on /proc/<pid>/ctl.
+ * The executable path (or, failing that, the first word of the command line)
+ * is only resolved when the PID is new or its start time differs from the
+ * cached entry, i.e. the PID has been reused by another process. The name
+ * is interned, so processes running the same executable share one copy of
+ * it and of its JSON-escaped form.
  *
- * @param pid The process ID.
- * @param info Reference to ProcessInfo struct to populate.
- * @return std::optional<uint64_t> containing the sutime if successful,
- * std::nullopt otherwise.
+ * @param shard The shard owning the PID
+ * @param pid The process ID
+ * @param start_time The process start time reported by the source
+ * @return Reference to the cache entry, valid until the PID is pruned
  */
-std::optional<uint64_t> ProcessCore::readProcessStatus(pid_t pid,
-                                                       ProcessInfo &info) {
-#ifdef __QNXNTO__
-  std::string ctl_path_str = "/proc/" + std::to_string(pid) + "/ctl";
-  int fd = open(ctl_path_str.c_str(), O_RDONLY);
-  if (fd == -1) {
-    // Process might have terminated between listing and opening
-    // std::cerr << "Failed to open " << ctl_path_str << ": " << strerror(errno)
-    // << std::endl;
-    return std::nullopt;
+const ProcessMetadata &ProcessCore::getMetadata(CollectorShard &shard,
+                                                pid_t pid,
+                                                uint64_t start_time) {
+  auto it = shard.metadata.find(pid);
+  if (it != shard.metadata.end() && it->second.start_time == start_time) {
+    return it->second;
   }
 
-  uint64_t sutime = 0; // Variable to store sutime
-
-  // Get general process info (path, parent PID, etc.)
-  debug_process_t pinfo = {0}; // Important to zero-initialize
-  if (devctl(fd, DCMD_PROC_INFO, &pinfo, sizeof(pinfo), nullptr) == EOK) {
-    info.pid = pid;
-    info.parent_pid = pinfo.parent;
-    info.num_threads = pinfo.num_threads;
-
-    // Get status of the first thread (TID 1) for priority, policy, state,
-    // sutime
-    procfs_status tinfo = {0}; // This is debug_thread_t in QNX 8.0
-    tinfo.tid = 1;             // Get info for thread 1
-    if (devctl(fd, DCMD_PROC_TIDSTATUS, &tinfo, sizeof(tinfo), nullptr) ==
-        EOK) {
-      info.priority = tinfo.priority;
-      info.policy = tinfo.policy;
-      info.state = tinfo.state; // Store the raw state code
-      sutime = tinfo.sutime;    // Store the sutime
-
-      close(fd);
-      return std::make_optional(sutime); // Success
-    } else {
-      // std::cerr << "Failed devctl DCMD_PROC_TIDSTATUS for PID " << pid << ":
-      // " << strerror(errno) << std::endl;
-    }
-  } else {
-    // std::cerr << "Failed devctl DCMD_PROC_INFO for PID " << pid << ": " <<
-    // strerror(errno) << std::endl;
+  ProcessMetadata &meta = shard.metadata[pid];
+  meta.start_time = start_time;
+  std::string name = getReader(shard).readName(pid);
+  if (name.empty()) {
+    name = "N/A"; // Default if nothing could be read
   }
-
-  // If we reach here, something failed
-  close(fd);
-  return std::nullopt;
-#else
-  // Non-QNX implementation placeholder
-  info.pid = pid info.parent_pid = -1;
-  info.num_threads = 0;
-  return std::nullopt; // Cannot get sutime
-#endif
+  // Interning escapes once per distinct name rather than on every response
+  meta.name = StringTable::getInstance().intern(name);
+  return meta;
 }
 } // namespace qnx
@@ -0,0 +1,167 @@
+/**
+ * @file ProcessDelta.cpp
+ * @brief Implementation of snapshot delta encoding for QNX Remote Process
+ * Monitor
+ */
+
+#include "server/ProcessDelta.hpp"
+#include "server/BinaryProtocol.hpp"
+#include "server/JsonWriter.hpp"
+
+namespace qnx {
+namespace {
+// Write only the fields that differ between two samples of one process;
+// returns false (and writes nothing) if none do
+bool writeChangedFields(JsonWriter &json, const ProcessInfo &before,
+                        const ProcessInfo &after) {
+  bool cpu = before.cpu_usage != after.cpu_usage;
+  bool memory = before.memory_usage / 1024 != after.memory_usage / 1024;
+  bool threads = before.num_threads != after.num_threads;
+  bool priority = before.priority != after.priority;
+  bool state = before.state != after.state;
+  if (!cpu && !memory && !threads && !priority && !state) {
+    return false;
+  }
+  json.beginObject().addInt("pid", after.pid);
+  if (cpu)
+    json.addDouble("cpu_usage", after.cpu_usage);
+  if (memory)
+    json.addUInt("memory_usage_kb", after.memory_usage / 1024);
+  if (threads)
+    json.addInt("threads", after.num_threads);
+  if (priority)
+    json.addInt("priority", after.priority);
+  if (state)
+    json.addInt("state", after.state);
+  json.endObject();
+  return true;
+}
+
+// Binary form of a delta; base is null when the client's generation is
+// unknown and the full table is sent
+void writeDeltaBinary(std::string &out, const ProcessSnapshot &current,
+                      const ProcessSnapshot *base,
+                      BinaryProtocol::MessageType type) {
+  out.reserve(out.size() + 32 +
+              (base ? 0 : current.processes.size() * 24));
+  BinaryProtocol::Writer binary(out);
+  binary.putHeader(type);
+  binary.putU64(current.generation);
+  binary.putU8(base ? 0 : 1);
+
+  pid_t previous_pid = 0;
+  if (!base) {
+    binary.putU16(static_cast<uint16_t>(DEFAULT_FIELDS));
+    binary.putU32(static_cast<uint32_t>(current.processes.size()));
+    for (const auto &info : current.processes) {
+      binary.putProcessRow(info, DEFAULT_FIELDS, previous_pid);
+    }
+    return;
+  }
+
+  binary.putU64(base->generation);
+  binary.putU16(static_cast<uint16_t>(DEFAULT_FIELDS));
+  size_t count_at = binary.reserveU32();
+  uint32_t count = 0;
+  for (const auto &info : current.processes) {
+    const ProcessInfo *old = base->find(info.pid);
+    if (!old || old->start_time != info.start_time) {
+      binary.putProcessRow(info, DEFAULT_FIELDS, previous_pid);
+      ++count;
+    }
+  }
+  binary.patchU32(count_at, count);
+
+  previous_pid = 0;
+  count_at = binary.reserveU32();
+  count = 0;
+  for (const auto &info : base->processes) {
+    if (!current.find(info.pid)) {
+      binary.putSvarint(static_cast<int64_t>(info.pid) - previous_pid);
+      previous_pid = info.pid;
+      ++count;
+    }
+  }
+  binary.patchU32(count_at, count);
+
+  previous_pid = 0;
+  count_at = binary.reserveU32();
+  count = 0;
+  for (const auto &info : current.processes) {
+    const ProcessInfo *old = base->find(info.pid);
+    if (old && old->start_time == info.start_time &&
+        binary.putProcessChange(*old, info, previous_pid)) {
+      ++count;
+    }
+  }
+  binary.patchU32(count_at, count);
+}
+} // namespace
+
+/**
+ * @brief Encode the changes from one snapshot to a newer one
+ *
+ * @param out Buffer the message is appended to
+ * @param current The newer snapshot
+ * @param base The snapshot the client holds, or nullptr if it is unknown
+ * @param encoding How the client asked for responses to be encoded
+ * @param pushed Encode a subscription push instead of a reply
+ */
+void encodeProcessDelta(std::string &out, const ProcessSnapshot &current,
+                        const ProcessSnapshot *base, WireEncoding encoding,
+                        bool pushed) {
+  if (encoding == WireEncoding::Binary) {
+    writeDeltaBinary(out, current, base,
+                     pushed ? BinaryProtocol::MessageType::ProcessUpdate
+                            : BinaryProtocol::MessageType::ProcessDelta);
+    return;
+  }
+
+  JsonWriter json(out);
+  json.beginObject();
+  if (pushed) {
+    json.addString("event", "process_delta").addString("scope", "all");
+  } else {
+    json.addString("status", "success");
+  }
+  json.addUInt("generation", current.generation);
+
+  if (!base) {
+    out.reserve(out.size() + current.processes.size() * 112);
+    json.addBool("full", true).beginArray("processes");
+    for (const auto &info : current.processes) {
+      json.addProcessRow(info);
+    }
+    json.endArray().endObject();
+    return;
+  }
+
+  json.addBool("full", false).addUInt("base", base->generation);
+
+  json.beginArray("added");
+  for (const auto &info : current.processes) {
+    const ProcessInfo *old = base->find(info.pid);
+    if (!old || old->start_time != info.start_time) {
+      json.addProcessRow(info);
+    }
+  }
+  json.endArray();
+
+  json.beginArray("removed");
+  for (const auto &info : base->processes) {
+    if (!current.find(info.pid)) {
+      json.addInt({}, info.pid);
+    }
+  }
+  json.endArray();
+
+  json.beginArray("changed");
+  for (const auto &info : current.processes) {
+    const ProcessInfo *old = base->find(info.pid);
+    if (old && old->start_time == info.start_time) {
+      writeChangedFields(json, *old, info);
+    }
+  }
+  json.endArray().endObject();
+}
+} // namespace qnx
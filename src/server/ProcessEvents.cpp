@@ -0,0 +1,174 @@
+/**
+ * @file ProcessEvents.cpp
+ * @brief Implementation of process lifecycle notifications for QNX Remote
+ * Process Monitor
+ */
+
+#include "server/ProcessEvents.hpp"
+#include "server/SamplingScheduler.hpp"
+#include <cerrno>
+#include <iostream>
+#include <system_error>
+#ifdef __QNXNTO__
+#include <sys/neutrino.h>
+#include <sys/procmgr.h>
+#include <sys/siginfo.h>
+#endif
+
+namespace qnx {
+namespace {
+#ifdef __QNXNTO__
+constexpr int PULSE_CREATE = _PULSE_CODE_MINAVAIL;
+constexpr int PULSE_DEATH = _PULSE_CODE_MINAVAIL + 1;
+constexpr int PULSE_STOP = _PULSE_CODE_MINAVAIL + 2;
+
+/**
+ * @brief Register a pulse with procnto for one kind of process event
+ *
+ * @param coid Connection the pulse is delivered on
+ * @param flags PROCMGR_EVENT_PROCESS_CREATE or PROCMGR_EVENT_PROCESS_DEATH
+ * @param code Pulse code identifying the event kind
+ * @return The notification handle, or -1 on failure
+ */
+int registerEvent(int coid, unsigned flags, int code) {
+  struct sigevent event;
+  SIGEV_PULSE_INIT(&event, coid, SIGEV_PULSE_PRIO_INHERIT, code, 0);
+  // procnto only delivers events that were registered with it
+  if (MsgRegisterEvent(&event, SYSMGR_COID) == -1) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to register process event: " << ec.message()
+              << std::endl;
+    return -1;
+  }
+  int handle = procmgr_event_notify_add(flags, &event);
+  if (handle == -1) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to request process event notification: "
+              << ec.message() << std::endl;
+  }
+  return handle;
+}
+#endif
+} // namespace
+
+/**
+ * @brief Get the singleton instance of the ProcessEvents class
+ *
+ * @return Reference to the singleton ProcessEvents instance
+ */
+ProcessEvents &ProcessEvents::getInstance() {
+  static ProcessEvents instance;
+  return instance;
+}
+
+/**
+ * @brief Destructor: stops the receiving thread if still running
+ */
+ProcessEvents::~ProcessEvents() { stop(); }
+
+/**
+ * @brief Register for notifications and start the receiving thread
+ *
+ * @return true if notifications are being received
+ */
+bool ProcessEvents::start() {
+  if (running_.load()) {
+    return true;
+  }
+#ifdef __QNXNTO__
+  chid_ = ChannelCreate(_NTO_CHF_PRIVATE);
+  if (chid_ == -1) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to create process event channel: " << ec.message()
+              << std::endl;
+    return false;
+  }
+  coid_ = ConnectAttach(0, 0, chid_, _NTO_SIDE_CHANNEL, 0);
+  if (coid_ == -1) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to connect process event channel: " << ec.message()
+              << std::endl;
+    stop();
+    return false;
+  }
+  create_handle_ =
+      registerEvent(coid_, PROCMGR_EVENT_PROCESS_CREATE, PULSE_CREATE);
+  death_handle_ =
+      registerEvent(coid_, PROCMGR_EVENT_PROCESS_DEATH, PULSE_DEATH);
+  if (create_handle_ == -1 || death_handle_ == -1) {
+    stop();
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread(&ProcessEvents::receiveLoop, this);
+  std::cout << "Receiving process lifecycle events" << std::endl;
+  return true;
+#else
+  std::cerr << "Process lifecycle events not supported on non-QNX systems"
+            << std::endl;
+  return false;
+#endif
+}
+
+/**
+ * @brief Unregister and stop the receiving thread
+ *
+ * Also releases whatever a failed start() managed to set up.
+ */
+void ProcessEvents::stop() {
+#ifdef __QNXNTO__
+  if (running_.exchange(false)) {
+    MsgSendPulse(coid_, -1, PULSE_STOP, 0);
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (create_handle_ != -1) {
+    procmgr_event_notify_delete(create_handle_);
+    create_handle_ = -1;
+  }
+  if (death_handle_ != -1) {
+    procmgr_event_notify_delete(death_handle_);
+    death_handle_ = -1;
+  }
+  if (coid_ != -1) {
+    ConnectDetach(coid_);
+    coid_ = -1;
+  }
+  if (chid_ != -1) {
+    ChannelDestroy(chid_);
+    chid_ = -1;
+  }
+#endif
+}
+
+/**
+ * @brief Body of the receiving thread
+ *
+ * Counts each pulse and asks the scheduler for a membership pass; the
+ * scheduler coalesces bursts into one pass.
+ */
+void ProcessEvents::receiveLoop() {
+#ifdef __QNXNTO__
+  SamplingScheduler &scheduler = SamplingScheduler::getInstance();
+  struct _pulse pulse;
+  while (MsgReceivePulse(chid_, &pulse, sizeof(pulse), nullptr) != -1) {
+    switch (pulse.code) {
+    case PULSE_CREATE:
+      ++created_;
+      break;
+    case PULSE_DEATH:
+      ++exited_;
+      break;
+    case PULSE_STOP:
+      return;
+    default:
+      continue;
+    }
+    scheduler.notifyMembershipChange();
+  }
+  std::error_code ec(errno, std::system_category());
+  std::cerr << "Process event channel failed: " << ec.message() << std::endl;
+#endif
+}
+} // namespace qnx
@@ -7,6 +7,8 @@
 #include <iostream>
 #include <optional>
 #include <set>
+#include <system_error>
+#include <vector>
 
 namespace qnx {
 ProcessGroup &qnx::ProcessGroup::getInstance() {
@@ -32,13 +34,20 @@ bool qnx::ProcessGroup::deleteGroup(int group_id) {
     return false;
   }
 
-  // Remove all processes from this group in the process_group_map
-  for (pid_t pid : it->second.processes) {
-    process_group_map_.erase(pid);
+  // Remove all processes from this group in the membership table
+  GroupMembership membership = *membership_;
+  for (auto member = membership.begin(); member != membership.end();) {
+    if (member->second == group_id) {
+      member = membership.erase(member);
+    } else {
+      ++member;
+    }
   }
+  publishMembership(std::move(membership));
 
   // Remove the group
-  return groups_.erase(group_id) > 0;
+  groups_.erase(it);
+  return true;
 }
 
 bool qnx::ProcessGroup::renameGroup(int group_id, std::string_view new_name) {
@@ -66,20 +75,14 @@ bool qnx::ProcessGroup::addProcessToGroup(pid_t pid, int group_id) {
     return false;
   }
 
-  // Remove process from previous group if any
-  auto prev_group_it = process_group_map_.find(pid);
-  if (prev_group_it != process_group_map_.end()) {
-    int prev_group_id = prev_group_it->second;
-    if (prev_group_id != group_id &&
-        groups_.find(prev_group_id) != groups_.end()) {
-      groups_[prev_group_id].processes.erase(pid);
-    }
+  // Moves the process out of its previous group, if any
+  auto member = membership_->find(pid);
+  if (member == membership_->end() || member->second != group_id) {
+    GroupMembership membership = *membership_;
+    membership[pid] = group_id;
+    publishMembership(std::move(membership));
   }
 
-  // Add to new group
-  it->second.processes.insert(pid);
-  process_group_map_[pid] = group_id;
-
   return true;
 }
 
@@ -91,22 +94,22 @@ bool qnx::ProcessGroup::removeProcessFromGroup(pid_t pid, int group_id) {
     return false;
   }
 
-  auto &processes = it->second.processes;
-  auto erase_count = processes.erase(pid);
-
-  if (erase_count > 0) {
-    process_group_map_.erase(pid);
-    return true;
+  auto member = membership_->find(pid);
+  if (member == membership_->end() || member->second != group_id) {
+    return false;
   }
 
-  return false;
+  GroupMembership membership = *membership_;
+  membership.erase(pid);
+  publishMembership(std::move(membership));
+  return true;
 }
 
 int qnx::ProcessGroup::getProcessGroupId(pid_t pid) const {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  auto it = process_group_map_.find(pid);
-  if (it != process_group_map_.end()) {
+  auto it = membership_->find(pid);
+  if (it != membership_->end()) {
     return it->second;
   }
 
@@ -116,48 +119,59 @@ int qnx::ProcessGroup::getProcessGroupId(pid_t pid) const {
 std::set<pid_t> qnx::ProcessGroup::getProcessesInGroup(int group_id) const {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  auto it = groups_.find(group_id);
-  if (it != groups_.end()) {
-    return it->second.processes;
+  std::set<pid_t> processes;
+  for (const auto &member : *membership_) {
+    if (member.second == group_id) {
+      processes.insert(member.first);
+    }
   }
+  return processes;
+}
 
-  return std::set<pid_t>();
+void qnx::ProcessGroup::publishMembership(GroupMembership membership) {
+  membership_ = std::make_shared<const GroupMembership>(std::move(membership));
+  ProcessCore::getInstance().setGroupMembership(membership_);
 }
 
 void qnx::ProcessGroup::updateGroupStats() {
+  // Totals were summed while the snapshot was built; just pick them up
+  ProcessSnapshotPtr snapshot = ProcessCore::getInstance().getSnapshot();
+
   std::lock_guard<std::mutex> lock(mutex_);
 
-  // Reset all group stats
   for (auto &group_pair : groups_) {
     Group &group = group_pair.second;
-    group.total_cpu_usage = 0.0;
-    group.total_memory_usage = 0;
-    group.num_processes = 0;
-
-    // Remove any processes that no longer exist
-    std::set<pid_t> to_remove;
-    for (pid_t pid : group.processes) {
-      // Use correct namespace
-      if (!qnx::exists(pid)) {
-        to_remove.insert(pid);
-        process_group_map_.erase(pid);
-      } else {
-        // Add current process stats to group totals
-        // Use correct namespace
-        auto proc_info_opt = ProcessCore::getInstance().getProcessById(pid);
-        if (proc_info_opt) {
-          const auto &proc_info = *proc_info_opt;
-          group.total_memory_usage += proc_info.memory_usage;
-          group.total_cpu_usage += proc_info.cpu_usage;
-          group.num_processes++;
-        }
-      }
+    auto totals = snapshot->group_totals.find(group.id);
+    if (totals != snapshot->group_totals.end()) {
+      group.total_cpu_usage = totals->second.cpu_usage;
+      group.total_memory_usage =
+          static_cast<long>(totals->second.memory_usage);
+      group.num_processes = totals->second.num_processes;
+    } else {
+      group.total_cpu_usage = 0.0;
+      group.total_memory_usage = 0;
+      group.num_processes = 0;
     }
+  }
 
-    // Remove dead processes
-    for (pid_t pid : to_remove) {
-      group.processes.erase(pid);
+  // A member the snapshot was built against but did not list has exited.
+  // Members added since then are left alone until a snapshot covers them.
+  if (!snapshot->group_membership) {
+    return;
+  }
+  const GroupMembership &covered = *snapshot->group_membership;
+  std::vector<pid_t> exited;
+  for (const auto &member : *membership_) {
+    if (!snapshot->find(member.first) && covered.count(member.first) != 0) {
+      exited.push_back(member.first);
+    }
+  }
+  if (!exited.empty()) {
+    GroupMembership membership = *membership_;
+    for (pid_t pid : exited) {
+      membership.erase(pid);
     }
+    publishMembership(std::move(membership));
   }
 }
 
@@ -185,35 +199,37 @@ void qnx::ProcessGroup::displayGroups() const {
   std::cout << "----------------------" << std::endl;
 }
 
-void qnx::ProcessGroup::prioritizeGroup(int group_id) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto it = groups_.find(group_id);
-  if (it == groups_.end()) {
-    std::cerr << "Error: Cannot prioritize non-existent group " << group_id
-              << std::endl;
-    return;
+std::optional<size_t> qnx::ProcessGroup::prioritizeGroup(int group_id,
+                                                        int priority,
+                                                        int policy) {
+  std::vector<pid_t> members;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = groups_.find(group_id);
+    if (it == groups_.end()) {
+      std::cerr << "Error: Cannot prioritize non-existent group " << group_id
+                << std::endl;
+      return std::nullopt;
+    }
+    for (const auto &member : *membership_) {
+      if (member.second == group_id) {
+        members.push_back(member.first);
+      }
+    }
   }
 
-  // Example: Set a higher priority (lower number is higher prio in POSIX/QNX)
-  // This is a simplified example; real implementation might involve
-  // iterating through processes and calling ProcessCore::adjustPriority
-  // with appropriate logic based on group membership or policy.
-  int new_base_priority = 10; // Example high priority
-  int policy = SCHED_RR;      // Example policy
-
-  // Silence unused variable warnings for placeholder implementation
-  (void)new_base_priority;
-  (void)policy;
-
-  std::cout << "Prioritizing group " << group_id << " (processes: ";
-  for (pid_t pid : it->second.processes) {
-    std::cout << pid << " ";
-    // Note: Adjusting priority needs careful consideration of permissions and
-    // policy ProcessCore::getInstance().adjustPriority(pid, new_base_priority,
-    // policy);
+  // System calls are made outside the lock so the stats loop is not held up
+  ControlRequest request{ControlAction::SetPriority, priority, policy};
+  size_t adjusted = 0;
+  for (pid_t pid : members) {
+    std::error_code ec = applyControl(pid, request);
+    if (ec) {
+      std::cerr << "Failed to prioritize PID " << pid << " in group "
+                << group_id << ": " << ec.message() << std::endl;
+      continue;
+    }
+    ++adjusted;
   }
-  std::cout << ")" << std::endl;
-  // You might update the group's priority field as well if needed
-  // it->second.priority = some_value_indicating_prioritization;
+  return adjusted;
 }
 } // namespace qnx
@@ -8,15 +8,65 @@
  * metrics like CPU and memory usage for each tracked process, allowing for
  * trend analysis and visualization in the monitoring interface.
  *
+ * Storage is a slab of equally sized ring buffers, one slot per tracked
+ * process, kept as separate CPU and memory columns. The ring position of a
+ * sample is its tick number modulo the capacity, shared by every process, so
+ * a single timestamp column covers all of them. Ticks on which a process was
+ * not sampled are marked with a NaN CPU value.
+ *
+ * Each sample is also folded into the open bucket of every rollup tier; a
+ * bucket is written to its tier's ring once a sample from a later bucket
+ * arrives, so no tier ever rescans older data.
+ *
  * The implementation provides thread-safe operations for adding, retrieving,
  * and managing history data with configurable limits on the number of processes
  * tracked and the amount of history stored per process.
  */
 
 #include "server/ProcessHistory.hpp"
-#include <ctime>
+#include "server/ProcessCore.hpp"
+#include "server/ServerMetrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
 
 namespace qnx {
+ProcessHistoryEntry HistoryView::Iterator::operator*() const {
+  size_t pos = static_cast<size_t>(tick_ % view_->capacity_);
+  ProcessHistoryEntry entry;
+  entry.cpu_usage = view_->cpu_[pos];
+  entry.memory_usage = static_cast<long>(view_->memory_kb_[pos]) * 1024;
+  entry.timestamp = view_->tick_time_[pos];
+  return entry;
+}
+
+HistoryView::Iterator &HistoryView::Iterator::operator++() {
+  ++tick_;
+  skipGaps();
+  return *this;
+}
+
+void HistoryView::Iterator::skipGaps() {
+  while (tick_ < view_->end_tick_ &&
+         std::isnan(view_->cpu_[tick_ % view_->capacity_])) {
+    ++tick_;
+  }
+}
+
+ProcessHistory::ProcessHistory()
+    : tick_time_(max_entries_per_process_, 0),
+      tiers_{Tier{10, 360}, Tier{60, 360}, Tier{600, 144}} {
+  // What one tracked process costs across the slab and every tier
+  size_t slot_bytes =
+      max_entries_per_process_ * (sizeof(float) + sizeof(uint32_t));
+  for (const Tier &tier : tiers_) {
+    slot_bytes += tier.capacity * 3 * (sizeof(float) + sizeof(uint32_t)) +
+                  sizeof(TierSeries);
+  }
+  max_tracked_processes_ = MEMORY_BUDGET / slot_bytes;
+}
+
 /**
  * @brief Get the singleton instance of the ProcessHistory class
  *
@@ -32,6 +82,198 @@ ProcessHistory &ProcessHistory::getInstance() {
   return instance;
 }
 
+/**
+ * @brief Start a new tick stamped with the given time
+ *
+ * The ring position taken over by the new tick held the oldest tick until
+ * now; series still covering that tick simply lose it, as views clamp their
+ * start to the retained window.
+ *
+ * Must be called with the history lock held exclusively.
+ *
+ * @param now Timestamp of the new tick
+ */
+void ProcessHistory::advanceTick(time_t now) {
+  ++tick_;
+  tick_time_[tick_ % max_entries_per_process_] = now;
+}
+
+/**
+ * @brief Size every tier's columns to the slab's current slot count
+ *
+ * Must be called with the history lock held exclusively.
+ */
+void ProcessHistory::growTiers() {
+  for (Tier &tier : tiers_) {
+    size_t cells = slots_used_ * tier.capacity;
+    tier.cpu_min.resize(cells);
+    tier.cpu_avg.resize(cells);
+    tier.cpu_max.resize(cells);
+    tier.memory_min_kb.resize(cells);
+    tier.memory_avg_kb.resize(cells);
+    tier.memory_max_kb.resize(cells);
+    tier.series.resize(slots_used_);
+  }
+}
+
+/**
+ * @brief Fold a sample into a process's open bucket of one tier
+ *
+ * A sample from a later bucket first closes the open one.
+ *
+ * Must be called with the history lock held exclusively.
+ *
+ * @param tier The rollup tier
+ * @param slot The process's slab slot
+ * @param now Sample timestamp
+ * @param cpu CPU usage percentage
+ * @param memory_kb Memory usage in KB
+ */
+void ProcessHistory::rollUp(Tier &tier, uint32_t slot, time_t now, float cpu,
+                            uint32_t memory_kb) {
+  TierSeries &series = tier.series[slot];
+  uint64_t bucket = static_cast<uint64_t>(now) / tier.seconds;
+  if (series.open.count != 0 && series.open_bucket != bucket) {
+    closeBucket(tier, slot);
+  }
+
+  Rollup &open = series.open;
+  if (open.count == 0) {
+    series.open_bucket = bucket;
+    open = Rollup{cpu, cpu, 0.0, memory_kb, memory_kb, 0, 0};
+  }
+  open.cpu_min = std::min(open.cpu_min, cpu);
+  open.cpu_max = std::max(open.cpu_max, cpu);
+  open.cpu_sum += cpu;
+  open.memory_min_kb = std::min(open.memory_min_kb, memory_kb);
+  open.memory_max_kb = std::max(open.memory_max_kb, memory_kb);
+  open.memory_sum_kb += memory_kb;
+  ++open.count;
+}
+
+/**
+ * @brief Write a process's open bucket into its tier ring
+ *
+ * Buckets skipped since the last completed one are marked empty. A bucket
+ * older than the last completed one (the clock stepped back) is dropped.
+ *
+ * Must be called with the history lock held exclusively.
+ *
+ * @param tier The rollup tier
+ * @param slot The process's slab slot
+ */
+void ProcessHistory::closeBucket(Tier &tier, uint32_t slot) {
+  TierSeries &series = tier.series[slot];
+  Rollup &open = series.open;
+  uint64_t bucket = series.open_bucket;
+  size_t base = slot * tier.capacity;
+
+  if (series.last_bucket != 0 && bucket <= series.last_bucket) {
+    open.count = 0;
+    return;
+  }
+  if (series.last_bucket != 0 &&
+      series.last_bucket + tier.capacity > bucket) {
+    for (uint64_t b = series.last_bucket + 1; b < bucket; ++b) {
+      tier.cpu_avg[base + b % tier.capacity] =
+          std::numeric_limits<float>::quiet_NaN();
+    }
+  } else {
+    series.first_bucket = bucket;
+  }
+
+  size_t cell = base + bucket % tier.capacity;
+  tier.cpu_min[cell] = open.cpu_min;
+  tier.cpu_avg[cell] = static_cast<float>(open.cpu_sum / open.count);
+  tier.cpu_max[cell] = open.cpu_max;
+  tier.memory_min_kb[cell] = open.memory_min_kb;
+  tier.memory_avg_kb[cell] =
+      static_cast<uint32_t>(open.memory_sum_kb / open.count);
+  tier.memory_max_kb[cell] = open.memory_max_kb;
+  series.last_bucket = bucket;
+  open.count = 0;
+}
+
+/**
+ * @brief Stop tracking a series and return its slot to the free list
+ *
+ * Must be called with the history lock held exclusively.
+ *
+ * @param it The series to release
+ */
+void ProcessHistory::releaseSeries(
+    std::unordered_map<pid_t, Series>::iterator it) {
+  free_slots_.push_back(it->second.slot);
+  series_.erase(it);
+}
+
+/**
+ * @brief Record one sample for a process on the current tick
+ *
+ * Starts tracking the process if needed, unless the slab is full, in which
+ * case the sample is dropped and counted.
+ *
+ * Must be called with the history lock held exclusively, after the tick the
+ * sample belongs to has been started.
+ *
+ * @param pid The process ID
+ * @param cpu_usage CPU usage percentage
+ * @param memory_usage Memory usage in bytes
+ */
+void ProcessHistory::recordSample(pid_t pid, double cpu_usage,
+                                  uint64_t memory_usage) {
+  const size_t capacity = max_entries_per_process_;
+
+  auto it = series_.find(pid);
+  if (it == series_.end()) {
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else if (slots_used_ < max_tracked_processes_) {
+      // The slab grows a whole slot at a time, up to max_tracked_processes_
+      slot = slots_used_++;
+      cpu_.resize(slots_used_ * capacity);
+      memory_kb_.resize(slots_used_ * capacity);
+      growTiers();
+    } else {
+      ServerMetrics::getInstance().add(Counter::HistorySamplesDropped);
+      return;
+    }
+    for (Tier &tier : tiers_) {
+      tier.series[slot] = TierSeries{};
+    }
+    it = series_.emplace(pid, Series{slot, tick_, tick_}).first;
+  } else {
+    Series &series = it->second;
+    float *cpu = &cpu_[series.slot * capacity];
+    if (series.last_tick + capacity <= tick_) {
+      // Every retained sample has been overwritten; start afresh
+      series.first_tick = tick_;
+    } else {
+      // Mark the ticks this process missed so stale cells are not read
+      for (uint64_t t = series.last_tick + 1; t < tick_; ++t) {
+        cpu[t % capacity] = std::numeric_limits<float>::quiet_NaN();
+      }
+    }
+    series.last_tick = tick_;
+  }
+
+  // NaN marks a missed tick, so it cannot be stored as a value
+  float cpu = std::isfinite(cpu_usage) ? static_cast<float>(cpu_usage) : 0.0f;
+  uint32_t memory_kb = static_cast<uint32_t>(std::min<uint64_t>(
+      memory_usage / 1024, std::numeric_limits<uint32_t>::max()));
+  uint32_t slot = it->second.slot;
+  size_t cell = slot * capacity + tick_ % capacity;
+  cpu_[cell] = cpu;
+  memory_kb_[cell] = memory_kb;
+
+  time_t now = tick_time_[tick_ % capacity];
+  for (Tier &tier : tiers_) {
+    rollUp(tier, slot, now, cpu, memory_kb);
+  }
+}
+
 /**
  * @brief Add a new history entry for a specific process
  *
@@ -40,8 +282,9 @@ ProcessHistory &ProcessHistory::getInstance() {
  * not already being tracked and the maximum number of tracked processes has
  * been reached, the new entry will be ignored.
  *
- * If the number of entries for a process exceeds max_entries_per_process_,
- * the oldest entry will be discarded to maintain the size limit.
+ * Each process keeps max_entries_per_process_ ticks; once the ring is full
+ * the oldest entry is overwritten. Recording a sample in the same second as
+ * the previous call shares (and, for the same process, replaces) that tick.
  *
  * Thread-safe through mutex locking of the history data.
  *
@@ -50,96 +293,350 @@ ProcessHistory &ProcessHistory::getInstance() {
  * @param memory_usage The current memory usage in bytes
  */
 void ProcessHistory::addEntry(pid_t pid, double cpu_usage, long memory_usage) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_, std::defer_lock);
+  lockTimed(lock, Latency::HistoryLockWait);
 
-  if (history_data_.find(pid) == history_data_.end() &&
-      history_data_.size() >= max_tracked_processes_) {
-    return;
+  time_t now = std::time(nullptr);
+  if (tick_ == 0 || tick_time_[tick_ % max_entries_per_process_] != now) {
+    advanceTick(now);
   }
+  recordSample(pid, cpu_usage,
+               static_cast<uint64_t>(std::max(memory_usage, 0L)));
+}
 
-  ProcessHistoryEntry entry;
-  entry.cpu_usage = cpu_usage;
-  entry.memory_usage = memory_usage;
-  entry.timestamp = std::time(nullptr);
+/**
+ * @brief Append one tick for every process in a snapshot
+ *
+ * All samples share a single timestamp and are recorded in one critical
+ * section. Tracked processes missing from the snapshot have exited; their
+ * history is released in the same pass so the slots can be reused.
+ *
+ * Thread-safe through mutex locking of the history data.
+ *
+ * @param snapshot The snapshot just published by ProcessCore
+ */
+void ProcessHistory::ingestSnapshot(const ProcessSnapshot &snapshot) {
+  std::unique_lock<std::shared_mutex> lock(mutex_, std::defer_lock);
+  lockTimed(lock, Latency::HistoryLockWait);
 
-  auto &history_deque = history_data_[pid];
-  history_deque.push_back(entry);
+  advanceTick(std::time(nullptr));
+  for (const ProcessInfo &info : snapshot.processes) {
+    recordSample(info.pid, info.cpu_usage, info.memory_usage);
+  }
 
-  if (history_deque.size() > max_entries_per_process_) {
-    history_deque.pop_front();
+  for (auto it = series_.begin(); it != series_.end();) {
+    auto current = it++;
+    if (current->second.last_tick != tick_) {
+      releaseSeries(current);
+    }
   }
 }
 
 /**
- * @brief Retrieve historical entries for a specific process
+ * @brief View the historical entries for a specific process
  *
- * Returns a vector containing the most recent history entries for the specified
- * process. The vector is ordered with the most recent entry first. If the
- * process is not being tracked or has no history, an empty vector is returned.
+ * Returns a view over the retained history of the specified process, ordered
+ * oldest first. If the process is not being tracked or has no history, an
+ * empty view is returned.
  *
- * Thread-safe through mutex locking of the history data.
+ * The view holds a shared lock on the history data until it is destroyed.
  *
  * @param pid The process ID to retrieve history for
- * @param count The maximum number of entries to retrieve
- * @return A vector of HistoryEntry objects containing the requested history
+ * @return A view over the recorded entries
  */
-std::vector<ProcessHistoryEntry> ProcessHistory::getHistory(pid_t pid) const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto it = history_data_.find(pid);
-  if (it != history_data_.end()) {
-    return std::vector<ProcessHistoryEntry>(it->second.begin(),
-                                            it->second.end());
+HistoryView ProcessHistory::getHistory(pid_t pid) const {
+  HistoryView view;
+  view.lock_ = std::shared_lock<std::shared_mutex>(mutex_, std::defer_lock);
+  lockTimed(view.lock_, Latency::HistoryLockWait);
+
+  auto it = series_.find(pid);
+  if (it == series_.end()) {
+    return view;
   }
-  return {};
+  const Series &series = it->second;
+  const size_t capacity = max_entries_per_process_;
+  if (series.last_tick + capacity <= tick_) {
+    return view;
+  }
+
+  uint64_t oldest = tick_ >= capacity ? tick_ - capacity + 1 : 1;
+  view.cpu_ = &cpu_[series.slot * capacity];
+  view.memory_kb_ = &memory_kb_[series.slot * capacity];
+  view.tick_time_ = tick_time_.data();
+  view.capacity_ = capacity;
+  view.first_tick_ = std::max(series.first_tick, oldest);
+  view.end_tick_ = series.last_tick + 1;
+  return view;
 }
 
 /**
- * @brief Clear all historical data for a specific process
+ * @brief Append a process's raw samples within [from, to] to a range
  *
- * Removes all history entries for the specified process. If the process
- * is not being tracked, this method has no effect.
+ * Tick timestamps never decrease, so the range is located by binary search.
+ *
+ * Must be called with the history lock held.
+ *
+ * @param series The process's series
+ * @param from Start of the range (inclusive)
+ * @param to End of the range (inclusive)
+ * @param range Receives the points
+ */
+void ProcessHistory::readRaw(const Series &series, time_t from, time_t to,
+                             HistoryRange &range) const {
+  const size_t capacity = max_entries_per_process_;
+  const float *cpu = &cpu_[series.slot * capacity];
+  const uint32_t *memory_kb = &memory_kb_[series.slot * capacity];
+  uint64_t oldest = tick_ >= capacity ? tick_ - capacity + 1 : 1;
+  uint64_t lo = std::max(series.first_tick, oldest);
+  uint64_t hi = series.last_tick + 1;
+
+  auto time_at = [&](uint64_t tick) { return tick_time_[tick % capacity]; };
+  uint64_t count = hi - lo;
+  while (count > 0) { // first tick at or after 'from'
+    uint64_t step = count / 2;
+    if (time_at(lo + step) < from) {
+      lo += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+
+  range.resolution = 1;
+  for (uint64_t tick = lo; tick < hi && time_at(tick) <= to; ++tick) {
+    size_t pos = tick % capacity;
+    if (std::isnan(cpu[pos])) {
+      continue;
+    }
+    range.points.push_back(HistoryPoint{time_at(tick), cpu[pos], cpu[pos],
+                                        cpu[pos], memory_kb[pos],
+                                        memory_kb[pos], memory_kb[pos]});
+  }
+}
+
+/**
+ * @brief Append a process's completed buckets within [from, to] to a range
+ *
+ * Must be called with the history lock held.
+ *
+ * @param tier The rollup tier to read
+ * @param slot The process's slab slot
+ * @param from Start of the range (inclusive)
+ * @param to End of the range (inclusive)
+ * @param range Receives the points
+ */
+void ProcessHistory::readTier(const Tier &tier, uint32_t slot, time_t from,
+                              time_t to, HistoryRange &range) const {
+  const TierSeries &series = tier.series[slot];
+  range.resolution = tier.seconds;
+  if (series.last_bucket == 0 || to < 0) {
+    return;
+  }
+  uint64_t oldest = series.last_bucket >= tier.capacity
+                        ? series.last_bucket - tier.capacity + 1
+                        : 0;
+  uint64_t lo = std::max({series.first_bucket, oldest,
+                          static_cast<uint64_t>(std::max<time_t>(from, 0)) /
+                              tier.seconds});
+  uint64_t hi = std::min(series.last_bucket,
+                         static_cast<uint64_t>(to) / tier.seconds);
+
+  size_t base = slot * tier.capacity;
+  for (uint64_t bucket = lo; bucket <= hi; ++bucket) {
+    size_t cell = base + bucket % tier.capacity;
+    if (std::isnan(tier.cpu_avg[cell])) {
+      continue;
+    }
+    range.points.push_back(HistoryPoint{
+        static_cast<time_t>(bucket * tier.seconds), tier.cpu_min[cell],
+        tier.cpu_avg[cell], tier.cpu_max[cell], tier.memory_min_kb[cell],
+        tier.memory_avg_kb[cell], tier.memory_max_kb[cell]});
+  }
+}
+
+/**
+ * @brief Query history over a time range within a point budget
+ *
+ * Resolutions are tried finest first: raw samples, then each rollup tier.
+ * A resolution qualifies when it still holds the start of the range (or
+ * has lost nothing since the process was first seen) and the range spans
+ * at most max_points of its intervals. Without a qualifying resolution the
+ * coarsest available one is read and adjacent points are merged until the
+ * budget is met. Either way the cost is proportional to the points read.
  *
  * Thread-safe through mutex locking of the history data.
  *
- * @param pid The process ID to clear history for
+ * @param pid The process ID to query
+ * @param from Start of the range (inclusive)
+ * @param to End of the range (inclusive)
+ * @param max_points Maximum number of points to return
+ * @return The chosen resolution and the points, oldest first
  */
-void ProcessHistory::clearProcessHistory(pid_t pid) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  history_data_.erase(pid);
+HistoryRange ProcessHistory::getHistoryRange(pid_t pid, time_t from, time_t to,
+                                             size_t max_points) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_, std::defer_lock);
+  lockTimed(lock, Latency::HistoryLockWait);
+  HistoryRange range;
+  max_points = std::max<size_t>(max_points, 1);
+
+  auto it = series_.find(pid);
+  if (it == series_.end() || from > to) {
+    return range;
+  }
+  const Series &series = it->second;
+  const uint32_t slot = series.slot;
+  const size_t capacity = max_entries_per_process_;
+
+  // Clamp the range to the data held, so that a short-lived process is
+  // answered from the finest resolution
+  bool raw_valid = series.last_tick + capacity > tick_;
+  uint64_t oldest_tick = tick_ >= capacity ? tick_ - capacity + 1 : 1;
+  uint64_t raw_first = std::max(series.first_tick, oldest_tick);
+  time_t data_start = std::numeric_limits<time_t>::max();
+  time_t data_end = std::numeric_limits<time_t>::min();
+  if (raw_valid) {
+    data_start = tick_time_[raw_first % capacity];
+    data_end = tick_time_[series.last_tick % capacity];
+  }
+  bool wrapped[1 + TIER_COUNT] = {series.first_tick < oldest_tick};
+  time_t retained[1 + TIER_COUNT] = {data_start};
+  bool available[1 + TIER_COUNT] = {raw_valid};
+  for (size_t i = 0; i < TIER_COUNT; ++i) {
+    const TierSeries &tier_series = tiers_[i].series[slot];
+    const size_t tier_capacity = tiers_[i].capacity;
+    available[1 + i] = tier_series.last_bucket != 0;
+    if (!available[1 + i]) {
+      continue;
+    }
+    uint64_t oldest = tier_series.last_bucket >= tier_capacity
+                          ? tier_series.last_bucket - tier_capacity + 1
+                          : 0;
+    wrapped[1 + i] = tier_series.first_bucket < oldest;
+    retained[1 + i] = static_cast<time_t>(
+        std::max(tier_series.first_bucket, oldest) * tiers_[i].seconds);
+    data_start = std::min(data_start, retained[1 + i]);
+    data_end = std::max(data_end, static_cast<time_t>(
+        (tier_series.last_bucket + 1) * tiers_[i].seconds - 1));
+  }
+  from = std::max(from, data_start);
+  to = std::min(to, data_end);
+  if (from > to) {
+    return range;
+  }
+
+  int chosen = -1; // 0 = raw, else tier chosen - 1
+  for (size_t i = 0; i < 1 + TIER_COUNT; ++i) {
+    if (available[i]) {
+      chosen = static_cast<int>(i);
+    }
+    time_t seconds = i == 0 ? 1 : tiers_[i - 1].seconds;
+    bool covers = !wrapped[i] || retained[i] <= from;
+    if (available[i] && covers &&
+        static_cast<uint64_t>(to - from) / seconds + 1 <= max_points) {
+      break;
+    }
+  }
+  if (chosen < 0) {
+    return range;
+  }
+  if (chosen == 0) {
+    readRaw(series, from, to, range);
+  } else {
+    readTier(tiers_[chosen - 1], slot, from, to, range);
+  }
+
+  // Still over budget: merge runs of adjacent points
+  std::vector<HistoryPoint> &points = range.points;
+  if (points.size() > max_points) {
+    size_t group = (points.size() + max_points - 1) / max_points;
+    size_t merged = 0;
+    for (size_t start = 0; start < points.size(); start += group) {
+      size_t end = std::min(start + group, points.size());
+      HistoryPoint point = points[start];
+      double cpu_sum = point.cpu_avg;
+      uint64_t memory_sum = point.memory_avg_kb;
+      for (size_t i = start + 1; i < end; ++i) {
+        point.cpu_min = std::min(point.cpu_min, points[i].cpu_min);
+        point.cpu_max = std::max(point.cpu_max, points[i].cpu_max);
+        point.memory_min_kb =
+            std::min(point.memory_min_kb, points[i].memory_min_kb);
+        point.memory_max_kb =
+            std::max(point.memory_max_kb, points[i].memory_max_kb);
+        cpu_sum += points[i].cpu_avg;
+        memory_sum += points[i].memory_avg_kb;
+      }
+      point.cpu_avg = static_cast<float>(cpu_sum / (end - start));
+      point.memory_avg_kb = static_cast<uint32_t>(memory_sum / (end - start));
+      points[merged++] = point;
+    }
+    points.resize(merged);
+    range.resolution *= static_cast<time_t>(group);
+  }
+  return range;
 }
 
 /**
- * @brief Clear all historical data for all processes
+ * @brief Get the IDs of all processes with recorded history
  *
- * Removes all history entries for all tracked processes, effectively
- * resetting the history module to its initial state.
+ * Thread-safe through mutex locking of the history data.
+ *
+ * @return The tracked process IDs, in no particular order
+ */
+std::vector<pid_t> ProcessHistory::getTrackedProcesses() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  std::vector<pid_t> pids;
+  pids.reserve(series_.size());
+  for (const auto &pair : series_) {
+    pids.push_back(pair.first);
+  }
+  return pids;
+}
+
+/**
+ * @brief Get the number of processes with recorded history
  *
  * Thread-safe through mutex locking of the history data.
+ *
+ * @return The number of tracked processes
  */
-void ProcessHistory::clearAllHistory() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  history_data_.clear();
+size_t ProcessHistory::trackedCount() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return series_.size();
 }
 
 /**
- * @brief Retrieve all historical data for all processes
+ * @brief Clear all historical data for a specific process
  *
- * Returns a map containing all historical entries for all tracked processes.
- * The map is keyed by process ID, and the value is a vector of
- * ProcessHistoryEntry objects.
+ * Removes all history entries for the specified process. If the process
+ * is not being tracked, this method has no effect.
  *
  * Thread-safe through mutex locking of the history data.
  *
- * @return A map of process ID to vector of ProcessHistoryEntry objects
+ * @param pid The process ID to clear history for
+ */
+void ProcessHistory::clearProcessHistory(pid_t pid) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto it = series_.find(pid);
+  if (it != series_.end()) {
+    releaseSeries(it);
+  }
+}
+
+/**
+ * @brief Clear all historical data for all processes
+ *
+ * Removes all history entries for all tracked processes, effectively
+ * resetting the history module to its initial state. The slab's memory is
+ * kept for reuse.
+ *
+ * Thread-safe through mutex locking of the history data.
  */
-std::map<pid_t, std::vector<ProcessHistoryEntry>>
-ProcessHistory::getAllHistory() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  std::map<pid_t, std::vector<ProcessHistoryEntry>> result;
-  for (const auto &pair : history_data_) {
-    result.emplace(pair.first, std::vector<ProcessHistoryEntry>(
-                                   pair.second.begin(), pair.second.end()));
+void ProcessHistory::clearAllHistory() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  series_.clear();
+  free_slots_.clear();
+  for (uint32_t slot = slots_used_; slot > 0; --slot) {
+    free_slots_.push_back(slot - 1);
   }
-  return result;
 }
 } // namespace qnx
@@ -0,0 +1,97 @@
+/**
+ * @file ProcessSource.cpp
+ * @brief Process source selection for QNX Remote Process Monitor
+ */
+
+#include "server/ProcessSource.hpp"
+#include "server/LinuxProcessSource.hpp"
+#include "server/QnxProcessSource.hpp"
+#include "server/ReplayProcessSource.hpp"
+#include <cctype>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <dirent.h>
+
+namespace qnx {
+/**
+ * @brief Name of the source used when none is configured
+ *
+ * @return "devctl" on QNX, "linux" elsewhere
+ */
+const char *defaultProcessSourceName() noexcept {
+#ifdef __QNXNTO__
+  return "devctl";
+#else
+  return "linux";
+#endif
+}
+
+/**
+ * @brief Create a process source by name
+ *
+ * The replay source is created with the default workload.
+ *
+ * @param name "devctl", "linux" or "replay"
+ * @param proc_root Where the /proc based sources list and open processes
+ * @return The source, or nullptr if the name is unknown
+ */
+std::unique_ptr<ProcessSource>
+createProcessSource(const std::string &name, const std::string &proc_root) {
+  if (name == "devctl") {
+    return std::make_unique<QnxProcessSource>(proc_root);
+  }
+  if (name == "linux") {
+    return std::make_unique<LinuxProcessSource>(proc_root);
+  }
+  if (name == "replay") {
+    return std::make_unique<ReplayProcessSource>(
+        ReplayProcessSource::Workload{});
+  }
+  return nullptr;
+}
+
+/**
+ * @brief List the numeric directory names under a /proc mount
+ *
+ * Walks the directory with readdir() and parses the names in place, so a
+ * listing allocates nothing once pids has grown to the process count.
+ *
+ * @param root Directory holding one subdirectory per PID
+ * @param pids Replaced with the PIDs, in directory order
+ * @throws std::runtime_error if root cannot be opened
+ */
+void listProcDirectory(const std::string &root, std::vector<pid_t> &pids) {
+  DIR *dir = opendir(root.c_str());
+  if (!dir) {
+    std::error_code ec(errno, std::system_category());
+    throw std::runtime_error("Proc filesystem not found: " + ec.message());
+  }
+
+  pids.clear();
+  while (struct dirent *entry = readdir(dir)) {
+#ifdef DT_DIR
+    if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN)
+      continue;
+#endif
+    const char *name = entry->d_name;
+    if (*name == '\0')
+      continue;
+
+    pid_t pid = 0;
+    bool numeric = true;
+    for (const char *c = name; *c != '\0'; ++c) {
+      if (!std::isdigit(static_cast<unsigned char>(*c))) {
+        numeric = false;
+        break;
+      }
+      pid = pid * 10 + (*c - '0');
+    }
+    if (numeric) {
+      pids.push_back(pid);
+    }
+  }
+  closedir(dir);
+}
+} // namespace qnx
@@ -0,0 +1,211 @@
+/**
+ * @file ReplayProcessSource.cpp
+ * @brief Implementation of the synthetic process source for QNX Remote
+ * Process Monitor
+ *
+ * Tables only change in listPids(), which runs with the collector mutex
+ * held and never concurrently with the readers, so readers use the table
+ * without locking. CPU time is derived from each process's start and load
+ * when it is read, so it keeps advancing between listings for the fast
+ * sampling tiers.
+ */
+
+#include "server/ReplayProcessSource.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace qnx {
+namespace {
+/// Policy and state reported for every generated thread (SCHED_RR, READY)
+constexpr int REPLAY_POLICY = 2;
+constexpr int REPLAY_STATE = 2;
+constexpr int REPLAY_PRIORITY = 10;
+/// Distinct executable names the processes are spread over
+constexpr pid_t REPLAY_NAMES = 32;
+
+/**
+ * @brief CPU time a process has used by a given time
+ */
+uint64_t sutimeAt(const ProcessSample &sample, double load,
+                  std::chrono::steady_clock::time_point started,
+                  std::chrono::steady_clock::time_point now) {
+  auto alive = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   now - started)
+                   .count() -
+               static_cast<int64_t>(sample.start_time);
+  return alive > 0 ? static_cast<uint64_t>(alive * load) : 0;
+}
+} // namespace
+
+/**
+ * @brief Constructor: generates the initial process table
+ *
+ * @param workload Shape of the table
+ */
+ReplayProcessSource::ReplayProcessSource(Workload workload)
+    : workload_(workload), rng_(workload.seed),
+      started_(std::chrono::steady_clock::now()), last_advance_(started_) {
+  workload_.processes = std::max<size_t>(workload_.processes, 1);
+  workload_.threads = std::max(workload_.threads, 1u);
+  processes_.reserve(workload_.processes);
+  for (size_t i = 0; i < workload_.processes; ++i) {
+    processes_.push_back(spawn());
+  }
+}
+
+/**
+ * @brief Advance the workload to now and list its PIDs
+ *
+ * @param pids Replaced with the PIDs, in ascending order
+ */
+void ReplayProcessSource::listPids(std::vector<pid_t> &pids) {
+  advance(std::chrono::steady_clock::now());
+  pids.clear();
+  pids.reserve(processes_.size());
+  for (const Process &process : processes_) {
+    pids.push_back(process.sample.pid);
+  }
+}
+
+std::unique_ptr<ProcessSource::Reader> ReplayProcessSource::openReader() {
+  return std::make_unique<ReplayReader>(*this);
+}
+
+/**
+ * @brief Look up a generated process
+ *
+ * @return The process, or nullptr if the PID is not live
+ */
+const ReplayProcessSource::Process *
+ReplayProcessSource::find(pid_t pid) const {
+  auto it = std::lower_bound(
+      processes_.begin(), processes_.end(), pid,
+      [](const Process &process, pid_t key) {
+        return process.sample.pid < key;
+      });
+  return it != processes_.end() && it->sample.pid == pid ? &*it : nullptr;
+}
+
+/**
+ * @brief Generate the next process
+ *
+ * Parents are picked among the live processes, which all have lower PIDs,
+ * so the table is always a forest.
+ */
+ReplayProcessSource::Process ReplayProcessSource::spawn() {
+  Process process;
+  ProcessSample &sample = process.sample;
+  sample.pid = next_pid_++;
+  sample.parent_pid =
+      processes_.empty()
+          ? 0
+          : processes_[rng_() % processes_.size()].sample.pid;
+  sample.num_threads = static_cast<int>(workload_.threads);
+  sample.priority = REPLAY_PRIORITY;
+  sample.policy = REPLAY_POLICY;
+  sample.state = REPLAY_STATE;
+  sample.start_time = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(last_advance_ -
+                                                           started_)
+          .count());
+  sample.memory_usage = (256 + rng_() % 65536) * 1024;
+
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  process.load =
+      unit(rng_) < workload_.busy_fraction ? workload_.busy_load / 100.0 : 0.0;
+  process.name = "/usr/bin/replay-" + std::to_string(sample.pid % REPLAY_NAMES);
+  return process;
+}
+
+/**
+ * @brief Replace the processes owed by the churn rate since the last call
+ *
+ * The first process is never replaced, so the tree keeps its root.
+ */
+void ReplayProcessSource::advance(std::chrono::steady_clock::time_point now) {
+  double elapsed = std::chrono::duration<double>(now - last_advance_).count();
+  last_advance_ = now;
+  if (workload_.churn_per_second <= 0 || processes_.size() < 2) {
+    return;
+  }
+  pending_churn_ += workload_.churn_per_second * elapsed;
+  auto replacements = static_cast<size_t>(std::floor(pending_churn_));
+  pending_churn_ -= static_cast<double>(replacements);
+  for (size_t i = 0; i < replacements; ++i) {
+    size_t victim = 1 + rng_() % (processes_.size() - 1);
+    processes_.erase(processes_.begin() + static_cast<ptrdiff_t>(victim));
+    processes_.push_back(spawn()); // Highest PID yet, so still sorted
+  }
+}
+
+/**
+ * @brief Read a batch of generated processes
+ *
+ * @param pids The PIDs to read, in ascending order
+ * @param count Number of PIDs
+ * @param out Room for count samples
+ * @return The number of samples written
+ */
+size_t ReplayProcessSource::ReplayReader::readBatch(const pid_t *pids,
+                                                    size_t count,
+                                                    ProcessSample *out) {
+  auto now = std::chrono::steady_clock::now();
+  const std::vector<Process> &processes = source_.processes_;
+  auto it = processes.begin();
+  size_t written = 0;
+  for (size_t i = 0; i < count; ++i) {
+    // Both sides are sorted, so the search resumes where the last one ended
+    it = std::lower_bound(it, processes.end(), pids[i],
+                          [](const Process &process, pid_t key) {
+                            return process.sample.pid < key;
+                          });
+    if (it == processes.end() || it->sample.pid != pids[i]) {
+      continue;
+    }
+    out[written] = it->sample;
+    out[written].sutime = sutimeAt(it->sample, it->load, source_.started_, now);
+    ++written;
+  }
+  return written;
+}
+
+/**
+ * @brief Split a generated process's CPU time evenly over its threads
+ *
+ * @param pid The process ID
+ * @param out Replaced with one sample per thread
+ * @return false if the PID is not live
+ */
+bool ReplayProcessSource::ReplayReader::readThreads(
+    pid_t pid, std::vector<ThreadSample> &out) {
+  out.clear();
+  const Process *process = source_.find(pid);
+  if (!process) {
+    return false;
+  }
+  uint64_t sutime = sutimeAt(process->sample, process->load, source_.started_,
+                             std::chrono::steady_clock::now());
+  unsigned threads = source_.workload_.threads;
+  for (unsigned tid = 1; tid <= threads; ++tid) {
+    ThreadSample thread;
+    thread.tid = static_cast<int>(tid);
+    thread.sutime = sutime / threads;
+    thread.priority = process->sample.priority;
+    thread.policy = process->sample.policy;
+    thread.state = process->sample.state;
+    out.push_back(thread);
+  }
+  return true;
+}
+
+/**
+ * @brief Name of a generated process
+ *
+ * @param pid The process ID
+ * @return The name, or empty if the PID is not live
+ */
+std::string ReplayProcessSource::ReplayReader::readName(pid_t pid) {
+  const Process *process = source_.find(pid);
+  return process ? process->name : std::string();
+}
+} // namespace qnx
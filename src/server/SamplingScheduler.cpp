@@ -0,0 +1,247 @@
+/**
+ * @file SamplingScheduler.cpp
+ * @brief Implementation of the stats loop cadence for QNX Remote Process
+ * Monitor
+ *
+ * The stats loop sleeps on a condition variable until the earliest deadline,
+ * so refresh requests, configuration changes and shutdown wake it at once.
+ */
+
+#include "server/SamplingScheduler.hpp"
+#include "server/ProcessGroup.hpp"
+#include "server/SubscriptionManager.hpp"
+#include <algorithm>
+#include <set>
+#include <utility>
+
+namespace qnx {
+/**
+ * @brief Get the singleton instance of the SamplingScheduler class
+ *
+ * @return Reference to the singleton SamplingScheduler instance
+ */
+SamplingScheduler &SamplingScheduler::getInstance() {
+  static SamplingScheduler instance;
+  return instance;
+}
+
+/**
+ * @brief Set the full collection intervals
+ *
+ * @param active Interval while at least one client is subscribed
+ * @param idle Interval while nobody is subscribed; fast tiers also pause
+ */
+void SamplingScheduler::setIntervals(std::chrono::milliseconds active,
+                                     std::chrono::milliseconds idle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  active_interval_ = std::max(active, MIN_INTERVAL);
+  idle_interval_ = std::max(idle, active_interval_);
+  wake_cv_.notify_one();
+}
+
+/**
+ * @brief Replace the fast sampling tiers
+ *
+ * @param tiers The new tiers; empty disables fast sampling
+ */
+void SamplingScheduler::setTiers(std::vector<SamplingTier> tiers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &tier : tiers) {
+    tier.interval = std::max(tier.interval, MIN_INTERVAL);
+  }
+  tiers_ = std::move(tiers);
+  // Due at once, so a newly watched process is read without delay
+  tier_deadlines_.assign(tiers_.size(), Clock::now());
+  wake_cv_.notify_one();
+}
+
+/**
+ * @brief Get the current fast sampling tiers
+ *
+ * @return A copy of the tiers
+ */
+std::vector<SamplingTier> SamplingScheduler::getTiers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tiers_;
+}
+
+/**
+ * @brief Block until the next pass is due
+ *
+ * A due full collection wins over everything else, and covers fast tiers
+ * and membership changes that fall due with it. So does a refresh request,
+ * once REFRESH_COALESCE has passed since the last full pass started.
+ * Membership and fast tier passes only run while someone is subscribed.
+ *
+ * @return The pass to run, or a Stop pass once stop() has been called
+ */
+SamplingPass SamplingScheduler::waitForNextPass() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (stopped_) {
+      return SamplingPass{};
+    }
+    Clock::time_point now = Clock::now();
+    bool active = SubscriptionManager::getInstance().count() > 0;
+
+    if (!started_) {
+      last_full_ = now;
+      return fullPass(now);
+    }
+    Clock::time_point full_due = last_full_ + fullInterval(active);
+    if (now >= full_due) {
+      // The next deadline counts from this one unless it fell an interval
+      // behind, e.g. when subscribers arrive during the idle interval
+      last_full_ = now - full_due >= fullInterval(active) ? now : full_due;
+      return fullPass(now);
+    }
+
+    Clock::time_point wake = full_due;
+    if (refresh_requested_ > refresh_dispatched_) {
+      Clock::time_point refresh_due = last_full_start_ + REFRESH_COALESCE;
+      if (now >= refresh_due) {
+        last_full_ = now; // Rephase the regular cadence after the refresh
+        return fullPass(now);
+      }
+      wake = std::min(wake, refresh_due);
+    }
+    if (active && membership_pending_) {
+      Clock::time_point membership_due =
+          last_membership_ + MEMBERSHIP_COALESCE;
+      if (now >= membership_due) {
+        membership_pending_ = false;
+        last_membership_ = now;
+        SamplingPass pass;
+        pass.kind = SamplingPass::Membership;
+        return pass;
+      }
+      wake = std::min(wake, membership_due);
+    }
+    if (active) {
+      SamplingPass pass;
+      pass.kind = SamplingPass::Fast;
+      for (size_t i = 0; i < tiers_.size(); ++i) {
+        if (now < tier_deadlines_[i]) {
+          wake = std::min(wake, tier_deadlines_[i]);
+          continue;
+        }
+        const SamplingTier &tier = tiers_[i];
+        pass.pids.insert(tier.pids.begin(), tier.pids.end());
+        if (tier.group_id != -1) {
+          std::set<pid_t> members =
+              ProcessGroup::getInstance().getProcessesInGroup(tier.group_id);
+          pass.pids.insert(members.begin(), members.end());
+        }
+        advance(tier_deadlines_[i], tier.interval, now);
+        wake = std::min(wake, tier_deadlines_[i]);
+      }
+      if (!pass.pids.empty()) {
+        return pass;
+      }
+    }
+    wake_cv_.wait_until(lock, wake);
+  }
+}
+
+/**
+ * @brief Report that a pass returned by waitForNextPass() has finished
+ *
+ * @param pass The pass
+ */
+void SamplingScheduler::completePass(const SamplingPass &pass) {
+  if (pass.kind != SamplingPass::Full) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  refresh_completed_ = std::max(refresh_completed_, pass.refresh_seq);
+  completed_cv_.notify_all();
+}
+
+/**
+ * @brief Ask for a full collection now and wait for it to finish
+ *
+ * @param timeout How long to wait; zero returns without waiting
+ * @return true if a collection started after the request has finished
+ */
+bool SamplingScheduler::requestRefresh(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t seq = ++refresh_requested_;
+  wake_cv_.notify_one();
+  completed_cv_.wait_for(lock, timeout, [this, seq] {
+    return stopped_ || refresh_completed_ >= seq;
+  });
+  return refresh_completed_ >= seq;
+}
+
+/**
+ * @brief Report that processes were created or exited
+ */
+void SamplingScheduler::notifyMembershipChange() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!membership_pending_) {
+    membership_pending_ = true;
+    wake_cv_.notify_one();
+  }
+}
+
+/**
+ * @brief Wake the stats loop and make waitForNextPass() return Stop
+ */
+void SamplingScheduler::stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopped_ = true;
+  wake_cv_.notify_all();
+  completed_cv_.notify_all();
+}
+
+/**
+ * @brief Full collection interval for the current subscriber state
+ *
+ * @param active Whether any client is subscribed
+ * @return The interval; mutex_ must be held
+ */
+std::chrono::milliseconds SamplingScheduler::fullInterval(bool active) const {
+  return active ? active_interval_ : idle_interval_;
+}
+
+/**
+ * @brief Move a deadline one interval on, or to now if it fell behind
+ *
+ * @param deadline The deadline to advance
+ * @param interval The tier's interval
+ * @param now The current time
+ */
+void SamplingScheduler::advance(Clock::time_point &deadline,
+                                std::chrono::milliseconds interval,
+                                Clock::time_point now) {
+  deadline += interval;
+  if (deadline + interval <= now) {
+    deadline = now;
+  }
+}
+
+/**
+ * @brief Hand out a full pass; mutex_ must be held
+ *
+ * Fast tiers that are due are covered by the full pass and move on too,
+ * as do pending membership changes.
+ *
+ * @param now The current time
+ * @return The pass, answering every refresh requested so far
+ */
+SamplingPass SamplingScheduler::fullPass(Clock::time_point now) {
+  started_ = true;
+  last_full_start_ = now;
+  membership_pending_ = false; // A full pass sees every process
+  for (size_t i = 0; i < tiers_.size(); ++i) {
+    if (now >= tier_deadlines_[i]) {
+      advance(tier_deadlines_[i], tiers_[i].interval, now);
+    }
+  }
+  SamplingPass pass;
+  pass.kind = SamplingPass::Full;
+  pass.refresh_seq = refresh_requested_;
+  refresh_dispatched_ = refresh_requested_;
+  return pass;
+}
+} // namespace qnx
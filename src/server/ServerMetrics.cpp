@@ -0,0 +1,368 @@
+/**
+ * @file ServerMetrics.cpp
+ * @brief Implementation of self-instrumentation for QNX Remote Process
+ * Monitor
+ *
+ * Thread blocks are created on a thread's first recording and never move, so
+ * the read side can walk them under the registry mutex while their owners
+ * keep recording.
+ */
+
+#include "server/ServerMetrics.hpp"
+#include <cstdio>
+
+namespace qnx {
+namespace {
+/**
+ * @brief Add to a counter that only the calling thread writes
+ */
+inline void bump(std::atomic<uint64_t> &counter, uint64_t amount) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+/**
+ * @brief Histogram bucket for a duration
+ */
+size_t bucketFor(std::chrono::steady_clock::duration duration) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration)
+                .count();
+  size_t bucket = 0;
+  while (us > 0 && bucket + 1 < HistogramSnapshot::BUCKETS) {
+    us >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+/**
+ * @brief Format a number for the Prometheus text format
+ */
+std::string promNumber(double value) {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.9g", value);
+  return text;
+}
+
+/**
+ * @brief Append one histogram as cumulative Prometheus buckets
+ *
+ * @param out The text being built
+ * @param name The metric family, without suffixes
+ * @param labels Label pairs shared by every sample, e.g. op="collect"
+ * @param histogram The histogram
+ */
+void appendPromHistogram(std::string &out, const std::string &name,
+                         const std::string &labels,
+                         const HistogramSnapshot &histogram) {
+  uint64_t cumulative = 0;
+  // The last bucket is open-ended, so it is only reported as +Inf
+  for (size_t i = 0; i + 1 < HistogramSnapshot::BUCKETS; ++i) {
+    cumulative += histogram.buckets[i];
+    out += name + "_bucket{" + labels + ",le=\"" +
+           promNumber(HistogramSnapshot::bucketBoundUs(i) / 1e6) + "\"} " +
+           std::to_string(cumulative) + "\n";
+  }
+  out += name + "_bucket{" + labels + ",le=\"+Inf\"} " +
+         std::to_string(histogram.count) + "\n";
+  out += name + "_sum{" + labels + "} " +
+         promNumber(histogram.sum_ns / 1e9) + "\n";
+  out += name + "_count{" + labels + "} " + std::to_string(histogram.count) +
+         "\n";
+}
+} // namespace
+
+/**
+ * @brief Upper bound of the bucket holding a quantile
+ *
+ * @param q The quantile, in [0, 1]
+ * @return The bound in microseconds, or 0 if nothing was recorded
+ */
+uint64_t HistogramSnapshot::quantileUs(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return bucketBoundUs(i);
+    }
+  }
+  return bucketBoundUs(BUCKETS - 1);
+}
+
+/**
+ * @brief Record one duration; called by the owning thread only
+ */
+void ServerMetrics::Histogram::record(
+    std::chrono::steady_clock::duration duration) {
+  auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  bump(count, 1);
+  bump(sum_ns, ns > 0 ? static_cast<uint64_t>(ns) : 0);
+  bump(buckets[bucketFor(duration)], 1);
+}
+
+/**
+ * @brief Add this histogram's contents to a total
+ */
+void ServerMetrics::Histogram::addTo(HistogramSnapshot &total) const {
+  total.count += count.load(std::memory_order_relaxed);
+  total.sum_ns += sum_ns.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+    total.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Add this thread's metrics to a total
+ */
+void ServerMetrics::ThreadMetrics::addTo(MetricsSnapshot &total) const {
+  for (size_t i = 0; i < counters.size(); ++i) {
+    total.counters[i] += counters[i].load(std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < latency.size(); ++i) {
+    latency[i].addTo(total.latency[i]);
+  }
+  for (size_t i = 0; i < commands.size(); ++i) {
+    commands[i].addTo(total.commands[i]);
+  }
+}
+
+/**
+ * @brief Fold an exiting thread's block into the retired totals
+ */
+ServerMetrics::ThreadSlot::~ThreadSlot() {
+  if (!metrics) {
+    return;
+  }
+  ServerMetrics &owner = ServerMetrics::getInstance();
+  std::lock_guard<std::mutex> lock(owner.mutex_);
+  metrics->addTo(owner.retired_);
+  for (auto it = owner.threads_.begin(); it != owner.threads_.end(); ++it) {
+    if (it->get() == metrics) {
+      owner.threads_.erase(it);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Get the singleton instance of the ServerMetrics class
+ *
+ * @return Reference to the singleton ServerMetrics instance
+ */
+ServerMetrics &ServerMetrics::getInstance() {
+  static ServerMetrics instance;
+  return instance;
+}
+
+ServerMetrics::ServerMetrics() : started_(std::chrono::steady_clock::now()) {
+  retired_.commands.resize(MAX_COMMANDS);
+}
+
+/**
+ * @brief Get the calling thread's block, creating it on first use
+ */
+ServerMetrics::ThreadMetrics &ServerMetrics::local() {
+  thread_local ThreadSlot slot;
+  if (!slot.metrics) {
+    auto metrics = std::make_unique<ThreadMetrics>();
+    slot.metrics = metrics.get();
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(std::move(metrics));
+  }
+  return *slot.metrics;
+}
+
+/**
+ * @brief Add to a counter
+ *
+ * @param counter The counter
+ * @param amount The amount to add
+ */
+void ServerMetrics::add(Counter counter, uint64_t amount) {
+  bump(local().counters[static_cast<size_t>(counter)], amount);
+}
+
+/**
+ * @brief Record the duration of an operation
+ *
+ * @param latency The operation
+ * @param duration How long it took
+ */
+void ServerMetrics::record(Latency latency,
+                           std::chrono::steady_clock::duration duration) {
+  local().latency[static_cast<size_t>(latency)].record(duration);
+}
+
+/**
+ * @brief Give a command its own latency histogram
+ *
+ * @param name The command name
+ * @return The command's slot, or NO_COMMAND if all are taken
+ */
+size_t ServerMetrics::registerCommand(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < command_names_.size(); ++i) {
+    if (command_names_[i] == name) {
+      return i;
+    }
+  }
+  if (command_names_.size() == MAX_COMMANDS) {
+    return NO_COMMAND;
+  }
+  command_names_.push_back(name);
+  return command_names_.size() - 1;
+}
+
+/**
+ * @brief Record how long a command took to handle
+ *
+ * @param slot Slot returned by registerCommand(); NO_COMMAND is ignored
+ * @param duration How long it took
+ */
+void ServerMetrics::recordCommand(
+    size_t slot, std::chrono::steady_clock::duration duration) {
+  if (slot < MAX_COMMANDS) {
+    local().commands[slot].record(duration);
+  }
+}
+
+/**
+ * @brief Sum the metrics of every thread, live and exited
+ *
+ * The blocks are read while their owners keep writing, so the totals are
+ * not an atomic cut, but each value is one that was actually stored.
+ *
+ * @return The totals
+ */
+MetricsSnapshot ServerMetrics::snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  MetricsSnapshot total = retired_;
+  for (const auto &metrics : threads_) {
+    metrics->addTo(total);
+  }
+  total.commands.resize(command_names_.size());
+  total.uptime = std::chrono::steady_clock::now() - started_;
+  return total;
+}
+
+/**
+ * @brief Get the names of the registered commands
+ *
+ * @return The names, indexed by slot
+ */
+std::vector<std::string> ServerMetrics::commandNames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return command_names_;
+}
+
+/**
+ * @brief Render metrics in the Prometheus text exposition format
+ *
+ * Commands that were never run are left out to keep the dump short.
+ *
+ * @param snapshot Metrics returned by snapshot()
+ * @param gauges Values to report alongside them
+ * @return The text, one sample per line
+ */
+std::string
+ServerMetrics::formatPrometheus(const MetricsSnapshot &snapshot,
+                                const std::vector<Gauge> &gauges) const {
+  std::string out;
+  out.reserve(16384);
+
+  out += "# HELP qrpm_uptime_seconds Time since the server started\n";
+  out += "# TYPE qrpm_uptime_seconds gauge\n";
+  out += "qrpm_uptime_seconds " +
+         promNumber(std::chrono::duration<double>(snapshot.uptime).count()) +
+         "\n";
+
+  for (size_t i = 0; i < snapshot.counters.size(); ++i) {
+    std::string name =
+        "qrpm_" + std::string(counterName(static_cast<Counter>(i))) + "_total";
+    out += "# TYPE " + name + " counter\n";
+    out += name + " " + std::to_string(snapshot.counters[i]) + "\n";
+  }
+
+  for (const auto &gauge : gauges) {
+    std::string name = "qrpm_" + gauge.name;
+    out += "# HELP " + name + " " + gauge.help + "\n";
+    out += "# TYPE " + name + (gauge.monotonic ? " counter\n" : " gauge\n");
+    out += name + " " + promNumber(gauge.value) + "\n";
+  }
+
+  out += "# HELP qrpm_operation_duration_seconds Time spent in server "
+         "operations\n";
+  out += "# TYPE qrpm_operation_duration_seconds histogram\n";
+  for (size_t i = 0; i < snapshot.latency.size(); ++i) {
+    appendPromHistogram(
+        out, "qrpm_operation_duration_seconds",
+        "operation=\"" +
+            std::string(latencyName(static_cast<Latency>(i))) + "\"",
+        snapshot.latency[i]);
+  }
+
+  std::vector<std::string> names = commandNames();
+  out += "# HELP qrpm_command_duration_seconds Time spent handling each "
+         "command\n";
+  out += "# TYPE qrpm_command_duration_seconds histogram\n";
+  for (size_t i = 0; i < snapshot.commands.size() && i < names.size(); ++i) {
+    if (snapshot.commands[i].count == 0) {
+      continue;
+    }
+    appendPromHistogram(out, "qrpm_command_duration_seconds",
+                        "command=\"" + names[i] + "\"", snapshot.commands[i]);
+  }
+  return out;
+}
+
+/**
+ * @brief Name of a counter as used by both output formats
+ */
+std::string_view ServerMetrics::counterName(Counter counter) {
+  switch (counter) {
+  case Counter::DevctlCalls:
+    return "devctl_calls";
+  case Counter::DevctlFailures:
+    return "devctl_failures";
+  case Counter::Requests:
+    return "requests";
+  case Counter::RequestErrors:
+    return "request_errors";
+  case Counter::BytesReceived:
+    return "bytes_received";
+  case Counter::BytesSent:
+    return "bytes_sent";
+  case Counter::HistorySamplesDropped:
+    return "history_samples_dropped";
+  case Counter::COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+/**
+ * @brief Name of a timed operation as used by both output formats
+ */
+std::string_view ServerMetrics::latencyName(Latency latency) {
+  switch (latency) {
+  case Latency::Collect:
+    return "collect";
+  case Latency::Refresh:
+    return "refresh";
+  case Latency::Membership:
+    return "membership";
+  case Latency::CoreLockWait:
+    return "core_lock_wait";
+  case Latency::HistoryLockWait:
+    return "history_lock_wait";
+  case Latency::COUNT:
+    break;
+  }
+  return "unknown";
+}
+} // namespace qnx
@@ -0,0 +1,209 @@
+/**
+ * @file SessionManager.cpp
+ * @brief Implementation of per-connection session state for QNX Remote
+ * Process Monitor
+ */
+
+#include "server/SessionManager.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+namespace qnx {
+namespace {
+/**
+ * @brief Generate an unguessable token: 128 bits from the system entropy
+ * source, hex encoded
+ */
+std::string generateToken() {
+  std::random_device entropy;
+  std::string token;
+  token.reserve(32);
+  char digits[9];
+  for (int i = 0; i < 4; ++i) {
+    std::snprintf(digits, sizeof(digits), "%08x",
+                  static_cast<uint32_t>(entropy()));
+    token += digits;
+  }
+  return token;
+}
+} // namespace
+
+/**
+ * @brief Get the singleton instance of the SessionManager class
+ *
+ * @return Reference to the singleton SessionManager instance
+ */
+SessionManager &SessionManager::getInstance() {
+  static SessionManager instance;
+  return instance;
+}
+
+/**
+ * @brief Get a client's session
+ *
+ * @param client_socket The client socket descriptor
+ * @return The session, or a default (unauthenticated, JSON) one
+ */
+Session SessionManager::getSession(int client_socket) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sessions_.find(client_socket);
+  return it != sessions_.end() ? it->second : Session{};
+}
+
+/**
+ * @brief Replace a client's session
+ *
+ * @param client_socket The client socket descriptor
+ * @param session The new session state
+ */
+void SessionManager::setSession(int client_socket, const Session &session) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sessions_[client_socket] = session;
+}
+
+/**
+ * @brief Forget a client's session
+ *
+ * @param client_socket The client socket descriptor
+ */
+void SessionManager::removeClient(int client_socket) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sessions_.find(client_socket);
+  if (it == sessions_.end()) {
+    return;
+  }
+  // The token outlives the connection so the client can resume with it
+  auto grant = tokens_.find(it->second.token);
+  if (grant != tokens_.end() && grant->second.client_socket == client_socket) {
+    grant->second.client_socket = -1;
+  }
+  sessions_.erase(it);
+}
+
+/**
+ * @brief Authenticate a connection and issue a session token for it
+ *
+ * @param client_socket The client socket descriptor
+ * @param session The session to store; its token is filled in
+ * @param username The user the session belongs to
+ * @return The new token
+ */
+std::string SessionManager::issueToken(int client_socket, Session &session,
+                                       const std::string &username) {
+  auto user = Authentication::FindUser(username);
+  TokenGrant grant{username, user ? user->hash : std::string(), -1, {}};
+  std::string token = generateToken();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  bindToken(client_socket, session, std::move(grant), token);
+  return token;
+}
+
+/**
+ * @brief Authenticate a connection with a previously issued token
+ *
+ * @param client_socket The client socket descriptor
+ * @param session The session to store; user type and token are filled in
+ * @param token The token presented by the client
+ * @return true if the token was valid and the session was stored
+ */
+bool SessionManager::redeemToken(int client_socket, Session &session,
+                                 const std::string &token) {
+  TokenGrant grant;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tokens_.find(token);
+    if (it == tokens_.end()) {
+      return false;
+    }
+    if (it->second.expires <= std::chrono::steady_clock::now()) {
+      tokens_.erase(it);
+      return false;
+    }
+    grant = it->second;
+  }
+
+  // The login file is consulted without holding the session lock
+  auto user = Authentication::FindUser(grant.username);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = tokens_.find(token);
+  if (it == tokens_.end()) {
+    return false; // Revoked meanwhile
+  }
+  if (!user || user->hash != grant.hash) {
+    tokens_.erase(it);
+    return false;
+  }
+  session.authenticated = true;
+  session.user_type = user->type;
+  bindToken(client_socket, session, std::move(grant), token);
+  return true;
+}
+
+/**
+ * @brief Store a token and its connection's session; mutex_ must be held
+ *
+ * Revokes any other token the connection held and deauthenticates any other
+ * connection the token was bound to, so one token serves one connection.
+ *
+ * @param client_socket The client socket descriptor
+ * @param session The session to store; its token is filled in
+ * @param grant The token's owner
+ * @param token The token
+ */
+void SessionManager::bindToken(int client_socket, Session &session,
+                               TokenGrant grant, std::string token) {
+  auto current = sessions_.find(client_socket);
+  if (current != sessions_.end() && !current->second.token.empty() &&
+      current->second.token != token) {
+    tokens_.erase(current->second.token);
+  }
+  if (grant.client_socket != -1 && grant.client_socket != client_socket) {
+    auto previous = sessions_.find(grant.client_socket);
+    if (previous != sessions_.end() && previous->second.token == token) {
+      previous->second.authenticated = false;
+      previous->second.token.clear();
+    }
+  }
+
+  grant.client_socket = client_socket;
+  grant.expires = std::chrono::steady_clock::now() + TOKEN_LIFETIME;
+  if (tokens_.find(token) == tokens_.end()) {
+    makeRoomForToken();
+  }
+  tokens_[token] = std::move(grant);
+  session.token = std::move(token);
+  sessions_[client_socket] = session;
+}
+
+/**
+ * @brief Drop expired tokens, and the one closest to expiry if still full;
+ * mutex_ must be held
+ */
+void SessionManager::makeRoomForToken() {
+  if (tokens_.size() < MAX_TOKENS) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  auto oldest = tokens_.end();
+  for (auto it = tokens_.begin(); it != tokens_.end();) {
+    if (it->second.expires <= now) {
+      it = tokens_.erase(it);
+      continue;
+    }
+    if (oldest == tokens_.end() ||
+        it->second.expires < oldest->second.expires) {
+      oldest = it;
+    }
+    ++it;
+  }
+  if (tokens_.size() >= MAX_TOKENS && oldest != tokens_.end()) {
+    auto owner = sessions_.find(oldest->second.client_socket);
+    if (owner != sessions_.end() && owner->second.token == oldest->first) {
+      owner->second.token.clear();
+    }
+    tokens_.erase(oldest);
+  }
+}
+} // namespace qnx
@@ -11,20 +11,24 @@
  * - Sending responses to clients and broadcasting messages
  *
  * The implementation is thread-safe and handles socket operations in an
- * asynchronous manner using a dedicated server thread and non-blocking I/O
- * operations.
+ * asynchronous manner using a dedicated poll()-driven I/O thread,
+ * non-blocking sockets and per-connection write queues. Requests are
+ * executed on the HandlerPool when it is running.
  */
 
 #include "server/SocketServer.hpp"
+#include "server/HandlerPool.hpp"
+#include "server/ServerMetrics.hpp"
 #include <algorithm>
 #include <arpa/inet.h>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <netinet/in.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <system_error>
 #include <unistd.h>
 #include <vector>
@@ -42,8 +46,35 @@ extern ssize_t recv(int sockfd, void *buf, size_t len, int flags);
 #endif
 
 namespace qnx {
-constexpr int MAX_CLIENTS = 30;
+constexpr int MAX_CLIENTS = 1024;
+constexpr int LISTEN_BACKLOG = 64;
 constexpr int BUFFER_SIZE = 4096;
+// A client that lets this much output pile up is dropped
+constexpr size_t MAX_QUEUED_BYTES = 16 * 1024 * 1024;
+// Stop reading from a client with this many requests awaiting the handler
+constexpr size_t MAX_PENDING_REQUESTS = 64;
+// Requests handled per pool job before yielding the worker
+constexpr size_t REQUESTS_PER_JOB = 16;
+// poll() timeout while a dispatch is waiting for room in the pool queue
+constexpr int DISPATCH_RETRY_MS = 10;
+// Queued segments gathered into one sendmsg() call
+constexpr size_t MAX_IOV = 16;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+namespace {
+/**
+ * @brief Put a descriptor into non-blocking mode
+ */
+bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+} // namespace
 
 /**
  * @brief Get the singleton instance of the SocketServer class
@@ -122,7 +153,7 @@ bool SocketServer::init(int port, MessageHandler handler) {
   }
 
   // Start listening for connections
-  if (listen(server_fd_, MAX_CLIENTS) < 0) {
+  if (listen(server_fd_, LISTEN_BACKLOG) < 0 || !setNonBlocking(server_fd_)) {
     std::error_code ec(errno, std::system_category());
     std::cerr << "Failed to listen on socket: " << ec.message() << std::endl;
     close(server_fd_);
@@ -130,6 +161,17 @@ bool SocketServer::init(int port, MessageHandler handler) {
     return false;
   }
 
+  // Self-pipe used by other threads to interrupt poll()
+  if (pipe(wake_fds_) < 0 || !setNonBlocking(wake_fds_[0]) ||
+      !setNonBlocking(wake_fds_[1])) {
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Failed to create wake-up pipe: " << ec.message()
+              << std::endl;
+    close(server_fd_);
+    server_fd_ = -1;
+    return false;
+  }
+
   // Start server thread
   running_ = true;
   server_thread_ = std::thread(&SocketServer::serverLoop, this);
@@ -152,118 +194,385 @@ void SocketServer::shutdown() {
     return; // Already shut down or not running
   }
 
-  // Close server socket to unblock accept()
+  // Interrupt poll() and wait for the I/O thread to finish
+  wake();
+  if (server_thread_.joinable()) {
+    server_thread_.join();
+  }
+
   if (server_fd_ != -1) {
     close(server_fd_);
     server_fd_ = -1;
   }
 
   // Close all client sockets
+  std::vector<int> closed;
   {
     std::lock_guard<std::mutex> lock(clients_mutex_);
-    for (int client_socket : client_sockets_) {
-      close(client_socket);
+    for (auto &pair : connections_) {
+      std::lock_guard<std::mutex> write_lock(pair.second->write_mutex);
+      pair.second->closed = true;
+      close(pair.first);
+      closed.push_back(pair.first);
+    }
+    connections_.clear();
+  }
+  if (disconnect_handler_) {
+    for (int client_socket : closed) {
+      disconnect_handler_(client_socket);
     }
-    client_sockets_.clear();
   }
 
-  // Join the server thread
-  if (server_thread_.joinable()) {
-    server_thread_.join();
+  for (int &fd : wake_fds_) {
+    if (fd != -1) {
+      close(fd);
+      fd = -1;
+    }
   }
 
   std::cout << "Socket server shut down." << std::endl;
 }
 
 /**
- * @brief Send a message to a specific client with length prefix
+ * @brief Send a message to a specific client
  *
- * Prepends a 4-byte network-order length header to the message before sending.
+ * Copies the message into a shared buffer and queues it; see the
+ * shared_ptr overload.
  *
  * @param client_socket The client socket descriptor
  * @param message The message string to send
- * @return true if the message was sent successfully, false otherwise
+ * @return true if the message was sent or queued, false otherwise
  */
 bool SocketServer::send(int client_socket, const std::string &message) {
-  if (::send(client_socket, message.c_str(), message.length(), 0) < 0) {
-    std::error_code ec(errno, std::system_category());
-    // Don't print error for broken pipe, it happens normally when client
-    // disconnects
-    if (ec.value() != EPIPE) {
-      std::cerr << "Failed to send message to client " << client_socket << ": "
-                << ec.message() << std::endl;
+  return enqueue(client_socket, std::make_shared<const std::string>(message));
+}
+
+/**
+ * @brief Send a shared message buffer to a specific client
+ *
+ * @param client_socket The client socket descriptor
+ * @param message The encoded message; shared, never copied
+ * @return true if the message was sent or queued, false otherwise
+ */
+bool SocketServer::send(int client_socket,
+                        std::shared_ptr<const std::string> message) {
+  return enqueue(client_socket, std::move(message));
+}
+
+/**
+ * @brief Get the framing a client negotiated with its first request
+ *
+ * @param client_socket The client socket descriptor
+ * @return The connection's framing, or Framing::Unknown
+ */
+Framing SocketServer::getFraming(int client_socket) {
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  auto it = connections_.find(client_socket);
+  return it != connections_.end() ? it->second->framing.load()
+                                  : Framing::Unknown;
+}
+
+/**
+ * @brief Get the traffic counters of every connected client
+ *
+ * @return One entry per connection, in no particular order
+ */
+std::vector<SocketServer::ClientTraffic> SocketServer::getClientTraffic() {
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  std::vector<ClientTraffic> traffic;
+  traffic.reserve(connections_.size());
+  for (const auto &entry : connections_) {
+    Connection &conn = *entry.second;
+    ClientTraffic client;
+    client.client_socket = entry.first;
+    client.bytes_received = conn.bytes_received.load();
+    {
+      std::lock_guard<std::mutex> write_lock(conn.write_mutex);
+      client.bytes_sent = conn.bytes_sent;
+      client.queued_bytes = conn.queued_bytes;
     }
-    return false;
+    traffic.push_back(client);
   }
-  return true;
+  return traffic;
+}
+
+/**
+ * @brief Get the number of connected clients
+ *
+ * @return The connection count
+ */
+size_t SocketServer::connectionCount() {
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  return connections_.size();
 }
 
 /**
  * @brief Broadcast a message to all connected clients
  *
- * Sends the same message to all currently connected clients.
- * Uses thread-safe access to the client list.
+ * Encodes nothing per client: the same buffer is queued on every connection.
  *
  * @param message The message to broadcast
  */
 void SocketServer::broadcast(const std::string &message) {
-  std::lock_guard<std::mutex> lock(clients_mutex_);
-  for (int client_socket : client_sockets_) {
-    send(client_socket, message);
+  auto shared = std::make_shared<const std::string>(message);
+  std::vector<int> sockets;
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    sockets.reserve(connections_.size());
+    for (const auto &pair : connections_) {
+      sockets.push_back(pair.first);
+    }
+  }
+  for (int client_socket : sockets) {
+    enqueue(client_socket, shared);
+  }
+}
+
+/**
+ * @brief Frame a buffer, queue it on a connection and try to send it
+ *
+ * The payload is framed the way the client frames its requests: a shared
+ * "\n" suffix for JSON framing, or a length header for length-prefixed
+ * framing. Framing bytes are queued as separate segments so the payload
+ * itself is never copied. If the connection's queue was empty the frame is
+ * written immediately; any remainder stays queued and the I/O thread is
+ * woken to watch for writability.
+ *
+ * @param client_socket The client socket descriptor
+ * @param message The buffer to send
+ * @return true if the message was sent or queued, false otherwise
+ */
+bool SocketServer::enqueue(int client_socket,
+                           std::shared_ptr<const std::string> message) {
+  if (!message || message->empty()) {
+    return true;
+  }
+
+  std::shared_ptr<Connection> conn;
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    auto it = connections_.find(client_socket);
+    if (it == connections_.end()) {
+      return false;
+    }
+    conn = it->second;
+  }
+  return enqueue(conn, std::move(message));
+}
+
+/**
+ * @brief Frame a buffer and queue it on a known connection
+ *
+ * Used for responses, which must reach the connection that sent the request
+ * even if its descriptor number has since been reused.
+ *
+ * @param conn The connection to send on
+ * @param message The buffer to send
+ * @return true if the message was sent or queued, false otherwise
+ */
+bool SocketServer::enqueue(const std::shared_ptr<Connection> &conn,
+                           std::shared_ptr<const std::string> message) {
+  if (!message || message->empty()) {
+    return true;
+  }
+
+  bool pending;
+  {
+    std::lock_guard<std::mutex> write_lock(conn->write_mutex);
+    if (conn->closed) {
+      return false;
+    }
+    if (conn->queued_bytes + message->size() > MAX_QUEUED_BYTES) {
+      std::cerr << "Client " << conn->fd
+                << " is not reading; dropping connection" << std::endl;
+      conn->closed = true; // the I/O thread reaps it
+      wake();
+      return false;
+    }
+    bool was_idle = conn->write_queue.empty();
+    Framing framing = conn->framing.load();
+    std::string prefix = framePrefix(framing, message->size());
+    if (!prefix.empty()) {
+      conn->queued_bytes += prefix.size();
+      conn->write_queue.push_back(
+          std::make_shared<const std::string>(std::move(prefix)));
+    }
+    conn->queued_bytes += message->size();
+    conn->write_queue.push_back(std::move(message));
+    if (auto suffix = frameSuffix(framing)) {
+      conn->queued_bytes += suffix->size();
+      conn->write_queue.push_back(std::move(suffix));
+    }
+    if (was_idle && !flushLocked(*conn)) {
+      conn->closed = true;
+      wake();
+      return false;
+    }
+    pending = !conn->write_queue.empty();
+  }
+
+  if (pending) {
+    wake(); // the I/O thread has to start polling for POLLOUT
+  }
+  return true;
+}
+
+/**
+ * @brief Write as much of the connection's queue as the socket accepts
+ *
+ * Up to MAX_IOV queued segments are written per sendmsg() call.
+ * Handles partial writes by remembering the offset into the front buffer.
+ *
+ * @param conn The connection to flush (write_mutex held)
+ * @return false if the connection failed and should be closed
+ */
+bool SocketServer::flushLocked(Connection &conn) {
+  struct iovec iov[MAX_IOV];
+  while (!conn.write_queue.empty()) {
+    // Gather the queued segments (frame header, payload, trailer, further
+    // messages) into one system call
+    size_t count = 0;
+    for (auto it = conn.write_queue.begin();
+         it != conn.write_queue.end() && count < MAX_IOV; ++it, ++count) {
+      const std::string &segment = **it;
+      size_t skip = count == 0 ? conn.write_offset : 0;
+      iov[count].iov_base = const_cast<char *>(segment.data() + skip);
+      iov[count].iov_len = segment.size() - skip;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    ssize_t sent = sendmsg(conn.fd, &msg, SEND_FLAGS);
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return true; // socket buffer full; wait for POLLOUT
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      std::error_code ec(errno, std::system_category());
+      // Don't print error for broken pipe, it happens normally when client
+      // disconnects
+      if (ec.value() != EPIPE) {
+        std::cerr << "Failed to send message to client " << conn.fd << ": "
+                  << ec.message() << std::endl;
+      }
+      return false;
+    }
+
+    // Retire every segment the kernel took in full
+    size_t remaining = static_cast<size_t>(sent);
+    conn.queued_bytes -= remaining;
+    conn.bytes_sent += remaining;
+    ServerMetrics::getInstance().add(Counter::BytesSent, remaining);
+    while (remaining > 0) {
+      size_t left = conn.write_queue.front()->size() - conn.write_offset;
+      if (remaining < left) {
+        conn.write_offset += remaining;
+        break;
+      }
+      remaining -= left;
+      conn.write_queue.pop_front();
+      conn.write_offset = 0;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Wake the I/O thread out of poll()
+ */
+void SocketServer::wake() {
+  if (wake_fds_[1] != -1) {
+    char byte = 1;
+    // A full pipe already guarantees a pending wake-up
+    (void)write(wake_fds_[1], &byte, 1);
   }
 }
 
 /**
- * @brief Main server loop that handles connections and messages
+ * @brief Main I/O loop
  *
- * This method runs in a separate thread and:
- * 1. Uses select() to monitor multiple socket file descriptors
- * 2. Accepts new client connections
- * 3. Receives and processes messages from existing clients
- * 4. Handles client disconnections
+ * Builds a pollfd set from the listening socket, the wake-up pipe and every
+ * connection (adding POLLOUT for connections with queued output), then
+ * services whatever became ready. The client lock is only held while
+ * copying the connection list, never while a handler runs.
  *
  * The loop continues until the server is shut down.
  */
 void SocketServer::serverLoop() {
-  fd_set read_fds;
-  int max_sd;
-  struct timeval tv = {1, 0}; // 1 second timeout for select
+  std::vector<pollfd> poll_fds;
+  std::vector<std::shared_ptr<Connection>> polled;
+
+  std::vector<std::shared_ptr<Connection>> to_dispatch;
 
   while (running_.load()) {
-    FD_ZERO(&read_fds);
-    if (server_fd_ == -1) { // Server socket closed during shutdown
-      break;
-    }
-    FD_SET(server_fd_, &read_fds);
-    max_sd = server_fd_;
+    poll_fds.clear();
+    polled.clear();
+    to_dispatch.clear();
+    poll_fds.push_back({server_fd_, POLLIN, 0});
+    poll_fds.push_back({wake_fds_[0], POLLIN, 0});
 
-    // Add client sockets to set
+    std::vector<int> to_close;
     {
       std::lock_guard<std::mutex> lock(clients_mutex_);
-      for (int sd : client_sockets_) {
-        FD_SET(sd, &read_fds);
-        if (sd > max_sd)
-          max_sd = sd;
+      for (const auto &pair : connections_) {
+        const auto &conn = pair.second;
+        short events = 0;
+        {
+          std::lock_guard<std::mutex> write_lock(conn->write_mutex);
+          if (conn->closed) {
+            to_close.push_back(pair.first);
+            continue;
+          }
+          if (!conn->write_queue.empty()) {
+            events |= POLLOUT;
+          }
+        }
+        {
+          std::lock_guard<std::mutex> request_lock(conn->request_mutex);
+          bool idle = !conn->dispatching;
+          if (idle && conn->peer_closed && conn->requests.empty()) {
+            to_close.push_back(pair.first);
+            continue;
+          }
+          if (idle && !conn->requests.empty()) {
+            to_dispatch.push_back(conn); // the pool queue was full earlier
+          }
+          // Back-pressure: leave the backlog in the kernel socket buffer
+          conn->read_paused = conn->requests.size() >= MAX_PENDING_REQUESTS;
+          if (!conn->read_paused && !conn->peer_closed) {
+            events |= POLLIN;
+          }
+        }
+        if (events != 0) {
+          poll_fds.push_back({pair.first, events, 0});
+          polled.push_back(conn);
+        }
       }
     }
+    for (int sd : to_close) {
+      closeConnection(sd);
+    }
 
-    // Reset timeout
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
+    bool retry = false;
+    for (const auto &conn : to_dispatch) {
+      retry |= !dispatch(conn);
+    }
 
-    // Wait for activity on any of the sockets
-    int activity = select(max_sd + 1, &read_fds, nullptr, nullptr, &tv);
+    int activity = poll(poll_fds.data(), poll_fds.size(),
+                        retry ? DISPATCH_RETRY_MS : 1000);
 
     if (!running_.load())
-      break; // Check again after select
+      break; // Check again after poll
 
     if (activity < 0) {
-      // select error (e.g., EINTR)
+      // poll error (e.g., EINTR)
       if (errno == EINTR)
         continue;
       std::error_code ec(errno, std::system_category());
-      std::cerr << "Select error: " << ec.message() << std::endl;
-      // Consider more robust error handling, maybe break the loop
+      std::cerr << "Poll error: " << ec.message() << std::endl;
       continue;
     }
 
@@ -272,129 +581,324 @@ void SocketServer::serverLoop() {
       continue;
     }
 
+    // Drain the wake-up pipe; it only exists to interrupt poll()
+    if (poll_fds[1].revents & POLLIN) {
+      char drain[64];
+      while (read(wake_fds_[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+
     // Check for incoming connections
-    if (FD_ISSET(server_fd_, &read_fds)) {
-      struct sockaddr_in client_address;
-      socklen_t client_len = sizeof(client_address);
-      int new_socket =
-          accept(server_fd_, (struct sockaddr *)&client_address, &client_len);
-
-      if (!running_.load()) { // Check if shutdown was initiated during accept
-        if (new_socket >= 0)
-          close(new_socket);
-        break;
+    if (poll_fds[0].revents & POLLIN) {
+      acceptConnections();
+    }
+
+    // Service client sockets
+    for (size_t i = 0; i < polled.size(); ++i) {
+      const pollfd &pfd = poll_fds[i + 2];
+      const auto &conn = polled[i];
+      bool keep = true;
+
+      if (pfd.revents & POLLOUT) {
+        std::lock_guard<std::mutex> write_lock(conn->write_mutex);
+        keep = flushLocked(*conn);
+      }
+      if (keep && (pfd.events & POLLIN) &&
+          (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+        keep = handleClient(conn);
       }
+      if (!keep) {
+        closeConnection(pfd.fd);
+      }
+    }
+  }
+  std::cout << "Server loop terminated." << std::endl;
+}
 
-      if (new_socket < 0) {
-        // Accept can fail if server_fd_ was closed
-        if (errno == EBADF)
-          break;
-        std::error_code ec(errno, std::system_category());
-        std::cerr << "Failed to accept new connection: " << ec.message()
-                  << std::endl;
+/**
+ * @brief Accept all pending connections on the listening socket
+ *
+ * New sockets are switched to non-blocking mode and registered with their
+ * own connection state.
+ */
+void SocketServer::acceptConnections() {
+  while (true) {
+    struct sockaddr_in client_address;
+    socklen_t client_len = sizeof(client_address);
+    int new_socket =
+        accept(server_fd_, (struct sockaddr *)&client_address, &client_len);
+
+    if (new_socket < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return; // No more pending connections
+      if (errno == EINTR)
         continue;
-      }
+      std::error_code ec(errno, std::system_category());
+      std::cerr << "Failed to accept new connection: " << ec.message()
+                << std::endl;
+      return;
+    }
 
-      // Get client IP and port
-      char client_ip[INET_ADDRSTRLEN];
-      inet_ntop(AF_INET, &client_address.sin_addr, client_ip, INET_ADDRSTRLEN);
-      int client_port = ntohs(client_address.sin_port);
-
-      std::cout << "New connection from " << client_ip << ":" << client_port
-                << ", socket fd is " << new_socket << std::endl;
-
-      // Add new client socket to list if there's room
-      {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        if (client_sockets_.size() < MAX_CLIENTS) {
-          client_sockets_.push_back(new_socket);
-        } else {
-          std::cerr << "Maximum clients reached. Rejecting connection from "
-                    << client_ip << std::endl;
-          close(new_socket);
-          continue;
-        }
-      }
+    // Get client IP and port
+    char client_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &client_address.sin_addr, client_ip, INET_ADDRSTRLEN);
+    int client_port = ntohs(client_address.sin_port);
+
+    if (!setNonBlocking(new_socket)) {
+      std::error_code ec(errno, std::system_category());
+      std::cerr << "Failed to make socket non-blocking: " << ec.message()
+                << std::endl;
+      close(new_socket);
+      continue;
     }
 
-    // Check for activity on client sockets
-    std::vector<int> clients_to_remove;
-    {
-      std::lock_guard<std::mutex> lock(clients_mutex_);
-      for (int sd : client_sockets_) {
-        if (FD_ISSET(sd, &read_fds)) {
-          // Use handleClient to process this client's communication
-          handleClient(sd);
-
-          // Check if client is still connected after handling
-          char buffer[1];
-          if (recv(sd, buffer, 1, MSG_PEEK | MSG_DONTWAIT) <= 0 &&
-              errno != EAGAIN && errno != EWOULDBLOCK) {
-            // Connection closed or error
-            clients_to_remove.push_back(sd);
-          }
-        }
-      }
+    std::cout << "New connection from " << client_ip << ":" << client_port
+              << ", socket fd is " << new_socket << std::endl;
 
-      // Remove disconnected clients
-      for (int sd_to_remove : clients_to_remove) {
-        client_sockets_.erase(std::remove(client_sockets_.begin(),
-                                          client_sockets_.end(), sd_to_remove),
-                              client_sockets_.end());
-      }
+    // Add new client socket to list if there's room
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    if (connections_.size() >= MAX_CLIENTS) {
+      std::cerr << "Maximum clients reached. Rejecting connection from "
+                << client_ip << std::endl;
+      close(new_socket);
+      continue;
     }
+    auto conn = std::make_shared<Connection>();
+    conn->fd = new_socket;
+    connections_.emplace(new_socket, std::move(conn));
   }
-  std::cout << "Server loop terminated." << std::endl;
 }
 
 /**
  * @brief Handle communication with a specific client
  *
- * Receives messages from the client, processes them through the message
- * handler, and sends back any responses. Handles errors and client
- * disconnections.
+ * Drains everything currently readable from the socket into the
+ * connection's reassembly buffer, queues each complete frame as a request
+ * and hands the queue to the handler. A client that closes its end still
+ * gets responses to the requests it sent first; the connection is closed
+ * once they have been handled.
  *
- * @param client_socket The socket descriptor for the client connection
+ * @param conn The connection to read from
+ * @return false if the connection should be closed now
  */
-void SocketServer::handleClient(int client_socket) {
+bool SocketServer::handleClient(const std::shared_ptr<Connection> &conn) {
   char buffer[BUFFER_SIZE];
-  memset(buffer, 0, BUFFER_SIZE);
-  ssize_t valread = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+  bool peer_closed = false;
+  uint64_t received = 0;
+
+  while (true) {
+    ssize_t valread = recv(conn->fd, buffer, BUFFER_SIZE, 0);
+    if (valread > 0) {
+      conn->decoder.append(buffer, static_cast<size_t>(valread));
+      received += static_cast<uint64_t>(valread);
+      continue;
+    }
+    if (valread == 0) {
+      peer_closed = true;
+      break;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
 
-  if (valread > 0) {
-    // Process message
-    buffer[valread] = '\0';
-    std::string message(buffer);
+    std::error_code ec(errno, std::system_category());
+    std::cerr << "Error reading from client " << conn->fd << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+  conn->bytes_received.fetch_add(received, std::memory_order_relaxed);
+  ServerMetrics::getInstance().add(Counter::BytesReceived, received);
+
+  {
+    std::lock_guard<std::mutex> request_lock(conn->request_mutex);
+    std::string message;
+    while (conn->decoder.next(message)) {
+      conn->framing.store(conn->decoder.framing());
+      conn->requests.push_back(std::move(message));
+    }
+    conn->peer_closed = peer_closed;
+  }
+
+  if (conn->decoder.failed()) {
+    std::cerr << "Framing error from client " << conn->fd
+              << "; closing connection" << std::endl;
+    return false;
+  }
+
+  // Retried by serverLoop() if the pool queue is full
+  dispatch(conn);
+
+  if (peer_closed) {
+    // Client disconnected
+    char client_ip[INET_ADDRSTRLEN];
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    if (getpeername(conn->fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+      inet_ntop(AF_INET, &addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+      std::cout << "Client disconnected: " << client_ip << " on socket fd "
+                << conn->fd << std::endl;
+    }
+    std::lock_guard<std::mutex> request_lock(conn->request_mutex);
+    return conn->dispatching || !conn->requests.empty();
+  }
+  return true;
+}
+
+/**
+ * @brief Hand a connection's queued requests to the handler
+ *
+ * At most one job per connection is in flight; it keeps processing until
+ * the connection's queue is empty, which keeps responses in request order.
+ * Without a running HandlerPool the requests are handled inline.
+ *
+ * @param conn The connection with pending requests
+ * @return false if the pool queue is full and the dispatch must be retried
+ */
+bool SocketServer::dispatch(const std::shared_ptr<Connection> &conn) {
+  {
+    std::lock_guard<std::mutex> request_lock(conn->request_mutex);
+    if (conn->dispatching || conn->requests.empty()) {
+      return true;
+    }
+    conn->dispatching = true;
+  }
+
+  HandlerPool &pool = HandlerPool::getInstance();
+  if (!pool.isRunning()) {
+    while (processRequests(conn)) {
+    }
+    return true;
+  }
+  if (!pool.trySubmit([this, conn] { handlerJob(conn); })) {
+    std::lock_guard<std::mutex> request_lock(conn->request_mutex);
+    conn->dispatching = false;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief HandlerPool job: process a connection's requests in batches
+ *
+ * Between batches the job requeues itself behind other connections' work.
+ * If the queue is full it simply carries on, since it already holds a
+ * worker.
+ *
+ * @param conn The connection that owns the requests
+ */
+void SocketServer::handlerJob(const std::shared_ptr<Connection> &conn) {
+  while (processRequests(conn)) {
+    if (HandlerPool::getInstance().trySubmit(
+            [this, conn] { handlerJob(conn); })) {
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Run the handler for a batch of a connection's requests, in order
+ *
+ * Responses are queued on the connection object itself, not looked up by
+ * descriptor. Reads are resumed once the backlog falls below the
+ * back-pressure limit, and ownership of the connection is released when the
+ * queue is empty.
+ *
+ * @param conn The connection that owns the requests
+ * @return true if requests remain and the caller still owns the connection
+ */
+bool SocketServer::processRequests(const std::shared_ptr<Connection> &conn) {
+  std::string message;
+  for (size_t handled = 0; handled < REQUESTS_PER_JOB; ++handled) {
+    bool closed;
+    {
+      std::lock_guard<std::mutex> write_lock(conn->write_mutex);
+      closed = conn->closed;
+    }
+
+    bool resume = false;
+    {
+      std::lock_guard<std::mutex> request_lock(conn->request_mutex);
+      if (closed) {
+        conn->requests.clear();
+      }
+      if (conn->requests.empty()) {
+        conn->dispatching = false;
+        if (conn->peer_closed) {
+          wake(); // let the I/O thread close it
+        }
+        return false;
+      }
+      message = std::move(conn->requests.front());
+      conn->requests.pop_front();
+      if (conn->read_paused && conn->requests.size() < MAX_PENDING_REQUESTS) {
+        conn->read_paused = false;
+        resume = true;
+      }
+    }
+    if (resume) {
+      wake(); // the I/O thread has to start polling for POLLIN again
+    }
 
-    // Call the message handler (could be in a separate thread for complex
-    // processing)
     if (message_handler_) {
       try {
-        std::string response = message_handler_(client_socket, message);
+        std::string response = message_handler_(conn->fd, message);
         if (!response.empty()) {
-          send(client_socket, response);
+          enqueue(conn,
+                  std::make_shared<const std::string>(std::move(response)));
         }
       } catch (const std::exception &e) {
-        std::cerr << "Error processing message from client " << client_socket
+        std::cerr << "Error processing message from client " << conn->fd
                   << ": " << e.what() << std::endl;
       }
     }
-  } else {
-    // Client disconnected or error
-    char client_ip[INET_ADDRSTRLEN];
-    struct sockaddr_in addr;
-    socklen_t addr_len = sizeof(addr);
+  }
+  return true;
+}
 
-    if (getpeername(client_socket, (struct sockaddr *)&addr, &addr_len) == 0) {
-      inet_ntop(AF_INET, &addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-      std::cout << "Client disconnected: " << client_ip << " on socket fd "
-                << client_socket << std::endl;
-    } else {
-      std::error_code ec(errno, std::system_category());
-      std::cerr << "Error reading from client " << client_socket << ": "
-                << ec.message() << std::endl;
+/**
+ * @brief Remove a connection and close its socket
+ *
+ * Marks the connection closed under its write lock first, so concurrent
+ * senders never write to a descriptor number that has been reused. While a
+ * handler job still owns the connection the descriptor stays open: the
+ * handler may yet record session or subscription state under its number,
+ * and closing it now would let the next client accept()ed inherit that
+ * state. The pending requests are dropped instead, and the job wakes the
+ * I/O thread to finish the close when it releases the connection.
+ *
+ * @param client_socket The socket descriptor of the connection
+ */
+void SocketServer::closeConnection(int client_socket) {
+  std::shared_ptr<Connection> conn;
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    auto it = connections_.find(client_socket);
+    if (it == connections_.end()) {
+      return;
     }
+    {
+      std::lock_guard<std::mutex> write_lock(it->second->write_mutex);
+      it->second->closed = true;
+    }
+    {
+      std::lock_guard<std::mutex> request_lock(it->second->request_mutex);
+      if (it->second->dispatching) {
+        it->second->requests.clear();
+        it->second->peer_closed = true; // the job wakes us when it is done
+        return;
+      }
+    }
+    conn = std::move(it->second);
+    connections_.erase(it);
+  }
+  {
+    std::lock_guard<std::mutex> write_lock(conn->write_mutex);
     close(client_socket);
   }
+  if (disconnect_handler_) {
+    disconnect_handler_(client_socket);
+  }
 }
 } // namespace qnx
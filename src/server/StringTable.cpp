@@ -0,0 +1,111 @@
+/**
+ * @file StringTable.cpp
+ * @brief Implementation of interned process names for QNX Remote Process
+ * Monitor
+ */
+
+#include "server/StringTable.hpp"
+#include "server/JsonWriter.hpp"
+#include <cstdint>
+#include <mutex>
+
+namespace qnx {
+/**
+ * @brief Get the singleton instance of the StringTable class
+ *
+ * @return Reference to the singleton StringTable instance
+ */
+StringTable &StringTable::getInstance() {
+  static StringTable instance;
+  return instance;
+}
+
+/**
+ * @brief Constructor: id 0 is reserved for the empty string
+ */
+StringTable::StringTable() {
+  entries_.emplace_back();
+  ids_.emplace(std::string_view(entries_.front().text), 0);
+}
+
+/**
+ * @brief Get the entry for a string, adding it if it is new
+ *
+ * @param text The string
+ * @return The entry; its views stay valid for the process lifetime
+ */
+InternedString StringTable::intern(std::string_view text) {
+  return *tryIntern(text, SIZE_MAX);
+}
+
+/**
+ * @brief Get the entry for a string, adding it only if the table stays
+ * within a size bound
+ *
+ * Known strings only take the lock shared, so collector workers resolving
+ * names at the same time do not serialise on the common path.
+ *
+ * @param text The string
+ * @param max_bytes Bound on bytes(), checked before a new entry is added
+ * @return The entry, or std::nullopt if text is new and would not fit
+ */
+std::optional<InternedString> StringTable::tryIntern(std::string_view text,
+                                                     size_t max_bytes) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(text);
+    if (it != ids_.end()) {
+      return handle(it->second);
+    }
+    if (text.size() > max_bytes || bytes_ > max_bytes - text.size()) {
+      return std::nullopt;
+    }
+  }
+
+  // Escape outside the lock; the result is dropped if another thread wins
+  Entry entry;
+  entry.text = std::string(text);
+  if (needsJsonEscape(text)) {
+    entry.escaped = jsonEscape(text);
+  }
+  size_t size = entry.text.size() + entry.escaped.size();
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto it = ids_.find(text);
+  if (it != ids_.end()) {
+    return handle(it->second);
+  }
+  if (size > max_bytes || bytes_ > max_bytes - size) {
+    return std::nullopt;
+  }
+  auto id = static_cast<uint32_t>(entries_.size());
+  bytes_ += size;
+  entries_.push_back(std::move(entry));
+  ids_.emplace(std::string_view(entries_.back().text), id);
+  return handle(id);
+}
+
+/**
+ * @brief Number of distinct strings interned
+ */
+size_t StringTable::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return entries_.size() - 1; // Not counting the empty string
+}
+
+/**
+ * @brief Bytes of string data held, escaped forms included
+ */
+size_t StringTable::bytes() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return bytes_;
+}
+
+/**
+ * @brief Build the handle of an entry; called with the lock held
+ */
+InternedString StringTable::handle(uint32_t id) const {
+  const Entry &entry = entries_[id];
+  return {id, entry.text, entry.escaped};
+}
+} // namespace qnx
@@ -0,0 +1,407 @@
+/**
+ * @file SubscriptionManager.cpp
+ * @brief Implementation of server-push subscriptions for QNX Remote Process
+ * Monitor
+ *
+ * Due subscriptions are grouped by scope under the lock; encoding and
+ * sending happen after it is released, so new subscriptions never wait on a
+ * push in progress.
+ */
+
+#include "server/SubscriptionManager.hpp"
+#include "server/JsonWriter.hpp"
+#include "server/ProcessDelta.hpp"
+#include "server/ProcessEvents.hpp"
+#include "server/ProcessGroup.hpp"
+#include "server/SocketServer.hpp"
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <utility>
+
+namespace qnx {
+namespace {
+// A push may run this much early so jitter in the stats loop does not make
+// a subscription skip a whole cycle
+constexpr std::chrono::milliseconds SCHEDULE_SLACK{100};
+
+/**
+ * @brief Whether a scope covers a process, judged by one snapshot
+ *
+ * @param subscription Any subscription with the scope
+ * @param snapshot Snapshot whose group membership decides group scopes
+ * @param pid The process
+ */
+bool scopeCovers(const Subscription &subscription,
+                 const ProcessSnapshot &snapshot, pid_t pid) {
+  switch (subscription.scope) {
+  case SubscriptionScope::Pids:
+    return std::binary_search(subscription.pids.begin(),
+                              subscription.pids.end(), pid);
+  case SubscriptionScope::Group: {
+    const auto &membership = snapshot.group_membership;
+    if (!membership) {
+      return false;
+    }
+    auto it = membership->find(pid);
+    return it != membership->end() && it->second == subscription.group_id;
+  }
+  default:
+    return true;
+  }
+}
+
+const char *scopeName(SubscriptionScope scope) {
+  switch (scope) {
+  case SubscriptionScope::Pids:
+    return "pids";
+  case SubscriptionScope::Group:
+    return "group";
+  default:
+    return "all";
+  }
+}
+} // namespace
+
+/**
+ * @brief Get the singleton instance of the SubscriptionManager class
+ *
+ * @return Reference to the singleton SubscriptionManager instance
+ */
+SubscriptionManager &SubscriptionManager::getInstance() {
+  static SubscriptionManager instance;
+  return instance;
+}
+
+/**
+ * @brief Register a subscription
+ *
+ * @param subscription The subscription; its id is ignored
+ * @return The ID assigned to the subscription
+ */
+int SubscriptionManager::subscribe(Subscription subscription) {
+  if (subscription.interval < MIN_INTERVAL) {
+    subscription.interval = MIN_INTERVAL;
+  }
+  std::sort(subscription.pids.begin(), subscription.pids.end());
+  subscription.pids.erase(
+      std::unique(subscription.pids.begin(), subscription.pids.end()),
+      subscription.pids.end());
+  subscription.next_due = {};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  subscription.id = next_id_++;
+  int id = subscription.id;
+  subscriptions_.emplace(id, std::move(subscription));
+  return id;
+}
+
+/**
+ * @brief Remove one of a client's subscriptions
+ *
+ * @param client_socket The client that owns the subscription
+ * @param subscription_id The subscription to remove
+ * @return true if the subscription existed and belonged to the client
+ */
+bool SubscriptionManager::unsubscribe(int client_socket,
+                                      int subscription_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = subscriptions_.find(subscription_id);
+  if (it == subscriptions_.end() ||
+      it->second.client_socket != client_socket) {
+    return false;
+  }
+  subscriptions_.erase(it);
+  return true;
+}
+
+/**
+ * @brief Remove every subscription of a client
+ *
+ * @param client_socket The client socket descriptor
+ * @return Number of subscriptions removed
+ */
+size_t SubscriptionManager::removeClient(int client_socket) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t removed = 0;
+  for (auto it = subscriptions_.begin(); it != subscriptions_.end();) {
+    if (it->second.client_socket == client_socket) {
+      it = subscriptions_.erase(it);
+      ++removed;
+    } else {
+      ++it;
+    }
+  }
+  return removed;
+}
+
+/**
+ * @brief Get the number of active subscriptions
+ * @return The subscription count
+ */
+size_t SubscriptionManager::count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return subscriptions_.size();
+}
+
+/**
+ * @brief Push a snapshot to every subscription that is due
+ *
+ * @param snapshot The snapshot that was just published
+ */
+void SubscriptionManager::publish(const ProcessSnapshotPtr &snapshot) {
+  if (!snapshot) {
+    return;
+  }
+
+  struct Fanout {
+    Subscription scope;       ///< Any subscription with this scope
+    std::vector<int> clients; ///< Every due subscriber
+  };
+  std::map<std::string, Fanout> due;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = snapshot->timestamp;
+    for (auto &pair : subscriptions_) {
+      Subscription &sub = pair.second;
+      if (now + SCHEDULE_SLACK < sub.next_due) {
+        continue;
+      }
+      sub.next_due = now + sub.interval;
+      std::string key = scopeKey(sub);
+      auto it = due.find(key);
+      if (it == due.end()) {
+        it = due.emplace(std::move(key), Fanout{sub, {}}).first;
+      }
+      it->second.clients.push_back(sub.client_socket);
+      sub.last_generation = snapshot->generation; // The next delta's base
+    }
+  }
+
+  SocketServer &server = SocketServer::getInstance();
+  for (const auto &pair : due) {
+    const Fanout &fanout = pair.second;
+    auto payload = std::make_shared<const std::string>(
+        encodeUpdate(*snapshot, fanout.scope));
+    // A client with several identical subscriptions gets one copy
+    std::set<int> clients(fanout.clients.begin(), fanout.clients.end());
+    for (int client_socket : clients) {
+      server.send(client_socket, payload);
+    }
+  }
+}
+
+/**
+ * @brief Push process creations and exits to subscriptions that want them
+ *
+ * @param before The previously published snapshot
+ * @param after The snapshot just published
+ */
+void SubscriptionManager::publishLifecycle(const ProcessSnapshot &before,
+                                           const ProcessSnapshot &after) {
+  struct Fanout {
+    Subscription scope;       ///< Any subscription with this scope
+    std::vector<int> clients; ///< Every subscriber to lifecycle events
+  };
+  std::map<std::string, Fanout> wanted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &pair : subscriptions_) {
+      const Subscription &sub = pair.second;
+      if (!sub.lifecycle) {
+        continue;
+      }
+      auto it = wanted.find(scopeKey(sub));
+      if (it == wanted.end()) {
+        it = wanted.emplace(scopeKey(sub), Fanout{sub, {}}).first;
+      }
+      it->second.clients.push_back(sub.client_socket);
+    }
+  }
+  if (wanted.empty()) {
+    return;
+  }
+
+  ProcessLifecycle lifecycle = diffSnapshots(before, after);
+  if (lifecycle.created.empty() && lifecycle.exited.empty()) {
+    return;
+  }
+  SocketServer &server = SocketServer::getInstance();
+  for (const auto &pair : wanted) {
+    const Fanout &fanout = pair.second;
+    std::string encoded =
+        encodeLifecycle(before, after, lifecycle, fanout.scope);
+    if (encoded.empty()) {
+      continue;
+    }
+    auto payload = std::make_shared<const std::string>(std::move(encoded));
+    std::set<int> clients(fanout.clients.begin(), fanout.clients.end());
+    for (int client_socket : clients) {
+      server.send(client_socket, payload);
+    }
+  }
+}
+
+/**
+ * @brief Build the key shared by subscriptions that get the same payload
+ *
+ * @param subscription The subscription
+ * @return "all", "group:<id>", "pids:<pid>,<pid>,..." or, for delta
+ * subscriptions, "delta:<encoding>:<base generation>"
+ */
+std::string SubscriptionManager::scopeKey(const Subscription &subscription) {
+  if (subscription.delta) {
+    return std::string(subscription.encoding == WireEncoding::Binary
+                           ? "delta:binary:"
+                           : "delta:json:") +
+           std::to_string(subscription.last_generation);
+  }
+  switch (subscription.scope) {
+  case SubscriptionScope::Group:
+    return "group:" + std::to_string(subscription.group_id);
+  case SubscriptionScope::Pids: {
+    std::string key = "pids:";
+    for (pid_t pid : subscription.pids) {
+      key += std::to_string(pid);
+      key += ',';
+    }
+    return key;
+  }
+  default:
+    return "all";
+  }
+}
+
+/**
+ * @brief Encode the update for one scope
+ *
+ * PIDs requested by a pids or group scope that are not in the snapshot are
+ * listed under "missing" so clients can drop them. Delta subscriptions get
+ * the changes since the generation they were last pushed, in the encoding
+ * they logged in with.
+ *
+ * @param snapshot The snapshot to encode
+ * @param subscription Any subscription with the scope to encode
+ * @return The encoded payload
+ */
+std::string SubscriptionManager::encodeUpdate(
+    const ProcessSnapshot &snapshot, const Subscription &subscription) {
+  std::string payload;
+  if (subscription.delta) {
+    ProcessSnapshotPtr base;
+    if (subscription.last_generation > 0) {
+      base = ProcessCore::getInstance().getSnapshot(
+          subscription.last_generation);
+    }
+    encodeProcessDelta(payload, snapshot, base.get(), subscription.encoding,
+                       true);
+    return payload;
+  }
+
+  JsonWriter json(payload);
+  json.beginObject()
+      .addString("event", "process_update")
+      .addString("scope", scopeName(subscription.scope));
+  if (subscription.scope == SubscriptionScope::Group) {
+    json.addInt("group_id", subscription.group_id);
+  }
+  json.addUInt("generation", snapshot.generation);
+
+  std::vector<pid_t> missing;
+  json.beginArray("processes");
+  if (subscription.scope == SubscriptionScope::All) {
+    payload.reserve(128 + snapshot.processes.size() * 112);
+    for (const auto &info : snapshot.processes) {
+      json.addProcessRow(info);
+    }
+  } else {
+    std::vector<pid_t> pids = subscription.pids;
+    if (subscription.scope == SubscriptionScope::Group) {
+      auto members = ProcessGroup::getInstance().getProcessesInGroup(
+          subscription.group_id);
+      pids.assign(members.begin(), members.end());
+    }
+    for (pid_t pid : pids) {
+      if (const ProcessInfo *info = snapshot.find(pid)) {
+        json.addProcessRow(*info);
+      } else {
+        missing.push_back(pid);
+      }
+    }
+  }
+  json.endArray();
+
+  if (!missing.empty()) {
+    json.beginArray("missing");
+    for (pid_t pid : missing) {
+      json.addInt({}, pid);
+    }
+    json.endArray();
+  }
+  json.endObject();
+  return payload;
+}
+
+/**
+ * @brief Encode the lifecycle events one scope covers
+ *
+ * Created processes are matched against the new snapshot and exited ones
+ * against the old one. When procnto notifications are being received, the
+ * running notification counts are included; they also count processes that
+ * exited too quickly to be listed.
+ *
+ * @param before The previously published snapshot
+ * @param after The snapshot just published
+ * @param lifecycle The changes between them
+ * @param subscription Any subscription with the scope to encode
+ * @return The encoded JSON payload, or an empty string if the scope covers
+ * none of the changes
+ */
+std::string SubscriptionManager::encodeLifecycle(
+    const ProcessSnapshot &before, const ProcessSnapshot &after,
+    const ProcessLifecycle &lifecycle, const Subscription &subscription) {
+  std::string payload;
+  JsonWriter json(payload);
+  json.beginObject()
+      .addString("event", "process_lifecycle")
+      .addString("scope", scopeName(subscription.scope));
+  if (subscription.scope == SubscriptionScope::Group) {
+    json.addInt("group_id", subscription.group_id);
+  }
+  json.addUInt("generation", after.generation);
+
+  bool any = false;
+  json.beginArray("created");
+  for (pid_t pid : lifecycle.created) {
+    if (!scopeCovers(subscription, after, pid)) {
+      continue;
+    }
+    const ProcessInfo &info = *after.find(pid);
+    json.beginObject()
+        .addInt("pid", info.pid)
+        .addInt("parent_pid", info.parent_pid)
+        .addString("name", info.name)
+        .endObject();
+    any = true;
+  }
+  json.endArray().beginArray("exited");
+  for (pid_t pid : lifecycle.exited) {
+    if (scopeCovers(subscription, before, pid)) {
+      json.addInt({}, pid);
+      any = true;
+    }
+  }
+  json.endArray();
+  if (!any) {
+    return {};
+  }
+
+  ProcessEvents &events = ProcessEvents::getInstance();
+  if (events.isRunning()) {
+    json.addUInt("notified_created", events.createdCount())
+        .addUInt("notified_exited", events.exitedCount());
+  }
+  json.endObject();
+  return payload;
+}
+} // namespace qnx
@@ -12,23 +12,38 @@
  */
 
 #include "shared/Authenticator.hpp"
+#include "server/FleetGateway.hpp"
+#include "server/HandlerPool.hpp"
+#include "server/HistoryStore.hpp"
 #include "server/JsonHandler.hpp" // Include the new handler
 #include "server/ProcessControl.hpp"
 #include "server/ProcessCore.hpp"
+#include "server/ProcessEvents.hpp"
 #include "server/ProcessGroup.hpp"
 #include "server/ProcessHistory.hpp"
+#include "server/ProcessSource.hpp"
+#include "server/ReplayProcessSource.hpp"
+#include "server/SamplingScheduler.hpp"
+#include "server/SessionManager.hpp"
 #include "server/SocketServer.hpp"
+#include "server/SubscriptionManager.hpp"
 
 #include <atomic>
 #include <chrono>
 #include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip> // For std::setw, std::fixed, std::setprecision
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <sys/json.h> // QNX native JSON library
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
 // For chrono literals like 500ms
@@ -50,60 +65,371 @@ void signalHandler(int signal) {
   }
 }
 
+/**
+ * @brief Push a new snapshot, and the processes created and exited since the
+ * previous one, to subscribed clients
+ *
+ * @param snapshot The snapshot just published
+ * @param previous The snapshot pushed before it; updated to snapshot
+ */
+void publishToSubscribers(const qnx::ProcessSnapshotPtr &snapshot,
+                          qnx::ProcessSnapshotPtr &previous) {
+  auto &subscriptions = qnx::SubscriptionManager::getInstance();
+  subscriptions.publish(snapshot);
+  if (previous) {
+    subscriptions.publishLifecycle(*previous, *snapshot);
+  }
+  previous = snapshot;
+}
+
 /**
  * @brief Background thread for updating process statistics and history
+ *
+ * Paced by the SamplingScheduler: full collections feed history, groups and
+ * subscribers, while fast tier passes only refresh their rows and push them
+ * and membership passes only add created and drop exited processes.
  */
 void statsUpdateLoop() {
-  using namespace std::chrono_literals;
   auto &proc_core = qnx::ProcessCore::getInstance(); // Get ProcessCore instance
   auto &proc_hist =
       qnx::ProcessHistory::getInstance(); // Get ProcessHistory instance
   auto &proc_group =
       qnx::ProcessGroup::getInstance(); // Get ProcessGroup instance
+  auto &scheduler = qnx::SamplingScheduler::getInstance();
+  qnx::ProcessSnapshotPtr previous; // Last snapshot pushed to subscribers
+
+  while (true) {
+    qnx::SamplingPass pass = scheduler.waitForNextPass();
+    if (pass.kind == qnx::SamplingPass::Stop) {
+      break;
+    }
+    if (pass.kind != qnx::SamplingPass::Full) {
+      // History keeps the full collection's cadence
+      bool published;
+      if (pass.kind == qnx::SamplingPass::Fast) {
+        published = proc_core.refreshProcesses(pass.pids).has_value();
+      } else {
+        // Only publishes when processes were created or exited
+        published = proc_core.updateMembership().value_or(0) > 0;
+      }
+      if (published) {
+        publishToSubscribers(proc_core.getSnapshot(), previous);
+      }
+      continue;
+    }
 
-  while (running.load()) {
     // Collect fresh process info
     if (auto count_opt = proc_core.collectInfo()) {
-      // Update group statistics (uses qnx::exists and qnx::getProcessInfo
-      // internally)
+      // Pick up group totals summed while the snapshot was built
       proc_group.updateGroupStats();
 
-      // Update process history
-      const auto &process_list = proc_core.getProcessList();
-      for (const auto &pinfo : process_list) {
-        // Call addEntry with individual values
-        proc_hist.addEntry(pinfo.pid, pinfo.cpu_usage, pinfo.memory_usage);
+      // Keep a watched group's membership mirrored into thread sampling
+      auto sampling = proc_core.getThreadSampling();
+      if (sampling->enabled && sampling->watched_group != -1) {
+        auto members = proc_group.getProcessesInGroup(sampling->watched_group);
+        std::unordered_set<pid_t> watched = sampling->explicit_pids;
+        watched.insert(members.begin(), members.end());
+        if (watched != sampling->watched) {
+          qnx::ThreadSamplingConfig config = *sampling;
+          config.watched = std::move(watched);
+          proc_core.setThreadSampling(std::move(config));
+        }
       }
+
+      // Update process history from the snapshot just published
+      qnx::ProcessSnapshotPtr snapshot = proc_core.getSnapshot();
+      proc_hist.ingestSnapshot(*snapshot);
+      qnx::HistoryStore::getInstance().append(*snapshot);
+
+      // Push the new snapshot to subscribed clients
+      publishToSubscribers(snapshot, previous);
     } else {
       std::cerr << "Error collecting process info in stats loop." << std::endl;
     }
-
-    // Sleep for the update interval
-    std::this_thread::sleep_for(1s); // Use chrono literal
+    scheduler.completePass(pass);
   }
   std::cout << "Stats update loop exiting." << std::endl;
 }
 
+/**
+ * @brief Command line configuration for the server
+ */
+struct ServerOptions {
+  unsigned collector_threads = 0; ///< 0 = one per CPU
+  uint64_t collector_cpu_mask = 0; ///< 0 = unrestricted
+  unsigned handler_threads = 0; ///< 0 = one per CPU
+  std::string history_dir; ///< Empty = history is not persisted
+  unsigned history_retention_hours = 72;
+  unsigned sample_interval_ms = 1000; ///< Full collection, with subscribers
+  unsigned idle_interval_ms = 5000;   ///< Full collection, without
+  std::string process_source; ///< Empty = the platform's default
+  std::string proc_root = "/proc";
+  size_t replay_processes = 1000; ///< Table size of the replay source
+  int port = 8080;
+  std::vector<qnx::UpstreamTarget> upstreams; ///< Non-empty = gateway mode
+  std::string upstream_user;
+  unsigned upstream_interval_ms = 1000;
+};
+
+/**
+ * @brief Add the upstreams listed in a file, one "[name=]host[:port]" per
+ * line; blank lines and lines starting with '#' are skipped
+ *
+ * @return false if the file cannot be read or a line is malformed
+ */
+bool readUpstreamFile(const std::string &path,
+                      std::vector<qnx::UpstreamTarget> &upstreams) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Cannot read upstream file: " << path << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+    size_t end = line.find_last_not_of(" \t\r");
+    auto target = qnx::parseUpstreamTarget(
+        std::string_view(line).substr(begin, end - begin + 1));
+    if (!target) {
+      std::cerr << "Invalid upstream in " << path << ": " << line
+                << std::endl;
+      return false;
+    }
+    upstreams.push_back(std::move(*target));
+  }
+  return true;
+}
+
+/**
+ * @brief Print command line usage
+ */
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "  --collector-threads N   /proc collector workers "
+               "(default: one per CPU)\n"
+            << "  --collector-cpus MASK   CPU mask collector workers are "
+               "pinned to\n"
+            << "  --handler-threads N     request handler workers "
+               "(default: one per CPU)\n"
+            << "  --history-dir DIR       persist history in DIR\n"
+            << "  --history-retention H   hours of persisted history to "
+               "keep (default: 72)\n"
+            << "  --sample-interval MS    collection interval while clients "
+               "are subscribed (default: 1000)\n"
+            << "  --idle-interval MS      collection interval while none are "
+               "(default: 5000)\n"
+            << "  --process-source NAME   devctl, linux or replay (default: "
+            << qnx::defaultProcessSourceName() << ")\n"
+            << "  --proc-root DIR         /proc mount to read (default: "
+               "/proc)\n"
+            << "  --replay-processes N    processes the replay source "
+               "generates (default: 1000)\n"
+            << "  --port N                port to listen on (default: 8080)\n"
+            << "  --upstream SPEC         run as a gateway aggregating the "
+               "server at\n"
+            << "                          [name=]host[:port]; may be "
+               "repeated\n"
+            << "  --upstream-file FILE    read more upstreams from FILE, "
+               "one per line\n"
+            << "  --upstream-user NAME    account to log in to upstreams "
+               "with; the\n"
+            << "                          password is read from "
+               "RPM_UPSTREAM_PASSWORD\n"
+            << "  --upstream-interval MS  update interval asked of "
+               "upstreams (default: 1000)\n"
+            << "  --help                  Show this message" << std::endl;
+}
+
+/**
+ * @brief Parse an unsigned option value
+ *
+ * std::stoul() accepts a sign and wraps "-1" around to the largest value,
+ * which would e.g. ask for billions of worker threads.
+ *
+ * @throws std::invalid_argument if the value is negative or not a number
+ */
+unsigned long parseUnsigned(const std::string &text) {
+  if (text.find('-') != std::string::npos) {
+    throw std::invalid_argument("must not be negative");
+  }
+  return std::stoul(text);
+}
+
+/**
+ * @brief Parse command line arguments
+ *
+ * @return The parsed options, or std::nullopt if the server should not start
+ */
+std::optional<ServerOptions> parseArguments(int argc, char *argv[]) {
+  ServerOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    bool has_value = i + 1 < argc;
+    try {
+      if (arg == "--collector-threads" && has_value) {
+        unsigned long threads = parseUnsigned(argv[++i]);
+        if (threads > qnx::ProcessCore::MAX_COLLECTOR_THREADS) {
+          std::cerr << "At most " << qnx::ProcessCore::MAX_COLLECTOR_THREADS
+                    << " collector threads are supported" << std::endl;
+          return std::nullopt;
+        }
+        options.collector_threads = static_cast<unsigned>(threads);
+      } else if (arg == "--collector-cpus" && has_value) {
+        std::string mask(argv[++i]);
+        if (mask.find('-') != std::string::npos) {
+          throw std::invalid_argument("must not be negative");
+        }
+        options.collector_cpu_mask = std::stoull(mask, nullptr, 0);
+      } else if (arg == "--handler-threads" && has_value) {
+        options.handler_threads = parseUnsigned(argv[++i]);
+      } else if (arg == "--history-dir" && has_value) {
+        options.history_dir = argv[++i];
+      } else if (arg == "--history-retention" && has_value) {
+        options.history_retention_hours = parseUnsigned(argv[++i]);
+      } else if (arg == "--sample-interval" && has_value) {
+        options.sample_interval_ms = parseUnsigned(argv[++i]);
+      } else if (arg == "--idle-interval" && has_value) {
+        options.idle_interval_ms = parseUnsigned(argv[++i]);
+      } else if (arg == "--process-source" && has_value) {
+        options.process_source = argv[++i];
+      } else if (arg == "--proc-root" && has_value) {
+        options.proc_root = argv[++i];
+      } else if (arg == "--replay-processes" && has_value) {
+        options.replay_processes = parseUnsigned(argv[++i]);
+      } else if (arg == "--port" && has_value) {
+        options.port = std::stoi(argv[++i]);
+      } else if (arg == "--upstream" && has_value) {
+        auto target = qnx::parseUpstreamTarget(argv[++i]);
+        if (!target) {
+          std::cerr << "Invalid upstream: " << argv[i] << std::endl;
+          return std::nullopt;
+        }
+        options.upstreams.push_back(std::move(*target));
+      } else if (arg == "--upstream-file" && has_value) {
+        if (!readUpstreamFile(argv[++i], options.upstreams)) {
+          return std::nullopt;
+        }
+      } else if (arg == "--upstream-user" && has_value) {
+        options.upstream_user = argv[++i];
+      } else if (arg == "--upstream-interval" && has_value) {
+        options.upstream_interval_ms = parseUnsigned(argv[++i]);
+      } else if (arg == "--help") {
+        printUsage(argv[0]);
+        return std::nullopt;
+      } else {
+        std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+        printUsage(argv[0]);
+        return std::nullopt;
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Invalid value for " << arg << ": " << e.what()
+                << std::endl;
+      return std::nullopt;
+    }
+  }
+  if (!options.upstreams.empty() && options.upstream_user.empty()) {
+    std::cerr << "Gateway mode requires --upstream-user" << std::endl;
+    return std::nullopt;
+  }
+  return options;
+}
+
 /**
  * @brief Main entry point for the application
  */
 int main(int argc, char *argv[]) {
+  auto options_opt = parseArguments(argc, argv);
+  if (!options_opt) {
+    return 1;
+  }
+  const ServerOptions &options = *options_opt;
+
   std::cout << "QNX Remote Process Monitor Server Starting..." << std::endl;
 
   // Setup signal handling
   signal(SIGINT, signalHandler);
   signal(SIGTERM, signalHandler);
 
-  // Singletons auto-initialize upon first access (no manual init() needed)
+  // A gateway serves the fleet view of its upstreams instead of its own host
+  std::thread stats_thread;
+  if (!options.upstreams.empty()) {
+    qnx::GatewayConfig config;
+    config.upstreams = options.upstreams;
+    config.username = options.upstream_user;
+    if (const char *password = std::getenv("RPM_UPSTREAM_PASSWORD")) {
+      config.password = password;
+    }
+    config.interval = std::chrono::milliseconds(options.upstream_interval_ms);
+    if (!qnx::FleetGateway::getInstance().start(std::move(config))) {
+      return 1;
+    }
+  } else {
+    // Singletons auto-initialize upon first access (no manual init() needed)
+    auto &proc_core = qnx::ProcessCore::getInstance();
+    std::string source_name = options.process_source.empty()
+                                  ? qnx::defaultProcessSourceName()
+                                  : options.process_source;
+    std::unique_ptr<qnx::ProcessSource> source;
+    if (source_name == "replay") {
+      qnx::ReplayProcessSource::Workload workload;
+      workload.processes = options.replay_processes;
+      source = std::make_unique<qnx::ReplayProcessSource>(workload);
+    } else {
+      source = qnx::createProcessSource(source_name, options.proc_root);
+    }
+    if (!source) {
+      std::cerr << "Unknown process source: " << source_name << std::endl;
+      return 1;
+    }
+    proc_core.setProcessSource(std::move(source));
+    proc_core.setCollectorThreads(options.collector_threads);
+    if (!proc_core.setCollectorAffinity(options.collector_cpu_mask)) {
+      std::cerr << "Collector CPU mask names CPUs this system does not have"
+                << std::endl;
+      return 1;
+    }
+
+    // Map the persisted history before the stats loop starts appending to it
+    if (!options.history_dir.empty()) {
+      if (!qnx::HistoryStore::getInstance().open(
+              options.history_dir,
+              std::chrono::hours(options.history_retention_hours))) {
+        return 1;
+      }
+    }
+
+    // Start the background statistics update thread
+    qnx::SamplingScheduler::getInstance().setIntervals(
+        std::chrono::milliseconds(options.sample_interval_ms),
+        std::chrono::milliseconds(options.idle_interval_ms));
+    stats_thread = std::thread(statsUpdateLoop);
+
+    // Without lifecycle events, membership changes wait for a full collection
+    qnx::ProcessEvents::getInstance().start();
+  }
+
+  // Requests run on the handler pool instead of the network thread
+  qnx::HandlerPool::getInstance().start(options.handler_threads);
 
-  // Start the background statistics update thread
-  std::thread stats_thread(statsUpdateLoop);
+  // Drop a client's subscriptions and session as soon as it disconnects
+  qnx::SocketServer::getInstance().setDisconnectHandler([](int client_socket) {
+    qnx::SubscriptionManager::getInstance().removeClient(client_socket);
+    qnx::SessionManager::getInstance().removeClient(client_socket);
+  });
 
   // Initialize and start the socket server (using updated namespace and
   // handler)
-  if (!qnx::SocketServer::getInstance().init(8080, qnx::handleMessage)) {
+  if (!qnx::SocketServer::getInstance().init(options.port,
+                                             qnx::handleMessage)) {
     std::cerr << "Failed to initialize socket server. Exiting." << std::endl;
     running = false; // Signal stats thread to stop
+    qnx::ProcessEvents::getInstance().stop();
+    qnx::SamplingScheduler::getInstance().stop();
+    qnx::HandlerPool::getInstance().stop();
+    qnx::FleetGateway::getInstance().stop();
     if (stats_thread.joinable())
       stats_thread.join();
     // Singletons auto-cleanup on program exit (no manual shutdown())
@@ -119,13 +445,19 @@ int main(int argc, char *argv[]) {
 
   std::cout << "Shutting down server..." << std::endl;
 
-  // Perform clean shutdown (using updated namespaces)
+  // Perform clean shutdown (using updated namespaces). Handlers finish first
+  // so none of them touches the server while it is torn down.
+  qnx::HandlerPool::getInstance().stop();
   qnx::SocketServer::getInstance().shutdown();
 
-  // Wait for the stats update thread to finish (ensure running is false)
+  // Wake the stats update thread and wait for it to finish
+  qnx::FleetGateway::getInstance().stop();
+  qnx::ProcessEvents::getInstance().stop();
+  qnx::SamplingScheduler::getInstance().stop();
   if (stats_thread.joinable()) {
     stats_thread.join();
   }
+  qnx::HistoryStore::getInstance().close();
 
   // Singletons auto-cleanup on program exit (no manual shutdown())
 
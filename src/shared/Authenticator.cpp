@@ -18,8 +18,11 @@
 #include <fcntl.h> // For O_RDONLY
 #include <fstream>
 #include <iostream> // Added for cerr
+#include <mutex>
 #include <string_view>
+#include <system_error>
 #include <unistd.h>
+#include <unordered_map>
 
 // Forward declaration for crypt
 extern "C" char *crypt(const char *key, const char *salt);
@@ -81,33 +84,41 @@ std::optional<UserEntry> UserEntry::FromString(std::string_view line) {
   return result;
 }
 
+namespace {
 /**
- * @brief Validate a user's login credentials
+ * @brief Parsed contents of the login file and the version they came from
+ */
+struct LoginFileCache {
+  std::mutex mutex;
+  bool loaded = false;
+  std::filesystem::file_time_type mtime;
+  std::uintmax_t size = 0;
+  std::unordered_map<std::string, UserEntry> users;
+};
+
+LoginFileCache &loginFileCache() {
+  static LoginFileCache cache;
+  return cache;
+}
+
+/**
+ * @brief Parse the login file into the cache
  *
- * Opens the login file and compares the provided username and password
- * against stored entries. The password is hashed with the stored salt
- * before comparison.
+ * Lines that are empty, comments or malformed are skipped. If a username
+ * appears twice, the first entry wins, as it did when the file was scanned
+ * on every login.
  *
- * @param username The username to validate
- * @param password The password to validate
- * @return true if credentials match an entry, false otherwise
+ * @param cache The cache to fill; its mutex must be held
+ * @return true if the file could be read
  */
-std::optional<UserType> ValidateLogin(std::string_view username,
-                                      std::string_view password) {
-  // Check if the login file exists
-  if (!std::filesystem::exists(LOGIN_FILE)) {
-    std::cerr << "Login file not found: " << LOGIN_FILE << std::endl;
-    return {};
-  }
-
-  // Open the login file
+bool loadLoginFile(LoginFileCache &cache) {
   std::ifstream fstream(LOGIN_FILE);
   if (!fstream) {
     std::cerr << "Failed to open login file: " << LOGIN_FILE << std::endl;
-    return {};
+    return false;
   }
 
-  // Check each line in the file for matching credentials
+  cache.users.clear();
   std::string line;
   while (std::getline(fstream, line)) {
     // Skip empty lines or lines starting with # (comments)
@@ -121,22 +132,75 @@ std::optional<UserType> ValidateLogin(std::string_view username,
                 << std::endl;
       continue;
     }
+    std::string username = user_entry->username;
+    cache.users.emplace(std::move(username), std::move(*user_entry));
+  }
+  return true;
+}
+} // namespace
 
-    // Only compare if usernames match
-    if (user_entry->username != username) {
-      continue;
-    }
+/**
+ * @brief Look up a user's entry in the login file
+ *
+ * Stats the file on every call and reparses it when its modification time
+ * or size has changed since it was last read, so edits take effect on the
+ * next login without a restart.
+ *
+ * @param username The username to look up
+ * @return The user's entry, or std::nullopt if there is none
+ */
+std::optional<UserEntry> FindUser(std::string_view username) {
+  LoginFileCache &cache = loginFileCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
 
-    // Generate hash from provided password and compare to stored hash
-    auto generated_hash_opt = generate_hash(password, user_entry->salt);
-    if (generated_hash_opt && *generated_hash_opt == user_entry->hash) {
-      // Found matching user and password: return their type
-      return user_entry->type;
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(LOGIN_FILE, ec);
+  std::uintmax_t size = ec ? 0 : std::filesystem::file_size(LOGIN_FILE, ec);
+  if (ec) {
+    std::cerr << "Login file not found: " << LOGIN_FILE << std::endl;
+    cache.loaded = false;
+    cache.users.clear();
+    return {};
+  }
+  if (!cache.loaded || mtime != cache.mtime || size != cache.size) {
+    cache.loaded = loadLoginFile(cache);
+    cache.mtime = mtime;
+    cache.size = size;
+    if (!cache.loaded) {
+      cache.users.clear();
+      return {};
     }
-    // Username matched but password didn't: authentication fails
+  }
+
+  auto it = cache.users.find(std::string(username));
+  if (it == cache.users.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+/**
+ * @brief Validate a user's login credentials
+ *
+ * Looks the user up in the cached login file and compares the provided
+ * password, hashed with the stored salt, against the stored hash.
+ *
+ * @param username The username to validate
+ * @param password The password to validate
+ * @return The user's type if the credentials match, std::nullopt otherwise
+ */
+std::optional<UserType> ValidateLogin(std::string_view username,
+                                      std::string_view password) {
+  auto user_entry = FindUser(username);
+  if (!user_entry) {
     return {};
   }
-  // Username not found in file
+
+  // Generate hash from provided password and compare to stored hash
+  auto generated_hash_opt = generate_hash(password, user_entry->salt);
+  if (generated_hash_opt && *generated_hash_opt == user_entry->hash) {
+    return user_entry->type;
+  }
   return {};
 }
 
@@ -158,6 +222,11 @@ std::optional<std::string> generate_hash(std::string_view password,
   std::string pwd_str(password);
   std::string salt_str(salt);
 
+  // crypt() returns a static buffer; logins may run on several handler
+  // threads at once
+  static std::mutex crypt_mutex;
+  std::lock_guard<std::mutex> lock(crypt_mutex);
+
   // Use crypt function from liblogin
   char *result = crypt(pwd_str.c_str(), salt_str.c_str());
   if (result == nullptr) {